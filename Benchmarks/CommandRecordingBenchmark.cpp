@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// commandrecordingbenchmark.cpp
+// ============
+// headless benchmark for render-command recording - culls and records a
+// synthetic scene with 1 to N threads and times the record and merge stages
+//
+//  usage: CommandRecordingBenchmark [objectCount] [iterations]
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CommandRecorder.h"
+#include "JobSystem.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	struct Object
+	{
+		glm::mat4 model;
+		glm::vec3 center;
+		float radius;
+		uint32_t textureID;
+		MeshType mesh;
+	};
+
+	double ElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const uint32_t objectCount = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 200000u;
+	const int iterations = (argc > 2) ? std::atoi(argv[2]) : 20;
+
+	// scatter objects around the camera, about half inside the frustum
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+	std::uniform_int_distribution<int> texture(0, 15);
+	std::uniform_int_distribution<int> mesh(0, static_cast<int>(MeshType::Count) - 1);
+	std::vector<Object> objects(objectCount);
+	for (Object& object : objects)
+	{
+		object.center = glm::vec3(position(random), position(random) * 0.2f, position(random));
+		object.model = glm::translate(object.center);
+		object.radius = 1.0f;
+		object.textureID = static_cast<uint32_t>(texture(random));
+		object.mesh = static_cast<MeshType>(mesh(random));
+	}
+
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 5.0f, 12.0f),
+		glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 projection = glm::perspective(glm::radians(80.0f), 1.25f, 0.1f, 100.0f);
+	const Frustum frustum = Frustum::FromMatrix(projection * view);
+
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0)
+	{
+		maxThreads = 1;
+	}
+
+	std::printf("objects=%u iterations=%d\n", objectCount, iterations);
+	std::printf("%8s %10s %12s %12s %12s\n", "threads", "visible", "record ms", "merge ms", "total ms");
+
+	std::vector<RenderCommand> commands;
+	for (unsigned threads = 1; threads <= maxThreads; ++threads)
+	{
+		JobSystem jobs(static_cast<int>(threads) - 1);
+		CommandRecorder recorder(&jobs);
+
+		double recordMs = 0.0;
+		double mergeMs = 0.0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			recorder.Record(objectCount, [&](uint32_t index, CommandBuffer& buffer)
+			{
+				const Object& object = objects[index];
+				if (!frustum.IntersectsSphere(object.center, object.radius))
+				{
+					return;
+				}
+
+				RenderCommand command;
+				command.item.model = object.model;
+				command.item.color = glm::vec4(1.0f);
+				command.item.uvScale = glm::vec2(1.0f);
+				command.item.textureID = object.textureID;
+				command.item.objectIndex = index;
+				command.item.mesh = object.mesh;
+				command.item.bUseTexture = (object.textureID != 0);
+				const float depth = -(view * glm::vec4(object.center, 1.0f)).z;
+				command.sortKey = MakeSortKey(command.item, depth, 100.0f);
+				buffer.Push(command);
+			});
+			recordMs += ElapsedMs(start);
+
+			start = std::chrono::steady_clock::now();
+			recorder.Merge(commands);
+			mergeMs += ElapsedMs(start);
+		}
+
+		for (size_t n = 1; n < commands.size(); ++n)
+		{
+			if (commands[n - 1].sortKey > commands[n].sortKey)
+			{
+				std::fprintf(stderr, "merge produced an unsorted list\n");
+				return EXIT_FAILURE;
+			}
+		}
+
+		std::printf("%8u %10zu %12.3f %12.3f %12.3f\n", threads, commands.size(),
+			recordMs / iterations, mergeMs / iterations, (recordMs + mergeMs) / iterations);
+	}
+
+	return EXIT_SUCCESS;
+}
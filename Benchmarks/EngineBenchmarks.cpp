@@ -0,0 +1,663 @@
+///////////////////////////////////////////////////////////////////////////////
+// enginebenchmarks.cpp
+// ============
+// Google Benchmark suite for the CPU hot paths - model matrix composition,
+// texture and material lookups, tag interning, database inserts, texture
+// decode, mesh generation, frame arena and object pool allocation. Needs no GPU or window; see
+// CMakeLists.txt in this folder
+//
+//  usage: EngineBenchmarks [--benchmark_filter=regex] [--benchmark_out=file]
+//
+// results are written to EngineBenchmarks.json unless --benchmark_out is given
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneLookup.h"
+#include "MeshGeometry.h"
+#include "DBHelper.h"
+#include "FrameArena.h"
+#include "ObjectPool.h"
+#include "StringInterner.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef ENGINE_TEXTURE_DIR
+#define ENGINE_TEXTURE_DIR "textures"
+#endif
+
+// declaration of global variables
+namespace
+{
+	const char* g_DefaultOutput = "--benchmark_out=EngineBenchmarks.json";
+	const char* g_DefaultFormat = "--benchmark_out_format=json";
+	const char* g_Textures[] =
+	{
+		"wood_seamless.jpeg",
+		"grey_mouse_body.jpeg",
+		"dark_mouse_buttons.jpeg"
+	};
+
+	struct Transform
+	{
+		glm::vec3 scale;
+		glm::vec3 rotation;
+		glm::vec3 position;
+	};
+
+	std::vector<Transform> MakeTransforms(size_t count)
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Transform> transforms(count);
+		for (Transform& t : transforms)
+		{
+			t.scale = glm::vec3(0.5f + unit(rng), 0.5f + unit(rng), 0.5f + unit(rng));
+			t.rotation = 360.0f * glm::vec3(unit(rng), unit(rng), unit(rng));
+			t.position = 100.0f * glm::vec3(unit(rng), unit(rng), unit(rng)) - glm::vec3(50.0f);
+		}
+		return transforms;
+	}
+
+	// tags shaped like the scene's own ("wood", "mouseBody", ...)
+	std::string MakeTag(int index)
+	{
+		return "sceneTag" + std::to_string(index);
+	}
+
+	// tag indices at random positions, the same for every variant
+	std::vector<int> MakeQueries(int tagCount, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<int> queries(256);
+		for (int& query : queries)
+		{
+			query = static_cast<int>(rng() % tagCount);
+		}
+		return queries;
+	}
+
+	// the lookup FindTextureSlot() did before tags were interned
+	int FindTagString(const std::vector<std::string>& tags, const std::string& tag)
+	{
+		for (size_t index = 0; index < tags.size(); index++)
+		{
+			if (tags[index].compare(tag) == 0)
+			{
+				return static_cast<int>(index);
+			}
+		}
+		return -1;
+	}
+
+	// laid out like SceneManager's scene objects
+	struct PooledObject
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+		uint32_t textureID;
+	};
+
+	PooledObject MakePooledObject(uint32_t index)
+	{
+		PooledObject object;
+		object.model = glm::mat4(1.0f);
+		object.color = glm::vec4(1.0f);
+		object.boundsCenter = glm::vec3(static_cast<float>(index));
+		object.boundsRadius = 1.0f + static_cast<float>(index & 7);
+		object.textureID = index;
+		return object;
+	}
+
+	bool ReadBinaryFile(const std::string& path, std::vector<unsigned char>& contents)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !contents.empty();
+	}
+}
+
+/***********************************************************
+ *  Model matrix composition, as done by SetTransformations()
+ *  for every draw and by MakeSceneObject() for every object.
+ ***********************************************************/
+static void BM_ComposeModelMatrix(benchmark::State& state)
+{
+	const std::vector<Transform> transforms = MakeTransforms(1024);
+	size_t index = 0;
+	for (auto _ : state)
+	{
+		const Transform& t = transforms[index++ & 1023];
+		glm::mat4 model = ComposeModelMatrix(t.scale, t.rotation.x, t.rotation.y,
+			t.rotation.z, t.position);
+		benchmark::DoNotOptimize(model);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ComposeModelMatrix);
+
+/***********************************************************
+ *  Texture slot lookup by tag over the 16 slots SceneManager
+ *  keeps, searching for a tag at a random position. The
+ *  String variant is the std::string search it replaced.
+ ***********************************************************/
+static void BM_FindTextureSlot(benchmark::State& state)
+{
+	const int slotCount = static_cast<int>(state.range(0));
+	std::vector<TextureSlot> slots(slotCount);
+	std::vector<StringId> queries;
+	for (int i = 0; i < slotCount; ++i)
+	{
+		slots[i].tag = StringInterner::Intern(MakeTag(i));
+		slots[i].ID = i + 1;
+	}
+	for (int query : MakeQueries(slotCount, 11))
+	{
+		queries.push_back(slots[query].tag);
+	}
+
+	size_t index = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(FindTextureSlot(slots.data(), slotCount, queries[index++ & 255]));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindTextureSlot)->Arg(4)->Arg(16);
+
+static void BM_FindTextureSlotString(benchmark::State& state)
+{
+	const int slotCount = static_cast<int>(state.range(0));
+	std::vector<std::string> tags;
+	std::vector<std::string> queries;
+	for (int i = 0; i < slotCount; ++i)
+	{
+		tags.push_back(MakeTag(i));
+	}
+	for (int query : MakeQueries(slotCount, 11))
+	{
+		queries.push_back(MakeTag(query));
+	}
+
+	size_t index = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(FindTagString(tags, queries[index++ & 255]));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindTextureSlotString)->Arg(4)->Arg(16);
+
+/***********************************************************
+ *  Material lookup by tag, for the scene's handful of
+ *  materials and for a larger generated set.
+ ***********************************************************/
+static void BM_FindMaterial(benchmark::State& state)
+{
+	const int materialCount = static_cast<int>(state.range(0));
+	std::vector<ObjectMaterial> materials(materialCount);
+	std::vector<StringId> queries;
+	for (int i = 0; i < materialCount; ++i)
+	{
+		materials[i].diffuseColor = glm::vec3(0.5f);
+		materials[i].specularColor = glm::vec3(0.2f);
+		materials[i].shininess = 8.0f;
+		materials[i].tag = StringInterner::Intern(MakeTag(i));
+	}
+	for (int query : MakeQueries(materialCount, 13))
+	{
+		queries.push_back(materials[query].tag);
+	}
+
+	ObjectMaterial material;
+	size_t index = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(FindMaterial(materials, queries[index++ & 255], material));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindMaterial)->Arg(8)->Arg(64);
+
+/***********************************************************
+ *  Texture ID by tag: the std::unordered_map keyed by string
+ *  that SceneManager used, against the flat list of IDs it
+ *  keeps now.
+ ***********************************************************/
+static void BM_TextureMapString(benchmark::State& state)
+{
+	const int textureCount = static_cast<int>(state.range(0));
+	std::unordered_map<std::string, uint32_t> textures;
+	std::vector<std::string> queries;
+	for (int i = 0; i < textureCount; ++i)
+	{
+		textures[MakeTag(i)] = i + 1;
+	}
+	for (int query : MakeQueries(textureCount, 17))
+	{
+		queries.push_back(MakeTag(query));
+	}
+
+	size_t index = 0;
+	for (auto _ : state)
+	{
+		auto it = textures.find(queries[index++ & 255]);
+		benchmark::DoNotOptimize((it != textures.end()) ? it->second : 0u);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TextureMapString)->Arg(4)->Arg(16);
+
+static void BM_TextureTableId(benchmark::State& state)
+{
+	const int textureCount = static_cast<int>(state.range(0));
+	std::vector<TextureSlot> textures(textureCount);
+	std::vector<StringId> queries;
+	for (int i = 0; i < textureCount; ++i)
+	{
+		textures[i].tag = StringInterner::Intern(MakeTag(i));
+		textures[i].ID = i + 1;
+	}
+	for (int query : MakeQueries(textureCount, 17))
+	{
+		queries.push_back(textures[query].tag);
+	}
+
+	size_t index = 0;
+	for (auto _ : state)
+	{
+		const StringId tag = queries[index++ & 255];
+		uint32_t ID = 0;
+		for (const TextureSlot& texture : textures)
+		{
+			if (texture.tag == tag)
+			{
+				ID = texture.ID;
+				break;
+			}
+		}
+		benchmark::DoNotOptimize(ID);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TextureTableId)->Arg(4)->Arg(16);
+
+/***********************************************************
+ *  Cost of turning a tag into an ID at run time: hashing
+ *  alone, and interning a tag that is already in the table
+ *  as loaders do. Literals cost nothing, "wood"_sid folds
+ *  to a constant.
+ ***********************************************************/
+static void BM_HashString(benchmark::State& state)
+{
+	std::vector<std::string> tags;
+	for (int i = 0; i < 256; ++i)
+	{
+		tags.push_back(MakeTag(i));
+	}
+
+	size_t index = 0;
+	for (auto _ : state)
+	{
+		const std::string& tag = tags[index++ & 255];
+		benchmark::DoNotOptimize(HashString(tag.data(), tag.size()));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HashString);
+
+static void BM_InternString(benchmark::State& state)
+{
+	std::vector<std::string> tags;
+	for (int i = 0; i < 256; ++i)
+	{
+		tags.push_back(MakeTag(i));
+		StringInterner::Intern(tags.back());
+	}
+
+	size_t index = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(StringInterner::Intern(tags[index++ & 255]));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InternString);
+
+/***********************************************************
+ *  Database inserts made by the telemetry, pacing and error
+ *  paths. Range 0 uses an in-memory database to isolate the
+ *  statement cost, range 1 a file like the renderer does so
+ *  the journal sync is included.
+ ***********************************************************/
+static void BM_DbLogTelemetry(benchmark::State& state)
+{
+	const bool bOnDisk = (state.range(0) != 0);
+	const char* dbPath = bOnDisk ? "EngineBenchmarks.db" : ":memory:";
+	std::remove("EngineBenchmarks.db");
+	{
+		DbHelper db(dbPath);
+		if (!db.isOpen())
+		{
+			state.SkipWithError("cannot open database");
+			return;
+		}
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(db.logTelemetry(60.0, 16.6));
+		}
+	}
+	std::remove("EngineBenchmarks.db");
+	state.SetItemsProcessed(state.iterations());
+	state.SetLabel(bOnDisk ? "file" : "memory");
+}
+BENCHMARK(BM_DbLogTelemetry)->Arg(0)->Arg(1);
+
+static void BM_DbLogFramePacing(benchmark::State& state)
+{
+	DbHelper db(":memory:");
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(db.logFramePacing(16.6, 0.4, 17.9, 18.3, 1, 60.0));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DbLogFramePacing);
+
+static void BM_DbLogError(benchmark::State& state)
+{
+	// the message is quoted into the statement, so include a quote
+	DbHelper db(":memory:");
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(db.logError("EngineBenchmarks", "texture 'wood' not found"));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DbLogError);
+
+/***********************************************************
+ *  stb_image decode of the scene textures from memory, so
+ *  disk reads are not part of the timing. The counters give
+ *  the decoded megapixels per second.
+ ***********************************************************/
+static void BM_DecodeTexture(benchmark::State& state)
+{
+	const std::string path = std::string(ENGINE_TEXTURE_DIR) + "/" + g_Textures[state.range(0)];
+	std::vector<unsigned char> encoded;
+	if (!ReadBinaryFile(path, encoded))
+	{
+		state.SkipWithError(("cannot read " + path).c_str());
+		return;
+	}
+
+	int width = 0;
+	int height = 0;
+	for (auto _ : state)
+	{
+		int channels = 0;
+		stbi_uc* pixels = stbi_load_from_memory(encoded.data(), static_cast<int>(encoded.size()),
+			&width, &height, &channels, 0);
+		if (pixels == nullptr)
+		{
+			state.SkipWithError(stbi_failure_reason());
+			break;
+		}
+		benchmark::DoNotOptimize(pixels);
+		stbi_image_free(pixels);
+	}
+	state.SetLabel(g_Textures[state.range(0)]);
+	state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(encoded.size()));
+	state.counters["Mpixels/s"] = benchmark::Counter(
+		static_cast<double>(width) * height * 1e-6, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_DecodeTexture)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+/***********************************************************
+ *  CPU mesh generation of every basic shape at a coarse and
+ *  a fine tessellation; the geometry is reused so only the
+ *  first iteration allocates.
+ ***********************************************************/
+static void BM_GenerateMesh(benchmark::State& state)
+{
+	const MeshType mesh = static_cast<MeshType>(state.range(0));
+	const uint32_t segments = static_cast<uint32_t>(state.range(1));
+	MeshGeometry geometry;
+	for (auto _ : state)
+	{
+		GenerateMeshGeometry(mesh, segments, geometry);
+		benchmark::DoNotOptimize(geometry.vertices.data());
+	}
+	state.counters["vertices"] = static_cast<double>(geometry.vertices.size());
+	state.counters["triangles"] = static_cast<double>(geometry.indices.size() / 3);
+}
+BENCHMARK(BM_GenerateMesh)
+	->ArgsProduct({ benchmark::CreateDenseRange(0, static_cast<int>(MeshType::Count) - 1, 1), { 16, 128 } })
+	->ArgNames({ "mesh", "segments" });
+
+/***********************************************************
+ *  Uniform name formatting as UploadLights() does it, in
+ *  the frame arena against building heap strings.
+ ***********************************************************/
+static void BM_FormatNameFrameArena(benchmark::State& state)
+{
+	FrameArena arena;
+	unsigned light = 0;
+	for (auto _ : state)
+	{
+		// a frame's worth of names between resets
+		if ((light & 255) == 0)
+		{
+			arena.BeginFrame();
+		}
+		benchmark::DoNotOptimize(arena.Format("pointLights[%u].%s", light++ % 5, "position"));
+	}
+	state.SetItemsProcessed(state.iterations());
+	state.counters["overflows"] = static_cast<double>(arena.GetStats().totalOverflows);
+}
+BENCHMARK(BM_FormatNameFrameArena);
+
+static void BM_FormatNameHeap(benchmark::State& state)
+{
+	unsigned light = 0;
+	for (auto _ : state)
+	{
+		std::string name = "pointLights[" + std::to_string(light++ % 5) + "]." + "position";
+		benchmark::DoNotOptimize(name.data());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatNameHeap);
+
+/***********************************************************
+ *  A short-lived per-frame table, such as the merge runs of
+ *  CommandRecorder, from the arena and from the heap.
+ ***********************************************************/
+static void BM_FrameVectorArena(benchmark::State& state)
+{
+	FrameArena arena;
+	const size_t count = static_cast<size_t>(state.range(0));
+	for (auto _ : state)
+	{
+		arena.BeginFrame();
+		FrameVector<size_t> runs{ FrameAllocator<size_t>(&arena) };
+		runs.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			runs.push_back(i);
+		}
+		benchmark::DoNotOptimize(runs.data());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameVectorArena)->Arg(16)->Arg(1024);
+
+static void BM_FrameVectorHeap(benchmark::State& state)
+{
+	const size_t count = static_cast<size_t>(state.range(0));
+	for (auto _ : state)
+	{
+		std::vector<size_t> runs;
+		runs.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			runs.push_back(i);
+		}
+		benchmark::DoNotOptimize(runs.data());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameVectorHeap)->Arg(16)->Arg(1024);
+
+/***********************************************************
+ *  Scene churn with a fixed number of live objects: every
+ *  iteration removes a random object and adds a new one,
+ *  through the object pool and through one heap block per
+ *  object. The Iterate pair then walks the live objects
+ *  after the same churn, as culling does every frame.
+ ***********************************************************/
+static void BM_ObjectPoolChurn(benchmark::State& state)
+{
+	const uint32_t liveCount = static_cast<uint32_t>(state.range(0));
+	ObjectPool<PooledObject> pool;
+	std::vector<PoolHandle> handles;
+	for (uint32_t i = 0; i < liveCount; ++i)
+	{
+		handles.push_back(pool.Create(MakePooledObject(i)));
+	}
+
+	std::mt19937 rng(19);
+	uint32_t next = liveCount;
+	for (auto _ : state)
+	{
+		PoolHandle& handle = handles[rng() % liveCount];
+		pool.Destroy(handle);
+		handle = pool.Create(MakePooledObject(next++));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ObjectPoolChurn)->Arg(1024)->Arg(65536);
+
+static void BM_HeapChurn(benchmark::State& state)
+{
+	const uint32_t liveCount = static_cast<uint32_t>(state.range(0));
+	std::vector<std::unique_ptr<PooledObject>> objects;
+	for (uint32_t i = 0; i < liveCount; ++i)
+	{
+		objects.push_back(std::make_unique<PooledObject>(MakePooledObject(i)));
+	}
+
+	std::mt19937 rng(19);
+	uint32_t next = liveCount;
+	for (auto _ : state)
+	{
+		std::unique_ptr<PooledObject>& object = objects[rng() % liveCount];
+		object.reset();
+		object = std::make_unique<PooledObject>(MakePooledObject(next++));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HeapChurn)->Arg(1024)->Arg(65536);
+
+static void BM_ObjectPoolIterate(benchmark::State& state)
+{
+	const uint32_t liveCount = static_cast<uint32_t>(state.range(0));
+	ObjectPool<PooledObject> pool;
+	std::vector<PoolHandle> handles;
+	for (uint32_t i = 0; i < liveCount; ++i)
+	{
+		handles.push_back(pool.Create(MakePooledObject(i)));
+	}
+	std::mt19937 rng(23);
+	for (uint32_t i = 0; i < liveCount * 4; ++i)
+	{
+		PoolHandle& handle = handles[rng() % liveCount];
+		pool.Destroy(handle);
+		handle = pool.Create(MakePooledObject(liveCount + i));
+	}
+
+	for (auto _ : state)
+	{
+		float radius = 0.0f;
+		for (const PooledObject& object : pool)
+		{
+			radius += object.boundsRadius;
+		}
+		benchmark::DoNotOptimize(radius);
+	}
+	state.SetItemsProcessed(state.iterations() * liveCount);
+}
+BENCHMARK(BM_ObjectPoolIterate)->Arg(65536);
+
+static void BM_HeapIterate(benchmark::State& state)
+{
+	const uint32_t liveCount = static_cast<uint32_t>(state.range(0));
+	std::vector<std::unique_ptr<PooledObject>> objects;
+	for (uint32_t i = 0; i < liveCount; ++i)
+	{
+		objects.push_back(std::make_unique<PooledObject>(MakePooledObject(i)));
+	}
+	std::mt19937 rng(23);
+	for (uint32_t i = 0; i < liveCount * 4; ++i)
+	{
+		std::unique_ptr<PooledObject>& object = objects[rng() % liveCount];
+		object.reset();
+		object = std::make_unique<PooledObject>(MakePooledObject(liveCount + i));
+	}
+
+	for (auto _ : state)
+	{
+		float radius = 0.0f;
+		for (const std::unique_ptr<PooledObject>& object : objects)
+		{
+			radius += object->boundsRadius;
+		}
+		benchmark::DoNotOptimize(radius);
+	}
+	state.SetItemsProcessed(state.iterations() * liveCount);
+}
+BENCHMARK(BM_HeapIterate)->Arg(65536);
+
+int main(int argc, char** argv)
+{
+	// default to JSON output so every run can be tracked
+	std::vector<char*> args(argv, argv + argc);
+	bool bHasOutput = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		bHasOutput = bHasOutput || (std::strncmp(argv[i], "--benchmark_out=", 16) == 0);
+	}
+	if (!bHasOutput)
+	{
+		args.push_back(const_cast<char*>(g_DefaultOutput));
+		args.push_back(const_cast<char*>(g_DefaultFormat));
+	}
+	int count = static_cast<int>(args.size());
+	args.push_back(nullptr);
+
+	benchmark::Initialize(&count, args.data());
+	if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+	{
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
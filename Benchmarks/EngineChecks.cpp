@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////////////
+// enginechecks.cpp
+// ============
+// headless correctness checks for the GL-free engine sources - every check
+// prints its result and the process exits non-zero when any of them fails
+//
+//  usage: EngineChecks
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+#include "MipResidency.h"
+#include "ObjectPool.h"
+#include "OcclusionCulling.h"
+#include "PerfCompare.h"
+#include "SceneLookup.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// declaration of global variables
+namespace
+{
+	int g_Failures = 0;
+
+	void Check(bool bPassed, const char* name)
+	{
+		std::printf("%s  %s\n", bPassed ? "pass" : "FAIL", name);
+		if (!bPassed)
+		{
+			g_Failures++;
+		}
+	}
+
+	// more chunks than a deque holds, so Run must fall back to running
+	// jobs inline while earlier ones are still queued
+	void CheckJobSystemOverflow()
+	{
+		const uint32_t count = 20000;
+		const uint64_t expected = static_cast<uint64_t>(count) * (count - 1) / 2;
+
+		bool bAllEqual = true;
+		for (int run = 0; run < 10; ++run)
+		{
+			JobSystem jobs(3);
+			std::atomic<uint64_t> sum{ 0 };
+			jobs.ParallelFor(count, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					sum.fetch_add(i, std::memory_order_relaxed);
+				}
+			});
+			bAllEqual = bAllEqual && (sum.load() == expected);
+		}
+		Check(bAllEqual, "JobSystem ParallelFor over 20000 chunks sums every index once");
+	}
+
+	// a second wave that depends on the first, both larger than a deque,
+	// so jobs that are not ready yet get parked on full deques
+	void CheckJobSystemDependencies()
+	{
+		const uint32_t count = 10000;
+
+		struct WAVE
+		{
+			uint32_t count = 0;
+			std::atomic<uint32_t> first{ 0 };
+			std::atomic<uint32_t> early{ 0 };
+			std::atomic<uint32_t> second{ 0 };
+		};
+		WAVE wave;
+		wave.count = count;
+
+		auto firstJob = [](void* data, uint32_t, uint32_t)
+		{
+			static_cast<WAVE*>(data)->first.fetch_add(1, std::memory_order_relaxed);
+		};
+		auto secondJob = [](void* data, uint32_t, uint32_t)
+		{
+			WAVE* w = static_cast<WAVE*>(data);
+			if (w->first.load(std::memory_order_relaxed) != w->count)
+			{
+				w->early.fetch_add(1, std::memory_order_relaxed);
+			}
+			w->second.fetch_add(1, std::memory_order_relaxed);
+		};
+
+		JobSystem jobs(3);
+		JobCounter firstDone;
+		JobCounter secondDone;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			jobs.Run(firstJob, &wave, i, i + 1, &firstDone);
+		}
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			jobs.Run(secondJob, &wave, i, i + 1, &secondDone, &firstDone);
+		}
+		jobs.Wait(firstDone);
+		jobs.Wait(secondDone);
+
+		Check((wave.first.load() == count) && (wave.second.load() == count) &&
+			(wave.early.load() == 0),
+			"JobSystem runs 10000 dependent jobs once each, after their dependency");
+	}
+
+	// destroying a value moves the last one into its place; every
+	// handle must keep naming its own value, and a handle must stop
+	// resolving once its value is gone, even after the slot is reused
+	void CheckObjectPoolHandles()
+	{
+		ObjectPool<int> pool;
+		const PoolHandle first = pool.Create(10);
+		const PoolHandle middle = pool.Create(20);
+		const PoolHandle last = pool.Create(30);
+
+		const bool bDestroyed = pool.Destroy(middle);
+		const int* pLast = pool.Get(last);
+		const int* pFirst = pool.Get(first);
+		Check(bDestroyed && (pool.Size() == 2) && (pLast != nullptr) && (*pLast == 30) &&
+			(pFirst != nullptr) && (*pFirst == 10) && (pool.HandleAt(1) == last),
+			"ObjectPool keeps the moved last value's handle after destroying the middle one");
+
+		const PoolHandle reused = pool.Create(40);
+		const int* pReused = pool.Get(reused);
+		Check((reused.slot == middle.slot) && (pReused != nullptr) && (*pReused == 40) &&
+			!pool.IsValid(middle) && !pool.Destroy(middle),
+			"ObjectPool rejects the old handle of a reused slot");
+
+		pool.Clear();
+		bool bAnyValid = pool.IsValid(first) || pool.IsValid(last) || pool.IsValid(reused);
+		const PoolHandle after = pool.Create(50);
+		bAnyValid = bAnyValid || pool.IsValid(first) || pool.IsValid(last) || pool.IsValid(reused);
+		Check(pool.IsValid(after) && (pool.Size() == 1) && !bAnyValid,
+			"ObjectPool invalidates every handle on Clear(), also once slots are reused");
+
+		Check((ObjectPool<int>::NextGeneration(0xFFFFFFFFu) == 1) &&
+			(ObjectPool<int>::NextGeneration(1) == 2) && PoolHandle().IsNull(),
+			"ObjectPool generations wrap around to 1, never to the null generation 0");
+	}
+
+	// the statistic PerfGate fails a build on, against answers worked
+	// out by hand
+	void CheckMannWhitney()
+	{
+		// m = n = 3 without ties: 2 of the 20 orderings give U >= 8
+		const MannWhitneyResult exact = MannWhitneyU({ 1.0, 2.0, 4.0 }, { 3.0, 5.0, 6.0 });
+		Check(exact.bExact && (exact.u == 8.0) && (std::fabs(exact.pValue - 0.1) < 1e-12),
+			"MannWhitneyU gives the exact p-value of small samples without ties");
+
+		// two runs of three ties: U = 13 of 16, variance 16 / 12 *
+		// (9 - 48 / 56), z = 4.5 / sqrt(variance)
+		const MannWhitneyResult tied = MannWhitneyU({ 1.0, 2.0, 2.0, 3.0 }, { 2.0, 3.0, 3.0, 4.0 });
+		Check(!tied.bExact && (tied.u == 13.0) && (std::fabs(tied.pValue - 0.0860168544609) < 1e-9),
+			"MannWhitneyU corrects the normal approximation for ties");
+
+		const MannWhitneyResult allTied = MannWhitneyU({ 2.0, 2.0, 2.0, 2.0, 2.0 }, { 2.0, 2.0, 2.0, 2.0, 2.0 });
+		Check(allTied.pValue == 1.0, "MannWhitneyU finds no slowdown when every value is tied");
+
+		TimingSamples baseline;
+		TimingSamples candidate;
+		baseline["even"] = { 4.0, 1.0, 3.0, 2.0 };
+		candidate["even"] = { 6.0, 5.0, 8.0, 7.0 };
+		baseline["odd"] = { 5.0, 1.0, 3.0 };
+		candidate["odd"] = { 3.0, 3.0, 3.0 };
+		const std::vector<PerfComparison> comparisons = ComparePerformance(baseline, candidate, PerfGateConfig());
+		Check((comparisons.size() == 2) &&
+			(comparisons[0].baselineMedianMs == 2.5) && (comparisons[0].candidateMedianMs == 6.5) &&
+			(comparisons[1].baselineMedianMs == 3.0) && (comparisons[1].candidateMedianMs == 3.0),
+			"ComparePerformance takes the mean of the middle two values of an even count as the median");
+	}
+
+	// a wall across the view hides a box behind it, while boxes in
+	// front of it or beside it stay visible
+	void CheckOcclusionCulling()
+	{
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.0f, 10.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.25f, 0.1f, 100.0f);
+		const glm::mat4 wall = ComposeModelMatrix(glm::vec3(8.0f, 4.0f, 0.2f),
+			0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+		OcclusionCuller culler;
+		culler.BeginFrame(projection * view);
+		culler.AddOccluder(MeshType::Box, wall);
+		culler.BuildPyramid();
+
+		const float radius = MeshBoundingRadius(MeshType::Box);
+		const bool bBehind = culler.IsOccluded(glm::vec3(0.0f, 1.0f, -5.0f), radius);
+		const bool bInFront = culler.IsOccluded(glm::vec3(0.0f, 1.0f, 3.0f), radius);
+		const bool bBeside = culler.IsOccluded(glm::vec3(9.0f, 1.0f, -5.0f), radius);
+		const bool bWall = culler.IsOccluded(glm::vec3(wall[3]), radius * 8.0f);
+		std::printf("      occluders %u, triangles %u, pyramid levels %u\n",
+			culler.GetOccluderCount(), culler.GetOccluderTriangleCount(), culler.GetLevelCount());
+
+		Check(culler.GetOccluderCount() == 1, "OcclusionCuller rasterizes the wall");
+		Check(bBehind, "OcclusionCuller hides a box behind the wall");
+		Check(!bInFront, "OcclusionCuller keeps a box in front of the wall");
+		Check(!bBeside, "OcclusionCuller keeps a box beside the wall");
+		Check(!bWall, "OcclusionCuller keeps the wall itself");
+	}
+
+	// the order of events TextureStreamer::Update() can produce: a
+	// decode of levels 0-1 is in flight at base 2, the camera moves
+	// away long enough for the base to drop to 4, then comes back
+	// close before the decode lands
+	void CheckMipDropDuringDecode()
+	{
+		MipResidency mips;
+		mips.levelCount = 10;
+		mips.residentLevel = 4;
+		mips.baseLevel = 2;
+		mips.wantedLevel = 0;
+
+		const bool bRequested = mips.NeedsDecode();
+		const uint32_t decodeGeneration = mips.generation;
+		mips.bDecoding = true;
+
+		mips.Drop(4);
+		mips.wantedLevel = 0;
+
+		// the decode holds levels 0 and 1; uploading level 3 from it
+		// would read past its end
+		uint32_t level = 0;
+		const bool bStaleUpload = mips.NextUpload(decodeGeneration, 0, 2, level);
+		Check(bRequested && !bStaleUpload,
+			"MipResidency drops a decode whose base level was dropped while it was in flight");
+		Check(mips.NeedsDecode(), "MipResidency asks again for the mips after the drop");
+
+		// a decode of the current generation that does not reach the
+		// base is refused as well
+		Check(!mips.NextUpload(mips.generation, 0, 2, level),
+			"MipResidency never uploads a level beyond the decoded ones");
+
+		const bool bUpload = mips.NextUpload(mips.generation, 0, 4, level);
+		Check(bUpload && (level == 3), "MipResidency uploads the level above the base from a new decode");
+	}
+}
+
+int main()
+{
+	CheckJobSystemOverflow();
+	CheckJobSystemDependencies();
+	CheckObjectPoolHandles();
+	CheckMannWhitney();
+	CheckOcclusionCulling();
+	CheckMipDropDuringDecode();
+
+	std::printf("%d check(s) failed\n", g_Failures);
+	return (g_Failures == 0) ? 0 : 1;
+}
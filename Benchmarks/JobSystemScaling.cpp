@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystemscaling.cpp
+// ============
+// scaling benchmark for the job system - runs the same frame-sized workloads
+// with 1 to N threads and reports the speedup over a single thread
+//
+//  usage: JobSystemScaling [objectCount] [iterations]
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	struct Transform
+	{
+		float scale[3];
+		float rotation[3];
+		float position[3];
+	};
+
+	struct Matrix
+	{
+		float m[16];
+	};
+
+	// compose translation * rotZ * rotY * rotX * scale, the same order
+	// SceneManager::SetTransformations uses
+	void ComposeTransform(const Transform& t, Matrix& out)
+	{
+		const float cx = std::cos(t.rotation[0]), sx = std::sin(t.rotation[0]);
+		const float cy = std::cos(t.rotation[1]), sy = std::sin(t.rotation[1]);
+		const float cz = std::cos(t.rotation[2]), sz = std::sin(t.rotation[2]);
+
+		const float r00 = cz * cy, r01 = cz * sy * sx - sz * cx, r02 = cz * sy * cx + sz * sx;
+		const float r10 = sz * cy, r11 = sz * sy * sx + cz * cx, r12 = sz * sy * cx - cz * sx;
+		const float r20 = -sy, r21 = cy * sx, r22 = cy * cx;
+
+		out.m[0] = r00 * t.scale[0]; out.m[4] = r01 * t.scale[1]; out.m[8] = r02 * t.scale[2];
+		out.m[1] = r10 * t.scale[0]; out.m[5] = r11 * t.scale[1]; out.m[9] = r12 * t.scale[2];
+		out.m[2] = r20 * t.scale[0]; out.m[6] = r21 * t.scale[1]; out.m[10] = r22 * t.scale[2];
+		out.m[3] = 0.0f; out.m[7] = 0.0f; out.m[11] = 0.0f;
+		out.m[12] = t.position[0]; out.m[13] = t.position[1]; out.m[14] = t.position[2];
+		out.m[15] = 1.0f;
+	}
+
+	// bounding sphere against six planes, the shape of a culling pass
+	bool SphereVisible(const Matrix& world, const float planes[6][4])
+	{
+		const float radius = 1.5f;
+		for (int p = 0; p < 6; ++p)
+		{
+			float d = planes[p][0] * world.m[12] + planes[p][1] * world.m[13] +
+				planes[p][2] * world.m[14] + planes[p][3];
+			if (d < -radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	double RunWorkload(JobSystem& jobs,
+		const std::vector<Transform>& transforms,
+		std::vector<Matrix>& matrices,
+		std::vector<unsigned char>& visible,
+		int iterations)
+	{
+		const float planes[6][4] = {
+			{ 1, 0, 0, 50 }, { -1, 0, 0, 50 },
+			{ 0, 1, 0, 50 }, { 0, -1, 0, 50 },
+			{ 0, 0, 1, 50 }, { 0, 0, -1, 50 } };
+		const uint32_t count = static_cast<uint32_t>(transforms.size());
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; ++i)
+		{
+			jobs.ParallelFor(count, 1024, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t n = begin; n < end; ++n)
+				{
+					ComposeTransform(transforms[n], matrices[n]);
+					visible[n] = SphereVisible(matrices[n], planes) ? 1 : 0;
+				}
+			});
+		}
+		auto stop = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(stop - start).count() / iterations;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const uint32_t objectCount = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 1000000u;
+	const int iterations = (argc > 2) ? std::atoi(argv[2]) : 20;
+
+	std::vector<Transform> transforms(objectCount);
+	srand(1234);
+	for (Transform& t : transforms)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			t.scale[i] = 0.5f + static_cast<float>(rand()) / RAND_MAX;
+			t.rotation[i] = 6.28f * static_cast<float>(rand()) / RAND_MAX;
+			t.position[i] = 200.0f * static_cast<float>(rand()) / RAND_MAX - 100.0f;
+		}
+	}
+	std::vector<Matrix> matrices(objectCount);
+	std::vector<unsigned char> visible(objectCount);
+
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0)
+	{
+		maxThreads = 1;
+	}
+
+	std::printf("objects=%u iterations=%d\n", objectCount, iterations);
+	std::printf("%8s %12s %10s %11s\n", "threads", "ms/iter", "speedup", "efficiency");
+
+	double baseline = 0.0;
+	for (unsigned threads = 1; threads <= maxThreads; ++threads)
+	{
+		// worker count excludes the calling thread
+		JobSystem jobs(static_cast<int>(threads) - 1);
+
+		// warm up the workers before measuring
+		RunWorkload(jobs, transforms, matrices, visible, 2);
+		double ms = RunWorkload(jobs, transforms, matrices, visible, iterations);
+		if (threads == 1)
+		{
+			baseline = ms;
+		}
+		double speedup = baseline / ms;
+		std::printf("%8u %12.3f %10.2f %10.1f%%\n", threads, ms, speedup,
+			100.0 * speedup / threads);
+	}
+
+	return EXIT_SUCCESS;
+}
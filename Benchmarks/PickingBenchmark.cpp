@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// pickingbenchmark.cpp
+// ============
+// headless benchmark for CPU ray picking - builds the picking tree over
+// generated scenes of 1k objects and up, then casts rays through random
+// viewport points on one thread and on all of them
+//
+//  usage: PickingBenchmark [maxObjects] [rays]
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ScenePicking.h"
+#include "SceneGenerator.h"
+#include "SceneLookup.h"
+#include "JobSystem.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	double ElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const uint32_t maxObjects = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 1000000u;
+	const uint32_t rayCount = (argc > 2) ? static_cast<uint32_t>(std::atoi(argv[2])) : 100000u;
+
+	// look across the whole generated world, as SceneScaling does
+	FrameView view;
+	view.position = glm::vec3(0.0f, 40.0f, 140.0f);
+	view.view = glm::lookAt(view.position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	view.projection = glm::perspective(glm::radians(60.0f), 1.25f, 0.1f, 400.0f);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> point(-1.0f, 1.0f);
+	std::vector<PickRay> rays(rayCount);
+	for (PickRay& ray : rays)
+	{
+		ray = MakePickRay(view, glm::vec2(point(random), point(random)));
+	}
+
+	JobSystem jobs;
+	std::printf("threads=%u rays=%u\n", jobs.GetThreadCount(), rayCount);
+	std::printf("%9s %10s %8s %10s %10s %13s %13s\n", "objects", "build ms", "hits",
+		"mean us", "max us", "rays/s (1)", "rays/s (all)");
+
+	for (uint32_t objects = 1000; objects <= maxObjects; objects *= 10)
+	{
+		SceneGenerationConfig cfg;
+		cfg.objectCount = objects;
+		GeneratedScene scene;
+		SceneGenerator::Generate(cfg, scene);
+
+		ScenePicker picker;
+		auto start = std::chrono::steady_clock::now();
+		picker.Reset(objects);
+		jobs.ParallelFor(objects, 4096, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const GeneratedObject& object = scene.objects[i];
+				picker.SetObject(i, object.mesh, ComposeModelMatrix(object.scale, object.rotation.x,
+					object.rotation.y, object.rotation.z, object.position));
+			}
+		});
+		picker.Build();
+		const double buildMs = ElapsedMs(start);
+
+		// one thread, timing every pick for the worst case
+		uint32_t hits = 0;
+		double maxUs = 0.0;
+		start = std::chrono::steady_clock::now();
+		for (const PickRay& ray : rays)
+		{
+			const auto pickStart = std::chrono::steady_clock::now();
+			PickHit hit;
+			hits += picker.Cast(ray, hit) ? 1 : 0;
+			maxUs = std::max(maxUs, ElapsedMs(pickStart) * 1000.0);
+		}
+		const double serialMs = ElapsedMs(start);
+
+		// all threads; the tree is read-only while casting
+		std::atomic<uint32_t> parallelHits{ 0 };
+		start = std::chrono::steady_clock::now();
+		jobs.ParallelFor(rayCount, 256, [&](uint32_t begin, uint32_t end)
+		{
+			uint32_t count = 0;
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				PickHit hit;
+				count += picker.Cast(rays[i], hit) ? 1 : 0;
+			}
+			parallelHits += count;
+		});
+		const double parallelMs = ElapsedMs(start);
+
+		if (parallelHits != hits)
+		{
+			std::fprintf(stderr, "parallel casts disagree with serial casts\n");
+			return EXIT_FAILURE;
+		}
+
+		std::printf("%9u %10.2f %8u %10.3f %10.1f %13.0f %13.0f\n", objects, buildMs, hits,
+			serialMs * 1000.0 / rayCount, maxUs, rayCount / (serialMs / 1000.0),
+			rayCount / (parallelMs / 1000.0));
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenescaling.cpp
+// ============
+// headless scaling curve - generates stress scenes from 1k to 1M objects and
+// times every CPU stage from generation to the sorted draw list, then the
+// cull of a moving camera with and without the reuse of the last frame's draws
+//
+//  usage: SceneScaling [maxObjects] [iterations] [distribution]
+//
+// the GL submission stage needs a window; time it with the renderer's
+// --scene and --benchmark options on the same generated files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGenerator.h"
+#include "SceneCulling.h"
+#include "FrameArena.h"
+#include "FramePipeline.h"
+#include "JobSystem.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// a camera path timed against the visibility cache, as the move
+	// and the turn around the vertical axis of every frame
+	struct MOTION
+	{
+		const char* name;
+		float move;
+		float turnRadians;
+	};
+	const MOTION g_Motions[] =
+	{
+		{ "still", 0.0f, 0.0f },
+		{ "slow pan", 0.002f, 0.0f },
+		{ "fast move", 0.1f, 0.01f },
+		{ "slow turn", 0.0f, 0.0002f }
+	};
+	const size_t g_MotionCount = sizeof(g_Motions) / sizeof(g_Motions[0]);
+	const int g_MotionFrames = 60;
+
+	struct MOTION_RESULT
+	{
+		uint32_t objects;
+		size_t motion;
+		double culledMs;
+		double cachedMs;
+		int reusedFrames;
+	};
+
+	double ElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+
+	// mean time of a frame's cull along a camera path starting at the
+	// given view, counting the frames that reused the previous draws
+	double TimeMotion(const FrameView& start, const MOTION& motion, bool bVisibilityCache,
+		const ObjectPool<SceneObject>& objects, JobSystem& jobs, int& reusedFrames)
+	{
+		FrameArena arena;
+		SceneCuller culler(&jobs, &arena);
+		culler.SetVisibilityCache(bVisibilityCache);
+		FramePacket packet;
+
+		const glm::vec3 up(0.0f, 1.0f, 0.0f);
+		const glm::vec3 forward = glm::normalize(-start.position);
+		const glm::vec3 right = glm::normalize(glm::cross(forward, up));
+		FrameView view = start;
+		reusedFrames = 0;
+
+		const auto begin = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < g_MotionFrames; ++frame)
+		{
+			const float angle = motion.turnRadians * frame;
+			const glm::vec3 direction = glm::vec3(glm::rotate(angle, up) * glm::vec4(forward, 0.0f));
+			view.position = start.position + right * (motion.move * frame);
+			view.view = glm::lookAt(view.position, view.position + direction, up);
+
+			arena.BeginFrame();
+			culler.Cull(view, objects, 1, packet);
+			reusedFrames += packet.bVisibilityReused ? 1 : 0;
+		}
+		return ElapsedMs(begin) / g_MotionFrames;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const uint32_t maxObjects = (argc > 1) ? static_cast<uint32_t>(std::atoi(argv[1])) : 1000000u;
+	const int iterations = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	SceneGenerationConfig cfg;
+	if ((argc > 3) && !SceneGenerator::ParseDistribution(argv[3], cfg.distribution))
+	{
+		std::fprintf(stderr, "distribution must be uniform, clustered or grid\n");
+		return EXIT_FAILURE;
+	}
+
+	// look across the whole generated world
+	FrameView view;
+	view.position = glm::vec3(0.0f, 40.0f, 140.0f);
+	view.view = glm::lookAt(view.position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	view.projection = glm::perspective(glm::radians(60.0f), 1.25f, 0.1f, 400.0f);
+
+	JobSystem jobs;
+	const char* scenePath = "SceneScaling.scene";
+
+	std::vector<MOTION_RESULT> motionResults;
+
+	std::printf("threads=%u iterations=%d\n", jobs.GetThreadCount(), iterations);
+	std::printf("%9s %10s %10s %10s %10s %10s %10s %10s\n", "objects", "generate", "save",
+		"load", "compose", "build", "visible", "occluded");
+
+	for (uint32_t objects = 1000; objects <= maxObjects; objects *= 10)
+	{
+		cfg.objectCount = objects;
+		GeneratedScene scene;
+
+		auto start = std::chrono::steady_clock::now();
+		SceneGenerator::Generate(cfg, scene);
+		const double generateMs = ElapsedMs(start);
+
+		start = std::chrono::steady_clock::now();
+		if (!SceneGenerator::Save(scenePath, scene))
+		{
+			return EXIT_FAILURE;
+		}
+		const double saveMs = ElapsedMs(start);
+
+		GeneratedScene loaded;
+		start = std::chrono::steady_clock::now();
+		if (!SceneGenerator::Load(scenePath, loaded))
+		{
+			return EXIT_FAILURE;
+		}
+		const double loadMs = ElapsedMs(start);
+
+		// the renderer's compose and cull path; without textures every
+		// object uses its color
+		ObjectPool<SceneObject> sceneObjects;
+		start = std::chrono::steady_clock::now();
+		ComposeGeneratedScene(loaded, nullptr, 0, sceneObjects, &jobs);
+		const double composeMs = ElapsedMs(start);
+
+		// culling, command recording, the sort/merge of the draw list and
+		// the occlusion test; the camera never moves, so the reuse of the
+		// last frame's draws is off to time the full cull every iteration
+		FrameArena arena;
+		SceneCuller culler(&jobs, &arena);
+		culler.SetVisibilityCache(false);
+		FramePacket packet;
+		arena.BeginFrame();
+		culler.Cull(view, sceneObjects, 1, packet);
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; ++i)
+		{
+			arena.BeginFrame();
+			culler.Cull(view, sceneObjects, 1, packet);
+		}
+		const double buildMs = ElapsedMs(start) / iterations;
+
+		std::printf("%9u %10.2f %10.2f %10.2f %10.2f %10.3f %10zu %10u\n", objects, generateMs,
+			saveMs, loadMs, composeMs, buildMs, packet.commands.size(), packet.occludedObjects);
+
+		for (size_t i = 0; i < g_MotionCount; ++i)
+		{
+			// every frame culls with the cache off, so nothing is reused
+			int noReuse = 0;
+			MOTION_RESULT result;
+			result.objects = objects;
+			result.motion = i;
+			result.culledMs = TimeMotion(view, g_Motions[i], false, sceneObjects, jobs, noReuse);
+			result.cachedMs = TimeMotion(view, g_Motions[i], true, sceneObjects, jobs, result.reusedFrames);
+			motionResults.push_back(result);
+		}
+	}
+
+	// the same cull along camera paths, every frame culled and then with
+	// the draws reused while the camera stays near the last culled pose
+	std::printf("\n%d frames per camera path\n", g_MotionFrames);
+	std::printf("%9s %10s %10s %10s %10s\n", "objects", "motion", "culled", "cached", "reused");
+	for (const MOTION_RESULT& result : motionResults)
+	{
+		std::printf("%9u %10s %10.3f %10.3f %10d\n", result.objects, g_Motions[result.motion].name,
+			result.culledMs, result.cachedMs, result.reusedFrames);
+	}
+
+	std::remove(scenePath);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,491 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationtracker.cpp
+// ============
+// heap allocation tracking - global operator new/delete hooks with totals per
+// thread and per named scope, plus sampled call stacks of the allocations
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define ALLOCATION_TRACKER_NOINLINE __declspec(noinline)
+#else
+#define ALLOCATION_TRACKER_NOINLINE __attribute__((noinline))
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#include <unistd.h>
+#define ALLOCATION_TRACKER_BACKTRACE 1
+#endif
+#endif
+
+// declaration of global variables
+namespace
+{
+	const uint32_t g_MaxStackDepth = 12;
+	// SampleCallSite() itself; the operator new frames below it stay,
+	// since inlining and tail calls make their number vary by build
+	const uint32_t g_SkippedFrames = 1;
+	const size_t g_MaxCallSites = 256;
+	const size_t g_MaxScopes = 32;
+
+	struct CALL_SITE
+	{
+		uint64_t hash;
+		uint64_t count;
+		uint32_t depth;
+		void* frames[g_MaxStackDepth];
+	};
+
+	struct SCOPE_TOTALS
+	{
+		std::atomic<const char*> name;
+		std::atomic<uint64_t> entries;
+		std::atomic<uint64_t> allocations;
+		std::atomic<uint64_t> bytes;
+		std::atomic<uint64_t> maxAllocations;
+	};
+
+	// plain globals with constant initialization, so they work
+	// for allocations made before main() and during static init
+	std::atomic<uint64_t> g_Allocations{ 0 };
+	std::atomic<uint64_t> g_Frees{ 0 };
+	std::atomic<uint64_t> g_Bytes{ 0 };
+	std::atomic<uint32_t> g_SampleInterval{ 0 };
+
+	std::atomic_flag g_CallSiteLock = ATOMIC_FLAG_INIT;
+	CALL_SITE g_CallSites[g_MaxCallSites];
+	size_t g_CallSiteCount = 0;
+	uint64_t g_DroppedSamples = 0;
+
+	SCOPE_TOTALS g_Scopes[g_MaxScopes];
+
+	thread_local uint64_t t_Allocations = 0;
+	thread_local uint64_t t_Frees = 0;
+	thread_local uint64_t t_Bytes = 0;
+	// set while sampling so allocations made by the unwinder
+	// are not sampled in turn
+	thread_local bool t_bSampling = false;
+
+	uint32_t CaptureStack(void** frames, uint32_t maxDepth)
+	{
+#if defined(_WIN32)
+		return CaptureStackBackTrace(0, maxDepth, frames, nullptr);
+#elif defined(ALLOCATION_TRACKER_BACKTRACE)
+		return static_cast<uint32_t>(backtrace(frames, static_cast<int>(maxDepth)));
+#else
+		(void)frames;
+		(void)maxDepth;
+		return 0;
+#endif
+	}
+
+	ALLOCATION_TRACKER_NOINLINE void SampleCallSite()
+	{
+		void* frames[g_MaxStackDepth + g_SkippedFrames];
+		t_bSampling = true;
+		const uint32_t captured = CaptureStack(frames, g_MaxStackDepth + g_SkippedFrames);
+		t_bSampling = false;
+		if (captured <= g_SkippedFrames)
+		{
+			return;
+		}
+
+		const uint32_t depth = captured - g_SkippedFrames;
+		uint64_t hash = 1469598103934665603ull;
+		for (uint32_t i = 0; i < depth; ++i)
+		{
+			hash = (hash ^ reinterpret_cast<uintptr_t>(frames[g_SkippedFrames + i])) * 1099511628211ull;
+		}
+
+		while (g_CallSiteLock.test_and_set(std::memory_order_acquire))
+		{
+		}
+		size_t index = 0;
+		while ((index < g_CallSiteCount) && (g_CallSites[index].hash != hash))
+		{
+			index++;
+		}
+		if (index < g_CallSiteCount)
+		{
+			g_CallSites[index].count++;
+		}
+		else if (g_CallSiteCount < g_MaxCallSites)
+		{
+			CALL_SITE& site = g_CallSites[g_CallSiteCount++];
+			site.hash = hash;
+			site.count = 1;
+			site.depth = depth;
+			std::memcpy(site.frames, frames + g_SkippedFrames, depth * sizeof(void*));
+		}
+		else
+		{
+			g_DroppedSamples++;
+		}
+		g_CallSiteLock.clear(std::memory_order_release);
+	}
+
+	void RecordAllocation(size_t size)
+	{
+		g_Allocations.fetch_add(1, std::memory_order_relaxed);
+		g_Bytes.fetch_add(size, std::memory_order_relaxed);
+		t_Allocations++;
+		t_Bytes += size;
+
+		const uint32_t interval = g_SampleInterval.load(std::memory_order_relaxed);
+		if ((interval != 0) && !t_bSampling && ((t_Allocations % interval) == 0))
+		{
+			SampleCallSite();
+		}
+	}
+
+	void RecordFree()
+	{
+		g_Frees.fetch_add(1, std::memory_order_relaxed);
+		t_Frees++;
+	}
+
+	void* Allocate(size_t size)
+	{
+		RecordAllocation(size);
+		void* pointer = std::malloc((size != 0) ? size : 1);
+		if (pointer == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return pointer;
+	}
+
+	void* AllocateAligned(size_t size, size_t alignment)
+	{
+		RecordAllocation(size);
+		if (size == 0)
+		{
+			size = 1;
+		}
+#if defined(_WIN32)
+		void* pointer = _aligned_malloc(size, alignment);
+#else
+		void* pointer = nullptr;
+		if (posix_memalign(&pointer, std::max(alignment, sizeof(void*)), size) != 0)
+		{
+			pointer = nullptr;
+		}
+#endif
+		if (pointer == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return pointer;
+	}
+
+	void Free(void* pointer)
+	{
+		if (pointer != nullptr)
+		{
+			RecordFree();
+			std::free(pointer);
+		}
+	}
+
+	void FreeAligned(void* pointer)
+	{
+		if (pointer != nullptr)
+		{
+			RecordFree();
+#if defined(_WIN32)
+			_aligned_free(pointer);
+#else
+			std::free(pointer);
+#endif
+		}
+	}
+
+	SCOPE_TOTALS* FindScope(const char* name)
+	{
+		for (SCOPE_TOTALS& scope : g_Scopes)
+		{
+			const char* current = scope.name.load(std::memory_order_acquire);
+			if (current == name)
+			{
+				return &scope;
+			}
+			if ((current == nullptr) &&
+				scope.name.compare_exchange_strong(current, name, std::memory_order_acq_rel))
+			{
+				return &scope;
+			}
+			// another thread claimed the slot; it may have been for this name
+			if (current == name)
+			{
+				return &scope;
+			}
+		}
+		return nullptr;
+	}
+}
+
+// ---------- global operator new / delete ----------
+
+void* operator new(size_t size) { return Allocate(size); }
+void* operator new[](size_t size) { return Allocate(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try { return Allocate(size); }
+	catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	try { return Allocate(size); }
+	catch (...) { return nullptr; }
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return AllocateAligned(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return AllocateAligned(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try { return AllocateAligned(size, static_cast<size_t>(alignment)); }
+	catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try { return AllocateAligned(size, static_cast<size_t>(alignment)); }
+	catch (...) { return nullptr; }
+}
+
+void operator delete(void* pointer) noexcept { Free(pointer); }
+void operator delete[](void* pointer) noexcept { Free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { Free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(pointer); }
+
+// ---------- AllocationTracker ----------
+
+AllocationCounts AllocationTracker::GetTotals()
+{
+	AllocationCounts counts;
+	counts.allocations = g_Allocations.load(std::memory_order_relaxed);
+	counts.frees = g_Frees.load(std::memory_order_relaxed);
+	counts.bytes = g_Bytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+AllocationCounts AllocationTracker::GetThreadTotals()
+{
+	AllocationCounts counts;
+	counts.allocations = t_Allocations;
+	counts.frees = t_Frees;
+	counts.bytes = t_Bytes;
+	return counts;
+}
+
+void AllocationTracker::SetSampleInterval(uint32_t interval)
+{
+	g_SampleInterval.store(interval, std::memory_order_relaxed);
+}
+
+void AllocationTracker::ClearCallSites()
+{
+	while (g_CallSiteLock.test_and_set(std::memory_order_acquire))
+	{
+	}
+	g_CallSiteCount = 0;
+	g_DroppedSamples = 0;
+	g_CallSiteLock.clear(std::memory_order_release);
+}
+
+/***********************************************************
+ *  PrintCallSites()
+ *
+ *  Prints the sampled stacks, most frequent first. Symbols
+ *  are resolved where the platform can do so without extra
+ *  libraries; elsewhere the return addresses are printed
+ *  for the debugger.
+ ***********************************************************/
+void AllocationTracker::PrintCallSites(FILE* pFile, size_t maxSites)
+{
+	// copy under the lock, print outside it so printing may allocate
+	static CALL_SITE sites[g_MaxCallSites];
+	while (g_CallSiteLock.test_and_set(std::memory_order_acquire))
+	{
+	}
+	const size_t count = g_CallSiteCount;
+	const uint64_t dropped = g_DroppedSamples;
+	std::memcpy(sites, g_CallSites, count * sizeof(CALL_SITE));
+	g_CallSiteLock.clear(std::memory_order_release);
+
+	std::sort(sites, sites + count, [](const CALL_SITE& a, const CALL_SITE& b)
+	{
+		return a.count > b.count;
+	});
+
+	std::fprintf(pFile, "allocation call sites: %zu sampled stacks, %llu samples dropped\n",
+		count, static_cast<unsigned long long>(dropped));
+	for (size_t i = 0; i < std::min(count, maxSites); ++i)
+	{
+		std::fprintf(pFile, "  #%zu sampled %llu times\n", i + 1,
+			static_cast<unsigned long long>(sites[i].count));
+		std::fflush(pFile);
+#if defined(ALLOCATION_TRACKER_BACKTRACE)
+		backtrace_symbols_fd(sites[i].frames, static_cast<int>(sites[i].depth), fileno(pFile));
+#else
+		for (uint32_t f = 0; f < sites[i].depth; ++f)
+		{
+			std::fprintf(pFile, "    %p\n", sites[i].frames[f]);
+		}
+#endif
+	}
+	std::fflush(pFile);
+}
+
+void AllocationTracker::PrintScopes(FILE* pFile)
+{
+	std::fprintf(pFile, "%-28s %10s %12s %12s %10s\n", "allocation scope", "entries",
+		"allocations", "bytes", "max/entry");
+	for (const SCOPE_TOTALS& scope : g_Scopes)
+	{
+		const char* name = scope.name.load(std::memory_order_acquire);
+		if (name == nullptr)
+		{
+			break;
+		}
+		std::fprintf(pFile, "%-28s %10llu %12llu %12llu %10llu\n", name,
+			static_cast<unsigned long long>(scope.entries.load(std::memory_order_relaxed)),
+			static_cast<unsigned long long>(scope.allocations.load(std::memory_order_relaxed)),
+			static_cast<unsigned long long>(scope.bytes.load(std::memory_order_relaxed)),
+			static_cast<unsigned long long>(scope.maxAllocations.load(std::memory_order_relaxed)));
+	}
+}
+
+// ---------- AllocationScope ----------
+
+AllocationScope::AllocationScope(const char* name)
+	: m_name(name), m_startAllocations(t_Allocations), m_startBytes(t_Bytes)
+{
+}
+
+AllocationScope::~AllocationScope()
+{
+	SCOPE_TOTALS* pScope = FindScope(m_name);
+	if (pScope == nullptr)
+	{
+		return;
+	}
+
+	const uint64_t allocations = t_Allocations - m_startAllocations;
+	pScope->entries.fetch_add(1, std::memory_order_relaxed);
+	pScope->allocations.fetch_add(allocations, std::memory_order_relaxed);
+	pScope->bytes.fetch_add(t_Bytes - m_startBytes, std::memory_order_relaxed);
+
+	uint64_t maxAllocations = pScope->maxAllocations.load(std::memory_order_relaxed);
+	while ((allocations > maxAllocations) &&
+		!pScope->maxAllocations.compare_exchange_weak(maxAllocations, allocations,
+			std::memory_order_relaxed))
+	{
+	}
+}
+
+// ---------- FrameAllocationCheck ----------
+
+FrameAllocationCheck::FrameAllocationCheck(uint32_t warmupFrames)
+	: m_warmupFrames(warmupFrames)
+{
+}
+
+void FrameAllocationCheck::BeginFrame()
+{
+	m_frameStart = AllocationTracker::GetTotals();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  Compares the totals with those of BeginFrame(). The
+ *  frees are not compared: memory released from an earlier
+ *  frame is fine, it is new requests that reach the heap.
+ ***********************************************************/
+void FrameAllocationCheck::EndFrame()
+{
+	const AllocationCounts frameEnd = AllocationTracker::GetTotals();
+	const uint32_t frame = m_frames++;
+	if (frame < m_warmupFrames)
+	{
+		if (frame + 1 == m_warmupFrames)
+		{
+			AllocationTracker::ClearCallSites();
+			AllocationTracker::SetSampleInterval(1);
+		}
+		return;
+	}
+
+	const uint64_t allocations = frameEnd.allocations - m_frameStart.allocations;
+	if (allocations == 0)
+	{
+		return;
+	}
+
+	const uint64_t bytes = frameEnd.bytes - m_frameStart.bytes;
+	if (m_failedFrames < kReportedFrames)
+	{
+		std::fprintf(stderr, "[AllocationTracker] frame %u allocated %llu times (%llu bytes)\n",
+			frame, static_cast<unsigned long long>(allocations),
+			static_cast<unsigned long long>(bytes));
+	}
+	m_failedFrames++;
+	m_allocations += allocations;
+	m_bytes += bytes;
+}
+
+bool FrameAllocationCheck::Passed() const
+{
+	return (m_frames > m_warmupFrames) && (m_failedFrames == 0);
+}
+
+void FrameAllocationCheck::PrintReport(FILE* pFile) const
+{
+	AllocationTracker::SetSampleInterval(0);
+	if (m_frames <= m_warmupFrames)
+	{
+		std::fprintf(pFile, "allocation test: only %u frames ran, the warm-up is %u\n",
+			m_frames, m_warmupFrames);
+		return;
+	}
+
+	std::fprintf(pFile, "allocation test: %u of %u frames after a %u frame warm-up allocated, "
+		"%llu allocations, %llu bytes\n", m_failedFrames, m_frames - m_warmupFrames,
+		m_warmupFrames, static_cast<unsigned long long>(m_allocations),
+		static_cast<unsigned long long>(m_bytes));
+	AllocationTracker::PrintScopes(pFile);
+	if (m_failedFrames > 0)
+	{
+		AllocationTracker::PrintCallSites(pFile, 10);
+	}
+}
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationtracker.h
+// ============
+// heap allocation tracking - global operator new/delete hooks with totals per
+// thread and per named scope, plus sampled call stacks of the allocations
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+struct AllocationCounts
+{
+	uint64_t allocations = 0;
+	uint64_t frees = 0;
+	uint64_t bytes = 0;
+};
+
+/***********************************************************
+ *  AllocationTracker
+ *
+ *  Every operator new and delete in the program goes through
+ *  AllocationTracker.cpp. Counting is a few relaxed atomic
+ *  adds, so it stays on in every build. Allocations made by
+ *  C code or drivers through malloc are not seen.
+ ***********************************************************/
+class AllocationTracker
+{
+public:
+	// all threads since startup
+	static AllocationCounts GetTotals();
+	// the calling thread since it started
+	static AllocationCounts GetThreadTotals();
+
+	// record the call stack of every Nth allocation; 0 stops sampling
+	static void SetSampleInterval(uint32_t interval);
+	static void ClearCallSites();
+	// the most frequent sampled stacks, as symbols where available
+	static void PrintCallSites(FILE* pFile, size_t maxSites);
+	// totals of every AllocationScope name seen so far
+	static void PrintScopes(FILE* pFile);
+};
+
+/***********************************************************
+ *  AllocationScope
+ *
+ *  Counts the allocations the constructing thread makes
+ *  until the scope ends and adds them to the totals kept
+ *  under its name. The name must be a string literal; work
+ *  the scope hands to other threads is not included.
+ ***********************************************************/
+class AllocationScope
+{
+public:
+	explicit AllocationScope(const char* name);
+	~AllocationScope();
+
+	AllocationScope(const AllocationScope&) = delete;
+	AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+	const char* m_name;
+	uint64_t m_startAllocations;
+	uint64_t m_startBytes;
+};
+
+/***********************************************************
+ *  FrameAllocationCheck
+ *
+ *  The steady-state test of the render loop: once the
+ *  warm-up frames are over, any allocation made between
+ *  BeginFrame() and EndFrame() on any thread fails the
+ *  frame. Call sites are sampled from the end of the
+ *  warm-up on, so the report shows where they came from.
+ ***********************************************************/
+class FrameAllocationCheck
+{
+public:
+	explicit FrameAllocationCheck(uint32_t warmupFrames);
+
+	void BeginFrame();
+	void EndFrame();
+
+	// true if frames past the warm-up ran and none of them allocated
+	bool Passed() const;
+	void PrintReport(FILE* pFile) const;
+
+private:
+	// failing frames reported as they happen; the rest only count
+	static const uint32_t kReportedFrames = 5;
+
+	uint32_t m_warmupFrames;
+	uint32_t m_frames = 0;
+	uint32_t m_failedFrames = 0;
+	uint64_t m_allocations = 0;
+	uint64_t m_bytes = 0;
+	AllocationCounts m_frameStart;
+};
@@ -0,0 +1,427 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpackage.cpp
+// ============
+// single-file asset packages - a hash-sorted index of named entries, each
+// aligned and optionally LZ compressed, read through a memory mapping so
+// stored entries are used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPackage.h"
+#include "LzCompression.h"
+#include "StringInterner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  Package file format (version 1, little-endian)
+	 *
+	 *  header: "APAK", uint32 version, uint32 entry count,
+	 *          uint32 alignment, uint64 names offset, uint64
+	 *          names size
+	 *  index:  one AssetPackage::ENTRY per entry, sorted by
+	 *          name hash and then by name
+	 *  names:  the entry names, not terminated
+	 *  data:   each entry at a multiple of the alignment,
+	 *          LZ compressed when its flags say so
+	 ***********************************************************/
+	struct PACKAGE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t alignment;
+		uint64_t namesOffset;
+		uint64_t namesSize;
+	};
+	static_assert(sizeof(PACKAGE_HEADER) == 32, "package header must be packed");
+	static_assert(sizeof(AssetPackage::ENTRY) == 40, "package entry must be packed");
+
+	const char g_Magic[4] = { 'A', 'P', 'A', 'K' };
+	const uint32_t g_Version = 1;
+	// the index is read in place, so it may not exceed what is mapped
+	const uint32_t g_MaxEntries = 1u << 20;
+	// every stored byte of an LZ entry decodes to at most 255 bytes, so
+	// a larger size is corrupt rather than something to allocate
+	const uint64_t g_MaxExpansion = 255;
+
+	bool EntryLess(const AssetPackage::ENTRY& a, const char* aName,
+		const AssetPackage::ENTRY& b, const char* bName)
+	{
+		if (a.hash != b.hash)
+		{
+			return a.hash < b.hash;
+		}
+		const int order = std::memcmp(aName, bName, std::min(a.nameLength, b.nameLength));
+		return (order != 0) ? (order < 0) : (a.nameLength < b.nameLength);
+	}
+
+	bool ReadWholeFile(const std::string& path, std::vector<uint8_t>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()),
+			static_cast<std::streamsize>(data.size())));
+	}
+
+	void PadTo(std::ofstream& file, uint64_t alignment)
+	{
+		static const char zeros[256] = {};
+		uint64_t padding = (alignment - static_cast<uint64_t>(file.tellp()) % alignment) % alignment;
+		while (padding > 0)
+		{
+			const uint64_t chunk = std::min<uint64_t>(padding, sizeof(zeros));
+			file.write(zeros, static_cast<std::streamsize>(chunk));
+			padding -= chunk;
+		}
+	}
+}
+
+/***********************************************************
+ *  ~AssetPackage()
+ *
+ *  The destructor for the class - unmaps the file
+ ***********************************************************/
+AssetPackage::~AssetPackage()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  Packs the files into a new package. Names must be unique;
+ *  two names sharing a hash are fine, as lookups compare the
+ *  name as well.
+ ***********************************************************/
+bool AssetPackage::Write(const std::string& path, const std::vector<SOURCE_FILE>& files,
+	uint32_t alignment, bool bCompress)
+{
+	if ((alignment == 0) || ((alignment & (alignment - 1)) != 0) || (files.size() > g_MaxEntries))
+	{
+		std::cerr << "[AssetPackage] the alignment must be a power of two and there may be at most "
+			<< g_MaxEntries << " files\n";
+		return false;
+	}
+
+	// index entries with their names, sorted the way Find() searches
+	std::string names;
+	std::vector<ENTRY> entries(files.size());
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		ENTRY& entry = entries[i];
+		std::memset(&entry, 0, sizeof(entry));
+		entry.hash = HashString(files[i].name.c_str(), files[i].name.size());
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint32_t>(files[i].name.size());
+		names += files[i].name;
+	}
+	std::vector<uint32_t> order(files.size());
+	for (uint32_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+	{
+		return EntryLess(entries[a], names.data() + entries[a].nameOffset,
+			entries[b], names.data() + entries[b].nameOffset);
+	});
+	for (size_t i = 1; i < order.size(); ++i)
+	{
+		if (files[order[i]].name == files[order[i - 1]].name)
+		{
+			std::cerr << "[AssetPackage] " << files[order[i]].name << " is packed twice\n";
+			return false;
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "[AssetPackage] cannot create " << path << "\n";
+		return false;
+	}
+
+	// the header and index are written again once the offsets are known
+	PACKAGE_HEADER header;
+	std::memcpy(header.magic, g_Magic, sizeof(header.magic));
+	header.version = g_Version;
+	header.entryCount = static_cast<uint32_t>(files.size());
+	header.alignment = alignment;
+	header.namesOffset = sizeof(PACKAGE_HEADER) + sizeof(ENTRY) * files.size();
+	header.namesSize = names.size();
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()),
+		static_cast<std::streamsize>(sizeof(ENTRY) * entries.size()));
+	file.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> compressed;
+	for (uint32_t index : order)
+	{
+		if (!ReadWholeFile(files[index].path, data))
+		{
+			std::cerr << "[AssetPackage] cannot read " << files[index].path << "\n";
+			return false;
+		}
+
+		ENTRY& entry = entries[index];
+		entry.size = data.size();
+		const std::vector<uint8_t>* pStored = &data;
+		if (bCompress && !data.empty())
+		{
+			LzCompress(data.data(), data.size(), compressed);
+			if (compressed.size() <= data.size() - data.size() / 8)
+			{
+				entry.flags |= kCompressed;
+				pStored = &compressed;
+			}
+		}
+
+		PadTo(file, alignment);
+		entry.offset = static_cast<uint64_t>(file.tellp());
+		entry.storedSize = pStored->size();
+		file.write(reinterpret_cast<const char*>(pStored->data()),
+			static_cast<std::streamsize>(pStored->size()));
+	}
+
+	std::vector<ENTRY> sorted(entries.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		sorted[i] = entries[order[i]];
+	}
+	file.seekp(sizeof(PACKAGE_HEADER));
+	file.write(reinterpret_cast<const char*>(sorted.data()),
+		static_cast<std::streamsize>(sizeof(ENTRY) * sorted.size()));
+
+	if (!file)
+	{
+		std::cerr << "[AssetPackage] failed writing " << path << "\n";
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  Maps a package read-only and validates its index. The
+ *  OS pages entries in as they are touched.
+ ***********************************************************/
+bool AssetPackage::Open(const std::string& path)
+{
+	Close();
+	m_path = path;
+
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER fileSize;
+	if ((hFile == INVALID_HANDLE_VALUE) || !GetFileSizeEx(hFile, &fileSize) || (fileSize.QuadPart == 0))
+	{
+		if (hFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(hFile);
+		}
+		std::cerr << "[AssetPackage] cannot open " << path << "\n";
+		return false;
+	}
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	void* pView = (hMapping != NULL) ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (pView == NULL)
+	{
+		if (hMapping != NULL)
+		{
+			CloseHandle(hMapping);
+		}
+		CloseHandle(hFile);
+		std::cerr << "[AssetPackage] cannot map " << path << "\n";
+		return false;
+	}
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	m_pBase = static_cast<const uint8_t*>(pView);
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	struct stat status;
+	if ((fd < 0) || (fstat(fd, &status) != 0) || (status.st_size == 0))
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		std::cerr << "[AssetPackage] cannot open " << path << "\n";
+		return false;
+	}
+	void* pView = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps the file referenced
+	close(fd);
+	if (pView == MAP_FAILED)
+	{
+		std::cerr << "[AssetPackage] cannot map " << path << "\n";
+		return false;
+	}
+	m_size = static_cast<size_t>(status.st_size);
+	m_pBase = static_cast<const uint8_t*>(pView);
+#endif
+
+	if (!Validate())
+	{
+		std::cerr << "[AssetPackage] " << path << " is not a valid version " << g_Version << " package\n";
+		Close();
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  Unmaps the package. Data returned by GetStoredData() is
+ *  no longer valid afterwards.
+ ***********************************************************/
+void AssetPackage::Close()
+{
+	if (m_pBase != nullptr)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(m_pBase);
+		CloseHandle(static_cast<HANDLE>(m_hMapping));
+		CloseHandle(static_cast<HANDLE>(m_hFile));
+		m_hMapping = nullptr;
+		m_hFile = nullptr;
+#else
+		munmap(const_cast<uint8_t*>(m_pBase), m_size);
+#endif
+	}
+	m_pBase = nullptr;
+	m_size = 0;
+	m_pEntries = nullptr;
+	m_pNames = nullptr;
+	m_namesSize = 0;
+	m_entryCount = 0;
+}
+
+/***********************************************************
+ *  Validate()
+ *
+ *  Checks the header, that every name and entry lies inside
+ *  the file, and that the index is sorted, so that nothing
+ *  read later can point outside the mapping.
+ ***********************************************************/
+bool AssetPackage::Validate() const
+{
+	if (m_size < sizeof(PACKAGE_HEADER))
+	{
+		return false;
+	}
+	PACKAGE_HEADER header;
+	std::memcpy(&header, m_pBase, sizeof(header));
+	const uint64_t indexEnd = sizeof(PACKAGE_HEADER) + static_cast<uint64_t>(header.entryCount) * sizeof(ENTRY);
+	if ((std::memcmp(header.magic, g_Magic, sizeof(header.magic)) != 0) || (header.version != g_Version) ||
+		(header.entryCount > g_MaxEntries) || (header.namesOffset != indexEnd) ||
+		(header.namesSize > m_size - std::min<uint64_t>(indexEnd, m_size)) || (indexEnd > m_size))
+	{
+		return false;
+	}
+
+	AssetPackage* self = const_cast<AssetPackage*>(this);
+	self->m_entryCount = header.entryCount;
+	self->m_pEntries = reinterpret_cast<const ENTRY*>(m_pBase + sizeof(PACKAGE_HEADER));
+	self->m_pNames = reinterpret_cast<const char*>(m_pBase + header.namesOffset);
+	self->m_namesSize = header.namesSize;
+
+	for (uint32_t i = 0; i < m_entryCount; ++i)
+	{
+		const ENTRY& entry = m_pEntries[i];
+		if ((static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > m_namesSize) ||
+			(entry.offset > m_size) || (entry.storedSize > m_size - entry.offset) ||
+			((entry.flags & ~kCompressed) != 0) ||
+			(((entry.flags & kCompressed) == 0) && (entry.storedSize != entry.size)) ||
+			(entry.size > entry.storedSize * g_MaxExpansion) ||
+			(HashString(m_pNames + entry.nameOffset, entry.nameLength) != entry.hash))
+		{
+			return false;
+		}
+		if ((i > 0) && !EntryLess(m_pEntries[i - 1], m_pNames + m_pEntries[i - 1].nameOffset,
+			entry, m_pNames + entry.nameOffset))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  Binary search on the name hash, then a compare of the
+ *  names sharing it.
+ ***********************************************************/
+const AssetPackage::ENTRY* AssetPackage::Find(const std::string& name) const
+{
+	const uint32_t hash = HashString(name.c_str(), name.size());
+	const ENTRY* pEnd = m_pEntries + m_entryCount;
+	const ENTRY* pEntry = std::lower_bound(m_pEntries, pEnd, hash,
+		[](const ENTRY& entry, uint32_t value) { return entry.hash < value; });
+	for (; (pEntry != pEnd) && (pEntry->hash == hash); ++pEntry)
+	{
+		if ((pEntry->nameLength == name.size()) &&
+			(std::memcmp(m_pNames + pEntry->nameOffset, name.data(), name.size()) == 0))
+		{
+			return pEntry;
+		}
+	}
+	return nullptr;
+}
+
+/***********************************************************
+ *  Extract()
+ *
+ *  Copies an entry out of the mapping, decompressing it if
+ *  it was packed compressed.
+ ***********************************************************/
+bool AssetPackage::Extract(const ENTRY& entry, std::vector<uint8_t>& output) const
+{
+	output.resize(static_cast<size_t>(entry.size));
+	if ((entry.flags & kCompressed) == 0)
+	{
+		std::memcpy(output.data(), GetStoredData(entry), output.size());
+		return true;
+	}
+	if (!LzDecompress(GetStoredData(entry), static_cast<size_t>(entry.storedSize), output.data(), output.size()))
+	{
+		std::cerr << "[AssetPackage] " << GetName(entry) << " in " << m_path << " is corrupt\n";
+		output.clear();
+		return false;
+	}
+	return true;
+}
+
+std::string AssetPackage::GetName(const ENTRY& entry) const
+{
+	return std::string(m_pNames + entry.nameOffset, entry.nameLength);
+}
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpackage.h
+// ============
+// single-file asset packages - a hash-sorted index of named entries, each
+// aligned and optionally LZ compressed, read through a memory mapping so
+// stored entries are used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  AssetPackage
+ *
+ *  Entry names are the normalized relative paths the
+ *  loaders ask for, such as "textures/wood_seamless.jpeg".
+ *  The index is sorted by the FNV-1a hash of the name, so a
+ *  lookup is a binary search and one name compare.
+ ***********************************************************/
+class AssetPackage
+{
+public:
+	// on-disk index entry, see AssetPackage.cpp for the layout
+	struct ENTRY
+	{
+		uint32_t hash;
+		uint32_t flags;
+		uint64_t offset;
+		uint64_t storedSize;
+		uint64_t size;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+	};
+
+	static const uint32_t kCompressed = 0x1u;
+	static const uint32_t kDefaultAlignment = 64;
+
+	// a file to pack and the name it is stored under
+	struct SOURCE_FILE
+	{
+		std::string name;
+		std::string path;
+	};
+
+	// entries are compressed only where that saves an eighth or more
+	static bool Write(const std::string& path, const std::vector<SOURCE_FILE>& files,
+		uint32_t alignment, bool bCompress);
+
+	AssetPackage() = default;
+	~AssetPackage();
+
+	AssetPackage(const AssetPackage&) = delete;
+	AssetPackage& operator=(const AssetPackage&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	// nullptr if the package has no entry of that name
+	const ENTRY* Find(const std::string& name) const;
+	// stored bytes of an entry, inside the mapping
+	const uint8_t* GetStoredData(const ENTRY& entry) const { return m_pBase + entry.offset; }
+	// the entry's bytes, decompressed if needed
+	bool Extract(const ENTRY& entry, std::vector<uint8_t>& output) const;
+
+	uint32_t GetEntryCount() const { return m_entryCount; }
+	const ENTRY& GetEntry(uint32_t index) const { return m_pEntries[index]; }
+	std::string GetName(const ENTRY& entry) const;
+	const std::string& GetPath() const { return m_path; }
+
+private:
+	bool Validate() const;
+
+	std::string m_path;
+	const uint8_t* m_pBase = nullptr;
+	size_t m_size = 0;
+	const ENTRY* m_pEntries = nullptr;
+	const char* m_pNames = nullptr;
+	uint64_t m_namesSize = 0;
+	uint32_t m_entryCount = 0;
+#if defined(_WIN32)
+	void* m_hFile = nullptr;
+	void* m_hMapping = nullptr;
+#endif
+};
@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.cpp
+// ============
+// scripted camera paths - keyframes of position, front, zoom and projection
+// joined by a Catmull-Rom spline, used by the flythrough benchmark
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPath.h"
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	const glm::vec3 g_WorldUp(0.0f, 1.0f, 0.0f);
+
+	glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1,
+		const glm::vec3& p2, const glm::vec3& p3, float u)
+	{
+		const float u2 = u * u;
+		const float u3 = u2 * u;
+		return 0.5f * ((2.0f * p1) +
+			(p2 - p0) * u +
+			(2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+			(3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+	}
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  Reads the keyframes of a path file. The keyframe times
+ *  must increase.
+ ***********************************************************/
+bool CameraPath::Load(const std::string& path)
+{
+	m_keyframes.clear();
+
+	AssetBlob blob;
+	if (!VirtualFileSystem::Read(path, blob))
+	{
+		std::cerr << "[CameraPath] cannot open " << path << "\n";
+		return false;
+	}
+	AssetStream file(blob);
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		size_t first = line.find_first_not_of(" \t\r");
+		if ((first == std::string::npos) || (line[first] == '#'))
+		{
+			continue;
+		}
+
+		KEYFRAME key;
+		std::string projection;
+		std::istringstream fields(line);
+		fields >> key.time
+			>> key.position.x >> key.position.y >> key.position.z
+			>> key.front.x >> key.front.y >> key.front.z
+			>> key.zoom >> projection;
+		if (fields.fail() || ((projection != "perspective") && (projection != "ortho")) ||
+			(glm::length(key.front) <= 0.0f) ||
+			(!m_keyframes.empty() && (key.time <= m_keyframes.back().time)))
+		{
+			std::cerr << "[CameraPath] " << path << ":" << lineNumber << " is not a valid keyframe\n";
+			m_keyframes.clear();
+			return false;
+		}
+
+		key.front = glm::normalize(key.front);
+		key.bOrthographic = (projection == "ortho");
+		m_keyframes.push_back(key);
+	}
+
+	if (m_keyframes.empty())
+	{
+		std::cerr << "[CameraPath] " << path << " has no keyframes\n";
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  GetDuration()
+ *
+ *  Time of the last keyframe.
+ ***********************************************************/
+float CameraPath::GetDuration() const
+{
+	return m_keyframes.empty() ? 0.0f : m_keyframes.back().time;
+}
+
+/***********************************************************
+ *  Sample()
+ *
+ *  Position and front follow the spline through the
+ *  surrounding four keyframes, the zoom is interpolated
+ *  linearly and the projection switches at keyframes. The
+ *  yaw and pitch are derived from the front so that mouse
+ *  input would continue smoothly from the sampled state.
+ ***********************************************************/
+CameraState CameraPath::Sample(float time, float movementSpeed) const
+{
+	CameraState state;
+	state.movementSpeed = movementSpeed;
+	if (m_keyframes.empty())
+	{
+		return state;
+	}
+
+	const size_t last = m_keyframes.size() - 1;
+	size_t segment = 0;
+	while ((segment < last) && (time >= m_keyframes[segment + 1].time))
+	{
+		segment++;
+	}
+
+	const KEYFRAME& k1 = m_keyframes[segment];
+	if (segment == last)
+	{
+		state.position = k1.position;
+		state.front = k1.front;
+		state.zoom = k1.zoom;
+		state.bOrthographic = k1.bOrthographic;
+	}
+	else
+	{
+		const KEYFRAME& k0 = m_keyframes[(segment > 0) ? segment - 1 : 0];
+		const KEYFRAME& k2 = m_keyframes[segment + 1];
+		const KEYFRAME& k3 = m_keyframes[std::min(segment + 2, last)];
+		const float u = glm::clamp((time - k1.time) / (k2.time - k1.time), 0.0f, 1.0f);
+
+		state.position = CatmullRom(k0.position, k1.position, k2.position, k3.position, u);
+		state.front = CatmullRom(k0.front, k1.front, k2.front, k3.front, u);
+		if (glm::length(state.front) <= 1e-5f)
+		{
+			state.front = k1.front;
+		}
+		state.front = glm::normalize(state.front);
+		state.zoom = k1.zoom + (k2.zoom - k1.zoom) * u;
+		state.bOrthographic = k1.bOrthographic;
+	}
+
+	state.yaw = glm::degrees(std::atan2(state.front.z, state.front.x));
+	state.pitch = glm::degrees(std::asin(glm::clamp(state.front.y, -1.0f, 1.0f)));
+	state.right = glm::normalize(glm::cross(state.front, g_WorldUp));
+	state.up = glm::normalize(glm::cross(state.right, state.front));
+	return state;
+}
@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.h
+// ============
+// scripted camera paths - keyframes of position, front, zoom and projection
+// joined by a Catmull-Rom spline, used by the flythrough benchmark
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTypes.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  CameraPath
+ *
+ *  Path files hold one keyframe per line, in time order:
+ *
+ *    time  posX posY posZ  frontX frontY frontZ  zoom  projection
+ *
+ *  where projection is "perspective" or "ortho". Lines that
+ *  are empty or start with '#' are skipped.
+ ***********************************************************/
+class CameraPath
+{
+public:
+	struct KEYFRAME
+	{
+		float time;
+		glm::vec3 position;
+		glm::vec3 front;
+		float zoom;
+		bool bOrthographic;
+	};
+
+	// returns false and keeps no keyframes if the file is invalid
+	bool Load(const std::string& path);
+
+	float GetDuration() const;
+	size_t GetKeyframeCount() const { return m_keyframes.size(); }
+
+	// camera state at a time along the path, clamped to its ends
+	CameraState Sample(float time, float movementSpeed) const;
+
+private:
+	std::vector<KEYFRAME> m_keyframes;
+};
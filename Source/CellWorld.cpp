@@ -0,0 +1,252 @@
+///////////////////////////////////////////////////////////////////////////////
+// cellworld.cpp
+// ============
+// spatially partitioned scene files - the objects of a generated scene
+// grouped into square cells on the ground plane, so that the cells around
+// the camera can be read on their own
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CellWorld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  Cell world file format (version 1, little-endian, packed)
+	 *
+	 *  header: "SCEL", uint32 version, uint32 seed, uint32
+	 *          texture count, float cell size, float origin x,
+	 *          float origin z, uint32 cells x, uint32 cells z,
+	 *          uint32 light count
+	 *  lights: light records of the scene file
+	 *  table:  per cell, row by row along x, uint64 offset
+	 *          of its first object and uint32 object count
+	 *  cells:  object records of the scene file, grouped by
+	 *          cell in table order
+	 ***********************************************************/
+	const char g_Magic[4] = { 'S', 'C', 'E', 'L' };
+	const uint32_t g_Version = 1;
+	// the cell table is kept in memory, so its size is capped
+	const uint32_t g_MaxCells = 4u * 1024u * 1024u;
+
+	template <typename T>
+	void WriteValue(std::ostream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(std::istream& file, T& value)
+	{
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  Writes a scene as a cell world. Each object goes to the
+ *  cell holding its position; the cells cover the bounds of
+ *  all object positions.
+ ***********************************************************/
+bool CellWorldFile::Save(const std::string& path, const GeneratedScene& scene, float cellSize)
+{
+	if (!(cellSize > 0.0f))
+	{
+		std::cerr << "[CellWorld] the cell size must be positive\n";
+		return false;
+	}
+
+	glm::vec2 minimum(0.0f);
+	glm::vec2 maximum(0.0f);
+	for (size_t i = 0; i < scene.objects.size(); ++i)
+	{
+		const glm::vec2 position(scene.objects[i].position.x, scene.objects[i].position.z);
+		minimum = (i == 0) ? position : glm::min(minimum, position);
+		maximum = (i == 0) ? position : glm::max(maximum, position);
+	}
+	const uint32_t cellsX = static_cast<uint32_t>(std::floor((maximum.x - minimum.x) / cellSize)) + 1;
+	const uint32_t cellsZ = static_cast<uint32_t>(std::floor((maximum.y - minimum.y) / cellSize)) + 1;
+	if (static_cast<uint64_t>(cellsX) * cellsZ > g_MaxCells)
+	{
+		std::cerr << "[CellWorld] " << cellsX << " x " << cellsZ
+			<< " cells are too many; use larger cells\n";
+		return false;
+	}
+
+	// counting sort of the objects by cell
+	const uint32_t cellCount = cellsX * cellsZ;
+	std::vector<uint32_t> objectCells(scene.objects.size());
+	std::vector<uint32_t> firstObject(cellCount + 1, 0);
+	for (size_t i = 0; i < scene.objects.size(); ++i)
+	{
+		const glm::vec3& position = scene.objects[i].position;
+		const uint32_t x = std::min(static_cast<uint32_t>((position.x - minimum.x) / cellSize), cellsX - 1);
+		const uint32_t z = std::min(static_cast<uint32_t>((position.z - minimum.y) / cellSize), cellsZ - 1);
+		objectCells[i] = z * cellsX + x;
+		firstObject[objectCells[i] + 1]++;
+	}
+	for (uint32_t c = 0; c < cellCount; ++c)
+	{
+		firstObject[c + 1] += firstObject[c];
+	}
+	std::vector<uint32_t> order(scene.objects.size());
+	std::vector<uint32_t> next(firstObject.begin(), firstObject.end() - 1);
+	for (size_t i = 0; i < scene.objects.size(); ++i)
+	{
+		order[next[objectCells[i]]++] = static_cast<uint32_t>(i);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "[CellWorld] cannot create " << path << "\n";
+		return false;
+	}
+
+	file.write(g_Magic, sizeof(g_Magic));
+	WriteValue(file, g_Version);
+	WriteValue(file, scene.seed);
+	WriteValue(file, scene.textureCount);
+	WriteValue(file, cellSize);
+	WriteValue(file, minimum.x);
+	WriteValue(file, minimum.y);
+	WriteValue(file, cellsX);
+	WriteValue(file, cellsZ);
+	WriteValue(file, static_cast<uint32_t>(scene.lights.size()));
+	for (const LightData& light : scene.lights)
+	{
+		SceneGenerator::WriteLight(file, light);
+	}
+
+	const uint64_t tableBytes = static_cast<uint64_t>(cellCount) * (sizeof(uint64_t) + sizeof(uint32_t));
+	const uint64_t firstOffset = static_cast<uint64_t>(file.tellp()) + tableBytes;
+	for (uint32_t c = 0; c < cellCount; ++c)
+	{
+		WriteValue(file, firstOffset + static_cast<uint64_t>(firstObject[c]) * SceneGenerator::kObjectRecordSize);
+		WriteValue(file, firstObject[c + 1] - firstObject[c]);
+	}
+	for (uint32_t index : order)
+	{
+		SceneGenerator::WriteObject(file, scene.objects[index]);
+	}
+
+	if (!file)
+	{
+		std::cerr << "[CellWorld] failed writing " << path << "\n";
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  Reads and validates the header, lights and cell table,
+ *  and keeps the file open for ReadCell().
+ ***********************************************************/
+bool CellWorldFile::Open(const std::string& path, std::vector<LightData>& lights)
+{
+	m_pFile.reset();
+	m_cells.clear();
+	m_objectCount = 0;
+	m_path = path;
+
+	if (VirtualFileSystem::ReadPackaged(path, m_blob))
+	{
+		m_pFile = std::make_unique<AssetStream>(m_blob);
+	}
+	else
+	{
+		std::unique_ptr<std::ifstream> pLoose = std::make_unique<std::ifstream>(path, std::ios::binary);
+		if (!pLoose->is_open())
+		{
+			std::cerr << "[CellWorld] cannot open " << path << "\n";
+			return false;
+		}
+		m_pFile = std::move(pLoose);
+	}
+	std::istream& file = *m_pFile;
+
+	char magic[4] = {};
+	uint32_t version = 0;
+	uint32_t seed = 0;
+	uint32_t lightCount = 0;
+	file.read(magic, sizeof(magic));
+	if (!file || (std::memcmp(magic, g_Magic, sizeof(magic)) != 0) ||
+		!ReadValue(file, version) || (version != g_Version) ||
+		!ReadValue(file, seed) || !ReadValue(file, m_textureCount) ||
+		!ReadValue(file, m_cellSize) || !ReadValue(file, m_origin.x) ||
+		!ReadValue(file, m_origin.y) || !ReadValue(file, m_cellsX) ||
+		!ReadValue(file, m_cellsZ) || !ReadValue(file, lightCount) ||
+		!(m_cellSize > 0.0f) || (m_cellsX == 0) || (m_cellsZ == 0) ||
+		(static_cast<uint64_t>(m_cellsX) * m_cellsZ > g_MaxCells) || (lightCount > g_MaxCells))
+	{
+		std::cerr << "[CellWorld] " << path << " is not a version " << g_Version << " cell world\n";
+		m_pFile.reset();
+		return false;
+	}
+
+	lights.resize(lightCount);
+	for (LightData& light : lights)
+	{
+		if (!SceneGenerator::ReadLight(file, light))
+		{
+			std::cerr << "[CellWorld] " << path << " is truncated\n";
+			lights.clear();
+			m_pFile.reset();
+			return false;
+		}
+	}
+
+	m_cells.resize(static_cast<size_t>(m_cellsX) * m_cellsZ);
+	for (CELL& cell : m_cells)
+	{
+		if (!ReadValue(file, cell.offset) || !ReadValue(file, cell.objectCount))
+		{
+			std::cerr << "[CellWorld] " << path << " is truncated\n";
+			m_cells.clear();
+			lights.clear();
+			m_pFile.reset();
+			return false;
+		}
+		m_objectCount += cell.objectCount;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  ReadCell()
+ *
+ *  Reads the objects of one cell, replacing the contents of
+ *  the vector but keeping its storage.
+ ***********************************************************/
+bool CellWorldFile::ReadCell(uint32_t cell, std::vector<GeneratedObject>& objects)
+{
+	objects.clear();
+	if (!m_pFile || (cell >= m_cells.size()))
+	{
+		return false;
+	}
+
+	std::istream& file = *m_pFile;
+	file.clear();
+	file.seekg(static_cast<std::streamoff>(m_cells[cell].offset));
+	objects.resize(m_cells[cell].objectCount);
+	for (GeneratedObject& object : objects)
+	{
+		if (!SceneGenerator::ReadObject(file, object))
+		{
+			std::cerr << "[CellWorld] cell " << cell << " of " << m_path << " is truncated or corrupt\n";
+			objects.clear();
+			return false;
+		}
+	}
+	return true;
+}
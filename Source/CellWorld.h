@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// cellworld.h
+// ============
+// spatially partitioned scene files - the objects of a generated scene
+// grouped into square cells on the ground plane, so that the cells around
+// the camera can be read on their own
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGenerator.h"
+#include "VirtualFileSystem.h"
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  CellWorldFile
+ *
+ *  Only the header, the lights and the cell table are read
+ *  by Open(); the objects stay on disk until ReadCell(). A
+ *  file is read by one thread at a time.
+ ***********************************************************/
+class CellWorldFile
+{
+public:
+	struct CELL
+	{
+		uint64_t offset;
+		uint32_t objectCount;
+	};
+
+	// partition a scene into cells of cellSize on x and z
+	static bool Save(const std::string& path, const GeneratedScene& scene, float cellSize);
+
+	bool Open(const std::string& path, std::vector<LightData>& lights);
+	bool ReadCell(uint32_t cell, std::vector<GeneratedObject>& objects);
+
+	uint32_t GetCellCount() const { return static_cast<uint32_t>(m_cells.size()); }
+	uint32_t GetCellsX() const { return m_cellsX; }
+	uint32_t GetCellsZ() const { return m_cellsZ; }
+	float GetCellSize() const { return m_cellSize; }
+	// x/z corner of the first cell
+	glm::vec2 GetOrigin() const { return m_origin; }
+	const CELL& GetCell(uint32_t cell) const { return m_cells[cell]; }
+	uint64_t GetObjectCount() const { return m_objectCount; }
+	uint32_t GetTextureCount() const { return m_textureCount; }
+
+	// bytes ReadCell() reads for a cell
+	static uint64_t GetCellBytes(const CELL& cell)
+	{
+		return static_cast<uint64_t>(cell.objectCount) * SceneGenerator::kObjectRecordSize;
+	}
+
+private:
+	// a stream over the mapped entry when the world is packaged,
+	// otherwise the loose file, which is never read whole
+	AssetBlob m_blob;
+	std::unique_ptr<std::istream> m_pFile;
+	std::string m_path;
+	std::vector<CELL> m_cells;
+	uint32_t m_cellsX = 0;
+	uint32_t m_cellsZ = 0;
+	float m_cellSize = 0.0f;
+	glm::vec2 m_origin = glm::vec2(0.0f);
+	uint64_t m_objectCount = 0;
+	uint32_t m_textureCount = 0;
+};
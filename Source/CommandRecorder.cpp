@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////////
+// commandrecorder.cpp
+// ============
+// multithreaded recording of POD render commands into per-partition linear
+// command buffers, followed by a parallel sort/merge into submission order
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CommandRecorder.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// below this many objects per partition the job overhead dominates
+	const uint32_t g_MinObjectsPerPartition = 256;
+
+	bool CompareCommands(const RenderCommand& a, const RenderCommand& b)
+	{
+		return a.sortKey < b.sortKey;
+	}
+}
+
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  Packs the state and depth of a draw item into a single
+ *  integer so that sorting groups state changes together.
+ ***********************************************************/
+uint64_t MakeSortKey(const DrawItem& item, float viewDepth, float farPlane)
+{
+	const uint64_t translucent = (item.color.a < 1.0f && !item.bUseTexture) ? 1u : 0u;
+	const uint64_t texture = item.bUseTexture ? (item.textureID & 0xFFFFFu) : 0u;
+	const uint64_t mesh = static_cast<uint64_t>(item.mesh) & 0x7u;
+
+	float normalized = (farPlane > 0.0f) ? viewDepth / farPlane : 0.0f;
+	normalized = std::min(std::max(normalized, 0.0f), 1.0f);
+	uint64_t depth = static_cast<uint64_t>(normalized * 65535.0f);
+	if (translucent)
+	{
+		// translucent draws blend back to front
+		depth = 65535u - depth;
+	}
+
+	return (translucent << 63) |
+		(texture << 43) |
+		(mesh << 40) |
+		(depth << 24) |
+		(static_cast<uint64_t>(item.objectIndex) & 0xFFFFFFu);
+}
+
+/***********************************************************
+ *  CommandRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CommandRecorder::CommandRecorder(JobSystem* pJobSystem, FrameArena* pFrameArena)
+	: m_pJobSystem(pJobSystem), m_pFrameArena(pFrameArena)
+{
+}
+
+/***********************************************************
+ *  ChoosePartitionCount()
+ *
+ *  One partition per thread, fewer when there are not enough
+ *  objects to keep every partition busy.
+ ***********************************************************/
+uint32_t CommandRecorder::ChoosePartitionCount(uint32_t objectCount) const
+{
+	uint32_t threads = (m_pJobSystem != nullptr) ? m_pJobSystem->GetThreadCount() : 1;
+	uint32_t byWork = objectCount / g_MinObjectsPerPartition;
+	return std::max(1u, std::min(threads, byWork));
+}
+
+/***********************************************************
+ *  RecordedCount()
+ *
+ *  Sum of the commands in all active partitions.
+ ***********************************************************/
+size_t CommandRecorder::RecordedCount() const
+{
+	size_t count = 0;
+	for (uint32_t p = 0; p < m_partitionCount; ++p)
+	{
+		count += m_buffers[p].Size();
+	}
+	return count;
+}
+
+/***********************************************************
+ *  Merge()
+ *
+ *  Sorts every partition on its own job, then merges sorted
+ *  runs pairwise, in parallel, until one run is left.
+ ***********************************************************/
+void CommandRecorder::Merge(std::vector<RenderCommand>& output)
+{
+	output.clear();
+	if (m_partitionCount == 0)
+	{
+		return;
+	}
+
+	// the output and scratch lists trade storage every frame, so all of
+	// them are kept large enough for everything the partitions can hold
+	size_t capacity = 0;
+	for (uint32_t p = 0; p < m_partitionCount; ++p)
+	{
+		capacity += m_buffers[p].Capacity();
+	}
+	output.reserve(capacity);
+	if (m_partitionCount > 1)
+	{
+		m_scratch[0].reserve(capacity);
+		m_scratch[1].reserve(capacity);
+	}
+
+	// sort each partition independently
+	ForEach(m_partitionCount, [&](uint32_t first, uint32_t last)
+	{
+		for (uint32_t p = first; p < last; ++p)
+		{
+			std::vector<RenderCommand>& commands = m_buffers[p].Commands();
+			std::sort(commands.begin(), commands.end(), CompareCommands);
+		}
+	});
+
+	if (m_partitionCount == 1)
+	{
+		const std::vector<RenderCommand>& commands = m_buffers[0].Commands();
+		output.assign(commands.begin(), commands.end());
+		return;
+	}
+
+	// lay the sorted partitions out back to back and remember
+	// where every run starts
+	std::vector<RenderCommand>* source = &m_scratch[0];
+	std::vector<RenderCommand>* target = &m_scratch[1];
+	source->clear();
+	// the run tables change size every frame, so they come from
+	// the frame arena rather than the heap
+	FrameVector<size_t> runs{ FrameAllocator<size_t>(m_pFrameArena) };
+	runs.reserve(m_partitionCount + 1);
+	for (uint32_t p = 0; p < m_partitionCount; ++p)
+	{
+		runs.push_back(source->size());
+		const std::vector<RenderCommand>& commands = m_buffers[p].Commands();
+		source->insert(source->end(), commands.begin(), commands.end());
+	}
+	runs.push_back(source->size());
+
+	// each round halves the number of runs
+	FrameVector<size_t> nextRuns{ FrameAllocator<size_t>(m_pFrameArena) };
+	nextRuns.reserve(runs.size());
+	while (runs.size() > 2)
+	{
+		const uint32_t runCount = static_cast<uint32_t>(runs.size() - 1);
+		const uint32_t pairCount = (runCount + 1) / 2;
+		target->resize(source->size());
+
+		ForEach(pairCount, [&](uint32_t first, uint32_t last)
+		{
+			for (uint32_t pair = first; pair < last; ++pair)
+			{
+				const size_t begin = runs[pair * 2];
+				const size_t middle = runs[pair * 2 + 1];
+				const size_t end = (pair * 2 + 2 < runs.size()) ? runs[pair * 2 + 2] : middle;
+				std::merge(source->begin() + begin, source->begin() + middle,
+					source->begin() + middle, source->begin() + end,
+					target->begin() + begin, CompareCommands);
+			}
+		});
+
+		nextRuns.clear();
+		for (uint32_t pair = 0; pair < pairCount; ++pair)
+		{
+			nextRuns.push_back(runs[pair * 2]);
+		}
+		nextRuns.push_back(runs.back());
+		runs.swap(nextRuns);
+		std::swap(source, target);
+	}
+
+	output.swap(*source);
+}
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// commandrecorder.h
+// ============
+// multithreaded recording of POD render commands into per-partition linear
+// command buffers, followed by a parallel sort/merge into submission order
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "RenderTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderCommand
+ *
+ *  A draw item tagged with the key it is submitted in.
+ ***********************************************************/
+struct RenderCommand
+{
+	uint64_t sortKey;
+	DrawItem item;
+};
+
+// build the submission order key for a draw item:
+//   [63]    translucent, drawn after everything opaque
+//   [62:43] texture ID, so draws sharing a texture are adjacent
+//   [42:40] mesh type, so draws sharing a VAO are adjacent
+//   [39:24] quantized view depth, front to back within a state
+//   [23:0]  object index, which makes the order deterministic
+uint64_t MakeSortKey(const DrawItem& item, float viewDepth, float farPlane);
+
+/***********************************************************
+ *  CommandBuffer
+ *
+ *  Linear, append-only list of render commands written by
+ *  exactly one job. Capacity is kept across frames.
+ ***********************************************************/
+class CommandBuffer
+{
+public:
+	void Clear() { m_commands.clear(); }
+	void Push(const RenderCommand& command) { m_commands.push_back(command); }
+	void Reserve(size_t count) { m_commands.reserve(count); }
+
+	size_t Size() const { return m_commands.size(); }
+	size_t Capacity() const { return m_commands.capacity(); }
+	const std::vector<RenderCommand>& Commands() const { return m_commands; }
+	std::vector<RenderCommand>& Commands() { return m_commands; }
+
+private:
+	std::vector<RenderCommand> m_commands;
+};
+
+/***********************************************************
+ *  CommandRecorder
+ *
+ *  Splits a range of objects into one partition per thread,
+ *  lets each partition record into its own CommandBuffer,
+ *  then sorts the buffers in parallel and merges them
+ *  pairwise into a single list in sort key order. Makes no
+ *  GL calls, so it can be exercised without a context.
+ ***********************************************************/
+class CommandRecorder
+{
+public:
+	// pJobSystem may be null, in which case everything runs on the caller;
+	// pFrameArena, when given, holds the merge bookkeeping of each frame
+	explicit CommandRecorder(JobSystem* pJobSystem = nullptr, FrameArena* pFrameArena = nullptr);
+
+	// record(objectIndex, buffer) is called once for every index in
+	// [0, objectCount) and may push any number of commands
+	template <typename RecordFunction>
+	void Record(uint32_t objectCount, const RecordFunction& record);
+
+	// sort and merge all partitions into the output list
+	void Merge(std::vector<RenderCommand>& output);
+
+	// total commands recorded by the last Record()
+	size_t RecordedCount() const;
+	uint32_t PartitionCount() const { return m_partitionCount; }
+
+private:
+	// every partition keeps room for one command per object it owns, up
+	// to this many, so frames below the peak do not reallocate
+	static const uint32_t kMaxReservedCommands = 16384;
+
+	uint32_t ChoosePartitionCount(uint32_t objectCount) const;
+	template <typename Body>
+	void ForEach(uint32_t count, const Body& body);
+
+	JobSystem* m_pJobSystem;
+	FrameArena* m_pFrameArena;
+	std::vector<CommandBuffer> m_buffers;
+	uint32_t m_partitionCount = 0;
+	// ping-pong storage for the pairwise merge rounds
+	std::vector<RenderCommand> m_scratch[2];
+};
+
+template <typename Body>
+void CommandRecorder::ForEach(uint32_t count, const Body& body)
+{
+	if (m_pJobSystem != nullptr)
+	{
+		m_pJobSystem->ParallelFor(count, 1, body);
+	}
+	else
+	{
+		body(0u, count);
+	}
+}
+
+template <typename RecordFunction>
+void CommandRecorder::Record(uint32_t objectCount, const RecordFunction& record)
+{
+	m_partitionCount = ChoosePartitionCount(objectCount);
+	if (m_buffers.size() < m_partitionCount)
+	{
+		m_buffers.resize(m_partitionCount);
+	}
+
+	const uint32_t partitionCount = m_partitionCount;
+	const uint32_t perPartition = (objectCount + partitionCount - 1) / partitionCount;
+	ForEach(partitionCount, [&](uint32_t first, uint32_t last)
+	{
+		for (uint32_t p = first; p < last; ++p)
+		{
+			CommandBuffer& buffer = m_buffers[p];
+			buffer.Clear();
+
+			const uint32_t begin = p * perPartition;
+			const uint32_t end = (begin + perPartition < objectCount) ? begin + perPartition : objectCount;
+			buffer.Reserve((end - begin < kMaxReservedCommands) ? end - begin : kMaxReservedCommands);
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				record(i, buffer);
+			}
+		}
+	});
+}
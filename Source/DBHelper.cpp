@@ -1,4 +1,4 @@
-#include "DbHelper.h"
+#include "DBHelper.h"
 #include <iostream>
 
 static int noop_cb(void*, int, char**, char**) { return 0; }
@@ -45,6 +45,31 @@ bool DbHelper::ensureSchema() {
             "ts DATETIME DEFAULT CURRENT_TIMESTAMP,"
             "fps REAL, frame_ms REAL"
         ");",
+        "CREATE TABLE IF NOT EXISTS frame_pacing ("
+            "ts DATETIME DEFAULT CURRENT_TIMESTAMP,"
+            "mean_ms REAL, stddev_ms REAL, p99_ms REAL, max_ms REAL,"
+            "swap_interval INTEGER, target_fps REAL"
+        ");",
+        "CREATE TABLE IF NOT EXISTS resolution_scale ("
+            "ts DATETIME DEFAULT CURRENT_TIMESTAMP,"
+            "scale REAL, gpu_ms REAL, width INTEGER, height INTEGER"
+        ");",
+        "CREATE TABLE IF NOT EXISTS benchmark_runs ("
+            "ts DATETIME DEFAULT CURRENT_TIMESTAMP,"
+            "name TEXT, frames INTEGER, mean_ms REAL, p99_ms REAL, max_ms REAL,"
+            "draw_calls REAL, culled_objects REAL"
+        ");",
+        "CREATE TABLE IF NOT EXISTS perf_comparisons ("
+            "ts DATETIME DEFAULT CURRENT_TIMESTAMP,"
+            "benchmark TEXT, baseline_file TEXT, candidate_file TEXT,"
+            "baseline_ms REAL, candidate_ms REAL, ratio REAL, p_value REAL,"
+            "regression INTEGER"
+        ");",
+        "CREATE TABLE IF NOT EXISTS idle_stats ("
+            "ts DATETIME DEFAULT CURRENT_TIMESTAMP,"
+            "interval_s REAL, idle_s REAL,"
+            "rendered_frames INTEGER, presented_frames INTEGER, wakeups INTEGER"
+        ");",
         "CREATE TABLE IF NOT EXISTS errors ("
             "ts DATETIME DEFAULT CURRENT_TIMESTAMP,"
             "source TEXT, message TEXT"
@@ -120,6 +145,160 @@ bool DbHelper::logTelemetry(double fps, double frameMs) {
     return ok;
 }
 
+bool DbHelper::logFramePacing(double meanMs, double stddevMs, double p99Ms,
+                              double maxMs, int swapInterval, double targetFps) {
+    if (!db_) return false;
+
+    const char* sql =
+        "INSERT INTO frame_pacing(mean_ms, stddev_ms, p99_ms, max_ms, swap_interval, target_fps) "
+        "VALUES(?, ?, ?, ?, ?, ?);";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "[DbHelper] prepare(logFramePacing) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+        return false;
+    }
+
+    sqlite3_bind_double(stmt, 1, meanMs);
+    sqlite3_bind_double(stmt, 2, stddevMs);
+    sqlite3_bind_double(stmt, 3, p99Ms);
+    sqlite3_bind_double(stmt, 4, maxMs);
+    sqlite3_bind_int(stmt, 5, swapInterval);
+    sqlite3_bind_double(stmt, 6, targetFps);
+
+    bool ok = (sqlite3_step(stmt) == SQLITE_DONE);
+    if (!ok) {
+        std::cerr << "[DbHelper] step(logFramePacing) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+bool DbHelper::logResolutionScale(double scale, double gpuMs, int width, int height) {
+    if (!db_) return false;
+
+    const char* sql =
+        "INSERT INTO resolution_scale(scale, gpu_ms, width, height) VALUES(?, ?, ?, ?);";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "[DbHelper] prepare(logResolutionScale) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+        return false;
+    }
+
+    sqlite3_bind_double(stmt, 1, scale);
+    sqlite3_bind_double(stmt, 2, gpuMs);
+    sqlite3_bind_int(stmt, 3, width);
+    sqlite3_bind_int(stmt, 4, height);
+
+    bool ok = (sqlite3_step(stmt) == SQLITE_DONE);
+    if (!ok) {
+        std::cerr << "[DbHelper] step(logResolutionScale) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+bool DbHelper::logBenchmark(const std::string& name, int frames, double meanMs,
+                            double p99Ms, double maxMs, double drawCalls, double culledObjects) {
+    if (!db_) return false;
+
+    const char* sql =
+        "INSERT INTO benchmark_runs(name, frames, mean_ms, p99_ms, max_ms, draw_calls, culled_objects) "
+        "VALUES(?, ?, ?, ?, ?, ?, ?);";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "[DbHelper] prepare(logBenchmark) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, frames);
+    sqlite3_bind_double(stmt, 3, meanMs);
+    sqlite3_bind_double(stmt, 4, p99Ms);
+    sqlite3_bind_double(stmt, 5, maxMs);
+    sqlite3_bind_double(stmt, 6, drawCalls);
+    sqlite3_bind_double(stmt, 7, culledObjects);
+
+    bool ok = (sqlite3_step(stmt) == SQLITE_DONE);
+    if (!ok) {
+        std::cerr << "[DbHelper] step(logBenchmark) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+bool DbHelper::logPerfComparison(const std::string& benchmark, const std::string& baselineFile,
+                                 const std::string& candidateFile, double baselineMs,
+                                 double candidateMs, double ratio, double pValue, bool regression) {
+    if (!db_) return false;
+
+    const char* sql =
+        "INSERT INTO perf_comparisons(benchmark, baseline_file, candidate_file, baseline_ms, "
+        "candidate_ms, ratio, p_value, regression) VALUES(?, ?, ?, ?, ?, ?, ?, ?);";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "[DbHelper] prepare(logPerfComparison) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, benchmark.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, baselineFile.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, candidateFile.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_double(stmt, 4, baselineMs);
+    sqlite3_bind_double(stmt, 5, candidateMs);
+    sqlite3_bind_double(stmt, 6, ratio);
+    sqlite3_bind_double(stmt, 7, pValue);
+    sqlite3_bind_int(stmt, 8, regression ? 1 : 0);
+
+    bool ok = (sqlite3_step(stmt) == SQLITE_DONE);
+    if (!ok) {
+        std::cerr << "[DbHelper] step(logPerfComparison) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+bool DbHelper::logIdleStats(double intervalSeconds, double idleSeconds,
+                            int renderedFrames, int presentedFrames, int wakeups) {
+    if (!db_) return false;
+
+    const char* sql =
+        "INSERT INTO idle_stats(interval_s, idle_s, rendered_frames, presented_frames, wakeups) "
+        "VALUES(?, ?, ?, ?, ?);";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "[DbHelper] prepare(logIdleStats) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+        return false;
+    }
+
+    sqlite3_bind_double(stmt, 1, intervalSeconds);
+    sqlite3_bind_double(stmt, 2, idleSeconds);
+    sqlite3_bind_int(stmt, 3, renderedFrames);
+    sqlite3_bind_int(stmt, 4, presentedFrames);
+    sqlite3_bind_int(stmt, 5, wakeups);
+
+    bool ok = (sqlite3_step(stmt) == SQLITE_DONE);
+    if (!ok) {
+        std::cerr << "[DbHelper] step(logIdleStats) failed: "
+                  << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
 bool DbHelper::logError(const std::string& source, const std::string& message) {
     if (!db_) return false;
 
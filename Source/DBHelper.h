@@ -22,6 +22,26 @@ public:
     // Telemetry: FPS and frame time (ms)
     bool logTelemetry(double fps, double frameMs);
 
+    // Frame pacing: frame-time distribution over one report interval
+    bool logFramePacing(double meanMs, double stddevMs, double p99Ms,
+                        double maxMs, int swapInterval, double targetFps);
+
+    // Dynamic resolution: scale chosen, smoothed GPU time, render size
+    bool logResolutionScale(double scale, double gpuMs, int width, int height);
+
+    // Benchmark run: summary of a timed run such as the flythrough
+    bool logBenchmark(const std::string& name, int frames, double meanMs,
+                      double p99Ms, double maxMs, double drawCalls, double culledObjects);
+
+    // Performance gate: one benchmark compared between two runs
+    bool logPerfComparison(const std::string& benchmark, const std::string& baselineFile,
+                           const std::string& candidateFile, double baselineMs,
+                           double candidateMs, double ratio, double pValue, bool regression);
+
+    // Idle rendering: time blocked on events and frames per interval
+    bool logIdleStats(double intervalSeconds, double idleSeconds,
+                      int renderedFrames, int presentedFrames, int wakeups);
+
     // Error log: source + message
     bool logError(const std::string& source, const std::string& message);
 
@@ -0,0 +1,385 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// dynamic resolution scaling - the scene renders into an offscreen target
+// whose size follows the measured GPU frame time, then gets upscaled and
+// sharpened into the window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+#include "ShaderUtils.h"
+#include "DBHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+
+extern std::unique_ptr<DbHelper> g_Db;
+
+// declaration of global variables
+namespace
+{
+	// weight of the newest sample in the smoothed GPU time
+	const double g_SmoothingFactor = 0.2;
+}
+
+/***********************************************************
+ *  DynamicResolutionController()
+ *
+ *  The constructor for the class - starts at full scale.
+ ***********************************************************/
+DynamicResolutionController::DynamicResolutionController(const DynamicResolutionConfig& cfg)
+	: m_cfg(cfg)
+	, m_scale(cfg.maxScale)
+{
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  Smooths the GPU time and steps the scale once the over-
+ *  or under-budget condition has held long enough.
+ ***********************************************************/
+bool DynamicResolutionController::Update(double gpuMs)
+{
+	if (!m_bHasSample)
+	{
+		m_smoothedGpuMs = gpuMs;
+		m_bHasSample = true;
+	}
+	else
+	{
+		m_smoothedGpuMs += g_SmoothingFactor * (gpuMs - m_smoothedGpuMs);
+	}
+
+	if (m_smoothedGpuMs > m_cfg.gpuBudgetMs)
+	{
+		m_overBudgetFrames++;
+		m_underBudgetFrames = 0;
+	}
+	else if (m_smoothedGpuMs < m_cfg.gpuBudgetMs * m_cfg.headroomFraction)
+	{
+		m_underBudgetFrames++;
+		m_overBudgetFrames = 0;
+	}
+	else
+	{
+		// inside the dead band - hold the current scale
+		m_overBudgetFrames = 0;
+		m_underBudgetFrames = 0;
+	}
+
+	float newScale = m_scale;
+	if (m_overBudgetFrames >= m_cfg.framesBeforeDecrease)
+	{
+		// pixel cost scales with the area, so step harder the
+		// further over budget the frame is
+		float target = m_scale * static_cast<float>(std::sqrt(m_cfg.gpuBudgetMs / m_smoothedGpuMs));
+		newScale = std::min(m_scale - m_cfg.scaleStep, target);
+		m_overBudgetFrames = 0;
+	}
+	else if (m_underBudgetFrames >= m_cfg.framesBeforeIncrease)
+	{
+		newScale = m_scale + m_cfg.scaleStep;
+		m_underBudgetFrames = 0;
+	}
+
+	newScale = std::min(std::max(newScale, m_cfg.minScale), m_cfg.maxScale);
+	if (std::fabs(newScale - m_scale) < 1e-4f)
+	{
+		return false;
+	}
+	m_scale = newScale;
+	return true;
+}
+
+/***********************************************************
+ *  GpuTimer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuTimer::GpuTimer()
+{
+	for (uint32_t i = 0; i < kQueryCount; ++i)
+	{
+		m_queries[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~GpuTimer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuTimer::~GpuTimer()
+{
+	if (m_queries[0] != 0)
+	{
+		glDeleteQueries(kQueryCount, m_queries);
+	}
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  Starts timing into the next query of the ring. If every
+ *  query is still pending the oldest result is dropped.
+ ***********************************************************/
+void GpuTimer::Begin()
+{
+	if (m_queries[0] == 0)
+	{
+		glGenQueries(kQueryCount, m_queries);
+	}
+	if (m_pendingCount == kQueryCount)
+	{
+		m_pendingCount--;
+	}
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_writeIndex]);
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  Stops timing the current query.
+ ***********************************************************/
+void GpuTimer::End()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	m_writeIndex = (m_writeIndex + 1) % kQueryCount;
+	m_pendingCount++;
+}
+
+/***********************************************************
+ *  TryGetResult()
+ *
+ *  Reads the oldest pending query without blocking.
+ ***********************************************************/
+bool GpuTimer::TryGetResult(double& milliseconds)
+{
+	if (m_pendingCount == 0)
+	{
+		return false;
+	}
+
+	uint32_t oldest = (m_writeIndex + kQueryCount - m_pendingCount) % kQueryCount;
+	GLint available = 0;
+	glGetQueryObjectiv(m_queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		return false;
+	}
+
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(m_queries[oldest], GL_QUERY_RESULT, &nanoseconds);
+	m_pendingCount--;
+	milliseconds = static_cast<double>(nanoseconds) / 1.0e6;
+	return true;
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution(const DynamicResolutionConfig& cfg)
+	: m_cfg(cfg)
+	, m_controller(cfg)
+{
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+	DestroyTarget();
+	if (m_upscaleProgram != 0)
+	{
+		glDeleteProgram(m_upscaleProgram);
+	}
+	if (m_emptyVertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArray);
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  Compiles the upscale/sharpen program. The fullscreen
+ *  triangle is generated in the vertex shader, but core
+ *  profile still needs a vertex array to be bound.
+ ***********************************************************/
+bool DynamicResolution::Initialize(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	std::string errorLog;
+	m_upscaleProgram = LoadShaderProgram(vertexShaderPath, fragmentShaderPath, errorLog);
+	if (m_upscaleProgram == 0)
+	{
+		std::cerr << "[DynamicResolution] upscale shader failed: " << errorLog << "\n";
+		if (g_Db && g_Db->isOpen()) {
+			g_Db->logError("DynamicResolution", errorLog);
+		}
+		return false;
+	}
+
+	m_uvScaleLocation = glGetUniformLocation(m_upscaleProgram, "uvScale");
+	m_texelSizeLocation = glGetUniformLocation(m_upscaleProgram, "texelSize");
+	m_sharpnessLocation = glGetUniformLocation(m_upscaleProgram, "sharpness");
+	glUseProgram(m_upscaleProgram);
+	glUniform1i(glGetUniformLocation(m_upscaleProgram, "sceneTexture"), 0);
+
+	glGenVertexArrays(1, &m_emptyVertexArray);
+	return true;
+}
+
+/***********************************************************
+ *  ResizeTarget()
+ *
+ *  (Re)creates the offscreen color and depth attachments.
+ ***********************************************************/
+void DynamicResolution::ResizeTarget(int width, int height)
+{
+	DestroyTarget();
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "[DynamicResolution] offscreen framebuffer is incomplete\n";
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_targetWidth = width;
+	m_targetHeight = height;
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  Frees the offscreen attachments.
+ ***********************************************************/
+void DynamicResolution::DestroyTarget()
+{
+	if (m_framebuffer != 0) glDeleteFramebuffers(1, &m_framebuffer);
+	if (m_colorTexture != 0) glDeleteTextures(1, &m_colorTexture);
+	if (m_depthBuffer != 0) glDeleteRenderbuffers(1, &m_depthBuffer);
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthBuffer = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  Feeds finished GPU timings to the controller and logs
+ *  every scale it settles on.
+ ***********************************************************/
+void DynamicResolution::UpdateScale()
+{
+	double gpuMs = 0.0;
+	while (m_gpuTimer.TryGetResult(gpuMs))
+	{
+		if (m_controller.Update(gpuMs))
+		{
+			const float scale = m_controller.GetScale();
+			const int width = static_cast<int>(m_windowWidth * scale);
+			const int height = static_cast<int>(m_windowHeight * scale);
+			std::cout << "INFO: render scale " << scale << " (" << width << "x" << height
+				<< ", GPU " << m_controller.GetSmoothedGpuMs() << " ms)\n";
+			if (g_Db && g_Db->isOpen()) {
+				g_Db->logResolutionScale(scale, m_controller.GetSmoothedGpuMs(), width, height);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginScene()
+ *
+ *  Binds the offscreen target with the viewport set to the
+ *  current render resolution and starts the GPU timer.
+ ***********************************************************/
+void DynamicResolution::BeginScene(int windowWidth, int windowHeight)
+{
+	UpdateScale();
+
+	m_windowWidth = windowWidth;
+	m_windowHeight = windowHeight;
+	// a minimized window reports a zero size
+	const int targetWidth = std::max(1, static_cast<int>(std::ceil(windowWidth * m_cfg.maxScale)));
+	const int targetHeight = std::max(1, static_cast<int>(std::ceil(windowHeight * m_cfg.maxScale)));
+	if ((targetWidth != m_targetWidth) || (targetHeight != m_targetHeight))
+	{
+		ResizeTarget(targetWidth, targetHeight);
+	}
+
+	const float scale = m_controller.GetScale();
+	m_renderWidth = std::max(1, std::min(m_targetWidth, static_cast<int>(windowWidth * scale)));
+	m_renderHeight = std::max(1, std::min(m_targetHeight, static_cast<int>(windowHeight * scale)));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+	m_gpuTimer.Begin();
+}
+
+/***********************************************************
+ *  EndScene()
+ *
+ *  Stops the GPU timer for the scene pass.
+ ***********************************************************/
+void DynamicResolution::EndScene()
+{
+	m_gpuTimer.End();
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  Draws the rendered sub-rectangle of the scene target to
+ *  the whole window through the sharpening shader.
+ ***********************************************************/
+void DynamicResolution::Present()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_windowWidth, m_windowHeight);
+	glDisable(GL_DEPTH_TEST);
+
+	glUseProgram(m_upscaleProgram);
+	glUniform2f(m_uvScaleLocation,
+		static_cast<float>(m_renderWidth) / m_targetWidth,
+		static_cast<float>(m_renderHeight) / m_targetHeight);
+	glUniform2f(m_texelSizeLocation, 1.0f / m_targetWidth, 1.0f / m_targetHeight);
+	glUniform1f(m_sharpnessLocation, m_cfg.sharpness);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glBindVertexArray(m_emptyVertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// dynamic resolution scaling - the scene renders into an offscreen target
+// whose size follows the measured GPU frame time, then gets upscaled and
+// sharpened into the window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+struct DynamicResolutionConfig
+{
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+	// GPU time the scene pass may take per frame
+	double gpuBudgetMs = 12.0;
+	// scale change per adjustment
+	float scaleStep = 0.05f;
+	// only scale up while below this fraction of the budget
+	double headroomFraction = 0.8;
+	// consecutive frames a condition must hold before the scale moves;
+	// scaling up waits longer than scaling down
+	uint32_t framesBeforeDecrease = 4;
+	uint32_t framesBeforeIncrease = 60;
+	// 0 = plain bilinear upscale, 1 = strongest sharpening
+	float sharpness = 0.5f;
+};
+
+/***********************************************************
+ *  DynamicResolutionController
+ *
+ *  Decides the render scale from GPU frame times. Drops the
+ *  scale quickly when over budget and raises it slowly once
+ *  there is clear headroom; the gap between the two
+ *  thresholds and the frame counts form the hysteresis.
+ *  Makes no GL calls.
+ ***********************************************************/
+class DynamicResolutionController
+{
+public:
+	explicit DynamicResolutionController(const DynamicResolutionConfig& cfg = {});
+
+	// feed one GPU time measurement; returns true if the scale changed
+	bool Update(double gpuMs);
+
+	float GetScale() const { return m_scale; }
+	double GetSmoothedGpuMs() const { return m_smoothedGpuMs; }
+
+private:
+	DynamicResolutionConfig m_cfg;
+	float m_scale;
+	double m_smoothedGpuMs = 0.0;
+	bool m_bHasSample = false;
+	uint32_t m_overBudgetFrames = 0;
+	uint32_t m_underBudgetFrames = 0;
+};
+
+/***********************************************************
+ *  GpuTimer
+ *
+ *  GL_TIME_ELAPSED queries in a small ring, read back a few
+ *  frames later so that measuring never stalls the CPU.
+ ***********************************************************/
+class GpuTimer
+{
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	void Begin();
+	void End();
+	// returns true when an older query has a result available
+	bool TryGetResult(double& milliseconds);
+
+private:
+	static const uint32_t kQueryCount = 4;
+
+	GLuint m_queries[kQueryCount];
+	uint32_t m_writeIndex = 0;
+	uint32_t m_pendingCount = 0;
+};
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  Owns the offscreen scene target, the GPU timer, the
+ *  controller and the upscale pass. The target is allocated
+ *  at the maximum scale and rendered into a sub-rectangle,
+ *  so changing the scale never reallocates.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	explicit DynamicResolution(const DynamicResolutionConfig& cfg = {});
+	~DynamicResolution();
+
+	// compile the upscale shader; returns false if it fails
+	bool Initialize(const char* vertexShaderPath, const char* fragmentShaderPath);
+
+	// bind the offscreen target for a window of the given size
+	void BeginScene(int windowWidth, int windowHeight);
+	// stop timing the scene pass
+	void EndScene();
+	// upscale the scene into the default framebuffer; leaves the
+	// upscale program bound, so callers re-bind their own program
+	void Present();
+
+	float GetScale() const { return m_controller.GetScale(); }
+	int GetRenderWidth() const { return m_renderWidth; }
+	int GetRenderHeight() const { return m_renderHeight; }
+	GLuint GetSceneFramebuffer() const { return m_framebuffer; }
+
+private:
+	void ResizeTarget(int width, int height);
+	void DestroyTarget();
+	void UpdateScale();
+
+	DynamicResolutionConfig m_cfg;
+	DynamicResolutionController m_controller;
+	GpuTimer m_gpuTimer;
+
+	GLuint m_framebuffer = 0;
+	GLuint m_colorTexture = 0;
+	GLuint m_depthBuffer = 0;
+	GLuint m_upscaleProgram = 0;
+	GLuint m_emptyVertexArray = 0;
+	GLint m_uvScaleLocation = -1;
+	GLint m_texelSizeLocation = -1;
+	GLint m_sharpnessLocation = -1;
+
+	int m_targetWidth = 0;
+	int m_targetHeight = 0;
+	int m_windowWidth = 0;
+	int m_windowHeight = 0;
+	int m_renderWidth = 0;
+	int m_renderHeight = 0;
+};
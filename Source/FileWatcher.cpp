@@ -0,0 +1,281 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// file change notification for hot reloading - inotify on Linux, polling of
+// the modification times everywhere else, with changes reported only once
+// the writes to a file have settled
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#include <filesystem>
+#include <iostream>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// a file must be quiet this long before it is reported
+	const std::chrono::milliseconds g_SettleTime(150);
+	// interval of the directory scans when polling
+	const std::chrono::milliseconds g_PollInterval(500);
+	// how long the inotify thread waits for events before checking
+	// whether it should stop
+	const int g_NotifyTimeoutMs = 100;
+
+	std::string JoinPath(const std::string& directory, const std::string& name)
+	{
+		return (std::filesystem::path(directory) / name).lexically_normal().generic_string();
+	}
+}
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher()
+{
+}
+
+/***********************************************************
+ *  ~FileWatcher()
+ *
+ *  The destructor for the class - stops the watch thread.
+ ***********************************************************/
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  AddDirectory()
+ *
+ *  Adds a directory to watch. Subdirectories are not
+ *  watched.
+ ***********************************************************/
+bool FileWatcher::AddDirectory(const std::string& directory)
+{
+	std::error_code error;
+	if (!std::filesystem::is_directory(directory, error))
+	{
+		std::cerr << "[FileWatcher] " << directory << " is not a directory\n";
+		return false;
+	}
+	for (const std::string& watched : m_directories)
+	{
+		if (std::filesystem::equivalent(watched, directory, error))
+		{
+			return true;
+		}
+	}
+	m_directories.push_back(directory);
+	return true;
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  Starts the watch thread. Uses inotify where it is
+ *  available and falls back to scanning the directories.
+ ***********************************************************/
+void FileWatcher::Start()
+{
+	if (m_bRunning)
+	{
+		return;
+	}
+	m_bRunning = true;
+
+#if defined(__linux__)
+	m_notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_notifyFd >= 0)
+	{
+		for (const std::string& directory : m_directories)
+		{
+			// saves either close the written file or rename a temporary over it
+			const int watch = inotify_add_watch(m_notifyFd, directory.c_str(),
+				IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (watch >= 0)
+			{
+				m_watchDirectories[watch] = directory;
+			}
+		}
+		m_thread = std::thread(&FileWatcher::NotifyLoop, this);
+		return;
+	}
+	std::cerr << "[FileWatcher] inotify is not available, polling instead\n";
+#endif
+
+	m_bPolling = true;
+	ScanDirectories(false);
+	m_thread = std::thread(&FileWatcher::PollLoop, this);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  Joins the watch thread. Changes not yet polled are kept.
+ ***********************************************************/
+void FileWatcher::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_stopMutex);
+		m_bRunning = false;
+	}
+	m_stopCondition.notify_one();
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+#if defined(__linux__)
+	if (m_notifyFd >= 0)
+	{
+		close(m_notifyFd);
+		m_notifyFd = -1;
+		m_watchDirectories.clear();
+	}
+#endif
+}
+
+/***********************************************************
+ *  PollChanges()
+ *
+ *  Hands out the files whose last event is older than the
+ *  settle time. Files still being written stay pending.
+ ***********************************************************/
+void FileWatcher::PollChanges(std::vector<std::string>& changed)
+{
+	const Clock::time_point now = Clock::now();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto it = m_pending.begin(); it != m_pending.end();)
+	{
+		if (now - it->second >= g_SettleTime)
+		{
+			changed.push_back(it->first);
+			it = m_pending.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+/***********************************************************
+ *  MarkChanged()
+ *
+ *  Records an event for a file, restarting its settle time.
+ ***********************************************************/
+void FileWatcher::MarkChanged(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pending[path] = Clock::now();
+}
+
+/***********************************************************
+ *  NotifyLoop()
+ *
+ *  Body of the watch thread with inotify.
+ ***********************************************************/
+void FileWatcher::NotifyLoop()
+{
+#if defined(__linux__)
+	alignas(inotify_event) char buffer[4096];
+	while (m_bRunning)
+	{
+		pollfd descriptor = { m_notifyFd, POLLIN, 0 };
+		if (poll(&descriptor, 1, g_NotifyTimeoutMs) <= 0)
+		{
+			continue;
+		}
+
+		ssize_t length = 0;
+		while ((length = read(m_notifyFd, buffer, sizeof(buffer))) > 0)
+		{
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				auto directory = m_watchDirectories.find(event->wd);
+				if ((event->len > 0) && !(event->mask & IN_ISDIR) &&
+					(directory != m_watchDirectories.end()))
+				{
+					MarkChanged(JoinPath(directory->second, event->name));
+				}
+				offset += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  PollLoop()
+ *
+ *  Body of the watch thread without change notification.
+ ***********************************************************/
+void FileWatcher::PollLoop()
+{
+	std::unique_lock<std::mutex> lock(m_stopMutex);
+	while (m_bRunning)
+	{
+		m_stopCondition.wait_for(lock, g_PollInterval, [&]() { return !m_bRunning; });
+		if (m_bRunning)
+		{
+			ScanDirectories(true);
+		}
+	}
+}
+
+/***********************************************************
+ *  ScanDirectories()
+ *
+ *  Compares the modification time and size of every file
+ *  with the previous scan. New files count as changed.
+ ***********************************************************/
+void FileWatcher::ScanDirectories(bool bReport)
+{
+	for (const std::string& directory : m_directories)
+	{
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+		{
+			if (!entry.is_regular_file(error))
+			{
+				continue;
+			}
+
+			WATCHED_FILE state;
+			const auto lastWrite = entry.last_write_time(error);
+			// only compared for equality, so the clock does not matter
+			state.lastWrite = Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+				lastWrite.time_since_epoch()));
+			state.size = static_cast<size_t>(entry.file_size(error));
+
+			const std::string path = JoinPath(directory, entry.path().filename().string());
+			auto it = m_files.find(path);
+			if (it == m_files.end())
+			{
+				m_files[path] = state;
+				if (bReport)
+				{
+					MarkChanged(path);
+				}
+			}
+			else if ((it->second.lastWrite != state.lastWrite) || (it->second.size != state.size))
+			{
+				it->second = state;
+				if (bReport)
+				{
+					MarkChanged(path);
+				}
+			}
+		}
+	}
+}
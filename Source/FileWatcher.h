@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// file change notification for hot reloading - inotify on Linux, polling of
+// the modification times everywhere else, with changes reported only once
+// the writes to a file have settled
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  Watches the files directly inside a set of directories
+ *  on a thread of its own. Editors often save in several
+ *  writes or through a temporary file, so a changed file is
+ *  only handed out by PollChanges() after it has been quiet
+ *  for a short while. The paths are the watched directory
+ *  joined with the file name.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// add before Start(); returns false if the directory does not exist
+	bool AddDirectory(const std::string& directory);
+	void Start();
+	void Stop();
+
+	// appends the files that changed and have settled since the last call
+	void PollChanges(std::vector<std::string>& changed);
+
+	// true when the platform has no change notification and the
+	// directories are scanned instead
+	bool IsPolling() const { return m_bPolling; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct WATCHED_FILE
+	{
+		Clock::time_point lastWrite;
+		size_t size;
+	};
+
+	void NotifyLoop();
+	void PollLoop();
+	void ScanDirectories(bool bReport);
+	void MarkChanged(const std::string& path);
+
+	std::vector<std::string> m_directories;
+	bool m_bPolling = false;
+	std::atomic<bool> m_bRunning{ false };
+	std::thread m_thread;
+
+	// wakes the polling thread for Stop()
+	std::mutex m_stopMutex;
+	std::condition_variable m_stopCondition;
+
+	// changed files and the time of their latest event
+	std::mutex m_mutex;
+	std::map<std::string, Clock::time_point> m_pending;
+
+	// polling only: the state of every file at the last scan
+	std::map<std::string, WATCHED_FILE> m_files;
+
+	// inotify only
+	int m_notifyFd = -1;
+	std::map<int, std::string> m_watchDirectories;
+};
@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// per-frame linear allocator - double-buffered bump allocation for transient
+// render data, with an STL allocator adapter and overflow counters
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  Both buffers start at the initial capacity.
+ ***********************************************************/
+FrameArena::FrameArena(size_t initialCapacity)
+{
+	for (BUFFER& buffer : m_buffers)
+	{
+		buffer.memory.reset(new unsigned char[initialCapacity]);
+		buffer.capacity = initialCapacity;
+	}
+	m_requiredCapacity = initialCapacity;
+	m_stats.capacity = initialCapacity;
+}
+
+FrameArena::~FrameArena()
+{
+	for (BUFFER& buffer : m_buffers)
+	{
+		ReleaseOverflow(buffer);
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  Closes the statistics of the frame that ended, then
+ *  switches to the other buffer, growing it first if the
+ *  frames have outgrown it.
+ ***********************************************************/
+void FrameArena::BeginFrame()
+{
+	BUFFER& finished = m_buffers[m_current];
+	const size_t used = finished.offset.load(std::memory_order_acquire);
+	const size_t required = used + finished.overflowBytes;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.frames++;
+	m_stats.lastFrameBytes = required;
+	m_stats.peakFrameBytes = (required > m_stats.peakFrameBytes) ? required : m_stats.peakFrameBytes;
+	m_stats.lastFrameOverflows = static_cast<uint32_t>(finished.overflow.size());
+	m_stats.totalOverflows += finished.overflow.size();
+	m_stats.allocations = m_allocations.load(std::memory_order_relaxed);
+	m_requiredCapacity = (required > m_requiredCapacity) ? required : m_requiredCapacity;
+
+	m_current ^= 1u;
+	BUFFER& next = m_buffers[m_current];
+	ReleaseOverflow(next);
+	if (next.capacity < m_requiredCapacity)
+	{
+		// leave headroom so a slowly growing frame does not
+		// reallocate every time
+		next.capacity = m_requiredCapacity + m_requiredCapacity / 2;
+		next.memory.reset(new unsigned char[next.capacity]);
+	}
+	m_stats.capacity = next.capacity;
+	next.offset.store(0, std::memory_order_release);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  Bumps the offset of the current buffer with a CAS so
+ *  that jobs may allocate concurrently. The alignment must
+ *  be a power of two.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t bytes, size_t alignment)
+{
+	m_allocations.fetch_add(1, std::memory_order_relaxed);
+
+	BUFFER& buffer = m_buffers[m_current];
+	const uintptr_t base = reinterpret_cast<uintptr_t>(buffer.memory.get());
+	size_t offset = buffer.offset.load(std::memory_order_relaxed);
+	while (true)
+	{
+		const uintptr_t start = (base + offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		const size_t end = static_cast<size_t>(start - base) + bytes;
+		if (end > buffer.capacity)
+		{
+			return AllocateOverflow(buffer, bytes, alignment);
+		}
+		if (buffer.offset.compare_exchange_weak(offset, end, std::memory_order_relaxed))
+		{
+			return reinterpret_cast<void*>(start);
+		}
+	}
+}
+
+/***********************************************************
+ *  Format()
+ *
+ *  Formats into arena memory; the text stays valid as long
+ *  as any other allocation of this frame.
+ ***********************************************************/
+const char* FrameArena::Format(const char* format, ...)
+{
+	// most names fit the stack buffer, which saves formatting twice
+	char local[256];
+	va_list args;
+	va_start(args, format);
+	va_list retryArgs;
+	va_copy(retryArgs, args);
+	const int length = std::vsnprintf(local, sizeof(local), format, args);
+	va_end(args);
+
+	if (length < 0)
+	{
+		va_end(retryArgs);
+		return "";
+	}
+
+	char* text = static_cast<char*>(Allocate(static_cast<size_t>(length) + 1, 1));
+	if (static_cast<size_t>(length) < sizeof(local))
+	{
+		std::memcpy(text, local, static_cast<size_t>(length) + 1);
+	}
+	else
+	{
+		std::vsnprintf(text, static_cast<size_t>(length) + 1, format, retryArgs);
+	}
+	va_end(retryArgs);
+	return text;
+}
+
+FrameArenaStats FrameArena::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void* FrameArena::AllocateOverflow(BUFFER& buffer, size_t bytes, size_t alignment)
+{
+	const size_t size = (bytes + alignment - 1) & ~(alignment - 1);
+	void* pointer = ::operator new(size, std::align_val_t(alignment));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	buffer.overflow.emplace_back(pointer, alignment);
+	buffer.overflowBytes += size;
+	return pointer;
+}
+
+void FrameArena::ReleaseOverflow(BUFFER& buffer)
+{
+	for (const auto& block : buffer.overflow)
+	{
+		::operator delete(block.first, std::align_val_t(block.second));
+	}
+	buffer.overflow.clear();
+	buffer.overflowBytes = 0;
+}
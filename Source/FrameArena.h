@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// per-frame linear allocator - double-buffered bump allocation for transient
+// render data, with an STL allocator adapter and overflow counters
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct FrameArenaStats
+{
+	uint64_t frames = 0;
+	// bytes handed out during the last finished frame
+	size_t lastFrameBytes = 0;
+	size_t peakFrameBytes = 0;
+	// size of each of the two buffers
+	size_t capacity = 0;
+	uint64_t allocations = 0;
+	// allocations that did not fit and went to the heap; zero once
+	// the buffers have grown to the steady-state frame
+	uint32_t lastFrameOverflows = 0;
+	uint64_t totalOverflows = 0;
+};
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  Allocations are a pointer bump and are never freed one
+ *  by one. BeginFrame() switches to the other buffer and
+ *  resets it, so memory handed out in one frame stays valid
+ *  through the next - long enough for a packet built on the
+ *  simulation thread to be submitted by the GL thread.
+ *
+ *  Allocate() may be called from any thread, BeginFrame()
+ *  only while nothing else uses the arena. When a frame does
+ *  not fit, the excess comes from the heap and the buffers
+ *  grow at the next BeginFrame().
+ ***********************************************************/
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t initialCapacity = 64 * 1024);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void BeginFrame();
+
+	void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	// printf-style formatting into the arena
+	const char* Format(const char* format, ...);
+
+	FrameArenaStats GetStats() const;
+
+private:
+	struct BUFFER
+	{
+		std::unique_ptr<unsigned char[]> memory;
+		size_t capacity = 0;
+		std::atomic<size_t> offset{ 0 };
+		// heap blocks, with their alignment, for the allocations
+		// that did not fit
+		std::vector<std::pair<void*, size_t>> overflow;
+		size_t overflowBytes = 0;
+	};
+
+	void* AllocateOverflow(BUFFER& buffer, size_t bytes, size_t alignment);
+	void ReleaseOverflow(BUFFER& buffer);
+
+	BUFFER m_buffers[2];
+	uint32_t m_current = 0;
+	// largest frame seen, including what overflowed
+	size_t m_requiredCapacity = 0;
+	std::atomic<uint64_t> m_allocations{ 0 };
+
+	mutable std::mutex m_mutex;
+	FrameArenaStats m_stats;
+};
+
+/***********************************************************
+ *  FrameAllocator
+ *
+ *  STL allocator drawing from a FrameArena. Deallocation is
+ *  a no-op, so containers using it must not outlive the
+ *  frame after the one they were filled in. Without an arena
+ *  it falls back to the global heap.
+ ***********************************************************/
+template <typename T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	FrameAllocator(FrameArena* pArena = nullptr) noexcept : m_pArena(pArena) {}
+
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>& other) noexcept : m_pArena(other.GetArena()) {}
+
+	T* allocate(size_t count)
+	{
+		if (m_pArena == nullptr)
+		{
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+		return static_cast<T*>(m_pArena->Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* pointer, size_t) noexcept
+	{
+		if (m_pArena == nullptr)
+		{
+			::operator delete(pointer);
+		}
+	}
+
+	FrameArena* GetArena() const noexcept { return m_pArena; }
+
+private:
+	FrameArena* m_pArena;
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) noexcept
+{
+	return a.GetArena() == b.GetArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) noexcept
+{
+	return a.GetArena() != b.GetArena();
+}
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -0,0 +1,298 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.cpp
+// ============
+// frame pacing - swap interval selection (including adaptive vsync), a
+// sleep+spin frame limiter and frame-time variance statistics
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+#include "FramePacer.h"
+
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// enough room for a report interval at a few thousand FPS
+	const size_t g_MaxSamples = 8192;
+}
+
+/***********************************************************
+ *  FramePacer()
+ *
+ *  The constructor for the class. On Windows the scheduler
+ *  tick is raised to 1ms so that short sleeps are accurate.
+ ***********************************************************/
+FramePacer::FramePacer(const FramePacingConfig& cfg)
+	: m_cfg(cfg)
+{
+	m_samples.reserve(g_MaxSamples);
+	m_sortScratch.reserve(g_MaxSamples);
+#ifdef _WIN32
+	timeBeginPeriod(1);
+#endif
+}
+
+/***********************************************************
+ *  ~FramePacer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+/***********************************************************
+ *  ParseVsyncMode()
+ *
+ *  Converts a command line value into a vsync mode.
+ ***********************************************************/
+bool FramePacer::ParseVsyncMode(const char* text, VsyncMode& mode)
+{
+	if (std::strcmp(text, "off") == 0)
+	{
+		mode = VsyncMode::Off;
+	}
+	else if (std::strcmp(text, "on") == 0)
+	{
+		mode = VsyncMode::On;
+	}
+	else if (std::strcmp(text, "adaptive") == 0)
+	{
+		mode = VsyncMode::Adaptive;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  ApplySwapInterval()
+ *
+ *  Sets the swap interval for the current context. Adaptive
+ *  vsync (interval -1) needs the swap_control_tear extension
+ *  and falls back to regular vsync without it.
+ ***********************************************************/
+int FramePacer::ApplySwapInterval()
+{
+	switch (m_cfg.vsync)
+	{
+	case VsyncMode::Off:
+		m_swapInterval = 0;
+		break;
+	case VsyncMode::On:
+		m_swapInterval = 1;
+		break;
+	case VsyncMode::Adaptive:
+		if (glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+			glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			m_swapInterval = -1;
+		}
+		else
+		{
+			std::cout << "INFO: adaptive vsync not supported, using vsync\n";
+			m_swapInterval = 1;
+		}
+		break;
+	}
+
+	glfwSwapInterval(m_swapInterval);
+	return m_swapInterval;
+}
+
+/***********************************************************
+ *  SetVsyncMode()
+ *
+ *  Changes the vsync mode; takes effect immediately when a
+ *  context is current.
+ ***********************************************************/
+void FramePacer::SetVsyncMode(VsyncMode mode)
+{
+	m_cfg.vsync = mode;
+	ApplySwapInterval();
+}
+
+/***********************************************************
+ *  SetTargetFps()
+ *
+ *  Changes the frame rate cap; 0 removes it.
+ ***********************************************************/
+void FramePacer::SetTargetFps(double targetFps)
+{
+	m_cfg.targetFps = targetFps;
+	m_bStarted = false;
+}
+
+/***********************************************************
+ *  WaitForNextFrame()
+ *
+ *  Sleeps for the bulk of the remaining frame period, then
+ *  spins to hit the deadline precisely. A frame that runs
+ *  late moves the deadline instead of trying to catch up.
+ ***********************************************************/
+void FramePacer::WaitForNextFrame()
+{
+	Clock::time_point now = Clock::now();
+	if (!m_bStarted)
+	{
+		m_frameStart = now;
+		m_reportStart = now;
+		m_deadline = now;
+		m_bStarted = true;
+	}
+
+	if (m_cfg.targetFps <= 0.0)
+	{
+		return;
+	}
+
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(1.0 / m_cfg.targetFps));
+	m_deadline += period;
+
+	if (now >= m_deadline)
+	{
+		// missed the deadline - pace from here on
+		m_deadline = now;
+		return;
+	}
+
+	const Clock::duration spinMargin = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double, std::milli>(m_cfg.spinMarginMs));
+	if (m_deadline - now > spinMargin)
+	{
+		std::this_thread::sleep_for(m_deadline - now - spinMargin);
+	}
+	while (Clock::now() < m_deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  Records the time since the previous EndFrame() and
+ *  finishes a report when the interval has elapsed.
+ ***********************************************************/
+void FramePacer::EndFrame()
+{
+	Clock::time_point now = Clock::now();
+	if (!m_bStarted)
+	{
+		m_frameStart = now;
+		m_reportStart = now;
+		m_deadline = now;
+		m_bStarted = true;
+		return;
+	}
+
+	m_lastFrameMs = std::chrono::duration<double, std::milli>(now - m_frameStart).count();
+	m_frameStart = now;
+	if (m_samples.size() < g_MaxSamples)
+	{
+		m_samples.push_back(m_lastFrameMs);
+	}
+
+	double elapsed = std::chrono::duration<double>(now - m_reportStart).count();
+	if (elapsed >= m_cfg.reportIntervalSeconds && !m_samples.empty())
+	{
+		ComputeStats(m_report);
+		m_report.fps = static_cast<double>(m_report.frames) / elapsed;
+		m_bReportReady = true;
+		m_samples.clear();
+		m_reportStart = now;
+	}
+}
+
+/***********************************************************
+ *  ResetFrameClock()
+ *
+ *  Moves the frame start, deadline and report start past a
+ *  pause in presenting.
+ ***********************************************************/
+void FramePacer::ResetFrameClock()
+{
+	if (!m_bStarted)
+	{
+		return;
+	}
+
+	Clock::time_point now = Clock::now();
+	m_reportStart += now - m_frameStart;
+	m_frameStart = now;
+	m_deadline = now;
+}
+
+/***********************************************************
+ *  ConsumeReport()
+ *
+ *  Hands out the statistics of the last finished interval.
+ ***********************************************************/
+bool FramePacer::ConsumeReport(FrameTimeStats& stats)
+{
+	if (!m_bReportReady)
+	{
+		return false;
+	}
+	stats = m_report;
+	m_bReportReady = false;
+	return true;
+}
+
+/***********************************************************
+ *  ComputeStats()
+ *
+ *  Mean, standard deviation, extremes and 99th percentile
+ *  of the frame times collected in this interval.
+ ***********************************************************/
+void FramePacer::ComputeStats(FrameTimeStats& stats)
+{
+	const size_t count = m_samples.size();
+	double sum = 0.0;
+	double minMs = m_samples[0];
+	double maxMs = m_samples[0];
+	for (double sample : m_samples)
+	{
+		sum += sample;
+		minMs = std::min(minMs, sample);
+		maxMs = std::max(maxMs, sample);
+	}
+	const double mean = sum / static_cast<double>(count);
+
+	double variance = 0.0;
+	for (double sample : m_samples)
+	{
+		variance += (sample - mean) * (sample - mean);
+	}
+	variance /= static_cast<double>(count);
+
+	m_sortScratch.assign(m_samples.begin(), m_samples.end());
+	size_t p99Index = static_cast<size_t>(std::ceil(0.99 * static_cast<double>(count))) - 1;
+	std::nth_element(m_sortScratch.begin(), m_sortScratch.begin() + p99Index, m_sortScratch.end());
+
+	stats.frames = static_cast<uint32_t>(count);
+	stats.meanMs = mean;
+	stats.stddevMs = std::sqrt(variance);
+	stats.minMs = minMs;
+	stats.maxMs = maxMs;
+	stats.p99Ms = m_sortScratch[p99Index];
+}
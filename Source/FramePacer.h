@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.h
+// ============
+// frame pacing - swap interval selection (including adaptive vsync), a
+// sleep+spin frame limiter and frame-time variance statistics
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+enum class VsyncMode
+{
+	Off,
+	On,
+	// tear instead of stalling when a frame misses the vblank
+	Adaptive
+};
+
+struct FramePacingConfig
+{
+	// 0 disables the frame limiter
+	double targetFps = 60.0;
+	VsyncMode vsync = VsyncMode::Adaptive;
+	// the limiter sleeps until this long before the deadline and
+	// spins for the rest, since OS sleeps overshoot by about 1ms
+	double spinMarginMs = 1.5;
+	// how often statistics are handed out for telemetry
+	double reportIntervalSeconds = 1.0;
+};
+
+struct FrameTimeStats
+{
+	uint32_t frames = 0;
+	double fps = 0.0;
+	double meanMs = 0.0;
+	double stddevMs = 0.0;
+	double minMs = 0.0;
+	double maxMs = 0.0;
+	double p99Ms = 0.0;
+};
+
+/***********************************************************
+ *  FramePacer
+ *
+ *  Call ApplySwapInterval() once the GL context is current.
+ *  Every frame, call WaitForNextFrame() right before
+ *  glfwSwapBuffers() and EndFrame() right after it.
+ ***********************************************************/
+class FramePacer
+{
+public:
+	explicit FramePacer(const FramePacingConfig& cfg = {});
+	~FramePacer();
+
+	// pick and set the swap interval; returns the interval in use
+	int ApplySwapInterval();
+	int GetSwapInterval() const { return m_swapInterval; }
+
+	// override the configured vsync mode and frame rate cap
+	void SetVsyncMode(VsyncMode mode);
+	void SetTargetFps(double targetFps);
+
+	// block until the target frame period has elapsed
+	void WaitForNextFrame();
+
+	// record the duration of the frame that was just presented
+	void EndFrame();
+
+	// resume after the loop stopped presenting for a while; the pause
+	// counts neither as a frame nor towards the report interval
+	void ResetFrameClock();
+
+	// returns true and fills stats once per report interval
+	bool ConsumeReport(FrameTimeStats& stats);
+
+	double GetLastFrameMs() const { return m_lastFrameMs; }
+
+	// parse "off", "on" or "adaptive"; returns false on anything else
+	static bool ParseVsyncMode(const char* text, VsyncMode& mode);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	void ComputeStats(FrameTimeStats& stats);
+
+	FramePacingConfig m_cfg;
+	int m_swapInterval = 1;
+
+	Clock::time_point m_frameStart;
+	Clock::time_point m_deadline;
+	Clock::time_point m_reportStart;
+	bool m_bStarted = false;
+	double m_lastFrameMs = 0.0;
+
+	// frame times of the current report interval; the scratch copy is
+	// sorted for the percentile so the samples keep arrival order
+	std::vector<double> m_samples;
+	std::vector<double> m_sortScratch;
+	bool m_bReportReady = false;
+	FrameTimeStats m_report;
+};
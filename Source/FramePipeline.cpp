@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepipeline.cpp
+// ============
+// two-stage frame pipeline - a simulation/visibility thread builds the frame
+// packet for frame N+1 while the GL thread submits the packet of frame N
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePipeline.h"
+#include "JobSystem.h"
+
+#include <chrono>
+
+/***********************************************************
+ *  FramePipeline()
+ *
+ *  The constructor for the class - starts the simulation
+ *  thread, which sleeps until the first Submit().
+ ***********************************************************/
+FramePipeline::FramePipeline(BuildFunction buildFunction, JobSystem* pJobSystem)
+	: m_buildFunction(buildFunction)
+	, m_pJobSystem(pJobSystem)
+{
+	m_simulationThread = std::thread(&FramePipeline::SimulationLoop, this);
+}
+
+/***********************************************************
+ *  ~FramePipeline()
+ *
+ *  The destructor for the class - finishes the packet being
+ *  built and joins the simulation thread.
+ ***********************************************************/
+FramePipeline::~FramePipeline()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bRunning = false;
+	}
+	m_submitCondition.notify_one();
+	m_simulationThread.join();
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  Hands the camera of a new frame to the simulation thread.
+ *  If the simulation thread has not started the previous
+ *  submission yet, the newer view replaces it.
+ ***********************************************************/
+void FramePipeline::Submit(const FrameView& view)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pendingView = view;
+		m_bHasPending = true;
+		m_submittedFrames++;
+	}
+	m_submitCondition.notify_one();
+}
+
+/***********************************************************
+ *  Acquire()
+ *
+ *  Waits for the packet of the previous frame (or the
+ *  current one on the very first frame), then swaps the
+ *  newest published slot in for reading.
+ ***********************************************************/
+const FramePacket* FramePipeline::Acquire()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_submittedFrames == 0)
+		{
+			return nullptr;
+		}
+
+		const uint64_t required = (m_submittedFrames > 1) ? m_submittedFrames - 1 : 1;
+		m_publishCondition.wait(lock, [&]()
+		{
+			return m_publishedFrames >= required;
+		});
+	}
+
+	if (m_readySlot.load(std::memory_order_acquire) & kFreshBit)
+	{
+		uint32_t previous = m_readySlot.exchange(m_readSlot, std::memory_order_acq_rel);
+		m_readSlot = previous & kIndexMask;
+	}
+	return &m_packets[m_readSlot];
+}
+
+/***********************************************************
+ *  WaitIdle()
+ *
+ *  Waits until the simulation thread has published the
+ *  packet of the latest Submit(). It then sleeps until the
+ *  next Submit() and touches no scene data.
+ ***********************************************************/
+void FramePipeline::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_publishCondition.wait(lock, [&]()
+	{
+		return !m_bHasPending && (m_publishedFrames >= m_submittedFrames);
+	});
+}
+
+/***********************************************************
+ *  SimulationLoop()
+ *
+ *  Body of the simulation thread. Builds one packet per
+ *  submitted view into the write slot and publishes it.
+ ***********************************************************/
+void FramePipeline::SimulationLoop()
+{
+	if (m_pJobSystem != nullptr)
+	{
+		m_pJobSystem->AttachCurrentThread();
+	}
+
+	for (;;)
+	{
+		FrameView view;
+		uint64_t frameNumber = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_submitCondition.wait(lock, [&]()
+			{
+				return m_bHasPending || !m_bRunning;
+			});
+			if (!m_bRunning)
+			{
+				return;
+			}
+			view = m_pendingView;
+			frameNumber = m_submittedFrames;
+			m_bHasPending = false;
+		}
+
+		FramePacket& packet = m_packets[m_writeSlot];
+		auto start = std::chrono::steady_clock::now();
+		packet.frameNumber = frameNumber;
+		packet.view = view;
+		m_buildFunction(view, packet);
+		packet.buildMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+
+		// publish: the written slot becomes the ready one and the
+		// previously ready slot is recycled for the next build
+		uint32_t previous = m_readySlot.exchange(m_writeSlot | kFreshBit, std::memory_order_acq_rel);
+		m_writeSlot = previous & kIndexMask;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_publishedFrames = frameNumber;
+		}
+		m_publishCondition.notify_one();
+	}
+}
@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepipeline.h
+// ============
+// two-stage frame pipeline - a simulation/visibility thread builds the frame
+// packet for frame N+1 while the GL thread submits the packet of frame N
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CommandRecorder.h"
+#include "ObjectPool.h"
+#include "RenderTypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  FramePacket
+ *
+ *  Immutable result of the simulation stage for one frame.
+ *  Once published, only the GL thread reads it.
+ ***********************************************************/
+struct FramePacket
+{
+	uint64_t frameNumber = 0;
+	FrameView view;
+	// visible draws, already in submission order
+	std::vector<RenderCommand> commands;
+	std::vector<LightData> lights;
+	// one entry per texture drawn
+	std::vector<TextureDemand> textureDemand;
+	// changes whenever the light set differs from the previous packet
+	uint32_t lightVersion = 0;
+	uint32_t culledObjects = 0;
+	// inside the frustum but hidden behind the occluders
+	uint32_t occludedObjects = 0;
+	uint32_t occluders = 0;
+	// the commands and counts were reused from an earlier frame whose
+	// camera was close enough to this one
+	bool bVisibilityReused = false;
+	// quads drawn after the commands in place of distant object
+	// groups, and the visible objects they replaced
+	std::vector<ImpostorDraw> impostors;
+	uint32_t impostorObjects = 0;
+	double buildMs = 0.0;
+	// the object of each command, only filled on frames with a GPU
+	// pick, whose IDs index into it
+	std::vector<PoolHandle> pickObjects;
+};
+
+/***********************************************************
+ *  FramePipeline
+ *
+ *  Owns the simulation thread and a triple buffer of frame
+ *  packets. The GL thread calls Submit() with the camera of
+ *  the new frame, then Acquire() to get the packet built
+ *  from the previous Submit(). This overlaps the two stages
+ *  and adds at most one frame of latency.
+ ***********************************************************/
+class FramePipeline
+{
+public:
+	typedef std::function<void(const FrameView& view, FramePacket& packet)> BuildFunction;
+
+	// pJobSystem is optional; when given, the simulation thread is
+	// attached to it so the build function may use ParallelFor
+	FramePipeline(BuildFunction buildFunction, JobSystem* pJobSystem = nullptr);
+	~FramePipeline();
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	// GL thread: start building the packet for a new frame
+	void Submit(const FrameView& view);
+
+	// GL thread: returns the newest packet, waiting until the packet
+	// of the previous Submit() is complete. The pointer stays valid
+	// until the next call to Acquire().
+	const FramePacket* Acquire();
+
+	// GL thread: wait until every submitted frame has been built, so
+	// the scene can be changed before the next Submit()
+	void WaitIdle();
+
+private:
+	static const uint32_t kFreshBit = 0x4u;
+	static const uint32_t kIndexMask = 0x3u;
+
+	void SimulationLoop();
+
+	BuildFunction m_buildFunction;
+	JobSystem* m_pJobSystem;
+
+	FramePacket m_packets[3];
+	// slot last published by the simulation thread, plus kFreshBit
+	// while the GL thread has not picked it up yet
+	std::atomic<uint32_t> m_readySlot{ 1 };
+	uint32_t m_writeSlot = 0;   // simulation thread only
+	uint32_t m_readSlot = 2;    // GL thread only
+
+	std::mutex m_mutex;
+	std::condition_variable m_submitCondition;
+	std::condition_variable m_publishCondition;
+	FrameView m_pendingView;
+	bool m_bHasPending = false;
+	bool m_bRunning = true;
+	uint64_t m_submittedFrames = 0;
+	uint64_t m_publishedFrames = 0;
+
+	std::thread m_simulationThread;
+};
@@ -0,0 +1,212 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametiminglog.cpp
+// ============
+// per-frame timing for replays and benchmarks - optional CSV output and a
+// summary with averages and 99th percentiles
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTimingLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	double Percentile99(std::vector<double>& values)
+	{
+		size_t index = static_cast<size_t>(std::ceil(0.99 * static_cast<double>(values.size()))) - 1;
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+}
+
+/***********************************************************
+ *  FrameTimingLog()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameTimingLog::FrameTimingLog()
+{
+}
+
+/***********************************************************
+ *  ~FrameTimingLog()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameTimingLog::~FrameTimingLog()
+{
+	if (m_pCsv != nullptr)
+	{
+		std::fclose(m_pCsv);
+	}
+}
+
+/***********************************************************
+ *  OpenCsv()
+ *
+ *  Creates the CSV file and writes the column names.
+ ***********************************************************/
+bool FrameTimingLog::OpenCsv(const char* path)
+{
+	m_pCsv = std::fopen(path, "w");
+	if (m_pCsv == nullptr)
+	{
+		std::cerr << "[FrameTimingLog] cannot create " << path << "\n";
+		return false;
+	}
+	std::fprintf(m_pCsv, "frame,sim_time,cpu_ms,frame_ms,draw_calls,culled_objects,occluded_objects,visibility_reused\n");
+	return true;
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  Preallocates room so that adding frames never allocates
+ *  while timing.
+ ***********************************************************/
+void FrameTimingLog::Reserve(uint32_t frames)
+{
+	m_frames.reserve(frames);
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  Stores the timing of one frame.
+ ***********************************************************/
+void FrameTimingLog::Add(const FrameTiming& timing)
+{
+	m_frames.push_back(timing);
+	if (m_pCsv != nullptr)
+	{
+		std::fprintf(m_pCsv, "%u,%.6f,%.4f,%.4f,%u,%u,%u,%d\n", timing.frame, timing.simTime,
+			timing.cpuMs, timing.frameMs, timing.drawCalls, timing.culledObjects,
+			timing.occludedObjects, timing.bVisibilityReused ? 1 : 0);
+	}
+}
+
+/***********************************************************
+ *  WriteJson()
+ *
+ *  Writes the summary followed by the per-frame CPU and
+ *  frame times, which the regression comparison reads.
+ ***********************************************************/
+bool FrameTimingLog::WriteJson(const char* path, const char* name) const
+{
+	FILE* pFile = std::fopen(path, "w");
+	if (pFile == nullptr)
+	{
+		std::cerr << "[FrameTimingLog] cannot create " << path << "\n";
+		return false;
+	}
+
+	// paths are used as names, so escape their backslashes
+	std::string escapedName;
+	for (const char* c = name; *c != '\0'; ++c)
+	{
+		if ((*c == '\\') || (*c == '"'))
+		{
+			escapedName += '\\';
+		}
+		escapedName += *c;
+	}
+
+	const FrameTimingSummary summary = Summarize();
+	std::fprintf(pFile, "{\n");
+	std::fprintf(pFile, "  \"name\": \"%s\",\n", escapedName.c_str());
+	std::fprintf(pFile, "  \"frames\": %u,\n", summary.frames);
+	std::fprintf(pFile, "  \"mean_cpu_ms\": %.4f,\n", summary.meanCpuMs);
+	std::fprintf(pFile, "  \"p99_cpu_ms\": %.4f,\n", summary.p99CpuMs);
+	std::fprintf(pFile, "  \"mean_frame_ms\": %.4f,\n", summary.meanFrameMs);
+	std::fprintf(pFile, "  \"p99_frame_ms\": %.4f,\n", summary.p99FrameMs);
+	std::fprintf(pFile, "  \"max_frame_ms\": %.4f,\n", summary.maxFrameMs);
+	std::fprintf(pFile, "  \"mean_draw_calls\": %.2f,\n", summary.meanDrawCalls);
+	std::fprintf(pFile, "  \"mean_culled_objects\": %.2f,\n", summary.meanCulledObjects);
+	std::fprintf(pFile, "  \"mean_occluded_objects\": %.2f,\n", summary.meanOccludedObjects);
+	std::fprintf(pFile, "  \"reused_frames\": %u,\n", summary.reusedFrames);
+	std::fprintf(pFile, "  \"mean_reused_cpu_ms\": %.4f,\n", summary.meanReusedCpuMs);
+	std::fprintf(pFile, "  \"mean_culled_cpu_ms\": %.4f,\n", summary.meanCulledCpuMs);
+
+	const char* arrays[2] = { "cpu_ms", "frame_ms" };
+	for (int a = 0; a < 2; ++a)
+	{
+		std::fprintf(pFile, "  \"%s\": [", arrays[a]);
+		for (size_t i = 0; i < m_frames.size(); ++i)
+		{
+			const double value = (a == 0) ? m_frames[i].cpuMs : m_frames[i].frameMs;
+			std::fprintf(pFile, "%s%.4f", (i == 0) ? "" : ", ", value);
+		}
+		std::fprintf(pFile, "]%s\n", (a == 0) ? "," : "");
+	}
+	std::fprintf(pFile, "}\n");
+
+	const bool ok = (std::ferror(pFile) == 0);
+	std::fclose(pFile);
+	return ok;
+}
+
+/***********************************************************
+ *  Summarize()
+ *
+ *  Means and 99th percentiles over all added frames.
+ ***********************************************************/
+FrameTimingSummary FrameTimingLog::Summarize() const
+{
+	FrameTimingSummary summary;
+	if (m_frames.empty())
+	{
+		return summary;
+	}
+
+	std::vector<double> cpuMs;
+	std::vector<double> frameMs;
+	cpuMs.reserve(m_frames.size());
+	frameMs.reserve(m_frames.size());
+
+	double drawCalls = 0.0;
+	double culledObjects = 0.0;
+	double occludedObjects = 0.0;
+	for (const FrameTiming& timing : m_frames)
+	{
+		cpuMs.push_back(timing.cpuMs);
+		frameMs.push_back(timing.frameMs);
+		summary.meanCpuMs += timing.cpuMs;
+		summary.meanFrameMs += timing.frameMs;
+		summary.maxFrameMs = std::max(summary.maxFrameMs, timing.frameMs);
+		drawCalls += timing.drawCalls;
+		culledObjects += timing.culledObjects;
+		occludedObjects += timing.occludedObjects;
+		if (timing.bVisibilityReused)
+		{
+			summary.reusedFrames++;
+			summary.meanReusedCpuMs += timing.cpuMs;
+		}
+		else
+		{
+			summary.meanCulledCpuMs += timing.cpuMs;
+		}
+	}
+
+	const double count = static_cast<double>(m_frames.size());
+	summary.frames = static_cast<uint32_t>(m_frames.size());
+	summary.meanCpuMs /= count;
+	summary.meanFrameMs /= count;
+	summary.meanDrawCalls = drawCalls / count;
+	summary.meanCulledObjects = culledObjects / count;
+	summary.meanOccludedObjects = occludedObjects / count;
+	if (summary.reusedFrames > 0)
+	{
+		summary.meanReusedCpuMs /= summary.reusedFrames;
+	}
+	if (summary.reusedFrames < summary.frames)
+	{
+		summary.meanCulledCpuMs /= (summary.frames - summary.reusedFrames);
+	}
+	summary.p99CpuMs = Percentile99(cpuMs);
+	summary.p99FrameMs = Percentile99(frameMs);
+	return summary;
+}
@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametiminglog.h
+// ============
+// per-frame timing for replays and benchmarks - optional CSV output and a
+// summary with averages and 99th percentiles
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+struct FrameTiming
+{
+	uint32_t frame = 0;
+	// simulated time at the end of the frame
+	double simTime = 0.0;
+	// CPU time spent on camera update, culling and recording
+	double cpuMs = 0.0;
+	// wall time from one frame to the next; equals cpuMs when headless
+	double frameMs = 0.0;
+	uint32_t drawCalls = 0;
+	uint32_t culledObjects = 0;
+	uint32_t occludedObjects = 0;
+	// the visible set of an earlier frame was reused instead of culling
+	bool bVisibilityReused = false;
+};
+
+struct FrameTimingSummary
+{
+	uint32_t frames = 0;
+	double meanCpuMs = 0.0;
+	double p99CpuMs = 0.0;
+	double meanFrameMs = 0.0;
+	double p99FrameMs = 0.0;
+	double maxFrameMs = 0.0;
+	double meanDrawCalls = 0.0;
+	double meanCulledObjects = 0.0;
+	double meanOccludedObjects = 0.0;
+	// frames that reused an earlier visible set, and the mean CPU time
+	// of those frames and of the ones that culled
+	uint32_t reusedFrames = 0;
+	double meanReusedCpuMs = 0.0;
+	double meanCulledCpuMs = 0.0;
+};
+
+/***********************************************************
+ *  FrameTimingLog
+ *
+ *  Collects one FrameTiming per frame. When a CSV path is
+ *  given every frame is also written out as it is added.
+ ***********************************************************/
+class FrameTimingLog
+{
+public:
+	FrameTimingLog();
+	~FrameTimingLog();
+
+	// start writing frames to a CSV file; returns false if it cannot be created
+	bool OpenCsv(const char* path);
+	void Reserve(uint32_t frames);
+	void Add(const FrameTiming& timing);
+
+	FrameTimingSummary Summarize() const;
+	// write the summary and every frame time as JSON
+	bool WriteJson(const char* path, const char* name) const;
+	const std::vector<FrameTiming>& GetFrames() const { return m_frames; }
+
+private:
+	std::vector<FrameTiming> m_frames;
+	FILE* m_pCsv = nullptr;
+};
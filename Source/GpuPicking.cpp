@@ -0,0 +1,218 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpupicking.cpp
+// ============
+// GPU ID-buffer picking - the draw list is rendered once more with an ID per
+// object into an integer target, and the pixel under the cursor comes back
+// through a pixel buffer and a fence a frame or two later
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuPicking.h"
+#include "ScenePicking.h"
+#include "ShaderUtils.h"
+#include "DBHelper.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+extern std::unique_ptr<DbHelper> g_Db;
+
+// declaration of global variables
+namespace
+{
+	// the ID, then the depth of the picked pixel
+	const GLsizeiptr g_PixelBufferSize = sizeof(GLuint) + sizeof(GLfloat);
+}
+
+/***********************************************************
+ *  GpuPicker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuPicker::GpuPicker()
+{
+}
+
+/***********************************************************
+ *  ~GpuPicker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuPicker::~GpuPicker()
+{
+	if (m_fence != 0) glDeleteSync(m_fence);
+	if (m_pixelBuffer != 0) glDeleteBuffers(1, &m_pixelBuffer);
+	if (m_framebuffer != 0) glDeleteFramebuffers(1, &m_framebuffer);
+	if (m_idBuffer != 0) glDeleteRenderbuffers(1, &m_idBuffer);
+	if (m_depthBuffer != 0) glDeleteRenderbuffers(1, &m_depthBuffer);
+	if (m_program != 0) glDeleteProgram(m_program);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  Compiles the ID program and creates the 1x1 ID and depth
+ *  target and the pixel buffer the readback goes through.
+ ***********************************************************/
+bool GpuPicker::Initialize(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	std::string errorLog;
+	m_program = LoadShaderProgram(vertexShaderPath, fragmentShaderPath, errorLog);
+	if (m_program == 0)
+	{
+		std::cerr << "[GpuPicker] ID shader failed: " << errorLog << "\n";
+		if (g_Db && g_Db->isOpen()) {
+			g_Db->logError("GpuPicker", errorLog);
+		}
+		return false;
+	}
+	m_modelLocation = glGetUniformLocation(m_program, "model");
+	m_viewLocation = glGetUniformLocation(m_program, "view");
+	m_projectionLocation = glGetUniformLocation(m_program, "projection");
+	m_objectIdLocation = glGetUniformLocation(m_program, "objectId");
+
+	glGenRenderbuffers(1, &m_idBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_idBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, 1, 1);
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, 1, 1);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_idBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	const bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	if (!bComplete)
+	{
+		std::cerr << "[GpuPicker] ID framebuffer is incomplete\n";
+		if (g_Db && g_Db->isOpen()) {
+			g_Db->logError("GpuPicker", "ID framebuffer is incomplete");
+		}
+		return false;
+	}
+
+	glGenBuffers(1, &m_pixelBuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, g_PixelBufferSize, NULL, GL_STREAM_READ);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return true;
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  Clears the ID target and binds it with the ID program.
+ *  The projection is narrowed to the picked pixel: in clip
+ *  space the point moves to the origin and one pixel of the
+ *  viewport is scaled up to the whole 1x1 target.
+ ***********************************************************/
+void GpuPicker::BeginPass(const FrameView& view, const glm::vec2& point, int viewportWidth, int viewportHeight)
+{
+	m_bPending = true;
+	m_point = point;
+	m_inverseViewProjection = glm::inverse(view.projection * view.view);
+	m_rayOrigin = MakePickRay(view, point).origin;
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &m_savedProgram);
+
+	const glm::mat4 pickMatrix =
+		glm::scale(glm::vec3(static_cast<float>(viewportWidth), static_cast<float>(viewportHeight), 1.0f)) *
+		glm::translate(glm::vec3(-point.x, -point.y, 0.0f));
+	const glm::mat4 projection = pickMatrix * view.projection;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, 1, 1);
+	const GLuint clearId[4] = { 0, 0, 0, 0 };
+	const GLfloat clearDepth = 1.0f;
+	glClearBufferuiv(GL_COLOR, 0, clearId);
+	glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+
+	glUseProgram(m_program);
+	glUniformMatrix4fv(m_viewLocation, 1, GL_FALSE, glm::value_ptr(view.view));
+	glUniformMatrix4fv(m_projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+}
+
+/***********************************************************
+ *  SetObject()
+ *
+ *  Sets the uniforms of the next draw.
+ ***********************************************************/
+void GpuPicker::SetObject(const glm::mat4& model, uint32_t id)
+{
+	glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+	glUniform1ui(m_objectIdLocation, id);
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  Copies the ID and depth into the pixel buffer, which the
+ *  GPU does after the draws without the CPU waiting, and
+ *  fences that copy.
+ ***********************************************************/
+void GpuPicker::EndPass()
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffer);
+	glReadPixels(0, 0, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, reinterpret_cast<void*>(0));
+	glReadPixels(0, 0, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, reinterpret_cast<void*>(sizeof(GLuint)));
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_savedFramebuffer));
+	glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+	glUseProgram(static_cast<GLuint>(m_savedProgram));
+}
+
+/***********************************************************
+ *  TryGetResult()
+ *
+ *  Polls the fence. Once it has signaled, the pixel buffer
+ *  is mapped and the depth is unprojected along the pick
+ *  point into a world position.
+ ***********************************************************/
+bool GpuPicker::TryGetResult(uint32_t& id, glm::vec3& position, float& distance)
+{
+	if (m_fence == 0)
+	{
+		return false;
+	}
+	const GLenum status = glClientWaitSync(m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+	{
+		return false;
+	}
+	glDeleteSync(m_fence);
+	m_fence = 0;
+	m_bPending = false;
+
+	GLuint pickedId = 0;
+	GLfloat depth = 1.0f;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffer);
+	const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, g_PixelBufferSize, GL_MAP_READ_BIT);
+	if (pixels != NULL)
+	{
+		const GLubyte* bytes = static_cast<const GLubyte*>(pixels);
+		std::memcpy(&pickedId, bytes, sizeof(pickedId));
+		std::memcpy(&depth, bytes + sizeof(pickedId), sizeof(depth));
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glm::vec4 world = m_inverseViewProjection * glm::vec4(m_point.x, m_point.y, depth * 2.0f - 1.0f, 1.0f);
+	id = pickedId;
+	position = glm::vec3(world) / world.w;
+	distance = glm::length(position - m_rayOrigin);
+	return true;
+}
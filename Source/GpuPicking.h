@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpupicking.h
+// ============
+// GPU ID-buffer picking - the draw list is rendered once more with an ID per
+// object into an integer target, and the pixel under the cursor comes back
+// through a pixel buffer and a fence a frame or two later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTypes.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+/***********************************************************
+ *  GpuPicker
+ *
+ *  The pass only covers the picked pixel: a pick matrix
+ *  scales that pixel of the viewport up to a 1x1 target, so
+ *  the GPU rasterizes one pixel per object no matter how
+ *  large the window is. The object ID and depth are copied
+ *  into a pixel buffer and read once the fence behind them
+ *  has signaled, so neither the pass nor the readback ever
+ *  waits for the GPU. One pick is in flight at a time.
+ ***********************************************************/
+class GpuPicker
+{
+public:
+	GpuPicker();
+	~GpuPicker();
+
+	// compile the ID shader and create the target; returns false if
+	// either fails
+	bool Initialize(const char* vertexShaderPath, const char* fragmentShaderPath);
+
+	// true from BeginPass() until TryGetResult() returns the result
+	bool IsPending() const { return m_bPending; }
+
+	// bind the ID target and program for a point of the viewport, in
+	// normalized device coordinates
+	void BeginPass(const FrameView& view, const glm::vec2& point, int viewportWidth, int viewportHeight);
+	// set the transform and ID of the next draw; the ID may not be 0
+	void SetObject(const glm::mat4& model, uint32_t id);
+	// queue the readback and rebind the caller's framebuffer, viewport
+	// and program
+	void EndPass();
+
+	// the ID under the point (0 for none), the world position it was
+	// hit at and its distance along the pick ray, once the GPU is
+	// done; never waits
+	bool TryGetResult(uint32_t& id, glm::vec3& position, float& distance);
+
+private:
+	GLuint m_program = 0;
+	GLint m_modelLocation = -1;
+	GLint m_viewLocation = -1;
+	GLint m_projectionLocation = -1;
+	GLint m_objectIdLocation = -1;
+
+	GLuint m_framebuffer = 0;
+	GLuint m_idBuffer = 0;
+	GLuint m_depthBuffer = 0;
+	GLuint m_pixelBuffer = 0;
+	GLsync m_fence = 0;
+	bool m_bPending = false;
+
+	// to unproject the read depth
+	glm::mat4 m_inverseViewProjection = glm::mat4(1.0f);
+	glm::vec2 m_point = glm::vec2(0.0f);
+	glm::vec3 m_rayOrigin = glm::vec3(0.0f);
+
+	// the caller's state, restored by EndPass()
+	GLint m_savedFramebuffer = 0;
+	GLint m_savedViewport[4] = {};
+	GLint m_savedProgram = 0;
+};
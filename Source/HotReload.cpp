@@ -0,0 +1,318 @@
+///////////////////////////////////////////////////////////////////////////////
+// hotreload.cpp
+// ============
+// hot reloading of the scene shaders, textures and generated scene files -
+// changed files are loaded on a background thread and swapped in between
+// frames, keeping the old version when the new one fails
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HotReload.h"
+#include "FramePipeline.h"
+#include "ShaderUtils.h"
+#include "DBHelper.h"
+
+#include <iostream>
+
+extern std::unique_ptr<DbHelper> g_Db;
+
+/***********************************************************
+ *  HotReloader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+HotReloader::HotReloader(SceneManager* pSceneManager, ShaderManager* pShaderManager,
+	FramePipeline* pFramePipeline)
+	: m_pSceneManager(pSceneManager)
+	, m_pShaderManager(pShaderManager)
+	, m_pFramePipeline(pFramePipeline)
+{
+}
+
+/***********************************************************
+ *  ~HotReloader()
+ *
+ *  The destructor for the class - stops watching, joins the
+ *  loader thread and drops the reloads never applied.
+ ***********************************************************/
+HotReloader::~HotReloader()
+{
+	m_watcher.Stop();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bRunning = false;
+	}
+	m_condition.notify_one();
+	if (m_loaderThread.joinable())
+	{
+		m_loaderThread.join();
+	}
+
+	for (std::unique_ptr<RELOAD>& reload : m_loaded)
+	{
+		SceneManager::FreeImage(reload->image);
+	}
+}
+
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  Watches the two stages of the scene program. A change to
+ *  either rebuilds the program from both.
+ ***********************************************************/
+void HotReloader::WatchShaders(const char* vertexPath, const char* fragmentPath)
+{
+	m_vertexPath = vertexPath;
+	m_fragmentPath = fragmentPath;
+	AddFile(AssetKind::Shader, vertexPath);
+	AddFile(AssetKind::Shader, fragmentPath);
+}
+
+void HotReloader::WatchTexture(const char* path)
+{
+	AddFile(AssetKind::Texture, path);
+}
+
+void HotReloader::WatchScene(const char* path)
+{
+	AddFile(AssetKind::Scene, path);
+}
+
+void HotReloader::AddFile(AssetKind kind, const char* path)
+{
+	WATCHED_FILE file;
+	file.kind = kind;
+	file.path = path;
+	file.normalized = std::filesystem::path(path).lexically_normal();
+
+	const std::filesystem::path directory = file.normalized.parent_path();
+	if (m_watcher.AddDirectory(directory.empty() ? std::string(".") : directory.string()))
+	{
+		m_files.push_back(file);
+	}
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  Starts the file watcher and the loader thread.
+ ***********************************************************/
+void HotReloader::Start()
+{
+	m_bRunning = true;
+	m_loaderThread = std::thread(&HotReloader::LoaderLoop, this);
+	m_watcher.Start();
+	std::cout << "INFO: hot reload watching " << m_files.size() << " files"
+		<< (m_watcher.IsPolling() ? " by polling" : "") << std::endl;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  Turns the settled file changes into reload requests and
+ *  applies the reloads the loader thread has finished.
+ ***********************************************************/
+void HotReloader::Update()
+{
+	m_changed.clear();
+	m_watcher.PollChanges(m_changed);
+
+	bool bRequested = false;
+	for (const std::string& changed : m_changed)
+	{
+		const std::filesystem::path normalized = std::filesystem::path(changed).lexically_normal();
+		for (const WATCHED_FILE& file : m_files)
+		{
+			if (file.normalized != normalized)
+			{
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			// both shader stages reload together, so one request covers them
+			bool bQueued = false;
+			for (const std::unique_ptr<RELOAD>& request : m_requests)
+			{
+				bQueued = bQueued || ((request->kind == file.kind) &&
+					((file.kind == AssetKind::Shader) || (request->path == file.path)));
+			}
+			if (!bQueued)
+			{
+				std::unique_ptr<RELOAD> request = std::make_unique<RELOAD>();
+				request->kind = file.kind;
+				request->path = file.path;
+				m_requests.push_back(std::move(request));
+				bRequested = true;
+			}
+		}
+	}
+	if (bRequested)
+	{
+		m_condition.notify_one();
+	}
+
+	std::vector<std::unique_ptr<RELOAD>> loaded;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_loaded.empty())
+		{
+			return;
+		}
+		loaded.swap(m_loaded);
+	}
+	for (std::unique_ptr<RELOAD>& reload : loaded)
+	{
+		Apply(*reload);
+	}
+}
+
+/***********************************************************
+ *  LoaderLoop()
+ *
+ *  Body of the loader thread. Loads one request at a time
+ *  and hands the result back to Update().
+ ***********************************************************/
+void HotReloader::LoaderLoop()
+{
+	for (;;)
+	{
+		std::unique_ptr<RELOAD> reload;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [&]()
+			{
+				return !m_requests.empty() || !m_bRunning;
+			});
+			if (!m_bRunning)
+			{
+				return;
+			}
+			reload = std::move(m_requests.front());
+			m_requests.erase(m_requests.begin());
+		}
+
+		Load(*reload);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_loaded.push_back(std::move(reload));
+	}
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  Reads the changed asset without touching GL or the
+ *  scene: shader sources as text, textures decoded to
+ *  pixels and scene files parsed.
+ ***********************************************************/
+void HotReloader::Load(RELOAD& reload) const
+{
+	switch (reload.kind)
+	{
+	case AssetKind::Shader:
+		if (!ReadTextFile(m_vertexPath.c_str(), reload.vertexSource) ||
+			!ReadTextFile(m_fragmentPath.c_str(), reload.fragmentSource))
+		{
+			reload.error = "cannot read the shader sources";
+			return;
+		}
+		break;
+	case AssetKind::Texture:
+		if (!SceneManager::DecodeImage(reload.path.c_str(), reload.image))
+		{
+			reload.error = "cannot decode the image";
+			return;
+		}
+		break;
+	case AssetKind::Scene:
+		if (!SceneGenerator::Load(reload.path, reload.scene))
+		{
+			reload.error = "cannot load the scene file";
+			return;
+		}
+		break;
+	}
+	reload.bLoaded = true;
+}
+
+/***********************************************************
+ *  Apply()
+ *
+ *  Swaps a loaded asset in. Runs on the GL thread between
+ *  frames; a scene waits for the frame pipeline to finish
+ *  the packet it is building from the old objects.
+ ***********************************************************/
+void HotReloader::Apply(RELOAD& reload)
+{
+	if (!reload.bLoaded)
+	{
+		ReportFailure(reload.path, reload.error);
+		return;
+	}
+
+	switch (reload.kind)
+	{
+	case AssetKind::Shader:
+		ApplyShaders(reload);
+		break;
+	case AssetKind::Texture:
+		if (m_pSceneManager->ReplaceSceneTexture(reload.path.c_str(), reload.image))
+		{
+			std::cout << "INFO: reloaded " << reload.path << std::endl;
+		}
+		break;
+	case AssetKind::Scene:
+		if (m_pFramePipeline != nullptr)
+		{
+			m_pFramePipeline->WaitIdle();
+		}
+		m_pSceneManager->LoadGeneratedScene(reload.scene);
+		std::cout << "INFO: reloaded " << reload.scene.objects.size() << " objects and "
+			<< reload.scene.lights.size() << " lights from " << reload.path << std::endl;
+		break;
+	}
+}
+
+/***********************************************************
+ *  ApplyShaders()
+ *
+ *  Compiles the sources the loader thread read, and only if
+ *  they link is that same program handed to ShaderManager
+ *  as the scene program; the files are not read again, so a
+ *  broken edit saved since never reaches it. The old program
+ *  is then deleted and the uniforms the scene set at startup
+ *  restored.
+ ***********************************************************/
+void HotReloader::ApplyShaders(RELOAD& reload)
+{
+	std::string errorLog;
+	const GLuint program = CompileShaderProgram(reload.vertexSource, reload.fragmentSource, errorLog);
+	if (program == 0)
+	{
+		ReportFailure(reload.path, errorLog);
+		return;
+	}
+
+	const GLuint previous = m_pShaderManager->m_programID;
+	m_pShaderManager->m_programID = program;
+	m_pShaderManager->use();
+	if ((previous != 0) && (previous != program))
+	{
+		glDeleteProgram(previous);
+	}
+
+	m_pSceneManager->OnShaderProgramChanged();
+	std::cout << "INFO: reloaded " << m_vertexPath << " and " << m_fragmentPath << std::endl;
+}
+
+/***********************************************************
+ *  ReportFailure()
+ *
+ *  The running version of the asset stays in use.
+ ***********************************************************/
+void HotReloader::ReportFailure(const std::string& path, const std::string& message) const
+{
+	std::cerr << "[HotReload] " << path << " kept the previous version: " << message << "\n";
+	if (g_Db && g_Db->isOpen()) {
+		g_Db->logError("HotReload", path + ": " + message);
+	}
+}
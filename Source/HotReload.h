@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// hotreload.h
+// ============
+// hot reloading of the scene shaders, textures and generated scene files -
+// changed files are loaded on a background thread and swapped in between
+// frames, keeping the old version when the new one fails
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FileWatcher.h"
+#include "SceneGenerator.h"
+#include "SceneManager.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FramePipeline;
+class ShaderManager;
+
+/***********************************************************
+ *  HotReloader
+ *
+ *  Reading and decoding run on a loader thread of its own.
+ *  Shaders are compiled on the GL thread, since they need
+ *  the context; a program that fails to compile or link is
+ *  reported and the running one stays. Failures are logged
+ *  through DbHelper::logError.
+ ***********************************************************/
+class HotReloader
+{
+public:
+	// pFramePipeline may be null when the scene is built on the GL thread
+	HotReloader(SceneManager* pSceneManager, ShaderManager* pShaderManager,
+		FramePipeline* pFramePipeline);
+	~HotReloader();
+
+	HotReloader(const HotReloader&) = delete;
+	HotReloader& operator=(const HotReloader&) = delete;
+
+	// register the files before Start()
+	void WatchShaders(const char* vertexPath, const char* fragmentPath);
+	void WatchTexture(const char* path);
+	void WatchScene(const char* path);
+	void Start();
+
+	// GL thread, between frames: queue loads for the changed files
+	// and swap in the ones that have finished loading
+	void Update();
+
+private:
+	enum class AssetKind
+	{
+		Shader,
+		Texture,
+		Scene
+	};
+
+	struct WATCHED_FILE
+	{
+		AssetKind kind;
+		std::string path;
+		std::filesystem::path normalized;
+	};
+
+	// one reload, from request to the loaded data
+	struct RELOAD
+	{
+		AssetKind kind;
+		std::string path;
+		bool bLoaded = false;
+		std::string error;
+		std::string vertexSource;
+		std::string fragmentSource;
+		SceneManager::DECODED_IMAGE image;
+		GeneratedScene scene;
+	};
+
+	void AddFile(AssetKind kind, const char* path);
+	void LoaderLoop();
+	void Load(RELOAD& reload) const;
+	void Apply(RELOAD& reload);
+	void ApplyShaders(RELOAD& reload);
+	void ReportFailure(const std::string& path, const std::string& message) const;
+
+	SceneManager* m_pSceneManager;
+	ShaderManager* m_pShaderManager;
+	FramePipeline* m_pFramePipeline;
+	std::string m_vertexPath;
+	std::string m_fragmentPath;
+
+	std::vector<WATCHED_FILE> m_files;
+	FileWatcher m_watcher;
+	std::vector<std::string> m_changed;
+
+	std::thread m_loaderThread;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_bRunning = false;
+	std::vector<std::unique_ptr<RELOAD>> m_requests;
+	std::vector<std::unique_ptr<RELOAD>> m_loaded;
+};
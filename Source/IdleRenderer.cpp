@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// idlerenderer.cpp
+// ============
+// event-driven idle rendering - stops redrawing while the camera and scene
+// are unchanged and blocks on window events until something happens
+///////////////////////////////////////////////////////////////////////////////
+
+#include "IdleRenderer.h"
+
+#include "GLFW/glfw3.h"
+
+/***********************************************************
+ *  IdleRenderer()
+ *
+ *  The constructor for the class - the first frame always
+ *  renders.
+ ***********************************************************/
+IdleRenderer::IdleRenderer(const IdleRenderingConfig& cfg)
+	: m_cfg(cfg)
+	, m_reportStart(Clock::now())
+{
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  Any change to the camera, the scene or the framebuffer
+ *  size restarts the settle count. Once enough unchanged
+ *  frames were rendered the loop only presents on request
+ *  and otherwise waits.
+ ***********************************************************/
+FrameAction IdleRenderer::BeginFrame(const FrameView& view, uint32_t sceneVersion,
+	int framebufferWidth, int framebufferHeight)
+{
+	const bool bChanged =
+		(view.view != m_lastView.view) ||
+		(view.projection != m_lastView.projection) ||
+		(view.bOrthographic != m_lastView.bOrthographic) ||
+		(sceneVersion != m_lastSceneVersion) ||
+		(framebufferWidth != m_lastWidth) ||
+		(framebufferHeight != m_lastHeight);
+
+	if (bChanged)
+	{
+		m_lastView = view;
+		m_lastSceneVersion = sceneVersion;
+		m_lastWidth = framebufferWidth;
+		m_lastHeight = framebufferHeight;
+		m_settledFrames = 0;
+	}
+
+	if (!IsIdle())
+	{
+		return FrameAction::Render;
+	}
+	if (m_bPresentRequested)
+	{
+		return FrameAction::Present;
+	}
+	return FrameAction::Wait;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  Counts a swapped frame towards the settle count and the
+ *  statistics.
+ ***********************************************************/
+void IdleRenderer::EndFrame(FrameAction action)
+{
+	if (action == FrameAction::Render)
+	{
+		m_current.renderedFrames++;
+		if (m_settledFrames < m_cfg.settleFrames)
+		{
+			m_settledFrames++;
+		}
+	}
+	else if (action == FrameAction::Present)
+	{
+		m_current.presentedFrames++;
+	}
+	m_bPresentRequested = false;
+}
+
+/***********************************************************
+ *  WaitForEvents()
+ *
+ *  Blocks until a window event arrives or the timeout runs
+ *  out, processing the events like glfwPollEvents() would.
+ ***********************************************************/
+double IdleRenderer::WaitForEvents()
+{
+	Clock::time_point start = Clock::now();
+	glfwWaitEventsTimeout(m_cfg.waitTimeoutSeconds);
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	m_current.idleSeconds += seconds;
+	m_current.wakeups++;
+	return seconds;
+}
+
+/***********************************************************
+ *  ConsumeReport()
+ *
+ *  Hands out the counts of the last finished interval.
+ ***********************************************************/
+bool IdleRenderer::ConsumeReport(IdleStats& stats)
+{
+	Clock::time_point now = Clock::now();
+	double elapsed = std::chrono::duration<double>(now - m_reportStart).count();
+	if (elapsed < m_cfg.reportIntervalSeconds)
+	{
+		return false;
+	}
+
+	stats = m_current;
+	stats.intervalSeconds = elapsed;
+	m_current = IdleStats();
+	m_reportStart = now;
+	return true;
+}
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// idlerenderer.h
+// ============
+// event-driven idle rendering - stops redrawing while the camera and scene
+// are unchanged and blocks on window events until something happens
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTypes.h"
+
+#include <chrono>
+#include <cstdint>
+
+struct IdleRenderingConfig
+{
+	// unchanged frames rendered before going idle; the frame pipeline
+	// shows the previous frame's view, so at least two are needed
+	uint32_t settleFrames = 3;
+	// longest a single wait blocks, so that changes made outside the
+	// event path (such as reloaded assets) are still picked up
+	double waitTimeoutSeconds = 0.1;
+	// how often statistics are handed out for telemetry
+	double reportIntervalSeconds = 10.0;
+};
+
+// what the main loop should do with the current iteration
+enum class FrameAction
+{
+	// build and draw the scene
+	Render,
+	// show the last rendered image again without drawing the scene
+	Present,
+	// nothing changed - block until an event arrives
+	Wait
+};
+
+struct IdleStats
+{
+	double intervalSeconds = 0.0;
+	double idleSeconds = 0.0;
+	uint32_t renderedFrames = 0;
+	uint32_t presentedFrames = 0;
+	uint32_t wakeups = 0;
+};
+
+/***********************************************************
+ *  IdleRenderer
+ *
+ *  Every loop iteration, call BeginFrame() with the frame's
+ *  camera and scene version. Render or Present actions are
+ *  followed by EndFrame() once the buffers are swapped; a
+ *  Wait action by WaitForEvents() instead of polling.
+ ***********************************************************/
+class IdleRenderer
+{
+public:
+	explicit IdleRenderer(const IdleRenderingConfig& cfg = {});
+
+	// compare the frame against the last rendered one
+	FrameAction BeginFrame(const FrameView& view, uint32_t sceneVersion,
+		int framebufferWidth, int framebufferHeight);
+	// count the frame that was just swapped
+	void EndFrame(FrameAction action);
+
+	// block on window events; returns the seconds spent waiting
+	double WaitForEvents();
+
+	// force the next frame to render
+	void MarkDirty() { m_settledFrames = 0; }
+	// the window contents were damaged and need presenting again
+	void RequestPresent() { m_bPresentRequested = true; }
+
+	bool IsIdle() const { return m_settledFrames >= m_cfg.settleFrames; }
+
+	// returns true and fills stats once per report interval
+	bool ConsumeReport(IdleStats& stats);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	IdleRenderingConfig m_cfg;
+
+	FrameView m_lastView;
+	uint32_t m_lastSceneVersion = 0;
+	int m_lastWidth = 0;
+	int m_lastHeight = 0;
+	uint32_t m_settledFrames = 0;
+	bool m_bPresentRequested = false;
+
+	Clock::time_point m_reportStart;
+	IdleStats m_current;
+};
@@ -0,0 +1,477 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorrendering.cpp
+// ============
+// impostors for distant composite objects - a group of objects is rendered
+// once from every direction of an octahedral grid into an atlas, and drawn as
+// a single textured quad while it is small on screen
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImpostorRendering.h"
+#include "ShaderUtils.h"
+#include "VirtualFileSystem.h"
+#include "DBHelper.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+extern std::unique_ptr<DbHelper> g_Db;
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  Impostor cache format (version 1, little-endian, packed)
+	 *
+	 *  header: "IMPO", uint32 version, uint32 grid size,
+	 *          uint32 cell size, uint64 source hash
+	 *  pixels: RGBA bytes of the atlas, bottom row first
+	 ***********************************************************/
+	const char g_Magic[4] = { 'I', 'M', 'P', 'O' };
+	const uint32_t g_Version = 1;
+	const size_t g_HeaderSize = sizeof(g_Magic) + 3 * sizeof(uint32_t) + sizeof(uint64_t);
+
+	// the finest mip an atlas keeps is a quarter of a cell across, as
+	// coarser ones would blend neighbouring views together
+	const GLint g_MaxImpostorMip = 2;
+
+	float SignNotZero(float value)
+	{
+		return (value >= 0.0f) ? 1.0f : -1.0f;
+	}
+
+	template <typename T>
+	void WriteValue(std::ostream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	// transparent texels next to the object take the color of an opaque
+	// neighbour, so filtering across the outline does not darken it
+	void DilateColors(ImpostorImage& image)
+	{
+		const int size = static_cast<int>(image.gridSize * image.cellSize);
+		const int cellSize = static_cast<int>(image.cellSize);
+		const std::vector<uint8_t> source = image.pixels;
+		const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				uint8_t* pTexel = &image.pixels[(static_cast<size_t>(y) * size + x) * 4];
+				if (pTexel[3] != 0)
+				{
+					continue;
+				}
+				for (const int* offset : offsets)
+				{
+					const int nx = x + offset[0];
+					const int ny = y + offset[1];
+					// stay inside the cell, which is a different view
+					if ((nx < 0) || (ny < 0) || (nx / cellSize != x / cellSize) ||
+						(ny / cellSize != y / cellSize) || (nx >= size) || (ny >= size))
+					{
+						continue;
+					}
+					const uint8_t* pNeighbour = &source[(static_cast<size_t>(ny) * size + nx) * 4];
+					if (pNeighbour[3] != 0)
+					{
+						std::memcpy(pTexel, pNeighbour, 3);
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ImpostorRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImpostorRenderer::ImpostorRenderer()
+{
+}
+
+/***********************************************************
+ *  ~ImpostorRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImpostorRenderer::~ImpostorRenderer()
+{
+	if (!m_textures.empty())
+	{
+		glDeleteTextures(static_cast<GLsizei>(m_textures.size()), m_textures.data());
+	}
+	if (m_emptyVertexArray != 0) glDeleteVertexArrays(1, &m_emptyVertexArray);
+	if (m_program != 0) glDeleteProgram(m_program);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  Compiles the quad program. The quad is generated in the
+ *  vertex shader, but core profile still needs a vertex
+ *  array to be bound.
+ ***********************************************************/
+bool ImpostorRenderer::Initialize(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	std::string errorLog;
+	m_program = LoadShaderProgram(vertexShaderPath, fragmentShaderPath, errorLog);
+	if (m_program == 0)
+	{
+		std::cerr << "[ImpostorRenderer] impostor shader failed: " << errorLog << "\n";
+		if (g_Db && g_Db->isOpen()) {
+			g_Db->logError("ImpostorRenderer", errorLog);
+		}
+		return false;
+	}
+	m_viewLocation = glGetUniformLocation(m_program, "view");
+	m_projectionLocation = glGetUniformLocation(m_program, "projection");
+	m_centerLocation = glGetUniformLocation(m_program, "center");
+	m_rightLocation = glGetUniformLocation(m_program, "right");
+	m_upLocation = glGetUniformLocation(m_program, "up");
+	m_uvRectLocation = glGetUniformLocation(m_program, "uvRect");
+	m_textureLocation = glGetUniformLocation(m_program, "impostorTexture");
+
+	glGenVertexArrays(1, &m_emptyVertexArray);
+	return true;
+}
+
+/***********************************************************
+ *  GetCellDirection()
+ *
+ *  Decodes the octahedral map at the center of a cell. The
+ *  map's x and y are the world x and z of a direction on the
+ *  octahedron |x| + |y| + |z| = 1.
+ ***********************************************************/
+glm::vec3 ImpostorRenderer::GetCellDirection(uint32_t gridSize, uint32_t x, uint32_t y)
+{
+	const float u = (static_cast<float>(x) + 0.5f) / static_cast<float>(gridSize) * 2.0f - 1.0f;
+	const float v = (static_cast<float>(y) + 0.5f) / static_cast<float>(gridSize) * 2.0f - 1.0f;
+	glm::vec3 direction(u, 1.0f - std::fabs(u) - std::fabs(v), v);
+	if (direction.y < 0.0f)
+	{
+		direction.x = (1.0f - std::fabs(v)) * SignNotZero(u);
+		direction.z = (1.0f - std::fabs(u)) * SignNotZero(v);
+	}
+	return glm::normalize(direction);
+}
+
+/***********************************************************
+ *  FindCell()
+ *
+ *  Encodes a direction into the octahedral map and returns
+ *  the cell it falls into.
+ ***********************************************************/
+void ImpostorRenderer::FindCell(uint32_t gridSize, const glm::vec3& direction, uint32_t& x, uint32_t& y)
+{
+	const float length = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+	float u = direction.x / length;
+	float v = direction.z / length;
+	if (direction.y < 0.0f)
+	{
+		const float foldedU = (1.0f - std::fabs(v)) * SignNotZero(u);
+		v = (1.0f - std::fabs(u)) * SignNotZero(v);
+		u = foldedU;
+	}
+	const float cells = static_cast<float>(gridSize);
+	x = std::min(static_cast<uint32_t>(std::max((u * 0.5f + 0.5f) * cells, 0.0f)), gridSize - 1);
+	y = std::min(static_cast<uint32_t>(std::max((v * 0.5f + 0.5f) * cells, 0.0f)), gridSize - 1);
+}
+
+/***********************************************************
+ *  GetViewAxes()
+ *
+ *  The right and up axes of a camera looking back along a
+ *  direction, the same ones glm::lookAt() builds from them,
+ *  with world up kept upright. Straight above or below, the
+ *  world's -z is used as up instead.
+ ***********************************************************/
+void ImpostorRenderer::GetViewAxes(const glm::vec3& direction, glm::vec3& right, glm::vec3& up)
+{
+	const glm::vec3 worldUp = (std::fabs(direction.y) > 0.999f) ?
+		glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	right = glm::normalize(glm::cross(worldUp, direction));
+	up = glm::cross(direction, right);
+}
+
+/***********************************************************
+ *  MakeDraw()
+ *
+ *  The quad for a group seen from a direction: it faces the
+ *  baked view nearest that direction, with that view's axes,
+ *  so the image lines up with the group it replaces.
+ ***********************************************************/
+ImpostorDraw ImpostorRenderer::MakeDraw(uint32_t gridSize, const glm::vec3& center, float radius,
+	const glm::vec3& direction, uint32_t textureID)
+{
+	uint32_t x = 0;
+	uint32_t y = 0;
+	FindCell(gridSize, direction, x, y);
+	glm::vec3 right;
+	glm::vec3 up;
+	GetViewAxes(GetCellDirection(gridSize, x, y), right, up);
+
+	const float cellUV = 1.0f / static_cast<float>(gridSize);
+	ImpostorDraw draw;
+	draw.center = center;
+	draw.right = right * radius;
+	draw.up = up * radius;
+	draw.uvRect = glm::vec4(static_cast<float>(x) * cellUV, static_cast<float>(y) * cellUV, cellUV, cellUV);
+	draw.textureID = textureID;
+	return draw;
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  Renders each cell of the grid into its part of an
+ *  offscreen target, cleared to transparent and depth
+ *  tested, then reads the atlas back. Every view is an orthographic camera twice the
+ *  radius out, framing exactly the bounding sphere.
+ ***********************************************************/
+bool ImpostorRenderer::Bake(const glm::vec3& center, float radius, uint32_t gridSize, uint32_t cellSize,
+	const DrawFunction& draw, ImpostorImage& image)
+{
+	const GLsizei size = static_cast<GLsizei>(gridSize * cellSize);
+	GLint savedFramebuffer = 0;
+	GLint savedViewport[4] = {};
+	GLfloat savedClearColor[4] = {};
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, savedViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, savedClearColor);
+	const GLboolean bSavedDepthTest = glIsEnabled(GL_DEPTH_TEST);
+
+	GLuint renderbuffers[2] = { 0, 0 };
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	const bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	if (bComplete)
+	{
+		glEnable(GL_DEPTH_TEST);
+		glViewport(0, 0, size, size);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius * 0.5f, radius * 3.5f);
+		for (uint32_t y = 0; y < gridSize; ++y)
+		{
+			for (uint32_t x = 0; x < gridSize; ++x)
+			{
+				const glm::vec3 direction = GetCellDirection(gridSize, x, y);
+				glm::vec3 right;
+				glm::vec3 up;
+				GetViewAxes(direction, right, up);
+				const glm::vec3 eye = center + direction * (radius * 2.0f);
+
+				glViewport(static_cast<GLint>(x * cellSize), static_cast<GLint>(y * cellSize),
+					static_cast<GLsizei>(cellSize), static_cast<GLsizei>(cellSize));
+				draw(glm::lookAt(eye, center, up), projection, eye);
+			}
+		}
+
+		image.gridSize = gridSize;
+		image.cellSize = cellSize;
+		image.pixels.resize(static_cast<size_t>(size) * size * 4);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+		DilateColors(image);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(savedFramebuffer));
+	glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+	glClearColor(savedClearColor[0], savedClearColor[1], savedClearColor[2], savedClearColor[3]);
+	if (!bSavedDepthTest)
+	{
+		glDisable(GL_DEPTH_TEST);
+	}
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(2, renderbuffers);
+
+	if (!bComplete)
+	{
+		std::cerr << "[ImpostorRenderer] bake framebuffer is incomplete\n";
+		if (g_Db && g_Db->isOpen()) {
+			g_Db->logError("ImpostorRenderer", "bake framebuffer is incomplete");
+		}
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  Uploads an atlas with a few mips, bound to no texture
+ *  unit afterwards.
+ ***********************************************************/
+GLuint ImpostorRenderer::CreateTexture(const ImpostorImage& image)
+{
+	const GLsizei size = static_cast<GLsizei>(image.gridSize * image.cellSize);
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, g_MaxImpostorMip);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_textures.push_back(texture);
+	return texture;
+}
+
+/***********************************************************
+ *  DeleteTexture()
+ *
+ *  Deletes one of the atlases. Textures the renderer did not
+ *  create are left alone.
+ ***********************************************************/
+void ImpostorRenderer::DeleteTexture(GLuint texture)
+{
+	auto found = std::find(m_textures.begin(), m_textures.end(), texture);
+	if (found == m_textures.end())
+	{
+		return;
+	}
+	glDeleteTextures(1, &texture);
+	m_textures.erase(found);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  Draws each quad as a four vertex strip. The quads arrive
+ *  in group order, so the texture is bound only when the
+ *  group changes.
+ ***********************************************************/
+void ImpostorRenderer::Draw(const FrameView& view, const std::vector<ImpostorDraw>& impostors)
+{
+	GLint savedProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &savedProgram);
+	glUseProgram(m_program);
+	glUniformMatrix4fv(m_viewLocation, 1, GL_FALSE, glm::value_ptr(view.view));
+	glUniformMatrix4fv(m_projectionLocation, 1, GL_FALSE, glm::value_ptr(view.projection));
+	glUniform1i(m_textureLocation, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(m_emptyVertexArray);
+
+	GLuint boundTexture = 0;
+	for (const ImpostorDraw& impostor : impostors)
+	{
+		if (impostor.textureID != boundTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, impostor.textureID);
+			boundTexture = impostor.textureID;
+		}
+		glUniform3fv(m_centerLocation, 1, &impostor.center[0]);
+		glUniform3fv(m_rightLocation, 1, &impostor.right[0]);
+		glUniform3fv(m_upLocation, 1, &impostor.up[0]);
+		glUniform4fv(m_uvRectLocation, 1, &impostor.uvRect[0]);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+
+	glBindVertexArray(0);
+	glUseProgram(static_cast<GLuint>(savedProgram));
+}
+
+/***********************************************************
+ *  LoadImage()
+ *
+ *  Reads a cached atlas through the virtual file system, so
+ *  an atlas stored in a mounted package is used in place of
+ *  baking. Missing files are expected and not reported.
+ ***********************************************************/
+bool ImpostorRenderer::LoadImage(const std::string& path, uint64_t sourceHash,
+	uint32_t gridSize, uint32_t cellSize, ImpostorImage& image)
+{
+	AssetBlob blob;
+	if (!VirtualFileSystem::Exists(path) || !VirtualFileSystem::Read(path, blob))
+	{
+		return false;
+	}
+
+	const uint8_t* pData = blob.GetData();
+	const size_t pixelBytes = static_cast<size_t>(gridSize) * cellSize * gridSize * cellSize * 4;
+	uint32_t header[3] = {};
+	uint64_t hash = 0;
+	if (blob.GetSize() >= g_HeaderSize)
+	{
+		std::memcpy(header, pData + sizeof(g_Magic), sizeof(header));
+		std::memcpy(&hash, pData + sizeof(g_Magic) + sizeof(header), sizeof(hash));
+	}
+	if ((blob.GetSize() != g_HeaderSize + pixelBytes) ||
+		(std::memcmp(pData, g_Magic, sizeof(g_Magic)) != 0) || (header[0] != g_Version) ||
+		(header[1] != gridSize) || (header[2] != cellSize) || (hash != sourceHash))
+	{
+		std::cerr << "[ImpostorRenderer] " << path << " is stale or corrupt; baking again\n";
+		return false;
+	}
+
+	image.gridSize = gridSize;
+	image.cellSize = cellSize;
+	image.sourceHash = sourceHash;
+	image.pixels.assign(pData + g_HeaderSize, pData + g_HeaderSize + pixelBytes);
+	return true;
+}
+
+/***********************************************************
+ *  SaveImage()
+ *
+ *  Writes an atlas as a loose file, creating its folder.
+ *  Packing the folder with PackAssets moves the cache into
+ *  the asset package.
+ ***********************************************************/
+bool ImpostorRenderer::SaveImage(const std::string& path, const ImpostorImage& image)
+{
+	std::error_code error;
+	const std::filesystem::path folder = std::filesystem::path(path).parent_path();
+	if (!folder.empty())
+	{
+		std::filesystem::create_directories(folder, error);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "[ImpostorRenderer] cannot create " << path << "\n";
+		return false;
+	}
+	file.write(g_Magic, sizeof(g_Magic));
+	WriteValue(file, g_Version);
+	WriteValue(file, image.gridSize);
+	WriteValue(file, image.cellSize);
+	WriteValue(file, image.sourceHash);
+	file.write(reinterpret_cast<const char*>(image.pixels.data()),
+		static_cast<std::streamsize>(image.pixels.size()));
+	if (!file)
+	{
+		std::cerr << "[ImpostorRenderer] failed writing " << path << "\n";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorrendering.h
+// ============
+// impostors for distant composite objects - a group of objects is rendered
+// once from every direction of an octahedral grid into an atlas, and drawn as
+// a single textured quad while it is small on screen
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTypes.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ImpostorConfig
+{
+	// groups smaller than this are drawn as their impostor; the size is
+	// the bounding radius over the distance, scaled like the projection,
+	// so about half the screen height is 1
+	float maxScreenSize = 0.06f;
+	// views along each side of the octahedral grid, and the pixels
+	// along each side of a view
+	uint32_t gridSize = 8;
+	uint32_t cellSize = 64;
+};
+
+// the pixels of an impostor atlas, as baked or read from the cache
+struct ImpostorImage
+{
+	uint32_t gridSize = 0;
+	uint32_t cellSize = 0;
+	// hash of everything the bake depends on; a cached image with a
+	// different hash is stale
+	uint64_t sourceHash = 0;
+	// RGBA, bottom row first, gridSize * cellSize pixels square
+	std::vector<uint8_t> pixels;
+};
+
+/***********************************************************
+ *  ImpostorRenderer
+ *
+ *  Cell (x, y) of the grid holds the view from the direction
+ *  an octahedral map puts at the cell's center: the upper
+ *  half of the sphere fills the inner diamond and the lower
+ *  half is folded out into the corners. Each view is an
+ *  orthographic image of the group's bounding sphere, so the
+ *  quad drawn in its place is the sphere's size, faces the
+ *  view nearest the camera and needs no depth correction.
+ *  Views are lit when baked; a change of lights needs a new
+ *  bake.
+ *
+ *  Baking and drawing run on the GL thread; the direction
+ *  helpers are plain math for the thread building frames.
+ ***********************************************************/
+class ImpostorRenderer
+{
+public:
+	// draws the group with the scene program for one view of the grid
+	typedef std::function<void(const glm::mat4& view, const glm::mat4& projection,
+		const glm::vec3& eye)> DrawFunction;
+
+	ImpostorRenderer();
+	~ImpostorRenderer();
+
+	ImpostorRenderer(const ImpostorRenderer&) = delete;
+	ImpostorRenderer& operator=(const ImpostorRenderer&) = delete;
+
+	// compile the quad shader; returns false if it fails
+	bool Initialize(const char* vertexShaderPath, const char* fragmentShaderPath);
+
+	// unit direction from the group toward the camera of a cell
+	static glm::vec3 GetCellDirection(uint32_t gridSize, uint32_t x, uint32_t y);
+	// the cell whose view is nearest a direction toward the camera
+	static void FindCell(uint32_t gridSize, const glm::vec3& direction, uint32_t& x, uint32_t& y);
+	// the screen axes of the view from a direction
+	static void GetViewAxes(const glm::vec3& direction, glm::vec3& right, glm::vec3& up);
+	// the quad replacing a group seen from a direction
+	static ImpostorDraw MakeDraw(uint32_t gridSize, const glm::vec3& center, float radius,
+		const glm::vec3& direction, uint32_t textureID);
+
+	// render every view of a group into an atlas and read it back; the
+	// caller's framebuffer and viewport are restored
+	bool Bake(const glm::vec3& center, float radius, uint32_t gridSize, uint32_t cellSize,
+		const DrawFunction& draw, ImpostorImage& image);
+	// upload an atlas; the renderer owns the texture
+	GLuint CreateTexture(const ImpostorImage& image);
+	// delete a texture made by CreateTexture() before the renderer is
+	// destroyed, such as when its group goes away
+	void DeleteTexture(GLuint texture);
+
+	// draw the quads of a frame; the caller's program is restored
+	void Draw(const FrameView& view, const std::vector<ImpostorDraw>& impostors);
+
+	// the cache, read from a mounted package or a loose file; false if
+	// missing, corrupt or of another hash or size
+	static bool LoadImage(const std::string& path, uint64_t sourceHash,
+		uint32_t gridSize, uint32_t cellSize, ImpostorImage& image);
+	static bool SaveImage(const std::string& path, const ImpostorImage& image);
+
+private:
+	GLuint m_program = 0;
+	GLint m_viewLocation = -1;
+	GLint m_projectionLocation = -1;
+	GLint m_centerLocation = -1;
+	GLint m_rightLocation = -1;
+	GLint m_upLocation = -1;
+	GLint m_uvRectLocation = -1;
+	GLint m_textureLocation = -1;
+	GLuint m_emptyVertexArray = 0;
+	std::vector<GLuint> m_textures;
+};
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputqueue.cpp
+// ============
+// timestamped input events - the GLFW callbacks push events into a lock-free
+// ring and the camera update consumes them once per frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputQueue.h"
+
+/***********************************************************
+ *  InputQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputQueue::InputQueue()
+	: m_head(0)
+	, m_tail(0)
+	, m_dropped(0)
+{
+}
+
+/***********************************************************
+ *  Push()
+ *
+ *  Copies the event into the ring and publishes it.
+ ***********************************************************/
+bool InputQueue::Push(const InputEvent& event)
+{
+	const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+	const uint32_t head = m_head.load(std::memory_order_acquire);
+	if (tail - head >= kCapacity)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	m_events[tail & kIndexMask] = event;
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+/***********************************************************
+ *  Drain()
+ *
+ *  Moves every published event into the output list,
+ *  coalescing consecutive mouse moves and scrolls.
+ ***********************************************************/
+uint32_t InputQueue::Drain(std::vector<InputEvent>& output)
+{
+	const size_t start = output.size();
+	uint32_t head = m_head.load(std::memory_order_relaxed);
+	const uint32_t tail = m_tail.load(std::memory_order_acquire);
+
+	for (; head != tail; ++head)
+	{
+		const InputEvent& event = m_events[head & kIndexMask];
+		if ((output.size() > start) && (output.back().type == event.type))
+		{
+			InputEvent& previous = output.back();
+			if (event.type == InputEventType::MouseMove)
+			{
+				previous.x = event.x;
+				previous.y = event.y;
+				previous.time = event.time;
+				m_coalesced++;
+				continue;
+			}
+			if (event.type == InputEventType::Scroll)
+			{
+				previous.x += event.x;
+				previous.y += event.y;
+				previous.time = event.time;
+				m_coalesced++;
+				continue;
+			}
+		}
+		output.push_back(event);
+	}
+
+	m_head.store(head, std::memory_order_release);
+	return static_cast<uint32_t>(output.size() - start);
+}
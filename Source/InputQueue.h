@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputqueue.h
+// ============
+// timestamped input events - the GLFW callbacks push events into a lock-free
+// ring and the camera update consumes them once per frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class InputEventType : uint8_t
+{
+	// key is a GLFW key code, action GLFW_PRESS or GLFW_RELEASE
+	Key,
+	// x/y is the absolute cursor position
+	MouseMove,
+	// y is the wheel offset
+	Scroll,
+	// key is a GLFW mouse button, action GLFW_PRESS or GLFW_RELEASE
+	MouseButton
+};
+
+struct InputEvent
+{
+	// glfwGetTime() when the event was received
+	double time = 0.0;
+	double x = 0.0;
+	double y = 0.0;
+	int32_t key = 0;
+	int32_t action = 0;
+	InputEventType type = InputEventType::Key;
+};
+
+/***********************************************************
+ *  InputQueue
+ *
+ *  Single producer, single consumer ring. Push() never
+ *  blocks; a full ring drops the event and counts it.
+ *  Drain() merges runs of mouse moves into the last one
+ *  and runs of scrolls into their sum, since only the
+ *  end result of such a run affects the camera.
+ ***********************************************************/
+class InputQueue
+{
+public:
+	InputQueue();
+
+	// producer side - returns false when the ring is full
+	bool Push(const InputEvent& event);
+
+	// consumer side - appends the queued events to output in
+	// arrival order; returns the number appended
+	uint32_t Drain(std::vector<InputEvent>& output);
+
+	uint64_t GetDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+	uint64_t GetCoalescedCount() const { return m_coalesced; }
+
+private:
+	static const uint32_t kCapacity = 1024;
+	static const uint32_t kIndexMask = kCapacity - 1;
+
+	InputEvent m_events[kCapacity];
+	// written by the consumer
+	std::atomic<uint32_t> m_head;
+	// written by the producer
+	std::atomic<uint32_t> m_tail;
+	std::atomic<uint64_t> m_dropped;
+	uint64_t m_coalesced = 0;
+};
@@ -0,0 +1,278 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecording.cpp
+// ============
+// input recording and replay - the input events and camera state of every
+// frame in a compact binary file that replays deterministically
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputRecording.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const char g_Magic[4] = { 'I', 'R', 'E', 'C' };
+	const uint32_t g_Version = 1;
+	// offset of the frame count inside the header
+	const std::streamoff g_FrameCountOffset = 8;
+
+	template <typename T>
+	void WriteValue(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(std::ifstream& file, T& value)
+	{
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	void WriteVec3(std::ofstream& file, const glm::vec3& value)
+	{
+		WriteValue(file, value.x);
+		WriteValue(file, value.y);
+		WriteValue(file, value.z);
+	}
+
+	bool ReadVec3(std::ifstream& file, glm::vec3& value)
+	{
+		return ReadValue(file, value.x) && ReadValue(file, value.y) && ReadValue(file, value.z);
+	}
+
+	void WriteCamera(std::ofstream& file, const CameraState& camera)
+	{
+		WriteVec3(file, camera.position);
+		WriteVec3(file, camera.front);
+		WriteVec3(file, camera.up);
+		WriteVec3(file, camera.right);
+		WriteValue(file, camera.yaw);
+		WriteValue(file, camera.pitch);
+		WriteValue(file, camera.zoom);
+		WriteValue(file, camera.movementSpeed);
+		WriteValue(file, static_cast<uint8_t>(camera.bOrthographic ? 1 : 0));
+	}
+
+	bool ReadCamera(std::ifstream& file, CameraState& camera)
+	{
+		uint8_t orthographic = 0;
+		bool ok = ReadVec3(file, camera.position) &&
+			ReadVec3(file, camera.front) &&
+			ReadVec3(file, camera.up) &&
+			ReadVec3(file, camera.right) &&
+			ReadValue(file, camera.yaw) &&
+			ReadValue(file, camera.pitch) &&
+			ReadValue(file, camera.zoom) &&
+			ReadValue(file, camera.movementSpeed) &&
+			ReadValue(file, orthographic);
+		camera.bOrthographic = (orthographic != 0);
+		return ok;
+	}
+}
+
+/***********************************************************
+ *  ~InputRecorder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputRecorder::~InputRecorder()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  Creates the file and writes the header with a frame
+ *  count of zero, patched by Close().
+ ***********************************************************/
+bool InputRecorder::Open(const char* path, const CameraState& initialCamera)
+{
+	m_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_file.is_open())
+	{
+		std::cerr << "[InputRecorder] cannot create " << path << "\n";
+		return false;
+	}
+
+	m_frameCount = 0;
+	m_recordedSeconds = 0.0;
+	m_file.write(g_Magic, sizeof(g_Magic));
+	WriteValue(m_file, g_Version);
+	WriteValue(m_file, m_frameCount);
+	WriteValue(m_file, m_recordedSeconds);
+	WriteCamera(m_file, initialCamera);
+	return true;
+}
+
+/***********************************************************
+ *  WriteFrame()
+ *
+ *  Appends one frame. Events that arrived before the frame
+ *  started (while the loop was paused) count as arriving
+ *  at its start.
+ ***********************************************************/
+void InputRecorder::WriteFrame(double frameStart, double frameEnd,
+	const std::vector<InputEvent>& events, const CameraState& camera)
+{
+	if (!m_file.is_open())
+	{
+		return;
+	}
+
+	const float deltaTime = static_cast<float>(frameEnd - frameStart);
+	const uint16_t eventCount = static_cast<uint16_t>(std::min<size_t>(events.size(), 0xFFFF));
+	WriteValue(m_file, deltaTime);
+	WriteValue(m_file, eventCount);
+	WriteCamera(m_file, camera);
+
+	for (uint16_t i = 0; i < eventCount; ++i)
+	{
+		const InputEvent& event = events[i];
+		WriteValue(m_file, static_cast<uint8_t>(event.type));
+		WriteValue(m_file, static_cast<uint8_t>(event.action));
+		WriteValue(m_file, static_cast<int16_t>(event.key));
+		WriteValue(m_file, static_cast<float>(std::max(0.0, event.time - frameStart)));
+		WriteValue(m_file, static_cast<float>(event.x));
+		WriteValue(m_file, static_cast<float>(event.y));
+	}
+
+	m_frameCount++;
+	m_recordedSeconds += frameEnd - frameStart;
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  Writes the final frame count and duration into the
+ *  header and closes the file.
+ ***********************************************************/
+void InputRecorder::Close()
+{
+	if (!m_file.is_open())
+	{
+		return;
+	}
+
+	m_file.seekp(g_FrameCountOffset);
+	WriteValue(m_file, m_frameCount);
+	WriteValue(m_file, m_recordedSeconds);
+	m_file.close();
+	std::cout << "INFO: recorded " << m_frameCount << " frames (" << m_recordedSeconds << " s)\n";
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  Reads and validates a whole recording.
+ ***********************************************************/
+bool InputPlayer::Open(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "[InputPlayer] cannot open " << path << "\n";
+		return false;
+	}
+
+	char magic[4] = {};
+	uint32_t version = 0;
+	uint32_t frameCount = 0;
+	file.read(magic, sizeof(magic));
+	if (!file || (std::memcmp(magic, g_Magic, sizeof(magic)) != 0) ||
+		!ReadValue(file, version) || (version != g_Version) ||
+		!ReadValue(file, frameCount) ||
+		!ReadValue(file, m_recordedSeconds) ||
+		!ReadCamera(file, m_initialCamera))
+	{
+		std::cerr << "[InputPlayer] " << path << " is not a version "
+			<< g_Version << " input recording\n";
+		return false;
+	}
+
+	m_frames.clear();
+	m_events.clear();
+	m_frames.reserve(frameCount);
+	for (uint32_t i = 0; i < frameCount; ++i)
+	{
+		RecordedFrame frame;
+		uint16_t eventCount = 0;
+		if (!ReadValue(file, frame.deltaTime) || !ReadValue(file, eventCount) ||
+			!ReadCamera(file, frame.camera))
+		{
+			break;
+		}
+
+		frame.firstEvent = static_cast<uint32_t>(m_events.size());
+		frame.eventCount = eventCount;
+		for (uint16_t e = 0; e < eventCount; ++e)
+		{
+			uint8_t type = 0;
+			uint8_t action = 0;
+			int16_t key = 0;
+			float offset = 0.0f;
+			float x = 0.0f;
+			float y = 0.0f;
+			if (!ReadValue(file, type) || !ReadValue(file, action) || !ReadValue(file, key) ||
+				!ReadValue(file, offset) || !ReadValue(file, x) || !ReadValue(file, y))
+			{
+				std::cerr << "[InputPlayer] " << path << " is truncated\n";
+				return !m_frames.empty();
+			}
+
+			InputEvent event;
+			event.type = static_cast<InputEventType>(type);
+			event.action = action;
+			event.key = key;
+			event.time = offset;
+			event.x = x;
+			event.y = y;
+			m_events.push_back(event);
+		}
+		m_frames.push_back(frame);
+	}
+
+	if (m_frames.size() != frameCount)
+	{
+		std::cerr << "[InputPlayer] " << path << " holds " << m_frames.size()
+			<< " of " << frameCount << " frames\n";
+	}
+	return !m_frames.empty();
+}
+
+/***********************************************************
+ *  GetMeanDeltaTime()
+ *
+ *  The average recorded frame time - the default replay
+ *  timestep, so a replay covers the recorded duration.
+ ***********************************************************/
+double InputPlayer::GetMeanDeltaTime() const
+{
+	if (m_frames.empty() || (m_recordedSeconds <= 0.0))
+	{
+		return 1.0 / 60.0;
+	}
+	return m_recordedSeconds / static_cast<double>(m_frames.size());
+}
+
+/***********************************************************
+ *  ScheduleEvents()
+ *
+ *  Scales the event offsets of a recorded frame from the
+ *  recorded frame time to the replay timestep.
+ ***********************************************************/
+void InputPlayer::ScheduleEvents(uint32_t index, double frameStart, double timestep,
+	std::vector<InputEvent>& output) const
+{
+	const RecordedFrame& frame = m_frames[index];
+	for (uint32_t i = 0; i < frame.eventCount; ++i)
+	{
+		InputEvent event = m_events[frame.firstEvent + i];
+		double fraction = (frame.deltaTime > 0.0f) ? event.time / frame.deltaTime : 1.0;
+		event.time = frameStart + std::min(1.0, std::max(0.0, fraction)) * timestep;
+		output.push_back(event);
+	}
+}
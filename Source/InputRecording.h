@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecording.h
+// ============
+// input recording and replay - the input events and camera state of every
+// frame in a compact binary file that replays deterministically
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "InputQueue.h"
+#include "RenderTypes.h"
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/***********************************************************
+ *  Recording file format (version 1, little-endian, packed)
+ *
+ *  header: "IREC", uint32 version, uint32 frame count,
+ *          double recorded seconds, initial camera
+ *  frame:  float delta time, uint16 event count,
+ *          camera after the update, then the events
+ *  event:  uint8 type, uint8 action, int16 key,
+ *          float seconds after frame start, float x, float y
+ *  camera: 16 floats (position, front, up, right, yaw,
+ *          pitch, zoom, movement speed), uint8 orthographic
+ ***********************************************************/
+
+/***********************************************************
+ *  InputRecorder
+ *
+ *  Call WriteFrame() after every camera update with the
+ *  events that update applied.
+ ***********************************************************/
+class InputRecorder
+{
+public:
+	~InputRecorder();
+
+	bool Open(const char* path, const CameraState& initialCamera);
+	void WriteFrame(double frameStart, double frameEnd,
+		const std::vector<InputEvent>& events, const CameraState& camera);
+	// patches the header with the frame count; called by the destructor too
+	void Close();
+
+	bool IsOpen() const { return m_file.is_open(); }
+	uint32_t GetFrameCount() const { return m_frameCount; }
+
+private:
+	std::ofstream m_file;
+	uint32_t m_frameCount = 0;
+	double m_recordedSeconds = 0.0;
+};
+
+// one frame of a loaded recording; the events live in the player
+struct RecordedFrame
+{
+	float deltaTime = 0.0f;
+	CameraState camera;
+	uint32_t firstEvent = 0;
+	uint32_t eventCount = 0;
+};
+
+/***********************************************************
+ *  InputPlayer
+ *
+ *  Loads a whole recording up front so that replaying does
+ *  no file IO. Replays run with a fixed timestep: each
+ *  recorded frame becomes one replay frame and its events
+ *  keep their relative position inside the frame.
+ ***********************************************************/
+class InputPlayer
+{
+public:
+	bool Open(const char* path);
+
+	uint32_t GetFrameCount() const { return static_cast<uint32_t>(m_frames.size()); }
+	double GetMeanDeltaTime() const;
+	const CameraState& GetInitialCamera() const { return m_initialCamera; }
+	const RecordedFrame& GetFrame(uint32_t index) const { return m_frames[index]; }
+
+	// append the events of a recorded frame with their times moved onto
+	// a replay frame that starts at frameStart and lasts timestep
+	void ScheduleEvents(uint32_t index, double frameStart, double timestep,
+		std::vector<InputEvent>& output) const;
+
+private:
+	CameraState m_initialCamera;
+	std::vector<RecordedFrame> m_frames;
+	// event times are seconds after the start of their frame
+	std::vector<InputEvent> m_events;
+	double m_recordedSeconds = 0.0;
+};
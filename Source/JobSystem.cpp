@@ -0,0 +1,494 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// work-stealing job scheduler shared by the engine subsystems - culling,
+// transform updates, light assignment, texture decoding
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <cassert>
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// index of the calling thread inside the job system that it is
+	// attached to; -1 for threads that never attached
+	thread_local int t_threadIndex = -1;
+	thread_local const JobSystem* t_owner = nullptr;
+
+	// number of empty polls before an idle worker goes to sleep
+	const int g_SpinsBeforeSleep = 64;
+}
+
+/***********************************************************
+ *  WorkStealingQueue()
+ *
+ *  The capacity is rounded up to the next power of two so
+ *  that indices can be wrapped with a mask.
+ ***********************************************************/
+WorkStealingQueue::WorkStealingQueue(uint32_t capacity)
+{
+	uint32_t size = 1;
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+	m_mask = size - 1;
+	m_buffer.reset(new std::atomic<Job*>[size]);
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		m_buffer[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+/***********************************************************
+ *  Push()
+ *
+ *  Adds a job at the bottom of the deque. Returns false when
+ *  the deque is full so the caller can run the job inline.
+ ***********************************************************/
+bool WorkStealingQueue::Push(Job* job)
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	int64_t top = m_top.load(std::memory_order_acquire);
+	if (bottom - top > static_cast<int64_t>(m_mask))
+	{
+		return false;
+	}
+
+	m_buffer[bottom & m_mask].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+/***********************************************************
+ *  Pop()
+ *
+ *  Takes the most recently pushed job. Races with thieves
+ *  only when a single job is left in the deque.
+ ***********************************************************/
+Job* WorkStealingQueue::Pop()
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// the deque was already empty
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = m_buffer[bottom & m_mask].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// last job - compete with the thieves for it
+		if (!m_top.compare_exchange_strong(top, top + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			job = nullptr;
+		}
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+/***********************************************************
+ *  Steal()
+ *
+ *  Takes the oldest job from the top of the deque.
+ ***********************************************************/
+Job* WorkStealingQueue::Steal()
+{
+	int64_t top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return nullptr;
+	}
+
+	Job* job = m_buffer[top & m_mask].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(top, top + 1,
+		std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		// lost the race against the owner or another thief
+		return nullptr;
+	}
+	return job;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  Creates the worker threads. The constructing thread is
+ *  attached as thread 0.
+ ***********************************************************/
+JobSystem::JobSystem(int workerCount)
+{
+	if (workerCount < 0)
+	{
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = (hardwareThreads > 1) ? static_cast<int>(hardwareThreads) - 1 : 0;
+	}
+	m_workerCount = static_cast<unsigned>(workerCount);
+
+	// one context for the creating thread, one per worker and a
+	// few spare ones for threads that attach later
+	m_contexts.resize(1 + m_workerCount + kExternalThreads);
+	for (ThreadContext& context : m_contexts)
+	{
+		context.queue.reset(new WorkStealingQueue(kQueueCapacity));
+		context.jobPool.reset(new Job[kJobPoolSize]);
+	}
+
+	t_threadIndex = 0;
+	t_owner = this;
+
+	m_workers.reserve(m_workerCount);
+	for (unsigned i = 0; i < m_workerCount; ++i)
+	{
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  Stops and joins the worker threads. Outstanding jobs must
+ *  have been waited on before the job system is destroyed.
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	m_running.store(false, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_wakeCondition.notify_all();
+	}
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+
+	if (t_owner == this)
+	{
+		t_threadIndex = -1;
+		t_owner = nullptr;
+	}
+}
+
+/***********************************************************
+ *  AttachCurrentThread()
+ *
+ *  Hands one of the spare contexts to the calling thread so
+ *  that it may schedule and wait on jobs.
+ ***********************************************************/
+bool JobSystem::AttachCurrentThread()
+{
+	if (t_owner == this)
+	{
+		return true;
+	}
+
+	unsigned slot = m_attachedThreads.fetch_add(1, std::memory_order_relaxed);
+	if (slot >= kExternalThreads)
+	{
+		return false;
+	}
+
+	t_threadIndex = static_cast<int>(1 + m_workerCount + slot);
+	t_owner = this;
+	return true;
+}
+
+/***********************************************************
+ *  CurrentThreadIndex()
+ *
+ *  Returns the context index of the calling thread.
+ ***********************************************************/
+unsigned JobSystem::CurrentThreadIndex() const
+{
+	assert(t_owner == this && "thread is not attached to this job system");
+	return static_cast<unsigned>(t_threadIndex);
+}
+
+/***********************************************************
+ *  AllocateJob()
+ *
+ *  Jobs come from a per-thread ring, so allocation needs no
+ *  locking. Jobs finish out of order, so the ring is searched
+ *  for the next slot that has been given back; nullptr is
+ *  returned when every slot is still in flight.
+ ***********************************************************/
+Job* JobSystem::AllocateJob(unsigned threadIndex)
+{
+	ThreadContext& context = m_contexts[threadIndex];
+	for (uint32_t i = 0; i < kJobPoolSize; ++i)
+	{
+		Job* job = &context.jobPool[(context.nextJob + i) & (kJobPoolSize - 1)];
+		if (!job->inUse.load(std::memory_order_acquire))
+		{
+			// only the owning thread sets the flag, so nothing can
+			// take the slot between the check and the store
+			job->inUse.store(true, std::memory_order_relaxed);
+			context.nextJob += i + 1;
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  Pushes a job onto the calling thread's deque and wakes a
+ *  sleeping worker to pick it up.
+ ***********************************************************/
+void JobSystem::Run(JobFunction function, void* data,
+	uint32_t begin, uint32_t end,
+	JobCounter* counter,
+	JobCounter* dependency)
+{
+	unsigned threadIndex = CurrentThreadIndex();
+
+	Job* job = AllocateJob(threadIndex);
+	if (job == nullptr)
+	{
+		// every slot is in flight - the job completes before Run
+		// returns, so its counter never needs to count it
+		RunInline(threadIndex, function, data, begin, end, dependency);
+		return;
+	}
+	job->function = function;
+	job->data = data;
+	job->begin = begin;
+	job->end = end;
+	job->counter = counter;
+	job->dependency = dependency;
+
+	if (counter != nullptr)
+	{
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (!Enqueue(threadIndex, job))
+	{
+		return;
+	}
+
+	if (m_sleepingWorkers.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_wakeCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  GetJob()
+ *
+ *  Pops from the thread's own deque, otherwise tries to
+ *  steal from the other threads starting with a neighbour.
+ ***********************************************************/
+Job* JobSystem::GetJob(unsigned threadIndex)
+{
+	Job* job = m_contexts[threadIndex].queue->Pop();
+	if (job != nullptr)
+	{
+		return job;
+	}
+
+	const unsigned contextCount = static_cast<unsigned>(m_contexts.size());
+	for (unsigned i = 1; i < contextCount; ++i)
+	{
+		unsigned victim = (threadIndex + i) % contextCount;
+		job = m_contexts[victim].queue->Steal();
+		if (job != nullptr)
+		{
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+/***********************************************************
+ *  IsReady()
+ *
+ *  A job is ready once the counter it depends on is done.
+ ***********************************************************/
+bool JobSystem::IsReady(const Job* job) const
+{
+	return (job->dependency == nullptr) || job->dependency->IsDone();
+}
+
+/***********************************************************
+ *  Enqueue()
+ *
+ *  Pushes a job onto the thread's deque. When the deque is
+ *  full the job has nowhere to wait, so the thread helps with
+ *  other jobs until it is ready and runs it right here;
+ *  false is returned in that case.
+ ***********************************************************/
+bool JobSystem::Enqueue(unsigned threadIndex, Job* job)
+{
+	if (m_contexts[threadIndex].queue->Push(job))
+	{
+		return true;
+	}
+
+	while (!IsReady(job))
+	{
+		Job* other = GetJob(threadIndex);
+		if (other != nullptr)
+		{
+			Execute(threadIndex, other);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	Execute(threadIndex, job);
+	return false;
+}
+
+/***********************************************************
+ *  RunInline()
+ *
+ *  Runs a job that could not get a slot on the calling
+ *  thread, helping with other jobs until its dependency is
+ *  done.
+ ***********************************************************/
+void JobSystem::RunInline(unsigned threadIndex, JobFunction function, void* data,
+	uint32_t begin, uint32_t end, JobCounter* dependency)
+{
+	while ((dependency != nullptr) && !dependency->IsDone())
+	{
+		Job* other = GetJob(threadIndex);
+		if (other != nullptr)
+		{
+			Execute(threadIndex, other);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	function(data, begin, end);
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  Runs a job once its dependency is satisfied. A job that
+ *  is not ready yet goes back on the deque, the oldest job
+ *  on the deque is tried in its place and false is returned.
+ ***********************************************************/
+bool JobSystem::Execute(unsigned threadIndex, Job* job)
+{
+	if (!IsReady(job))
+	{
+		// popping again would return the same job, so take the oldest
+		// one first - usually the job the parked one is waiting for.
+		// A job stolen from another thread may not fit back on a full
+		// deque, in which case Enqueue runs it once it is ready.
+		Job* other = m_contexts[threadIndex].queue->Steal();
+		Enqueue(threadIndex, job);
+		if (other != nullptr)
+		{
+			if (IsReady(other))
+			{
+				Execute(threadIndex, other);
+			}
+			else
+			{
+				Enqueue(threadIndex, other);
+				std::this_thread::yield();
+			}
+		}
+		return false;
+	}
+
+	// the slot goes back to its owner before the job runs, so
+	// nothing may be read from it afterwards
+	JobFunction function = job->function;
+	void* data = job->data;
+	uint32_t begin = job->begin;
+	uint32_t end = job->end;
+	JobCounter* counter = job->counter;
+	job->inUse.store(false, std::memory_order_release);
+
+	function(data, begin, end);
+
+	if (counter != nullptr)
+	{
+		counter->pending.fetch_sub(1, std::memory_order_release);
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  Helps executing jobs until the counter drops to zero, so
+ *  waiting never blocks a thread that could do work.
+ ***********************************************************/
+void JobSystem::Wait(JobCounter& counter)
+{
+	unsigned threadIndex = CurrentThreadIndex();
+
+	while (!counter.IsDone())
+	{
+		Job* job = GetJob(threadIndex);
+		if (job != nullptr)
+		{
+			Execute(threadIndex, job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  Body of every worker thread. Idle workers spin briefly
+ *  and then sleep until new work is scheduled.
+ ***********************************************************/
+void JobSystem::WorkerLoop(unsigned threadIndex)
+{
+	t_threadIndex = static_cast<int>(threadIndex);
+	t_owner = this;
+
+	int idleSpins = 0;
+	while (m_running.load(std::memory_order_acquire))
+	{
+		Job* job = GetJob(threadIndex);
+		if (job != nullptr)
+		{
+			Execute(threadIndex, job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < g_SpinsBeforeSleep)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// the timeout covers a wake-up racing with the sleep
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_sleepingWorkers.fetch_add(1, std::memory_order_release);
+		m_wakeCondition.wait_for(lock, std::chrono::milliseconds(1));
+		m_sleepingWorkers.fetch_sub(1, std::memory_order_release);
+		idleSpins = 0;
+	}
+}
@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// work-stealing job scheduler shared by the engine subsystems - culling,
+// transform updates, light assignment, texture decoding
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobCounter
+ *
+ *  Tracks the number of outstanding jobs in a group. A job
+ *  decrements its counter when it completes, and a job that
+ *  depends on a counter is held back until it reaches zero.
+ ***********************************************************/
+struct JobCounter
+{
+	std::atomic<uint32_t> pending{ 0 };
+
+	bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// signature of a job entry point - the job works on [begin, end)
+typedef void (*JobFunction)(void* data, uint32_t begin, uint32_t end);
+
+struct Job
+{
+	JobFunction function = nullptr;
+	void* data = nullptr;
+	uint32_t begin = 0;
+	uint32_t end = 0;
+	JobCounter* counter = nullptr;
+	JobCounter* dependency = nullptr;
+	// set while the job is queued or running; whichever thread
+	// executes the job clears it to give the slot back
+	std::atomic<bool> inUse{ false };
+};
+
+/***********************************************************
+ *  WorkStealingQueue
+ *
+ *  Fixed-capacity Chase-Lev deque. The owning thread pushes
+ *  and pops at the bottom; any other thread may steal from
+ *  the top.
+ ***********************************************************/
+class WorkStealingQueue
+{
+public:
+	explicit WorkStealingQueue(uint32_t capacity);
+
+	// owner thread only
+	bool Push(Job* job);
+	Job* Pop();
+	// any thread
+	Job* Steal();
+
+	uint32_t Capacity() const { return m_mask + 1; }
+
+private:
+	std::unique_ptr<std::atomic<Job*>[]> m_buffer;
+	uint32_t m_mask;
+	alignas(64) std::atomic<int64_t> m_top{ 0 };
+	alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+};
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  Owns the worker threads and one deque per participating
+ *  thread. The thread that constructs the job system is
+ *  thread 0; other threads (e.g. the frame pipeline) must
+ *  call AttachCurrentThread() before scheduling jobs.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// a negative workerCount uses one worker per remaining hardware thread
+	explicit JobSystem(int workerCount = -1);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// number of threads that execute jobs, including the caller
+	unsigned GetThreadCount() const { return m_workerCount + 1; }
+
+	// give the calling thread its own deque; returns false when
+	// all external slots are already taken
+	bool AttachCurrentThread();
+
+	// schedule a job over [begin, end); when a dependency is given
+	// the job does not start before that counter reaches zero
+	void Run(JobFunction function, void* data,
+		uint32_t begin, uint32_t end,
+		JobCounter* counter,
+		JobCounter* dependency = nullptr);
+
+	// execute pending jobs on the calling thread until the counter is done
+	void Wait(JobCounter& counter);
+
+	// split [0, count) into chunks of at most grainSize and run
+	// body(begin, end) on every chunk, returning once all are done
+	template <typename Body>
+	void ParallelFor(uint32_t count, uint32_t grainSize, const Body& body);
+
+private:
+	static const uint32_t kQueueCapacity = 4096;
+	// stolen jobs may wait in other threads' deques, so a thread can have
+	// more jobs in flight than its own deque holds
+	static const uint32_t kJobPoolSize = 2 * kQueueCapacity;
+	static const unsigned kExternalThreads = 2;
+
+	struct ThreadContext
+	{
+		std::unique_ptr<WorkStealingQueue> queue;
+		std::unique_ptr<Job[]> jobPool;
+		uint32_t nextJob = 0;
+	};
+
+	Job* AllocateJob(unsigned threadIndex);
+	Job* GetJob(unsigned threadIndex);
+	bool IsReady(const Job* job) const;
+	bool Enqueue(unsigned threadIndex, Job* job);
+	void RunInline(unsigned threadIndex, JobFunction function, void* data,
+		uint32_t begin, uint32_t end, JobCounter* dependency);
+	bool Execute(unsigned threadIndex, Job* job);
+	void WorkerLoop(unsigned threadIndex);
+	unsigned CurrentThreadIndex() const;
+
+	template <typename Body>
+	static void ParallelForTrampoline(void* data, uint32_t begin, uint32_t end)
+	{
+		(*static_cast<const Body*>(data))(begin, end);
+	}
+
+	unsigned m_workerCount = 0;
+	std::vector<ThreadContext> m_contexts;
+	std::vector<std::thread> m_workers;
+	std::atomic<unsigned> m_attachedThreads{ 0 };
+	std::atomic<bool> m_running{ true };
+
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic<uint32_t> m_sleepingWorkers{ 0 };
+};
+
+template <typename Body>
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const Body& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	if (grainSize == 0)
+	{
+		grainSize = 1;
+	}
+
+	// small ranges are not worth the scheduling overhead
+	if (count <= grainSize || m_workerCount == 0)
+	{
+		body(0u, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (uint32_t begin = 0; begin < count; begin += grainSize)
+	{
+		uint32_t end = (count - begin > grainSize) ? begin + grainSize : count;
+		Run(&JobSystem::ParallelForTrampoline<Body>,
+			const_cast<Body*>(&body), begin, end, &counter);
+	}
+	Wait(counter);
+}
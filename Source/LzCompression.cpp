@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+// lzcompression.cpp
+// ============
+// small byte-oriented LZ77 codec for asset package entries - fast to decode,
+// no dictionary or entropy stage, so images that are already compressed are
+// better stored as they are
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LzCompression.h"
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  Stream format
+	 *
+	 *  A sequence of blocks, each a token byte whose high four
+	 *  bits are the literal count and low four bits the match
+	 *  length minus kMinMatch. A nibble of 15 continues in
+	 *  bytes that add up until one is below 255. The literals
+	 *  follow, then a 16-bit little-endian match offset. The
+	 *  last block has literals only.
+	 ***********************************************************/
+	const size_t kMinMatch = 4;
+	const size_t kMaxOffset = 65535;
+	const int kHashBits = 14;
+
+	uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t HashSequence(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - kHashBits);
+	}
+
+	void WriteLength(std::vector<uint8_t>& output, size_t length)
+	{
+		while (length >= 255)
+		{
+			output.push_back(255);
+			length -= 255;
+		}
+		output.push_back(static_cast<uint8_t>(length));
+	}
+
+	void WriteBlock(std::vector<uint8_t>& output, const uint8_t* literals, size_t literalCount,
+		size_t matchLength, size_t offset)
+	{
+		const size_t matchCode = (matchLength > 0) ? matchLength - kMinMatch : 0;
+		output.push_back(static_cast<uint8_t>(
+			((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+		if (literalCount >= 15)
+		{
+			WriteLength(output, literalCount - 15);
+		}
+		output.insert(output.end(), literals, literals + literalCount);
+		if (matchLength > 0)
+		{
+			output.push_back(static_cast<uint8_t>(offset & 0xFF));
+			output.push_back(static_cast<uint8_t>(offset >> 8));
+			if (matchCode >= 15)
+			{
+				WriteLength(output, matchCode - 15);
+			}
+		}
+	}
+
+	bool ReadLength(const uint8_t*& p, const uint8_t* end, size_t& length)
+	{
+		uint8_t next;
+		do
+		{
+			if (p >= end)
+			{
+				return false;
+			}
+			next = *p++;
+			length += next;
+		} while (next == 255);
+		return true;
+	}
+}
+
+/***********************************************************
+ *  LzCompress()
+ *
+ *  Greedy parse with a single-entry hash table of the last
+ *  position of every 4-byte sequence.
+ ***********************************************************/
+void LzCompress(const uint8_t* data, size_t size, std::vector<uint8_t>& output)
+{
+	output.clear();
+	output.reserve(size + size / 255 + 16);
+
+	std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+	size_t literalStart = 0;
+	size_t position = 0;
+	while (position + kMinMatch <= size)
+	{
+		const uint32_t sequence = Read32(data + position);
+		uint32_t& slot = table[HashSequence(sequence)];
+		const size_t candidate = slot;
+		slot = static_cast<uint32_t>(position);
+
+		if ((candidate < position) && (position - candidate <= kMaxOffset) &&
+			(Read32(data + candidate) == sequence))
+		{
+			size_t length = kMinMatch;
+			while ((position + length < size) && (data[candidate + length] == data[position + length]))
+			{
+				length++;
+			}
+			WriteBlock(output, data + literalStart, position - literalStart, length, position - candidate);
+			position += length;
+			literalStart = position;
+		}
+		else
+		{
+			position++;
+		}
+	}
+	WriteBlock(output, data + literalStart, size - literalStart, 0, 0);
+}
+
+/***********************************************************
+ *  LzDecompress()
+ *
+ *  Every length and offset is checked against both buffers
+ *  before it is used.
+ ***********************************************************/
+bool LzDecompress(const uint8_t* data, size_t size, uint8_t* output, size_t outputSize)
+{
+	const uint8_t* p = data;
+	const uint8_t* end = data + size;
+	size_t written = 0;
+	while (p < end)
+	{
+		const uint8_t token = *p++;
+		size_t literalCount = token >> 4;
+		if ((literalCount == 15) && !ReadLength(p, end, literalCount))
+		{
+			return false;
+		}
+		if ((literalCount > static_cast<size_t>(end - p)) || (literalCount > outputSize - written))
+		{
+			return false;
+		}
+		std::memcpy(output + written, p, literalCount);
+		p += literalCount;
+		written += literalCount;
+
+		if (p == end)
+		{
+			break;
+		}
+
+		if (end - p < 2)
+		{
+			return false;
+		}
+		const size_t offset = static_cast<size_t>(p[0]) | (static_cast<size_t>(p[1]) << 8);
+		p += 2;
+		size_t matchLength = token & 0x0F;
+		if ((matchLength == 15) && !ReadLength(p, end, matchLength))
+		{
+			return false;
+		}
+		matchLength += kMinMatch;
+		if ((offset == 0) || (offset > written) || (matchLength > outputSize - written))
+		{
+			return false;
+		}
+
+		// byte by byte, as the match may overlap what it writes
+		const uint8_t* source = output + written - offset;
+		for (size_t i = 0; i < matchLength; ++i)
+		{
+			output[written + i] = source[i];
+		}
+		written += matchLength;
+	}
+	return written == outputSize;
+}
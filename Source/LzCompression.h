@@ -0,0 +1,20 @@
+///////////////////////////////////////////////////////////////////////////////
+// lzcompression.h
+// ============
+// small byte-oriented LZ77 codec for asset package entries - fast to decode,
+// no dictionary or entropy stage, so images that are already compressed are
+// better stored as they are
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// compress size bytes, replacing the contents of output
+void LzCompress(const uint8_t* data, size_t size, std::vector<uint8_t>& output);
+
+// decompress into exactly outputSize bytes; returns false if the input
+// is corrupt or does not decode to that size
+bool LzDecompress(const uint8_t* data, size_t size, uint8_t* output, size_t outputSize);
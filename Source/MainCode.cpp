@@ -22,9 +22,27 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
-#include "DbHelper.h"
+#include "DBHelper.h"
+#include "JobSystem.h"
+#include "FramePipeline.h"
+#include "FramePacer.h"
+#include "DynamicResolution.h"
+#include "IdleRenderer.h"
+#include "InputRecording.h"
+#include "FrameTimingLog.h"
+#include "CameraPath.h"
+#include "SceneGenerator.h"
+#include "AllocationTracker.h"
+#include "HotReload.h"
+#include "SceneStreaming.h"
+#include "VirtualFileSystem.h"
+#include <chrono>
+#include <cstring>
 #include <memory>
 
+// shared with SceneManager.cpp and ViewManager.cpp
+std::unique_ptr<DbHelper> g_Db;
+
 // Namespace for declaring global variables
 namespace
 {
@@ -34,15 +52,51 @@ namespace
     std::unique_ptr<SceneManager>  g_SceneManager;
     std::unique_ptr<ShaderManager> g_ShaderManager;
     std::unique_ptr<ViewManager>   g_ViewManager;
-	std::unique_ptr<DBHelper> g_Db;
+    std::unique_ptr<JobSystem>     g_JobSystem;
+    std::unique_ptr<FramePipeline> g_FramePipeline;
+    std::unique_ptr<FramePacer>    g_FramePacer;
+    std::unique_ptr<DynamicResolution> g_DynamicResolution;
+    std::unique_ptr<IdleRenderer>  g_IdleRenderer;
+    std::unique_ptr<InputRecorder> g_InputRecorder;
+    std::unique_ptr<InputPlayer>   g_InputPlayer;
+    std::unique_ptr<CameraPath>    g_CameraPath;
+    std::unique_ptr<HotReloader>   g_HotReloader;
+    std::unique_ptr<SceneStreamer> g_SceneStreamer;
+
+    // frames rendered at the start of the path before timing begins,
+    // so that shader compilation and first uploads are not measured
+    const uint32_t g_BenchmarkWarmupFrames = 30;
+
+    // frames of --alloc-test that may still allocate: pools, command
+    // lists and arenas grow to their working size during these
+    const uint32_t g_AllocationWarmupFrames = 120;
+
+    const char* const g_VertexShaderPath = "shaders/vertexShader.glsl";
+    const char* const g_FragmentShaderPath = "shaders/fragmentShader.glsl";
+
+    // events of a replayed frame kept without reallocating
+    const size_t g_ReservedFrameEvents = 256;
+
+    double ElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    }
 }
-wManager* g_ViewManager = nullptr;
 
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+int RunHeadlessReplay(const InputPlayer& player, double timestep,
+	const char* timingsPath, const char* scenePath, bool bAllocationTest,
+	bool bOcclusionCulling, bool bVisibilityCache);
+void PrintReplaySummary(const FrameTimingLog& timings, float maxCameraDrift);
+bool ReportBenchmark(const FrameTimingLog& timings, const char* name, const char* jsonPath);
+void PrintArenaStats(const char* stage, const FrameArenaStats& stats);
+void ReportPick(SceneManager& scene, const FrameView& view);
+void ReportGpuPick(SceneManager& scene);
 
 
 /***********************************************************
@@ -53,6 +107,198 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the simulation/visibility stage runs on its own thread unless
+	// the serial path is requested for debugging
+	bool bUsePipeline = true;
+	FramePacingConfig pacingConfig;
+	bool bUseDynamicResolution = true;
+	DynamicResolutionConfig resolutionConfig;
+	bool bUseIdleRendering = false;
+	const char* recordPath = nullptr;
+	const char* replayPath = nullptr;
+	const char* timingsPath = nullptr;
+	double replayTimestep = 0.0;
+	bool bHeadless = false;
+	const char* benchmarkPath = nullptr;
+	const char* benchmarkJsonPath = "benchmark.json";
+	uint32_t benchmarkFrames = 1000;
+	const char* scenePath = nullptr;
+	const char* streamPath = nullptr;
+	bool bAllocationTest = false;
+	bool bHotReload = false;
+	bool bPackaged = false;
+	bool bGpuPicking = false;
+	bool bOcclusionCulling = true;
+	bool bVisibilityCache = true;
+	bool bImpostors = true;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--serial") == 0)
+		{
+			bUsePipeline = false;
+		}
+		else if ((std::strcmp(argv[i], "--fps") == 0) && (i + 1 < argc))
+		{
+			// 0 runs uncapped
+			pacingConfig.targetFps = std::atof(argv[++i]);
+		}
+		else if ((std::strcmp(argv[i], "--vsync") == 0) && (i + 1 < argc))
+		{
+			if (!FramePacer::ParseVsyncMode(argv[++i], pacingConfig.vsync))
+			{
+				std::cerr << "[Main] --vsync expects off, on or adaptive\n";
+			}
+		}
+		else if (std::strcmp(argv[i], "--no-drs") == 0)
+		{
+			// render straight into the window at native resolution
+			bUseDynamicResolution = false;
+		}
+		else if ((std::strcmp(argv[i], "--drs-budget") == 0) && (i + 1 < argc))
+		{
+			// GPU milliseconds the scene pass may take per frame
+			resolutionConfig.gpuBudgetMs = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--idle") == 0)
+		{
+			// stop redrawing while nothing in the view changes
+			bUseIdleRendering = true;
+		}
+		else if ((std::strcmp(argv[i], "--record") == 0) && (i + 1 < argc))
+		{
+			// capture the input and camera of every frame
+			recordPath = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--replay") == 0) && (i + 1 < argc))
+		{
+			// drive the camera from a recording instead of the user
+			replayPath = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--replay-dt") == 0) && (i + 1 < argc))
+		{
+			// fixed replay timestep in seconds; defaults to the recorded mean
+			replayTimestep = std::atof(argv[++i]);
+		}
+		else if ((std::strcmp(argv[i], "--timings") == 0) && (i + 1 < argc))
+		{
+			// per-frame replay timing as CSV
+			timingsPath = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--benchmark") == 0) && (i + 1 < argc))
+		{
+			// fly the camera along a scripted path and report the timing
+			benchmarkPath = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--benchmark-frames") == 0) && (i + 1 < argc))
+		{
+			benchmarkFrames = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if ((std::strcmp(argv[i], "--benchmark-json") == 0) && (i + 1 < argc))
+		{
+			benchmarkJsonPath = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--scene") == 0) && (i + 1 < argc))
+		{
+			// render a generated scene file instead of the desk
+			scenePath = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--stream") == 0) && (i + 1 < argc))
+		{
+			// stream the cells of a cell world around the camera
+			streamPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			// replay without a window, timing only the CPU stages
+			bHeadless = true;
+		}
+		else if (std::strcmp(argv[i], "--alloc-test") == 0)
+		{
+			// fail if any frame after the warm-up reaches the heap
+			bAllocationTest = true;
+		}
+		else if (std::strcmp(argv[i], "--hot-reload") == 0)
+		{
+			// reload edited shaders, textures and the --scene file
+			bHotReload = true;
+		}
+		else if ((std::strcmp(argv[i], "--package") == 0) && (i + 1 < argc))
+		{
+			// read assets from an asset package before loose files; may
+			// be repeated, later packages shadowing earlier ones
+			if (!VirtualFileSystem::MountPackage(argv[++i]))
+			{
+				return(EXIT_FAILURE);
+			}
+			bPackaged = true;
+		}
+		else if (std::strcmp(argv[i], "--gpu-pick") == 0)
+		{
+			// pick through an ID buffer read back from the GPU
+			bGpuPicking = true;
+		}
+		else if (std::strcmp(argv[i], "--no-occlusion") == 0)
+		{
+			// draw everything inside the frustum, hidden or not
+			bOcclusionCulling = false;
+		}
+		else if (std::strcmp(argv[i], "--no-visibility-cache") == 0)
+		{
+			// cull every frame, even while the camera is still
+			bVisibilityCache = false;
+		}
+		else if (std::strcmp(argv[i], "--no-impostors") == 0)
+		{
+			// draw distant object groups as their objects
+			bImpostors = false;
+		}
+	}
+
+	if (bHotReload && bPackaged)
+	{
+		std::cerr << "[Main] packaged assets shadow the loose files --hot-reload watches\n";
+	}
+
+	if (replayPath != nullptr)
+	{
+		g_InputPlayer = std::make_unique<InputPlayer>();
+		if (!g_InputPlayer->Open(replayPath))
+		{
+			return(EXIT_FAILURE);
+		}
+		if (replayTimestep <= 0.0)
+		{
+			replayTimestep = g_InputPlayer->GetMeanDeltaTime();
+		}
+		if (bHeadless)
+		{
+			return RunHeadlessReplay(*g_InputPlayer, replayTimestep, timingsPath, scenePath,
+				bAllocationTest, bOcclusionCulling, bVisibilityCache);
+		}
+		// replays must render every frame
+		bUseIdleRendering = false;
+	}
+	else if (benchmarkPath != nullptr)
+	{
+		g_CameraPath = std::make_unique<CameraPath>();
+		if (!g_CameraPath->Load(benchmarkPath) || (benchmarkFrames == 0))
+		{
+			return(EXIT_FAILURE);
+		}
+		// measure an uncapped, fixed workload: no vsync, no frame cap,
+		// no frame skipping and no resolution changes mid-run
+		pacingConfig.vsync = VsyncMode::Off;
+		pacingConfig.targetFps = 0.0;
+		bUseIdleRendering = false;
+		bUseDynamicResolution = false;
+	}
+
+	if (bHeadless && (g_InputPlayer == nullptr))
+	{
+		std::cerr << "[Main] --headless needs --replay <file>\n";
+		return(EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -66,11 +312,14 @@ int main(int argc, char* argv[])
 	}
 
 
+	// start the worker threads used by the engine subsystems
+	g_JobSystem = std::make_unique<JobSystem>();
+
 	// try to create a new shader manager object
-	g_ShaderManager = new ShaderManager();
+	g_ShaderManager = std::make_unique<ShaderManager>();
 	// try to create a new view manager object
-	g_ViewManager = new ViewManager(
-		g_ShaderManager);
+	g_ViewManager = std::make_unique<ViewManager>(
+		g_ShaderManager.get());
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
@@ -81,69 +330,690 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// the swap interval applies to the context made current above
+	g_FramePacer = std::make_unique<FramePacer>(pacingConfig);
+	g_FramePacer->ApplySwapInterval();
+
 	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
+	g_ShaderManager->LoadShaders(g_VertexShaderPath, g_FragmentShaderPath);
 	g_ShaderManager->use();
 
+	// the scene renders offscreen at a scale that follows the GPU
+	// frame time, then gets upscaled into the window
+	if (bUseDynamicResolution)
+	{
+		g_DynamicResolution = std::make_unique<DynamicResolution>(resolutionConfig);
+		if (!g_DynamicResolution->Initialize(
+			"shaders/upscaleVertexShader.glsl",
+			"shaders/upscaleFragmentShader.glsl"))
+		{
+			g_DynamicResolution.reset();
+		}
+		g_ShaderManager->use();
+	}
+
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager = std::make_unique<SceneManager>(
+		g_ShaderManager.get(), g_JobSystem.get());
 	g_SceneManager->PrepareScene();
+	g_SceneManager->SetOcclusionCulling(bOcclusionCulling);
+	g_SceneManager->SetVisibilityCache(bVisibilityCache);
+	if (scenePath != nullptr)
+	{
+		GeneratedScene scene;
+		if (!SceneGenerator::Load(scenePath, scene))
+		{
+			return(EXIT_FAILURE);
+		}
+		g_SceneManager->LoadGeneratedScene(scene);
+		std::cout << "INFO: loaded " << scene.objects.size() << " objects and "
+			<< scene.lights.size() << " lights from " << scenePath << "\n";
+	}
+	if (streamPath != nullptr)
+	{
+		g_SceneStreamer = std::make_unique<SceneStreamer>(g_SceneManager.get());
+		if (!g_SceneStreamer->Open(streamPath))
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+	if (bImpostors)
+	{
+		if (!g_SceneManager->EnableImpostors(
+			"shaders/impostorVertexShader.glsl",
+			"shaders/impostorFragmentShader.glsl"))
+		{
+			std::cerr << "[Main] impostors are unavailable; drawing every object\n";
+		}
+		g_ShaderManager->use();
+	}
+	if (bGpuPicking)
+	{
+		if (!g_SceneManager->EnableGpuPicking(
+			"shaders/pickVertexShader.glsl",
+			"shaders/pickFragmentShader.glsl"))
+		{
+			std::cerr << "[Main] GPU picking is unavailable; picking on the CPU\n";
+		}
+		g_ShaderManager->use();
+	}
+
+	// the scene is fully prepared, so the simulation thread may now
+	// read the scene objects while this thread submits GL commands
+	if (bUsePipeline)
+	{
+		g_FramePipeline = std::make_unique<FramePipeline>(
+			[](const FrameView& view, FramePacket& packet)
+			{
+				// streamed cells change the objects between builds only
+				if (g_SceneStreamer)
+				{
+					g_SceneStreamer->Update(view);
+				}
+				if (view.bPickRequested && !g_SceneManager->IsGpuPicking())
+				{
+					ReportPick(*g_SceneManager, view);
+				}
+				g_SceneManager->BuildFramePacket(view, packet);
+			},
+			g_JobSystem.get());
+	}
+
+	if (bHotReload)
+	{
+		g_HotReloader = std::make_unique<HotReloader>(
+			g_SceneManager.get(), g_ShaderManager.get(), g_FramePipeline.get());
+		g_HotReloader->WatchShaders(g_VertexShaderPath, g_FragmentShaderPath);
+		for (size_t i = 0; i < SceneManager::GetSceneTextureCount(); ++i)
+		{
+			g_HotReloader->WatchTexture(SceneManager::GetSceneTextureFile(i));
+		}
+		if (scenePath != nullptr)
+		{
+			g_HotReloader->WatchScene(scenePath);
+		}
+		g_HotReloader->Start();
+	}
+
+	// in idle mode the window only redraws when the camera or the
+	// scene changes, or when the system asks for the contents again
+	if (bUseIdleRendering)
+	{
+		g_IdleRenderer = std::make_unique<IdleRenderer>();
+		glfwSetWindowRefreshCallback(g_Window, [](GLFWwindow*)
+		{
+			if (g_IdleRenderer)
+			{
+				g_IdleRenderer->RequestPresent();
+			}
+		});
+	}
+
+	FrameTimingLog frameTimings;
+	std::vector<InputEvent> replayEvents;
+	replayEvents.reserve(g_ReservedFrameEvents);
+	FrameAllocationCheck allocationCheck(g_AllocationWarmupFrames);
+	uint32_t timedFrame = 0;
+	uint32_t warmupFramesLeft = 0;
+	float benchmarkSpeed = 0.0f;
+	float maxCameraDrift = 0.0f;
+	if (g_InputPlayer)
+	{
+		// the replay clock starts at zero like the recording did
+		g_ViewManager->SetLiveInput(false);
+		g_ViewManager->SetCameraState(g_InputPlayer->GetInitialCamera());
+		g_ViewManager->ResetFrameTimer(0.0);
+		frameTimings.Reserve(g_InputPlayer->GetFrameCount());
+		if (timingsPath != nullptr)
+		{
+			frameTimings.OpenCsv(timingsPath);
+		}
+	}
+	else if (g_CameraPath)
+	{
+		g_ViewManager->SetLiveInput(false);
+		g_ViewManager->ResetFrameTimer(0.0);
+		benchmarkSpeed = g_ViewManager->GetCameraState().movementSpeed;
+		warmupFramesLeft = g_BenchmarkWarmupFrames;
+		frameTimings.Reserve(benchmarkFrames);
+		if (timingsPath != nullptr)
+		{
+			frameTimings.OpenCsv(timingsPath);
+		}
+	}
+	else if (recordPath != nullptr)
+	{
+		g_InputRecorder = std::make_unique<InputRecorder>();
+		g_ViewManager->ResetFrameTimer(0.0);
+		glfwSetTime(0.0);
+		if (!g_InputRecorder->Open(recordPath, g_ViewManager->GetCameraState()))
+		{
+			g_InputRecorder.reset();
+		}
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		std::chrono::steady_clock::time_point cpuStart = std::chrono::steady_clock::now();
+
+		// reloads are swapped in between frames, before the next
+		// packet is submitted to the simulation thread
+		if (g_HotReloader)
+		{
+			g_HotReloader->Update();
+		}
+		if (bAllocationTest)
+		{
+			allocationCheck.BeginFrame();
+		}
+
+		// apply input and capture the camera for this frame
+		FrameView frameView;
+		if (g_InputPlayer)
+		{
+			if (timedFrame >= g_InputPlayer->GetFrameCount())
+			{
+				break;
+			}
+
+			// feed the recorded events of this frame on the fixed timestep
+			const double frameStart = timedFrame * replayTimestep;
+			replayEvents.clear();
+			g_InputPlayer->ScheduleEvents(timedFrame, frameStart, replayTimestep, replayEvents);
+			for (const InputEvent& event : replayEvents)
+			{
+				g_ViewManager->QueueInputEvent(event);
+			}
+			frameView = g_ViewManager->UpdateCamera(frameStart + replayTimestep);
+
+			const CameraState& recorded = g_InputPlayer->GetFrame(timedFrame).camera;
+			maxCameraDrift = glm::max(maxCameraDrift, glm::length(
+				g_ViewManager->GetCameraState().position - recorded.position));
+		}
+		else if (g_CameraPath)
+		{
+			if (timedFrame >= benchmarkFrames)
+			{
+				break;
+			}
+
+			// spread the timed frames evenly over the path; the warm-up
+			// frames hold its start
+			float pathTime = 0.0f;
+			if ((warmupFramesLeft == 0) && (benchmarkFrames > 1))
+			{
+				pathTime = g_CameraPath->GetDuration() *
+					static_cast<float>(timedFrame) / static_cast<float>(benchmarkFrames - 1);
+			}
+			g_ViewManager->SetCameraState(g_CameraPath->Sample(pathTime, benchmarkSpeed));
+			frameView = g_ViewManager->UpdateCamera(static_cast<double>(pathTime));
+		}
+		else
+		{
+			frameView = g_ViewManager->UpdateCamera();
+		}
+
+		if (g_InputRecorder)
+		{
+			g_InputRecorder->WriteFrame(g_ViewManager->GetFrameStart(),
+				g_ViewManager->GetFrameEnd(), g_ViewManager->GetFrameEvents(),
+				g_ViewManager->GetCameraState());
+		}
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		int width = 0;
+		int height = 0;
+		glfwGetFramebufferSize(g_Window, &width, &height);
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		FrameAction action = FrameAction::Render;
+		const FramePacket* renderedPacket = nullptr;
+		if (g_IdleRenderer)
+		{
+			// held keys keep moving the camera without new events, a
+			// pick is answered by the next frame build, or by a later
+			// frame that polls the GPU readback; streamed mips and
+			// cells are only added by the frames drawn after they load
+			if (g_ViewManager->IsInputActive() || frameView.bPickRequested ||
+				g_SceneManager->IsGpuPickPending() || g_SceneManager->IsTextureStreamingPending() ||
+				(g_SceneStreamer && g_SceneStreamer->IsLoading()))
+			{
+				g_IdleRenderer->MarkDirty();
+			}
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+			action = g_IdleRenderer->BeginFrame(
+				frameView, g_SceneManager->GetSceneVersion(), width, height);
 
+			// the last image only survives in the offscreen target;
+			// the back buffer is undefined after a swap
+			if ((action == FrameAction::Present) && !g_DynamicResolution)
+			{
+				action = FrameAction::Render;
+			}
+
+			IdleStats idleStats;
+			if (g_IdleRenderer->ConsumeReport(idleStats) && g_Db && g_Db->isOpen())
+			{
+				g_Db->logIdleStats(idleStats.intervalSeconds, idleStats.idleSeconds,
+					static_cast<int>(idleStats.renderedFrames),
+					static_cast<int>(idleStats.presentedFrames),
+					static_cast<int>(idleStats.wakeups));
+			}
+
+			if (action == FrameAction::Wait)
+			{
+				// nothing changed - sleep until input or a timeout
+				g_IdleRenderer->WaitForEvents();
+				g_ViewManager->ResetFrameTimer();
+				g_FramePacer->ResetFrameClock();
+				// a waiting frame is still checked for allocations,
+				// and counts towards the warmup
+				if (bAllocationTest)
+				{
+					allocationCheck.EndFrame();
+				}
+				continue;
+			}
+		}
+
+		if (action == FrameAction::Render)
+		{
+			// redirect the scene into the scaled offscreen target
+			if (g_DynamicResolution)
+			{
+				g_DynamicResolution->BeginScene(width, height);
+			}
+
+			// Enable z-depth
+			glEnable(GL_DEPTH_TEST);
+
+			// Clear the frame and z buffers
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			if (g_FramePipeline)
+			{
+				// start culling this frame on the simulation thread and
+				// submit the packet that was built during the last frame
+				g_FramePipeline->Submit(frameView);
+				const FramePacket* packet = g_FramePipeline->Acquire();
+				renderedPacket = packet;
+				if (packet != nullptr)
+				{
+					// convert from 3D object space to 2D view
+					g_ViewManager->ApplyFrameView(packet->view);
+
+					// refresh the 3D scene
+					g_SceneManager->ExecuteFramePacket(*packet);
+				}
+			}
+			else
+			{
+				// convert from 3D object space to 2D view
+				g_ViewManager->ApplyFrameView(frameView);
+
+				// refresh the 3D scene
+				if (g_SceneStreamer)
+				{
+					g_SceneStreamer->Update(frameView);
+				}
+				if (frameView.bPickRequested && !g_SceneManager->IsGpuPicking())
+				{
+					ReportPick(*g_SceneManager, frameView);
+				}
+				g_SceneManager->RenderScene(frameView);
+				renderedPacket = &g_SceneManager->GetLocalPacket();
+			}
+
+			if (g_DynamicResolution)
+			{
+				g_DynamicResolution->EndScene();
+			}
+		}
+
+		// the ID readback arrives a frame or two after its pass
+		if (g_SceneManager->IsGpuPickPending())
+		{
+			ReportGpuPick(*g_SceneManager);
+		}
+
+		// upscale the scene into the window
+		if (g_DynamicResolution)
+		{
+			g_DynamicResolution->Present();
+			g_ShaderManager->use();
+		}
+
+		const double cpuMs = ElapsedMs(cpuStart);
+
+		// hold the frame until the target frame period has elapsed
+		g_FramePacer->WaitForNextFrame();
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
+		g_FramePacer->EndFrame();
+		if (g_IdleRenderer)
+		{
+			g_IdleRenderer->EndFrame(action);
+		}
+
+		if (warmupFramesLeft > 0)
+		{
+			warmupFramesLeft--;
+		}
+		else if (g_InputPlayer || g_CameraPath)
+		{
+			FrameTiming timing;
+			timing.frame = timedFrame;
+			timing.simTime = g_ViewManager->GetFrameEnd();
+			timing.cpuMs = cpuMs;
+			timing.frameMs = g_FramePacer->GetLastFrameMs();
+			if (renderedPacket != nullptr)
+			{
+				timing.drawCalls = static_cast<uint32_t>(renderedPacket->commands.size());
+				timing.culledObjects = renderedPacket->culledObjects;
+				timing.occludedObjects = renderedPacket->occludedObjects;
+				timing.bVisibilityReused = renderedPacket->bVisibilityReused;
+			}
+			frameTimings.Add(timing);
+			timedFrame++;
+		}
+
+		// report the frame-time distribution once per interval
+		FrameTimeStats frameStats;
+		if (g_FramePacer->ConsumeReport(frameStats) && g_Db && g_Db->isOpen())
+		{
+			g_Db->logTelemetry(frameStats.fps, frameStats.meanMs);
+			g_Db->logFramePacing(frameStats.meanMs, frameStats.stddevMs,
+				frameStats.p99Ms, frameStats.maxMs,
+				g_FramePacer->GetSwapInterval(), pacingConfig.targetFps);
+		}
 
 		// query the latest GLFW events
 		glfwPollEvents();
+
+		if (bAllocationTest)
+		{
+			allocationCheck.EndFrame();
+		}
 	}
-	static double telemetryAccum = 0.0;
-	telemetryAccum += deltaTime;
 
-	if (g_Db && g_Db->isOpen() && telemetryAccum >= 1.0) {
-    double fps = (deltaTime > 0.0) ? (1.0 / deltaTime) : 0.0;
-    g_Db->logTelemetry(fps, deltaTime * 1000.0);
-    telemetryAccum = 0.0;
+	int exitCode = EXIT_SUCCESS;
+	if (bAllocationTest)
+	{
+		allocationCheck.PrintReport(stdout);
+		if (!allocationCheck.Passed())
+		{
+			exitCode = EXIT_FAILURE;
+		}
+	}
+	if (g_InputPlayer || g_CameraPath)
+	{
+		PrintArenaStats("build", g_SceneManager->GetBuildArenaStats());
+		PrintArenaStats("submit", g_SceneManager->GetSubmitArenaStats());
+	}
+	if (g_InputPlayer)
+	{
+		PrintReplaySummary(frameTimings, maxCameraDrift);
+	}
+	else if (g_CameraPath)
+	{
+		// a run cut short by closing the window is not a result
+		if ((timedFrame < benchmarkFrames) ||
+			!ReportBenchmark(frameTimings, benchmarkPath, benchmarkJsonPath))
+		{
+			std::cerr << "[Main] benchmark did not complete\n";
+			exitCode = EXIT_FAILURE;
+		}
 	}
 
 	// clear the allocated manager objects from memory
-	if (NULL != g_SceneManager)
+	g_InputRecorder.reset();
+	g_InputPlayer.reset();
+	g_CameraPath.reset();
+	g_HotReloader.reset();
+	g_IdleRenderer.reset();
+	g_FramePipeline.reset();
+	if (g_SceneStreamer)
 	{
-		delete g_SceneManager;
-		g_SceneManager = NULL;
+		const StreamingStats streaming = g_SceneStreamer->GetStats();
+		std::cout << "INFO: streamed " << streaming.cellsLoaded << " cells in, "
+			<< streaming.cellsUnloaded << " out, " << (streaming.bytesRead >> 10) << " KiB read\n";
+		g_SceneStreamer.reset();
 	}
-	if (NULL != g_ViewManager)
+	if (g_SceneManager)
 	{
-		delete g_ViewManager;
-		g_ViewManager = NULL;
+		const TextureStreamingStats textures = g_SceneManager->GetTextureStreamingStats();
+		std::cout << "INFO: texture mips hold " << (textures.residentTexels >> 10) << "K of "
+			<< (textures.fullTexels >> 10) << "K texels, " << textures.levelsUploaded
+			<< " levels streamed in, " << textures.levelsDropped << " out\n";
 	}
-	if (NULL != g_ShaderManager)
+	g_DynamicResolution.reset();
+	g_SceneManager.reset();
+	g_ViewManager.reset();
+	g_ShaderManager.reset();
+	g_JobSystem.reset();
+	g_FramePacer.reset();
+	if (g_Db) g_Db.reset();
+	VirtualFileSystem::UnmountAll();
+
+	// Terminates the program
+	exit(exitCode); 
+}
+
+/***********************************************************
+ *	RunHeadlessReplay()
+ *
+ *  This function replays a recording without a window or
+ *  GL context. Each frame runs the camera update and the
+ *  culling and command recording of the scene, and the
+ *  time of those CPU stages is reported per frame.
+ ***********************************************************/
+int RunHeadlessReplay(const InputPlayer& player, double timestep,
+	const char* timingsPath, const char* scenePath, bool bAllocationTest,
+	bool bOcclusionCulling, bool bVisibilityCache)
+{
+	JobSystem jobs;
+	ViewManager view(nullptr);
+	view.SetCameraState(player.GetInitialCamera());
+	view.ResetFrameTimer(0.0);
+
+	// only the object list is needed - no meshes, textures or shaders
+	SceneManager scene(nullptr, &jobs);
+	scene.SetOcclusionCulling(bOcclusionCulling);
+	scene.SetVisibilityCache(bVisibilityCache);
+	if (scenePath != nullptr)
 	{
-		delete g_ShaderManager;
-		g_ShaderManager = NULL;
+		GeneratedScene generated;
+		if (!SceneGenerator::Load(scenePath, generated))
+		{
+			return(EXIT_FAILURE);
+		}
+		scene.LoadGeneratedScene(generated);
+	}
+	else
+	{
+		scene.DefineSceneObjects();
+	}
+
+	FrameTimingLog timings;
+	timings.Reserve(player.GetFrameCount());
+	if ((timingsPath != nullptr) && !timings.OpenCsv(timingsPath))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	FramePacket packet;
+	std::vector<InputEvent> events;
+	events.reserve(g_ReservedFrameEvents);
+	FrameAllocationCheck allocationCheck(g_AllocationWarmupFrames);
+	float maxCameraDrift = 0.0f;
+	for (uint32_t frame = 0; frame < player.GetFrameCount(); ++frame)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (bAllocationTest)
+		{
+			allocationCheck.BeginFrame();
+		}
+
+		const double frameStart = frame * timestep;
+		events.clear();
+		player.ScheduleEvents(frame, frameStart, timestep, events);
+		for (const InputEvent& event : events)
+		{
+			view.QueueInputEvent(event);
+		}
+		FrameView frameView = view.UpdateCamera(frameStart + timestep);
+		scene.BuildFramePacket(frameView, packet);
+
+		FrameTiming timing;
+		timing.frame = frame;
+		timing.simTime = frameStart + timestep;
+		timing.cpuMs = ElapsedMs(start);
+		timing.frameMs = timing.cpuMs;
+		timing.drawCalls = static_cast<uint32_t>(packet.commands.size());
+		timing.culledObjects = packet.culledObjects;
+		timing.occludedObjects = packet.occludedObjects;
+		timing.bVisibilityReused = packet.bVisibilityReused;
+		timings.Add(timing);
+
+		maxCameraDrift = glm::max(maxCameraDrift, glm::length(
+			view.GetCameraState().position - player.GetFrame(frame).camera.position));
+		if (bAllocationTest)
+		{
+			allocationCheck.EndFrame();
+		}
+	}
+
+	PrintArenaStats("build", scene.GetBuildArenaStats());
+	PrintReplaySummary(timings, maxCameraDrift);
+	if (bAllocationTest)
+	{
+		allocationCheck.PrintReport(stdout);
+		if (!allocationCheck.Passed())
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	PrintReplaySummary()
+ *
+ *  This function prints the timing summary of a replay and
+ *  how far the replayed camera strayed from the recording.
+ ***********************************************************/
+void PrintReplaySummary(const FrameTimingLog& timings, float maxCameraDrift)
+{
+	FrameTimingSummary summary = timings.Summarize();
+	std::cout << "INFO: replayed " << summary.frames << " frames\n"
+		<< "INFO: cpu ms mean " << summary.meanCpuMs << " p99 " << summary.p99CpuMs << "\n"
+		<< "INFO: frame ms mean " << summary.meanFrameMs << " p99 " << summary.p99FrameMs
+		<< " max " << summary.maxFrameMs << "\n"
+		<< "INFO: draw calls " << summary.meanDrawCalls
+		<< " culled objects " << summary.meanCulledObjects
+		<< " occluded objects " << summary.meanOccludedObjects << "\n"
+		<< "INFO: visibility reused on " << summary.reusedFrames << " frames, cpu ms mean "
+		<< summary.meanReusedCpuMs << " reused " << summary.meanCulledCpuMs << " culled\n"
+		<< "INFO: max camera drift from recording " << maxCameraDrift << std::endl;
+}
+
+/***********************************************************
+ *	ReportPick()
+ *
+ *  This function picks the object under the view's pick
+ *  point and prints it with the time the pick took. It runs
+ *  where the frame is built, as that is where the objects
+ *  may change.
+ ***********************************************************/
+void ReportPick(SceneManager& scene, const FrameView& view)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	SceneManager::PICK_RESULT result;
+	const bool bHit = scene.PickObject(view, view.pickPoint, result);
+	const double pickUs = ElapsedMs(start) * 1000.0;
+	if (bHit)
+	{
+		std::cout << "INFO: picked object " << result.object.slot << "." << result.object.generation
+			<< " at distance " << result.distance << " in " << pickUs << " us\n";
+	}
+	else
+	{
+		std::cout << "INFO: pick hit no object (" << pickUs << " us)\n";
+	}
+}
+
+/***********************************************************
+ *	ReportGpuPick()
+ *
+ *  This function prints the result of the ID buffer pick in
+ *  flight, if the GPU has finished it.
+ ***********************************************************/
+void ReportGpuPick(SceneManager& scene)
+{
+	SceneManager::PICK_RESULT result;
+	if (!scene.TakeGpuPick(result))
+	{
+		return;
+	}
+	if (!result.object.IsNull())
+	{
+		std::cout << "INFO: GPU picked object " << result.object.slot << "." << result.object.generation
+			<< " at distance " << result.distance << "\n";
+	}
+	else
+	{
+		std::cout << "INFO: GPU pick hit no object\n";
+	}
+}
+
+/***********************************************************
+ *	PrintArenaStats()
+ *
+ *  This function prints how much frame arena memory a stage
+ *  used. Overflows in the last frame mean the steady state
+ *  still reached the heap.
+ ***********************************************************/
+void PrintArenaStats(const char* stage, const FrameArenaStats& stats)
+{
+	std::cout << "INFO: " << stage << " arena frames " << stats.frames
+		<< " last " << stats.lastFrameBytes << " B peak " << stats.peakFrameBytes
+		<< " B capacity " << stats.capacity << " B allocations " << stats.allocations
+		<< " heap overflows " << stats.totalOverflows
+		<< " (last frame " << stats.lastFrameOverflows << ")" << std::endl;
+}
+
+/***********************************************************
+ *	ReportBenchmark()
+ *
+ *  This function prints the flythrough results and stores
+ *  them as JSON and in the telemetry tables.
+ ***********************************************************/
+bool ReportBenchmark(const FrameTimingLog& timings, const char* name, const char* jsonPath)
+{
+	FrameTimingSummary summary = timings.Summarize();
+	std::cout << "BENCHMARK: " << name << "\n"
+		<< "BENCHMARK: frames " << summary.frames << "\n"
+		<< "BENCHMARK: frame ms avg " << summary.meanFrameMs << " p99 " << summary.p99FrameMs
+		<< " max " << summary.maxFrameMs << "\n"
+		<< "BENCHMARK: cpu ms avg " << summary.meanCpuMs << " p99 " << summary.p99CpuMs << "\n"
+		<< "BENCHMARK: draw calls " << summary.meanDrawCalls
+		<< " culled objects " << summary.meanCulledObjects
+		<< " occluded objects " << summary.meanOccludedObjects << "\n"
+		<< "BENCHMARK: visibility reused on " << summary.reusedFrames << " frames, cpu ms avg "
+		<< summary.meanReusedCpuMs << " reused " << summary.meanCulledCpuMs << " culled" << std::endl;
+
+	if (g_Db && g_Db->isOpen())
+	{
+		const double fps = (summary.meanFrameMs > 0.0) ? 1000.0 / summary.meanFrameMs : 0.0;
+		g_Db->logTelemetry(fps, summary.meanFrameMs);
+		g_Db->logBenchmark(name, static_cast<int>(summary.frames), summary.meanFrameMs,
+			summary.p99FrameMs, summary.maxFrameMs, summary.meanDrawCalls,
+			summary.meanCulledObjects);
 	}
-	if (g_Db) g_Db.reset();
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	return timings.WriteJson(jsonPath, name);
 }
 
 /***********************************************************
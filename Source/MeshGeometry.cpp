@@ -0,0 +1,212 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.cpp
+// ============
+// CPU-side vertex and index data for the basic shapes - the same unit meshes
+// ShapeMeshes uploads, generated without GL for headless tools and queries
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float g_Pi = 3.14159265358979f;
+	const float g_TorusMainRadius = 1.0f;
+	const float g_TorusTubeRadius = 0.2f;
+	const float g_TaperedTopRadius = 0.5f;
+
+	uint32_t AddVertex(MeshGeometry& geometry, glm::vec3 position, glm::vec3 normal, glm::vec2 uv)
+	{
+		geometry.vertices.push_back({ position, normal, uv });
+		return static_cast<uint32_t>(geometry.vertices.size() - 1);
+	}
+
+	void AddTriangle(MeshGeometry& geometry, uint32_t a, uint32_t b, uint32_t c)
+	{
+		geometry.indices.push_back(a);
+		geometry.indices.push_back(b);
+		geometry.indices.push_back(c);
+	}
+
+	// two triangles over a quad given counter-clockwise
+	void AddQuad(MeshGeometry& geometry, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+	{
+		AddTriangle(geometry, a, b, c);
+		AddTriangle(geometry, a, c, d);
+	}
+
+	// rows x columns grid of vertices wrapped into quads, such as
+	// the sphere's stacks and slices or the torus' rings and sides
+	void AddGridIndices(MeshGeometry& geometry, uint32_t first, uint32_t rows, uint32_t columns)
+	{
+		for (uint32_t row = 0; row + 1 < rows; ++row)
+		{
+			for (uint32_t column = 0; column + 1 < columns; ++column)
+			{
+				const uint32_t a = first + row * columns + column;
+				const uint32_t b = a + columns;
+				AddQuad(geometry, a, b, b + 1, a + 1);
+			}
+		}
+	}
+
+	void GeneratePlane(MeshGeometry& geometry)
+	{
+		const glm::vec3 up(0.0f, 1.0f, 0.0f);
+		const uint32_t a = AddVertex(geometry, glm::vec3(-1.0f, 0.0f, 1.0f), up, glm::vec2(0.0f, 0.0f));
+		const uint32_t b = AddVertex(geometry, glm::vec3(1.0f, 0.0f, 1.0f), up, glm::vec2(1.0f, 0.0f));
+		const uint32_t c = AddVertex(geometry, glm::vec3(1.0f, 0.0f, -1.0f), up, glm::vec2(1.0f, 1.0f));
+		const uint32_t d = AddVertex(geometry, glm::vec3(-1.0f, 0.0f, -1.0f), up, glm::vec2(0.0f, 1.0f));
+		AddQuad(geometry, a, b, c, d);
+	}
+
+	void GenerateBox(MeshGeometry& geometry)
+	{
+		// each face as its normal and the two in-plane axes
+		const glm::vec3 faces[6][3] =
+		{
+			{ glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0) },
+			{ glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0) },
+			{ glm::vec3(1, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0) },
+			{ glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0) },
+			{ glm::vec3(0, 1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1) },
+			{ glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1) }
+		};
+
+		for (const auto& face : faces)
+		{
+			const glm::vec3 center = 0.5f * face[0];
+			const glm::vec3 u = 0.5f * face[1];
+			const glm::vec3 v = 0.5f * face[2];
+			const uint32_t a = AddVertex(geometry, center - u - v, face[0], glm::vec2(0.0f, 0.0f));
+			const uint32_t b = AddVertex(geometry, center + u - v, face[0], glm::vec2(1.0f, 0.0f));
+			const uint32_t c = AddVertex(geometry, center + u + v, face[0], glm::vec2(1.0f, 1.0f));
+			const uint32_t d = AddVertex(geometry, center - u + v, face[0], glm::vec2(0.0f, 1.0f));
+			AddQuad(geometry, a, b, c, d);
+		}
+	}
+
+	void GenerateSphere(MeshGeometry& geometry, uint32_t segments)
+	{
+		const uint32_t stacks = std::max(2u, segments / 2);
+		const uint32_t first = static_cast<uint32_t>(geometry.vertices.size());
+
+		// the seam column is duplicated so the texture wraps cleanly
+		for (uint32_t stack = 0; stack <= stacks; ++stack)
+		{
+			const float v = static_cast<float>(stack) / stacks;
+			const float phi = g_Pi * v;
+			for (uint32_t slice = 0; slice <= segments; ++slice)
+			{
+				const float u = static_cast<float>(slice) / segments;
+				const float theta = 2.0f * g_Pi * u;
+				const glm::vec3 normal(std::sin(phi) * std::cos(theta), -std::cos(phi),
+					std::sin(phi) * std::sin(theta));
+				AddVertex(geometry, normal, normal, glm::vec2(u, v));
+			}
+		}
+		AddGridIndices(geometry, first, stacks + 1, segments + 1);
+	}
+
+	// a flat disc facing up or down, fanned around its center
+	void AddCap(MeshGeometry& geometry, uint32_t segments, float y, float radius, bool bFacingUp)
+	{
+		const glm::vec3 normal(0.0f, bFacingUp ? 1.0f : -1.0f, 0.0f);
+		const uint32_t center = AddVertex(geometry, glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f));
+		for (uint32_t slice = 0; slice <= segments; ++slice)
+		{
+			const float theta = 2.0f * g_Pi * slice / segments;
+			const float x = std::cos(theta);
+			const float z = std::sin(theta);
+			AddVertex(geometry, glm::vec3(radius * x, y, radius * z), normal,
+				glm::vec2(0.5f + 0.5f * x, 0.5f - 0.5f * z));
+		}
+		for (uint32_t slice = 0; slice < segments; ++slice)
+		{
+			const uint32_t a = center + 1 + slice;
+			if (bFacingUp)
+				AddTriangle(geometry, center, a + 1, a);
+			else
+				AddTriangle(geometry, center, a, a + 1);
+		}
+	}
+
+	// cylinder, tapered cylinder and cone differ only in the top radius
+	void GenerateFrustum(MeshGeometry& geometry, uint32_t segments, float topRadius)
+	{
+		const float bottomRadius = 1.0f;
+		const uint32_t first = static_cast<uint32_t>(geometry.vertices.size());
+
+		for (uint32_t row = 0; row <= 1; ++row)
+		{
+			const float radius = (row == 0) ? bottomRadius : topRadius;
+			for (uint32_t slice = 0; slice <= segments; ++slice)
+			{
+				const float u = static_cast<float>(slice) / segments;
+				const float theta = 2.0f * g_Pi * u;
+				const float x = std::cos(theta);
+				const float z = std::sin(theta);
+				const glm::vec3 normal = glm::normalize(glm::vec3(x, bottomRadius - topRadius, z));
+				AddVertex(geometry, glm::vec3(radius * x, static_cast<float>(row), radius * z),
+					normal, glm::vec2(u, static_cast<float>(row)));
+			}
+		}
+		AddGridIndices(geometry, first, 2, segments + 1);
+
+		AddCap(geometry, segments, 0.0f, bottomRadius, false);
+		if (topRadius > 0.0f)
+		{
+			AddCap(geometry, segments, 1.0f, topRadius, true);
+		}
+	}
+
+	void GenerateTorus(MeshGeometry& geometry, uint32_t segments)
+	{
+		const uint32_t sides = std::max(3u, segments / 2);
+		const uint32_t first = static_cast<uint32_t>(geometry.vertices.size());
+
+		for (uint32_t ring = 0; ring <= segments; ++ring)
+		{
+			const float u = static_cast<float>(ring) / segments;
+			const float theta = 2.0f * g_Pi * u;
+			const glm::vec3 outward(std::cos(theta), std::sin(theta), 0.0f);
+			for (uint32_t side = 0; side <= sides; ++side)
+			{
+				const float v = static_cast<float>(side) / sides;
+				const float phi = 2.0f * g_Pi * v;
+				const glm::vec3 normal = std::cos(phi) * outward + glm::vec3(0.0f, 0.0f, std::sin(phi));
+				AddVertex(geometry, g_TorusMainRadius * outward + g_TorusTubeRadius * normal,
+					normal, glm::vec2(u, v));
+			}
+		}
+		AddGridIndices(geometry, first, segments + 1, sides + 1);
+	}
+}
+
+/***********************************************************
+ *  GenerateMeshGeometry()
+ *
+ *  Replaces the contents of the geometry with the unit mesh
+ *  of the shape.
+ ***********************************************************/
+void GenerateMeshGeometry(MeshType mesh, uint32_t segments, MeshGeometry& geometry)
+{
+	geometry.vertices.clear();
+	geometry.indices.clear();
+	segments = std::max(3u, segments);
+
+	switch (mesh)
+	{
+	case MeshType::Plane:           GeneratePlane(geometry); break;
+	case MeshType::Box:             GenerateBox(geometry); break;
+	case MeshType::Sphere:          GenerateSphere(geometry, segments); break;
+	case MeshType::Cylinder:        GenerateFrustum(geometry, segments, 1.0f); break;
+	case MeshType::TaperedCylinder: GenerateFrustum(geometry, segments, g_TaperedTopRadius); break;
+	case MeshType::Cone:            GenerateFrustum(geometry, segments, 0.0f); break;
+	case MeshType::Torus:           GenerateTorus(geometry, segments); break;
+	default:                        break;
+	}
+}
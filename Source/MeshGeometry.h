@@ -0,0 +1,40 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.h
+// ============
+// CPU-side vertex and index data for the basic shapes - the same unit meshes
+// ShapeMeshes uploads, generated without GL for headless tools and queries
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+struct MeshVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+};
+
+// indexed triangle list, counter-clockwise when seen from outside
+struct MeshGeometry
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+/***********************************************************
+ *  GenerateMeshGeometry()
+ *
+ *  Builds the unit mesh of a shape in its model space: the
+ *  plane spans -1..1 on x and z, the box -0.5..0.5, the
+ *  sphere has radius 1, the cylinder, tapered cylinder and
+ *  cone stand on the origin with radius 1 and height 1, and
+ *  the torus lies in the xy plane. Every shape fits inside
+ *  MeshBoundingRadius(). Segments is the number of slices
+ *  around curved shapes, at least 3.
+ ***********************************************************/
+void GenerateMeshGeometry(MeshType mesh, uint32_t segments, MeshGeometry& geometry);
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// mipresidency.cpp
+// ============
+// the GL-free bookkeeping of a streamed texture - which mips are resident,
+// which are wanted, and whether a decode of the finer ones still applies
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MipResidency.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  NeedsDecode()
+ *
+ *  This method is used for telling whether the file should
+ *  be read again for finer mips.
+ ***********************************************************/
+bool MipResidency::NeedsDecode() const
+{
+	return (wantedLevel < baseLevel) && !bDecoding && !bFailed;
+}
+
+/***********************************************************
+ *  Drop()
+ *
+ *  This method is used for moving the base level to a
+ *  coarser mip. The decode in flight covers the levels
+ *  above the old base only, so once the camera comes back
+ *  its levels would no longer reach the new base; it is
+ *  dropped by its generation and requested again.
+ ***********************************************************/
+void MipResidency::Drop(uint32_t level)
+{
+	baseLevel = level;
+	framesAboveBase = 0;
+	generation++;
+	bDecoding = false;
+}
+
+/***********************************************************
+ *  Restart()
+ *
+ *  This method is used for going back to the resident mips
+ *  once the texture's pixels were replaced.
+ ***********************************************************/
+void MipResidency::Restart()
+{
+	baseLevel = residentLevel;
+	wantedLevel = residentLevel;
+	framesAboveBase = 0;
+	generation++;
+	bDecoding = false;
+	bFailed = false;
+}
+
+/***********************************************************
+ *  NextUpload()
+ *
+ *  This method is used for choosing the level a decode
+ *  uploads next: the one just above the base level, as long
+ *  as it is still wanted and the decode holds it. The check
+ *  against the decoded levels holds even for a decode of the
+ *  current generation, so a stale one can never be read past
+ *  its end.
+ ***********************************************************/
+bool MipResidency::NextUpload(uint32_t decodeGeneration, uint32_t firstLevel, size_t chainLevels,
+	uint32_t& level) const
+{
+	const uint32_t finest = std::max(firstLevel, wantedLevel);
+	if ((decodeGeneration != generation) || (baseLevel <= finest) ||
+		(baseLevel - 1 >= firstLevel + chainLevels))
+	{
+		return false;
+	}
+	level = baseLevel - 1;
+	return true;
+}
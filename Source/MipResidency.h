@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// mipresidency.h
+// ============
+// the GL-free bookkeeping of a streamed texture - which mips are resident,
+// which are wanted, and whether a decode of the finer ones still applies
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************
+ *  MipResidency
+ *
+ *  The mips from baseLevel down to 1x1 are resident. A
+ *  decode of the finer mips [wantedLevel, baseLevel) is
+ *  tagged with the generation it was requested under, and
+ *  anything that moves the base level the other way, or
+ *  replaces the pixels, bumps the generation so that the
+ *  decode is dropped when it lands.
+ ***********************************************************/
+struct MipResidency
+{
+	uint32_t levelCount = 0;
+	// coarsest level that is streamed; it and below always stay
+	uint32_t residentLevel = 0;
+	// finest level currently specified
+	uint32_t baseLevel = 0;
+	uint32_t wantedLevel = 0;
+	uint32_t framesAboveBase = 0;
+	// bumped whenever a decode in flight no longer fits the mips
+	uint32_t generation = 0;
+	bool bDecoding = false;
+	// the file could not be decoded again; only the resident mips stay
+	bool bFailed = false;
+
+	// a finer mip is wanted and no decode is in flight for it
+	bool NeedsDecode() const;
+	// move the base level to a coarser mip; a decode in flight
+	// was made for the old base, so it is dropped
+	void Drop(uint32_t level);
+	// start again from the resident mips, after new pixels
+	void Restart();
+	// the next level to upload from a decode of levels
+	// [firstLevel, firstLevel + chainLevels) made under generation;
+	// false once nothing of it is usable any more
+	bool NextUpload(uint32_t decodeGeneration, uint32_t firstLevel, size_t chainLevels,
+		uint32_t& level) const;
+};
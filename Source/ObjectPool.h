@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////////////////
+// objectpool.h
+// ============
+// typed object pool with generational handles - O(1) create and destroy,
+// densely packed values for iteration and detection of stale handles
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  PoolHandle
+ *
+ *  Names one value of an ObjectPool. The generation changes
+ *  every time the slot is reused, so a handle kept past the
+ *  destruction of its value no longer resolves, even after
+ *  a new value has taken the slot. The default handle never
+ *  resolves.
+ ***********************************************************/
+struct PoolHandle
+{
+	uint32_t slot = 0;
+	uint32_t generation = 0;
+
+	bool IsNull() const { return generation == 0; }
+	bool operator==(const PoolHandle& other) const
+	{
+		return (slot == other.slot) && (generation == other.generation);
+	}
+	bool operator!=(const PoolHandle& other) const { return !(*this == other); }
+};
+
+/***********************************************************
+ *  ObjectPool
+ *
+ *  The values live back to back in one array, so iterating
+ *  over them touches no gaps; destroying a value moves the
+ *  last one into its place. Handles go through a slot table
+ *  that follows those moves. Storage is kept when values are
+ *  destroyed, so after Reserve() or a first fill the pool
+ *  reuses its memory instead of returning it to the heap.
+ ***********************************************************/
+template <typename T>
+class ObjectPool
+{
+public:
+	void Reserve(size_t count);
+
+	PoolHandle Create(const T& value);
+	// appends count default values and returns the position of the
+	// first, for loaders that fill them in place (possibly in parallel)
+	size_t CreateRange(size_t count);
+	// returns false if the handle is stale or null
+	bool Destroy(PoolHandle handle);
+	void Clear();
+
+	// null if the handle is stale or null
+	T* Get(PoolHandle handle);
+	const T* Get(PoolHandle handle) const;
+	bool IsValid(PoolHandle handle) const { return Get(handle) != nullptr; }
+
+	// positions in the packed array; they change when values are destroyed
+	size_t Size() const { return m_values.size(); }
+	bool Empty() const { return m_values.empty(); }
+	T& operator[](size_t index) { return m_values[index]; }
+	const T& operator[](size_t index) const { return m_values[index]; }
+	PoolHandle HandleAt(size_t index) const;
+
+	// the generation a slot moves to when its value is destroyed;
+	// it wraps around past 0, which is reserved for the null handle
+	static uint32_t NextGeneration(uint32_t generation)
+	{
+		return (generation == 0xFFFFFFFFu) ? 1 : generation + 1;
+	}
+
+	T* begin() { return m_values.data(); }
+	T* end() { return m_values.data() + m_values.size(); }
+	const T* begin() const { return m_values.data(); }
+	const T* end() const { return m_values.data() + m_values.size(); }
+
+private:
+	static const uint32_t kNoSlot = 0xFFFFFFFFu;
+
+	struct SLOT
+	{
+		// position of the value while the slot is live,
+		// the next free slot while it is not
+		uint32_t index;
+		uint32_t generation;
+	};
+
+	uint32_t AcquireSlot(uint32_t index);
+
+	std::vector<T> m_values;
+	// the slot of every packed value
+	std::vector<uint32_t> m_valueSlots;
+	std::vector<SLOT> m_slots;
+	uint32_t m_freeSlot = kNoSlot;
+};
+
+template <typename T>
+void ObjectPool<T>::Reserve(size_t count)
+{
+	m_values.reserve(count);
+	m_valueSlots.reserve(count);
+	m_slots.reserve(count);
+}
+
+template <typename T>
+uint32_t ObjectPool<T>::AcquireSlot(uint32_t index)
+{
+	uint32_t slot = m_freeSlot;
+	if (slot != kNoSlot)
+	{
+		m_freeSlot = m_slots[slot].index;
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(m_slots.size());
+		m_slots.push_back({ 0, 1 });
+	}
+	m_slots[slot].index = index;
+	m_valueSlots.push_back(slot);
+	return slot;
+}
+
+template <typename T>
+PoolHandle ObjectPool<T>::Create(const T& value)
+{
+	const uint32_t slot = AcquireSlot(static_cast<uint32_t>(m_values.size()));
+	m_values.push_back(value);
+
+	PoolHandle handle;
+	handle.slot = slot;
+	handle.generation = m_slots[slot].generation;
+	return handle;
+}
+
+template <typename T>
+size_t ObjectPool<T>::CreateRange(size_t count)
+{
+	const size_t first = m_values.size();
+	m_values.resize(first + count);
+	for (size_t i = first; i < first + count; ++i)
+	{
+		AcquireSlot(static_cast<uint32_t>(i));
+	}
+	return first;
+}
+
+template <typename T>
+bool ObjectPool<T>::Destroy(PoolHandle handle)
+{
+	if (!IsValid(handle))
+	{
+		return false;
+	}
+
+	// move the last value into the hole and point its slot there
+	SLOT& slot = m_slots[handle.slot];
+	const uint32_t index = slot.index;
+	const uint32_t last = static_cast<uint32_t>(m_values.size() - 1);
+	if (index != last)
+	{
+		m_values[index] = m_values[last];
+		m_valueSlots[index] = m_valueSlots[last];
+		m_slots[m_valueSlots[index]].index = index;
+	}
+	m_values.pop_back();
+	m_valueSlots.pop_back();
+
+	slot.generation = NextGeneration(slot.generation);
+	slot.index = m_freeSlot;
+	m_freeSlot = handle.slot;
+	return true;
+}
+
+template <typename T>
+void ObjectPool<T>::Clear()
+{
+	while (!m_values.empty())
+	{
+		Destroy(HandleAt(m_values.size() - 1));
+	}
+}
+
+template <typename T>
+T* ObjectPool<T>::Get(PoolHandle handle)
+{
+	return const_cast<T*>(static_cast<const ObjectPool<T>*>(this)->Get(handle));
+}
+
+template <typename T>
+const T* ObjectPool<T>::Get(PoolHandle handle) const
+{
+	if ((handle.slot >= m_slots.size()) || (handle.generation == 0))
+	{
+		return nullptr;
+	}
+	const SLOT& slot = m_slots[handle.slot];
+	return (slot.generation == handle.generation) ? &m_values[slot.index] : nullptr;
+}
+
+template <typename T>
+PoolHandle ObjectPool<T>::HandleAt(size_t index) const
+{
+	PoolHandle handle;
+	handle.slot = m_valueSlots[index];
+	handle.generation = m_slots[handle.slot].generation;
+	return handle;
+}
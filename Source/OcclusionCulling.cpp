@@ -0,0 +1,490 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculling.cpp
+// ============
+// CPU occlusion culling - a few large occluders are rasterized into a small
+// software depth buffer, reduced to a hierarchical-Z pyramid, and the bounds
+// of the other visible objects are tested against it
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCulling.h"
+#include "MeshGeometry.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define OCCLUSION_SSE2 1
+#include <emmintrin.h>
+#else
+#define OCCLUSION_SSE2 0
+#endif
+
+// declaration of global variables
+namespace
+{
+	// the four pixels rasterized together must never straddle a row
+	static_assert((OcclusionCuller::kWidth % 4) == 0, "rows are rasterized four pixels at a time");
+
+	struct OCCLUDER_SHAPE
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+	};
+
+	// the unit box and plane; flat faces need no more than the
+	// lowest tessellation
+	const OCCLUDER_SHAPE& GetOccluderShape(MeshType mesh)
+	{
+		static const OCCLUDER_SHAPE shapes[2] = { []()
+		{
+			OCCLUDER_SHAPE shape;
+			MeshGeometry geometry;
+			GenerateMeshGeometry(MeshType::Plane, 3, geometry);
+			for (const MeshVertex& vertex : geometry.vertices)
+			{
+				shape.positions.push_back(vertex.position);
+			}
+			shape.indices = geometry.indices;
+			return shape;
+		}(), []()
+		{
+			OCCLUDER_SHAPE shape;
+			MeshGeometry geometry;
+			GenerateMeshGeometry(MeshType::Box, 3, geometry);
+			for (const MeshVertex& vertex : geometry.vertices)
+			{
+				shape.positions.push_back(vertex.position);
+			}
+			shape.indices = geometry.indices;
+			return shape;
+		}() };
+		return shapes[(mesh == MeshType::Box) ? 1 : 0];
+	}
+
+	// normalized device coordinates to pixels, and depth to [0, 1]
+	glm::vec3 ToScreen(const glm::vec4& clip)
+	{
+		const float invW = 1.0f / clip.w;
+		return glm::vec3(
+			(clip.x * invW * 0.5f + 0.5f) * static_cast<float>(OcclusionCuller::kWidth),
+			(clip.y * invW * 0.5f + 0.5f) * static_cast<float>(OcclusionCuller::kHeight),
+			clip.z * invW * 0.5f + 0.5f);
+	}
+}
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor allocates the depth buffer and every level
+ *  of the pyramid, down to a single texel.
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+	: m_viewProjection(1.0f),
+	m_occluders(0),
+	m_occluderTriangles(0)
+{
+	uint32_t width = kWidth;
+	uint32_t height = kHeight;
+	while (true)
+	{
+		LEVEL level;
+		level.width = width;
+		level.height = height;
+		level.depth.assign(static_cast<size_t>(width) * height, 1.0f);
+		m_levels.push_back(std::move(level));
+		if ((width == 1) && (height == 1))
+		{
+			break;
+		}
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+}
+
+/***********************************************************
+ *  IsOccluderMesh()
+ *
+ *  Boxes and planes are the only meshes rasterized as
+ *  occluders.
+ ***********************************************************/
+bool OcclusionCuller::IsOccluderMesh(MeshType mesh)
+{
+	return (mesh == MeshType::Box) || (mesh == MeshType::Plane);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  Clears the depth buffer to the far plane.
+ ***********************************************************/
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	std::fill(m_levels[0].depth.begin(), m_levels[0].depth.end(), 1.0f);
+	m_occluders = 0;
+	m_occluderTriangles = 0;
+}
+
+/***********************************************************
+ *  AddOccluder()
+ *
+ *  Transforms the vertices of the mesh to clip space once and
+ *  rasterizes each of its triangles. Both sides are drawn, as
+ *  a plane occludes from either.
+ ***********************************************************/
+void OcclusionCuller::AddOccluder(MeshType mesh, const glm::mat4& model)
+{
+	if (!IsOccluderMesh(mesh))
+	{
+		return;
+	}
+
+	const OCCLUDER_SHAPE& shape = GetOccluderShape(mesh);
+	const glm::mat4 modelViewProjection = m_viewProjection * model;
+	m_clipVertices.resize(shape.positions.size());
+	for (size_t i = 0; i < shape.positions.size(); ++i)
+	{
+		m_clipVertices[i] = modelViewProjection * glm::vec4(shape.positions[i], 1.0f);
+	}
+	for (size_t i = 0; i + 2 < shape.indices.size(); i += 3)
+	{
+		RasterizeClipTriangle(m_clipVertices[shape.indices[i]],
+			m_clipVertices[shape.indices[i + 1]], m_clipVertices[shape.indices[i + 2]]);
+	}
+	m_occluders++;
+}
+
+/***********************************************************
+ *  RasterizeClipTriangle()
+ *
+ *  Cuts a triangle against the near plane, which leaves a
+ *  polygon of up to four vertices, then rasterizes it as a
+ *  fan. Triangles outside the other planes are left to the
+ *  bounding rectangle of the rasterizer.
+ ***********************************************************/
+void OcclusionCuller::RasterizeClipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	const glm::vec4 input[3] = { a, b, c };
+	glm::vec4 polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		const glm::vec4& current = input[i];
+		const glm::vec4& next = input[(i + 1) % 3];
+		// signed distance to the near plane, z = -w
+		const float currentDistance = current.z + current.w;
+		const float nextDistance = next.z + next.w;
+		if (currentDistance >= 0.0f)
+		{
+			polygon[count++] = current;
+		}
+		if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+		{
+			const float t = currentDistance / (currentDistance - nextDistance);
+			polygon[count++] = current + (next - current) * t;
+		}
+	}
+	if (count < 3)
+	{
+		return;
+	}
+
+	const glm::vec3 first = ToScreen(polygon[0]);
+	for (int i = 1; i + 1 < count; ++i)
+	{
+		RasterizeTriangle(first, ToScreen(polygon[i]), ToScreen(polygon[i + 1]));
+	}
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  Writes the nearer of the buffer and the triangle depth to
+ *  every pixel whose center is inside the triangle. The depth
+ *  written is the farthest the triangle's plane reaches over
+ *  the pixel, so a pixel never claims to be nearer than any
+ *  point of the triangle in it.
+ ***********************************************************/
+void OcclusionCuller::RasterizeTriangle(const glm::vec3& a, const glm::vec3& inB, const glm::vec3& inC)
+{
+	glm::vec3 b = inB;
+	glm::vec3 c = inC;
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (!(std::fabs(area) > 1e-6f))
+	{
+		return;
+	}
+	if (area < 0.0f)
+	{
+		std::swap(b, c);
+		area = -area;
+	}
+
+	// pixels whose centers lie inside the bounds, clamped to the buffer
+	const float minX = std::min(a.x, std::min(b.x, c.x));
+	const float maxX = std::max(a.x, std::max(b.x, c.x));
+	const float minY = std::min(a.y, std::min(b.y, c.y));
+	const float maxY = std::max(a.y, std::max(b.y, c.y));
+	const int x0 = std::max(static_cast<int>(std::ceil(std::max(minX, -1.0f) - 0.5f)), 0);
+	const int x1 = std::min(static_cast<int>(std::floor(std::min(maxX, static_cast<float>(kWidth) + 1.0f) - 0.5f)),
+		static_cast<int>(kWidth) - 1);
+	const int y0 = std::max(static_cast<int>(std::ceil(std::max(minY, -1.0f) - 0.5f)), 0);
+	const int y1 = std::min(static_cast<int>(std::floor(std::min(maxY, static_cast<float>(kHeight) + 1.0f) - 0.5f)),
+		static_cast<int>(kHeight) - 1);
+	if ((x0 > x1) || (y0 > y1))
+	{
+		return;
+	}
+	m_occluderTriangles++;
+
+	// edge functions e = A * x + B * y + C, positive inside
+	const float edgeA[3] = { b.y - c.y, c.y - a.y, a.y - b.y };
+	const float edgeB[3] = { c.x - b.x, a.x - c.x, b.x - a.x };
+	const float edgeC[3] = {
+		-(edgeA[0] * b.x + edgeB[0] * b.y),
+		-(edgeA[1] * c.x + edgeB[1] * c.y),
+		-(edgeA[2] * a.x + edgeB[2] * a.y) };
+
+	// the depth plane from the barycentric weights, each edge's own
+	// function being the weight of the opposite vertex
+	const float invArea = 1.0f / area;
+	const float depthA = (edgeA[0] * a.z + edgeA[1] * b.z + edgeA[2] * c.z) * invArea;
+	const float depthB = (edgeB[0] * a.z + edgeB[1] * b.z + edgeB[2] * c.z) * invArea;
+	const float depthC = (edgeC[0] * a.z + edgeC[1] * b.z + edgeC[2] * c.z) * invArea +
+		0.5f * (std::fabs(depthA) + std::fabs(depthB));
+	const float maxDepth = std::max(a.z, std::max(b.z, c.z));
+
+	float* depth = m_levels[0].depth.data();
+	const int firstX = x0 & ~3;
+	for (int y = y0; y <= y1; ++y)
+	{
+		const float centerY = static_cast<float>(y) + 0.5f;
+		float* row = depth + static_cast<size_t>(y) * kWidth;
+		const float rowEdge0 = edgeB[0] * centerY + edgeC[0];
+		const float rowEdge1 = edgeB[1] * centerY + edgeC[1];
+		const float rowEdge2 = edgeB[2] * centerY + edgeC[2];
+		const float rowDepth = depthB * centerY + depthC;
+
+#if OCCLUSION_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 stepA0 = _mm_set1_ps(edgeA[0]);
+		const __m128 stepA1 = _mm_set1_ps(edgeA[1]);
+		const __m128 stepA2 = _mm_set1_ps(edgeA[2]);
+		const __m128 stepDepth = _mm_set1_ps(depthA);
+		const __m128 row0 = _mm_set1_ps(rowEdge0);
+		const __m128 row1 = _mm_set1_ps(rowEdge1);
+		const __m128 row2 = _mm_set1_ps(rowEdge2);
+		const __m128 rowZ = _mm_set1_ps(rowDepth);
+		const __m128 farthest = _mm_set1_ps(maxDepth);
+		for (int x = firstX; x <= x1; x += 4)
+		{
+			const __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+			const __m128 e0 = _mm_add_ps(_mm_mul_ps(stepA0, centerX), row0);
+			const __m128 e1 = _mm_add_ps(_mm_mul_ps(stepA1, centerX), row1);
+			const __m128 e2 = _mm_add_ps(_mm_mul_ps(stepA2, centerX), row2);
+			const __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero),
+				_mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+			const __m128 z = _mm_min_ps(_mm_add_ps(_mm_mul_ps(stepDepth, centerX), rowZ), farthest);
+			const __m128 current = _mm_loadu_ps(row + x);
+			const __m128 nearer = _mm_min_ps(current, z);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+		}
+#else
+		for (int x = firstX; x <= x1; ++x)
+		{
+			const float centerX = static_cast<float>(x) + 0.5f;
+			if ((edgeA[0] * centerX + rowEdge0 >= 0.0f) &&
+				(edgeA[1] * centerX + rowEdge1 >= 0.0f) &&
+				(edgeA[2] * centerX + rowEdge2 >= 0.0f))
+			{
+				row[x] = std::min(row[x], std::min(depthA * centerX + rowDepth, maxDepth));
+			}
+		}
+#endif
+	}
+}
+
+/***********************************************************
+ *  BuildPyramid()
+ *
+ *  Each texel takes the farthest of the four texels below
+ *  it. A level that is one texel wide or high keeps that
+ *  size, folding only the other axis.
+ ***********************************************************/
+void OcclusionCuller::BuildPyramid()
+{
+	for (size_t l = 1; l < m_levels.size(); ++l)
+	{
+		const LEVEL& source = m_levels[l - 1];
+		LEVEL& target = m_levels[l];
+		for (uint32_t y = 0; y < target.height; ++y)
+		{
+			const uint32_t sourceY0 = std::min(y * 2, source.height - 1);
+			const uint32_t sourceY1 = std::min(y * 2 + 1, source.height - 1);
+			const float* row0 = source.depth.data() + static_cast<size_t>(sourceY0) * source.width;
+			const float* row1 = source.depth.data() + static_cast<size_t>(sourceY1) * source.width;
+			float* out = target.depth.data() + static_cast<size_t>(y) * target.width;
+			for (uint32_t x = 0; x < target.width; ++x)
+			{
+				const uint32_t sourceX0 = std::min(x * 2, source.width - 1);
+				const uint32_t sourceX1 = std::min(x * 2 + 1, source.width - 1);
+				out[x] = std::max(std::max(row0[sourceX0], row0[sourceX1]),
+					std::max(row1[sourceX0], row1[sourceX1]));
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  Projects the corners of the box around the sphere. Their
+ *  rectangle is grown by a pixel, as occluder coverage is
+ *  only sampled at pixel centers, and the level is chosen so
+ *  that at most three texels per axis cover it. Bounds that
+ *  reach the near plane are never occluded.
+ ***********************************************************/
+bool OcclusionCuller::IsOccluded(const glm::vec3& center, float radius) const
+{
+	const glm::vec4 clipCenter = m_viewProjection * glm::vec4(center, 1.0f);
+	const glm::vec4 axisX = m_viewProjection[0] * radius;
+	const glm::vec4 axisY = m_viewProjection[1] * radius;
+	const glm::vec4 axisZ = m_viewProjection[2] * radius;
+
+	// bounds of the corners in normalized device coordinates
+	float ndcMinX;
+	float ndcMaxX;
+	float ndcMinY;
+	float ndcMaxY;
+	float ndcNearestZ;
+#if OCCLUSION_SSE2
+	// four corners at a time, the near and then the far half along z
+	const __m128 signX = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+	const __m128 signY = _mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f);
+	const __m128 baseX = _mm_add_ps(_mm_set1_ps(clipCenter.x),
+		_mm_add_ps(_mm_mul_ps(signX, _mm_set1_ps(axisX.x)), _mm_mul_ps(signY, _mm_set1_ps(axisY.x))));
+	const __m128 baseY = _mm_add_ps(_mm_set1_ps(clipCenter.y),
+		_mm_add_ps(_mm_mul_ps(signX, _mm_set1_ps(axisX.y)), _mm_mul_ps(signY, _mm_set1_ps(axisY.y))));
+	const __m128 baseZ = _mm_add_ps(_mm_set1_ps(clipCenter.z),
+		_mm_add_ps(_mm_mul_ps(signX, _mm_set1_ps(axisX.z)), _mm_mul_ps(signY, _mm_set1_ps(axisY.z))));
+	const __m128 baseW = _mm_add_ps(_mm_set1_ps(clipCenter.w),
+		_mm_add_ps(_mm_mul_ps(signX, _mm_set1_ps(axisX.w)), _mm_mul_ps(signY, _mm_set1_ps(axisY.w))));
+	const __m128 epsilon = _mm_set1_ps(1e-6f);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 lowX = _mm_set1_ps(FLT_MAX);
+	__m128 highX = _mm_set1_ps(-FLT_MAX);
+	__m128 lowY = _mm_set1_ps(FLT_MAX);
+	__m128 highY = _mm_set1_ps(-FLT_MAX);
+	__m128 lowZ = _mm_set1_ps(FLT_MAX);
+	for (int half = 0; half < 2; ++half)
+	{
+		const float sign = (half == 0) ? -1.0f : 1.0f;
+		const __m128 x = _mm_add_ps(baseX, _mm_set1_ps(axisZ.x * sign));
+		const __m128 y = _mm_add_ps(baseY, _mm_set1_ps(axisZ.y * sign));
+		const __m128 z = _mm_add_ps(baseZ, _mm_set1_ps(axisZ.z * sign));
+		const __m128 w = _mm_add_ps(baseW, _mm_set1_ps(axisZ.w * sign));
+		const __m128 crossing = _mm_or_ps(_mm_cmple_ps(w, epsilon), _mm_cmplt_ps(_mm_add_ps(z, w), zero));
+		if (_mm_movemask_ps(crossing) != 0)
+		{
+			return false;
+		}
+		const __m128 invW = _mm_div_ps(_mm_set1_ps(1.0f), w);
+		const __m128 ndcX = _mm_mul_ps(x, invW);
+		const __m128 ndcY = _mm_mul_ps(y, invW);
+		lowX = _mm_min_ps(lowX, ndcX);
+		highX = _mm_max_ps(highX, ndcX);
+		lowY = _mm_min_ps(lowY, ndcY);
+		highY = _mm_max_ps(highY, ndcY);
+		lowZ = _mm_min_ps(lowZ, _mm_mul_ps(z, invW));
+	}
+	float lanes[5][4];
+	_mm_storeu_ps(lanes[0], lowX);
+	_mm_storeu_ps(lanes[1], highX);
+	_mm_storeu_ps(lanes[2], lowY);
+	_mm_storeu_ps(lanes[3], highY);
+	_mm_storeu_ps(lanes[4], lowZ);
+	ndcMinX = std::min(std::min(lanes[0][0], lanes[0][1]), std::min(lanes[0][2], lanes[0][3]));
+	ndcMaxX = std::max(std::max(lanes[1][0], lanes[1][1]), std::max(lanes[1][2], lanes[1][3]));
+	ndcMinY = std::min(std::min(lanes[2][0], lanes[2][1]), std::min(lanes[2][2], lanes[2][3]));
+	ndcMaxY = std::max(std::max(lanes[3][0], lanes[3][1]), std::max(lanes[3][2], lanes[3][3]));
+	ndcNearestZ = std::min(std::min(lanes[4][0], lanes[4][1]), std::min(lanes[4][2], lanes[4][3]));
+#else
+	ndcMinX = FLT_MAX;
+	ndcMaxX = -FLT_MAX;
+	ndcMinY = FLT_MAX;
+	ndcMaxY = -FLT_MAX;
+	ndcNearestZ = FLT_MAX;
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		const glm::vec4 clip = clipCenter +
+			axisX * ((corner & 1) ? 1.0f : -1.0f) +
+			axisY * ((corner & 2) ? 1.0f : -1.0f) +
+			axisZ * ((corner & 4) ? 1.0f : -1.0f);
+		if ((clip.w <= 1e-6f) || (clip.z + clip.w < 0.0f))
+		{
+			return false;
+		}
+		const float invW = 1.0f / clip.w;
+		ndcMinX = std::min(ndcMinX, clip.x * invW);
+		ndcMaxX = std::max(ndcMaxX, clip.x * invW);
+		ndcMinY = std::min(ndcMinY, clip.y * invW);
+		ndcMaxY = std::max(ndcMaxY, clip.y * invW);
+		ndcNearestZ = std::min(ndcNearestZ, clip.z * invW);
+	}
+#endif
+
+	const float minX = (ndcMinX * 0.5f + 0.5f) * static_cast<float>(kWidth);
+	const float maxX = (ndcMaxX * 0.5f + 0.5f) * static_cast<float>(kWidth);
+	const float minY = (ndcMinY * 0.5f + 0.5f) * static_cast<float>(kHeight);
+	const float maxY = (ndcMaxY * 0.5f + 0.5f) * static_cast<float>(kHeight);
+	const float nearestDepth = ndcNearestZ * 0.5f + 0.5f;
+	if ((maxX < 0.0f) || (maxY < 0.0f) ||
+		(minX >= static_cast<float>(kWidth)) || (minY >= static_cast<float>(kHeight)))
+	{
+		return false;
+	}
+
+	// the coordinates are clamped first, so truncation floors them
+	const int x0 = std::max(static_cast<int>(std::max(minX, 0.0f)) - 1, 0);
+	const int x1 = std::min(static_cast<int>(std::min(maxX, static_cast<float>(kWidth))) + 1, static_cast<int>(kWidth) - 1);
+	const int y0 = std::max(static_cast<int>(std::max(minY, 0.0f)) - 1, 0);
+	const int y1 = std::min(static_cast<int>(std::min(maxY, static_cast<float>(kHeight))) + 1, static_cast<int>(kHeight) - 1);
+
+	const int extent = std::max(x1 - x0, y1 - y0);
+	size_t levelIndex = 0;
+	while (((extent >> levelIndex) > 1) && (levelIndex + 1 < m_levels.size()))
+	{
+		levelIndex++;
+	}
+	const LEVEL& level = m_levels[levelIndex];
+	const uint32_t tx0 = std::min(static_cast<uint32_t>(x0) >> levelIndex, level.width - 1);
+	const uint32_t tx1 = std::min(static_cast<uint32_t>(x1) >> levelIndex, level.width - 1);
+	const uint32_t ty0 = std::min(static_cast<uint32_t>(y0) >> levelIndex, level.height - 1);
+	const uint32_t ty1 = std::min(static_cast<uint32_t>(y1) >> levelIndex, level.height - 1);
+	float farthest = 0.0f;
+	for (uint32_t y = ty0; y <= ty1; ++y)
+	{
+		const float* row = level.depth.data() + static_cast<size_t>(y) * level.width;
+		for (uint32_t x = tx0; x <= tx1; ++x)
+		{
+			farthest = std::max(farthest, row[x]);
+		}
+	}
+	return nearestDepth > farthest;
+}
+
+/***********************************************************
+ *  GetDepth()
+ *
+ *  One texel of a pyramid level, 1 outside of it.
+ ***********************************************************/
+float OcclusionCuller::GetDepth(uint32_t level, uint32_t x, uint32_t y) const
+{
+	if ((level >= m_levels.size()) || (x >= m_levels[level].width) || (y >= m_levels[level].height))
+	{
+		return 1.0f;
+	}
+	return m_levels[level].depth[static_cast<size_t>(y) * m_levels[level].width + x];
+}
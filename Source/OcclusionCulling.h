@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculling.h
+// ============
+// CPU occlusion culling - a few large occluders are rasterized into a small
+// software depth buffer, reduced to a hierarchical-Z pyramid, and the bounds
+// of the other visible objects are tested against it
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+struct OcclusionConfig
+{
+	// most occluders rasterized per frame, the largest on screen first
+	uint32_t maxOccluders = 32;
+	// smallest occluder, as its bounding radius over the distance,
+	// scaled like the projection; about half the screen height is 1
+	float minOccluderSize = 0.15f;
+};
+
+/***********************************************************
+ *  OcclusionCuller
+ *
+ *  The depth buffer is kWidth x kHeight, whatever the size of
+ *  the window, and holds the nearest occluder depth of every
+ *  pixel in normalized [0, 1] depth. Four pixels of a row are
+ *  rasterized at once with SSE2 where the compiler targets it.
+ *
+ *  Each level of the pyramid keeps the farthest depth of four
+ *  texels of the level below, so an object is occluded when
+ *  the nearest point of its bounds is behind the farthest
+ *  occluder depth over the rectangle it covers. The test only
+ *  reads the pyramid and may run on any number of threads
+ *  once BuildPyramid() has returned.
+ *
+ *  Only boxes and planes occlude: their meshes are solid, so
+ *  any pixel inside their outline is really hidden behind
+ *  them, which the open or curved shapes do not promise at a
+ *  low tessellation.
+ ***********************************************************/
+class OcclusionCuller
+{
+public:
+	static const uint32_t kWidth = 256;
+	static const uint32_t kHeight = 128;
+
+	OcclusionCuller();
+
+	// true for the meshes AddOccluder() rasterizes
+	static bool IsOccluderMesh(MeshType mesh);
+
+	// clear the depth buffer for a new view
+	void BeginFrame(const glm::mat4& viewProjection);
+	// rasterize the triangles of a box or plane; other meshes are ignored
+	void AddOccluder(MeshType mesh, const glm::mat4& model);
+	// reduce the depth buffer into the pyramid; call once, after the
+	// last occluder
+	void BuildPyramid();
+
+	// true if a bounding sphere is fully hidden behind the occluders
+	bool IsOccluded(const glm::vec3& center, float radius) const;
+
+	uint32_t GetOccluderCount() const { return m_occluders; }
+	uint32_t GetOccluderTriangleCount() const { return m_occluderTriangles; }
+	uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_levels.size()); }
+	// depth of a pyramid texel, for tools that show the buffer
+	float GetDepth(uint32_t level, uint32_t x, uint32_t y) const;
+
+private:
+	struct LEVEL
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<float> depth;
+	};
+
+	// clip-space triangle, cut against the near plane
+	void RasterizeClipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	// screen-space triangle, x and y in pixels and z in [0, 1]
+	void RasterizeTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+
+	glm::mat4 m_viewProjection;
+	// level 0 is the rasterized depth buffer
+	std::vector<LEVEL> m_levels;
+	// vertices of the occluder being rasterized, in clip space
+	std::vector<glm::vec4> m_clipVertices;
+	uint32_t m_occluders;
+	uint32_t m_occluderTriangles;
+};
@@ -0,0 +1,494 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcompare.cpp
+// ============
+// performance regression checks - loads timing samples from Google Benchmark
+// and frame timing JSON files and compares two runs with a Mann-Whitney U test
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PerfCompare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// the exact U distribution is used up to this many samples per side
+	const size_t g_MaxExactSamples = 25;
+
+	// just enough JSON for the two result formats; no dependencies
+	// so the gate runs anywhere the benchmarks do
+	struct JsonValue
+	{
+		enum class Type { Null, Bool, Number, String, Array, Object };
+
+		Type type = Type::Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string text;
+		std::vector<JsonValue> items;
+		std::vector<std::pair<std::string, JsonValue>> members;
+
+		const JsonValue* Find(const char* key) const
+		{
+			for (const auto& member : members)
+			{
+				if (member.first == key)
+				{
+					return &member.second;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		explicit JsonParser(const std::string& text) : m_text(text) {}
+
+		bool Parse(JsonValue& value)
+		{
+			return ParseValue(value, 0) && (SkipSpace(), m_pos == m_text.size());
+		}
+
+	private:
+		// deep enough for both formats, shallow enough to never overflow
+		static const int kMaxDepth = 64;
+
+		void SkipSpace()
+		{
+			while ((m_pos < m_text.size()) && std::strchr(" \t\r\n", m_text[m_pos]) != nullptr)
+			{
+				m_pos++;
+			}
+		}
+
+		bool Match(const char* literal)
+		{
+			const size_t length = std::strlen(literal);
+			if (m_text.compare(m_pos, length, literal) != 0)
+			{
+				return false;
+			}
+			m_pos += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value, int depth)
+		{
+			SkipSpace();
+			if ((m_pos >= m_text.size()) || (depth > kMaxDepth))
+			{
+				return false;
+			}
+
+			const char c = m_text[m_pos];
+			if (c == '{')
+			{
+				value.type = JsonValue::Type::Object;
+				m_pos++;
+				SkipSpace();
+				if ((m_pos < m_text.size()) && (m_text[m_pos] == '}'))
+				{
+					m_pos++;
+					return true;
+				}
+				while (true)
+				{
+					std::pair<std::string, JsonValue> member;
+					SkipSpace();
+					if (!ParseString(member.first))
+					{
+						return false;
+					}
+					SkipSpace();
+					if (!Match(":") || !ParseValue(member.second, depth + 1))
+					{
+						return false;
+					}
+					value.members.push_back(std::move(member));
+					SkipSpace();
+					if (Match("}"))
+					{
+						return true;
+					}
+					if (!Match(","))
+					{
+						return false;
+					}
+				}
+			}
+			if (c == '[')
+			{
+				value.type = JsonValue::Type::Array;
+				m_pos++;
+				SkipSpace();
+				if ((m_pos < m_text.size()) && (m_text[m_pos] == ']'))
+				{
+					m_pos++;
+					return true;
+				}
+				while (true)
+				{
+					value.items.emplace_back();
+					if (!ParseValue(value.items.back(), depth + 1))
+					{
+						return false;
+					}
+					SkipSpace();
+					if (Match("]"))
+					{
+						return true;
+					}
+					if (!Match(","))
+					{
+						return false;
+					}
+				}
+			}
+			if (c == '"')
+			{
+				value.type = JsonValue::Type::String;
+				return ParseString(value.text);
+			}
+			if (Match("true") || Match("false"))
+			{
+				value.type = JsonValue::Type::Bool;
+				value.boolean = (c == 't');
+				return true;
+			}
+			if (Match("null"))
+			{
+				value.type = JsonValue::Type::Null;
+				return true;
+			}
+
+			const char* start = m_text.c_str() + m_pos;
+			char* end = nullptr;
+			value.number = std::strtod(start, &end);
+			if (end == start)
+			{
+				return false;
+			}
+			value.type = JsonValue::Type::Number;
+			m_pos += static_cast<size_t>(end - start);
+			return true;
+		}
+
+		// names and labels are plain ASCII; \u escapes are kept as '?'
+		bool ParseString(std::string& text)
+		{
+			if (!Match("\""))
+			{
+				return false;
+			}
+			while (m_pos < m_text.size())
+			{
+				char c = m_text[m_pos++];
+				if (c == '"')
+				{
+					return true;
+				}
+				if (c == '\\')
+				{
+					if (m_pos >= m_text.size())
+					{
+						return false;
+					}
+					c = m_text[m_pos++];
+					switch (c)
+					{
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case 'r': c = '\r'; break;
+					case 'b': c = '\b'; break;
+					case 'f': c = '\f'; break;
+					case 'u': c = '?'; m_pos = std::min(m_pos + 4, m_text.size()); break;
+					default: break;
+					}
+				}
+				text += c;
+			}
+			return false;
+		}
+
+		const std::string& m_text;
+		size_t m_pos = 0;
+	};
+
+	double MillisecondsPerUnit(const std::string& unit)
+	{
+		if (unit == "ns") return 1e-6;
+		if (unit == "us") return 1e-3;
+		if (unit == "s") return 1e3;
+		return 1.0;
+	}
+
+	double Median(std::vector<double> values)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+		const size_t middle = values.size() / 2;
+		std::nth_element(values.begin(), values.begin() + middle, values.end());
+		double median = values[middle];
+		if ((values.size() % 2) == 0)
+		{
+			median = 0.5 * (median + *std::max_element(values.begin(), values.begin() + middle));
+		}
+		return median;
+	}
+
+	bool LoadGoogleBenchmark(const JsonValue& benchmarks, TimingMetric metric, TimingSamples& samples)
+	{
+		const char* timeKey = (metric == TimingMetric::Cpu) ? "cpu_time" : "real_time";
+		for (const JsonValue& run : benchmarks.items)
+		{
+			// aggregates (mean, median, stddev) would count as extra samples
+			const JsonValue* runType = run.Find("run_type");
+			const JsonValue* error = run.Find("error_occurred");
+			if (((runType != nullptr) && (runType->text != "iteration")) ||
+				((error != nullptr) && error->boolean))
+			{
+				continue;
+			}
+
+			const JsonValue* name = run.Find("run_name");
+			if (name == nullptr)
+			{
+				name = run.Find("name");
+			}
+			const JsonValue* time = run.Find(timeKey);
+			const JsonValue* unit = run.Find("time_unit");
+			if ((name == nullptr) || (time == nullptr) || (time->type != JsonValue::Type::Number))
+			{
+				return false;
+			}
+			samples[name->text].push_back(
+				time->number * MillisecondsPerUnit((unit != nullptr) ? unit->text : "ns"));
+		}
+		return true;
+	}
+
+	bool LoadFrameTimings(const JsonValue& root, TimingSamples& samples)
+	{
+		const char* arrays[2] = { "cpu_ms", "frame_ms" };
+		for (const char* key : arrays)
+		{
+			const JsonValue* values = root.Find(key);
+			if ((values == nullptr) || (values->type != JsonValue::Type::Array))
+			{
+				return false;
+			}
+			std::vector<double>& series = samples[std::string("frames/") + key];
+			for (const JsonValue& value : values->items)
+			{
+				series.push_back(value.number);
+			}
+		}
+		return true;
+	}
+
+	// number of orderings of m and n samples giving each U, for the
+	// exact distribution without ties; counts[u] over u = 0..m*n
+	std::vector<double> ExactUCounts(size_t m, size_t n)
+	{
+		// table[i][j] holds the counts for i and j samples
+		std::vector<std::vector<std::vector<double>>> table(m + 1,
+			std::vector<std::vector<double>>(n + 1));
+		for (size_t i = 0; i <= m; ++i)
+		{
+			for (size_t j = 0; j <= n; ++j)
+			{
+				std::vector<double>& counts = table[i][j];
+				counts.assign(i * j + 1, 0.0);
+				if ((i == 0) || (j == 0))
+				{
+					counts[0] = 1.0;
+					continue;
+				}
+				// the largest value is either from the first sample,
+				// beating all j of the second, or from the second
+				const std::vector<double>& first = table[i - 1][j];
+				const std::vector<double>& second = table[i][j - 1];
+				for (size_t u = 0; u < first.size(); ++u)
+				{
+					counts[u + j] += first[u];
+				}
+				for (size_t u = 0; u < second.size(); ++u)
+				{
+					counts[u] += second[u];
+				}
+			}
+		}
+		return table[m][n];
+	}
+}
+
+/***********************************************************
+ *  LoadTimingSamples()
+ *
+ *  Detects the format from the top-level keys and adds the
+ *  samples to the map.
+ ***********************************************************/
+bool LoadTimingSamples(const std::string& path, TimingMetric metric, TimingSamples& samples)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "[PerfCompare] cannot open " << path << "\n";
+		return false;
+	}
+	const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	JsonValue root;
+	JsonParser parser(text);
+	if (!parser.Parse(root) || (root.type != JsonValue::Type::Object))
+	{
+		std::cerr << "[PerfCompare] " << path << " is not valid JSON\n";
+		return false;
+	}
+
+	const JsonValue* benchmarks = root.Find("benchmarks");
+	const bool ok = ((benchmarks != nullptr) && (benchmarks->type == JsonValue::Type::Array))
+		? LoadGoogleBenchmark(*benchmarks, metric, samples)
+		: LoadFrameTimings(root, samples);
+	if (!ok)
+	{
+		std::cerr << "[PerfCompare] " << path << " is neither a benchmark nor a frame timing file\n";
+	}
+	return ok;
+}
+
+/***********************************************************
+ *  MannWhitneyU()
+ *
+ *  Ranks both samples together, giving tied values their
+ *  average rank. Small samples without ties use the exact
+ *  distribution of U; otherwise the normal approximation
+ *  with tie and continuity corrections.
+ ***********************************************************/
+MannWhitneyResult MannWhitneyU(const std::vector<double>& baseline,
+	const std::vector<double>& candidate)
+{
+	MannWhitneyResult result;
+	const size_t m = candidate.size();
+	const size_t n = baseline.size();
+	if ((m == 0) || (n == 0))
+	{
+		return result;
+	}
+
+	// value and whether it came from the candidate
+	std::vector<std::pair<double, bool>> all;
+	all.reserve(m + n);
+	for (double value : baseline)
+	{
+		all.emplace_back(value, false);
+	}
+	for (double value : candidate)
+	{
+		all.emplace_back(value, true);
+	}
+	std::sort(all.begin(), all.end());
+
+	double candidateRankSum = 0.0;
+	double tieTerm = 0.0;
+	for (size_t first = 0; first < all.size(); )
+	{
+		size_t last = first;
+		while ((last + 1 < all.size()) && (all[last + 1].first == all[first].first))
+		{
+			last++;
+		}
+		// ranks are 1-based
+		const double rank = 0.5 * static_cast<double>(first + last + 2);
+		for (size_t i = first; i <= last; ++i)
+		{
+			candidateRankSum += all[i].second ? rank : 0.0;
+		}
+		const double ties = static_cast<double>(last - first + 1);
+		tieTerm += ties * ties * ties - ties;
+		first = last + 1;
+	}
+
+	const double mn = static_cast<double>(m) * static_cast<double>(n);
+	result.u = candidateRankSum - 0.5 * static_cast<double>(m) * static_cast<double>(m + 1);
+
+	if ((tieTerm == 0.0) && (m <= g_MaxExactSamples) && (n <= g_MaxExactSamples))
+	{
+		const std::vector<double> counts = ExactUCounts(m, n);
+		double total = 0.0;
+		double tail = 0.0;
+		for (size_t u = 0; u < counts.size(); ++u)
+		{
+			total += counts[u];
+			tail += (static_cast<double>(u) >= result.u) ? counts[u] : 0.0;
+		}
+		result.pValue = tail / total;
+		result.bExact = true;
+		return result;
+	}
+
+	const double count = static_cast<double>(m + n);
+	const double variance = mn / 12.0 * ((count + 1.0) - tieTerm / (count * (count - 1.0)));
+	if (variance <= 0.0)
+	{
+		// every value tied: no evidence either way
+		return result;
+	}
+	const double z = (result.u - 0.5 * mn - 0.5) / std::sqrt(variance);
+	result.pValue = 0.5 * std::erfc(z / std::sqrt(2.0));
+	return result;
+}
+
+/***********************************************************
+ *  ComparePerformance()
+ *
+ *  A series regresses when the test is significant and its
+ *  median slowed down by at least the threshold, so tiny but
+ *  consistent differences do not fail a build.
+ ***********************************************************/
+std::vector<PerfComparison> ComparePerformance(const TimingSamples& baseline,
+	const TimingSamples& candidate, const PerfGateConfig& cfg)
+{
+	std::vector<PerfComparison> comparisons;
+	for (const auto& entry : baseline)
+	{
+		const auto found = candidate.find(entry.first);
+		if (found == candidate.end())
+		{
+			continue;
+		}
+
+		PerfComparison comparison;
+		comparison.name = entry.first;
+		comparison.baselineCount = entry.second.size();
+		comparison.candidateCount = found->second.size();
+		comparison.baselineMedianMs = Median(entry.second);
+		comparison.candidateMedianMs = Median(found->second);
+		if (comparison.baselineMedianMs > 0.0)
+		{
+			comparison.ratio = comparison.candidateMedianMs / comparison.baselineMedianMs;
+		}
+
+		comparison.bTested = (comparison.baselineCount >= cfg.minSamples) &&
+			(comparison.candidateCount >= cfg.minSamples);
+		if (comparison.bTested)
+		{
+			comparison.pValue = MannWhitneyU(entry.second, found->second).pValue;
+			comparison.bRegression = (comparison.pValue < cfg.alpha) &&
+				(comparison.ratio >= 1.0 + cfg.thresholdPercent / 100.0);
+		}
+		comparisons.push_back(comparison);
+	}
+	return comparisons;
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcompare.h
+// ============
+// performance regression checks - loads timing samples from Google Benchmark
+// and frame timing JSON files and compares two runs with a Mann-Whitney U test
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+enum class TimingMetric
+{
+	// CPU time of the benchmarked thread
+	Cpu,
+	// wall clock time
+	Real
+};
+
+// samples in milliseconds, by benchmark name
+typedef std::map<std::string, std::vector<double>> TimingSamples;
+
+struct MannWhitneyResult
+{
+	// pairs where the candidate is slower, ties counting half
+	double u = 0.0;
+	// one-sided: chance of a U this large with no slowdown
+	double pValue = 1.0;
+	// exact distribution rather than the normal approximation
+	bool bExact = false;
+};
+
+struct PerfGateConfig
+{
+	// significance level of the test
+	double alpha = 0.05;
+	// smallest median slowdown, in percent, that counts as a regression
+	double thresholdPercent = 5.0;
+	// fewer samples on either side leaves a benchmark untested
+	size_t minSamples = 5;
+};
+
+struct PerfComparison
+{
+	std::string name;
+	size_t baselineCount = 0;
+	size_t candidateCount = 0;
+	double baselineMedianMs = 0.0;
+	double candidateMedianMs = 0.0;
+	// candidate median over baseline median
+	double ratio = 1.0;
+	double pValue = 1.0;
+	bool bTested = false;
+	bool bRegression = false;
+};
+
+/***********************************************************
+ *  LoadTimingSamples()
+ *
+ *  Reads a Google Benchmark JSON file, where each iteration
+ *  run is one sample (use --benchmark_repetitions to get
+ *  several), or a FrameTimingLog JSON file, whose cpu_ms and
+ *  frame_ms arrays become the "frames/cpu_ms" and
+ *  "frames/frame_ms" series. The metric only applies to
+ *  Google Benchmark files.
+ ***********************************************************/
+bool LoadTimingSamples(const std::string& path, TimingMetric metric, TimingSamples& samples);
+
+// one-sided test that the candidate is slower than the baseline
+MannWhitneyResult MannWhitneyU(const std::vector<double>& baseline,
+	const std::vector<double>& candidate);
+
+// compares every series found in both runs, in name order
+std::vector<PerfComparison> ComparePerformance(const TimingSamples& baseline,
+	const TimingSamples& candidate, const PerfGateConfig& cfg);
@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertypes.h
+// ============
+// plain data shared between the CPU scene stages and GL submission - camera
+// matrices, draw items, lights and view frustum tests
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// the basic shapes that ShapeMeshes can draw
+enum class MeshType : uint8_t
+{
+	Plane,
+	Box,
+	Sphere,
+	Cylinder,
+	TaperedCylinder,
+	Cone,
+	Torus,
+	Count
+};
+
+// radius of a sphere around each unit mesh, centered on the mesh origin
+inline float MeshBoundingRadius(MeshType mesh)
+{
+	switch (mesh)
+	{
+	case MeshType::Plane:           return 1.415f;
+	case MeshType::Box:             return 0.867f;
+	case MeshType::Sphere:          return 1.0f;
+	case MeshType::Cylinder:
+	case MeshType::TaperedCylinder:
+	case MeshType::Cone:            return 1.415f;
+	case MeshType::Torus:           return 1.25f;
+	default:                        return 1.415f;
+	}
+}
+
+/***********************************************************
+ *  FrameView
+ *
+ *  Camera state captured for one frame.
+ ***********************************************************/
+struct FrameView
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::vec3 position = glm::vec3(0.0f);
+	bool bOrthographic = false;
+	// an object pick was asked for this frame at this viewport point,
+	// in normalized device coordinates
+	bool bPickRequested = false;
+	glm::vec2 pickPoint = glm::vec2(0.0f);
+};
+
+/***********************************************************
+ *  CameraState
+ *
+ *  Everything the camera update depends on, so that a
+ *  recorded camera can be restored exactly.
+ ***********************************************************/
+struct CameraState
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
+	float yaw = 0.0f;
+	float pitch = 0.0f;
+	float zoom = 0.0f;
+	float movementSpeed = 0.0f;
+	bool bOrthographic = false;
+};
+
+/***********************************************************
+ *  DrawItem
+ *
+ *  Everything needed to issue one mesh draw. Contains no
+ *  pointers so it can be copied between threads freely.
+ ***********************************************************/
+struct DrawItem
+{
+	glm::mat4 model;
+	glm::vec4 color;
+	glm::vec2 uvScale;
+	uint32_t textureID;
+	uint32_t objectIndex;
+	MeshType mesh;
+	bool bUseTexture;
+};
+
+/***********************************************************
+ *  TextureDemand
+ *
+ *  Largest on-screen size of a texture in one frame, as a
+ *  fraction of the viewport height times its UV repeat; the
+ *  texture streamer turns it into the finest mip needed.
+ ***********************************************************/
+struct TextureDemand
+{
+	uint32_t textureID;
+	float screenSize;
+};
+
+/***********************************************************
+ *  ImpostorDraw
+ *
+ *  One quad standing in for a distant group of objects: the
+ *  corners are center -/+ right -/+ up, textured with the
+ *  uvRect part (offset, then size) of the group's atlas.
+ ***********************************************************/
+struct ImpostorDraw
+{
+	glm::vec3 center;
+	glm::vec3 right;
+	glm::vec3 up;
+	glm::vec4 uvRect;
+	uint32_t textureID;
+};
+
+/***********************************************************
+ *  LightData
+ *
+ *  One point light as uploaded to the lit fragment shader.
+ ***********************************************************/
+struct LightData
+{
+	glm::vec3 position;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	bool bActive;
+};
+
+/***********************************************************
+ *  Frustum
+ *
+ *  Six planes extracted from a view-projection matrix, with
+ *  the normals pointing into the visible volume.
+ ***********************************************************/
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	static Frustum FromMatrix(const glm::mat4& viewProjection)
+	{
+		Frustum frustum;
+		const glm::mat4& m = viewProjection;
+		for (int i = 0; i < 3; ++i)
+		{
+			glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+			glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+			frustum.planes[i * 2 + 0] = w + row;
+			frustum.planes[i * 2 + 1] = w - row;
+		}
+		for (glm::vec4& plane : frustum.planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	bool IntersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
@@ -0,0 +1,307 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneculling.cpp
+// ============
+// the CPU visibility stage of a frame - the placed scene objects are culled
+// against the view frustum and the largest occluders, and the visible ones
+// recorded as sorted render commands. Nothing here touches GL, so headless
+// tools and benchmarks run the same path as the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneCulling.h"
+#include "FramePipeline.h"
+#include "JobSystem.h"
+#include "SceneGenerator.h"
+#include "SceneLookup.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// depth at which the sort key stops telling draws apart
+	const float g_SortFarPlane = 100.0f;
+
+	// the bounding sphere of MakeSceneObject() from a draw's model
+	// matrix, whose column lengths are the scale; grown by a hair so
+	// rounding never leaves it smaller than the stored one
+	float DrawBoundsRadius(const DrawItem& item)
+	{
+		const float scale = glm::sqrt(glm::max(glm::dot(glm::vec3(item.model[0]), glm::vec3(item.model[0])),
+			glm::max(glm::dot(glm::vec3(item.model[1]), glm::vec3(item.model[1])),
+				glm::dot(glm::vec3(item.model[2]), glm::vec3(item.model[2])))));
+		return MeshBoundingRadius(item.mesh) * scale * 1.0001f;
+	}
+}
+
+/***********************************************************
+ *  MakeSceneObject()
+ *
+ *  This function is used for composing the model matrix and
+ *  bounding sphere of a placed mesh.
+ ***********************************************************/
+SceneObject MakeSceneObject(
+	MeshType mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	uint32_t textureID,
+	glm::vec4 color)
+{
+	SceneObject object;
+	object.mesh = mesh;
+	object.model = ComposeModelMatrix(
+		scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
+	object.boundsCenter = glm::vec3(object.model[3]);
+	object.boundsRadius = MeshBoundingRadius(mesh) *
+		glm::max(scaleXYZ.x, glm::max(scaleXYZ.y, scaleXYZ.z));
+	object.color = color;
+	object.textureID = textureID;
+	object.bUseTexture = (textureID != 0);
+	object.group = kNoObjectGroup;
+	return object;
+}
+
+/***********************************************************
+ *  MapGeneratedTexture()
+ *
+ *  This function is used for mapping the texture index of a
+ *  generated object onto the loaded scene textures, wrapping
+ *  around when the scene file names more than are loaded.
+ ***********************************************************/
+uint32_t MapGeneratedTexture(uint8_t textureIndex, const uint32_t* textureIDs, uint32_t textureCount)
+{
+	if ((textureIndex == 0) || (textureCount == 0))
+	{
+		return 0;
+	}
+	return textureIDs[(textureIndex - 1) % textureCount];
+}
+
+/***********************************************************
+ *  ComposeGeneratedScene()
+ *
+ *  This function is used for replacing the objects of a pool
+ *  with a generated scene. The pool keeps its storage, so
+ *  reloading a scene of a similar size does not go back to
+ *  the heap.
+ ***********************************************************/
+void ComposeGeneratedScene(const GeneratedScene& scene,
+	const uint32_t* textureIDs, uint32_t textureCount,
+	ObjectPool<SceneObject>& objects, JobSystem* pJobSystem)
+{
+	const uint32_t objectCount = static_cast<uint32_t>(scene.objects.size());
+
+	objects.Clear();
+	objects.Reserve(objectCount);
+	const size_t first = objects.CreateRange(objectCount);
+	auto build = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const GeneratedObject& generated = scene.objects[i];
+			objects[first + i] = MakeSceneObject(generated.mesh, generated.scale,
+				generated.rotation.x, generated.rotation.y, generated.rotation.z, generated.position,
+				MapGeneratedTexture(generated.textureIndex, textureIDs, textureCount), generated.color);
+		}
+	};
+	if (pJobSystem != NULL)
+	{
+		pJobSystem->ParallelFor(objectCount, 4096, build);
+	}
+	else
+	{
+		build(0, objectCount);
+	}
+}
+
+/***********************************************************
+ *  SceneCuller()
+ *
+ *  The constructor starts with occlusion culling and the
+ *  visibility cache turned on.
+ ***********************************************************/
+SceneCuller::SceneCuller(JobSystem* pJobSystem, FrameArena* pFrameArena) :
+	m_pJobSystem(pJobSystem),
+	m_commandRecorder(pJobSystem, pFrameArena),
+	m_bOcclusionCulling(true),
+	m_bVisibilityCache(true)
+{
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for culling the scene objects against
+ *  the view frustum and recording a sorted render command for
+ *  each visible object, then removing the ones behind the
+ *  occluders. While the camera stays near the pose of the
+ *  last culled frame, that frame's commands are reused
+ *  instead.
+ ***********************************************************/
+void SceneCuller::Cull(const FrameView& view, const ObjectPool<SceneObject>& objects,
+	uint32_t objectVersion, FramePacket& packet)
+{
+	packet.bVisibilityReused = m_bVisibilityCache &&
+		m_visibilityCache.Reuse(view, objectVersion, packet);
+	if (packet.bVisibilityReused)
+	{
+		return;
+	}
+
+	const Frustum frustum = Frustum::FromMatrix(view.projection * view.view);
+	m_commandRecorder.Record(static_cast<uint32_t>(objects.Size()),
+		[&](uint32_t index, CommandBuffer& buffer)
+		{
+			const SceneObject& object = objects[index];
+			if (!frustum.IntersectsSphere(object.boundsCenter, object.boundsRadius))
+			{
+				return;
+			}
+
+			RenderCommand command;
+			command.item.model = object.model;
+			command.item.color = object.color;
+			command.item.uvScale = glm::vec2(1.0f);
+			command.item.textureID = object.textureID;
+			command.item.objectIndex = index;
+			command.item.mesh = object.mesh;
+			command.item.bUseTexture = object.bUseTexture;
+
+			const float viewDepth = -(view.view * glm::vec4(object.boundsCenter, 1.0f)).z;
+			command.sortKey = MakeSortKey(command.item, viewDepth, g_SortFarPlane);
+			buffer.Push(command);
+		});
+
+	m_commandRecorder.Merge(packet.commands);
+	packet.culledObjects = static_cast<uint32_t>(objects.Size() - packet.commands.size());
+	packet.occludedObjects = 0;
+	packet.occluders = 0;
+	if (m_bOcclusionCulling)
+	{
+		CullOccludedCommands(view, packet);
+	}
+	if (m_bVisibilityCache)
+	{
+		m_visibilityCache.Store(view, objectVersion, packet);
+	}
+}
+
+/***********************************************************
+ *  CullOccludedCommands()
+ *
+ *  This method is used for removing the draws hidden behind
+ *  other objects. The largest visible boxes and planes are
+ *  rasterized into the occlusion culler's depth buffer, then
+ *  the bounds of every other command are tested against its
+ *  pyramid on the job system. The remaining commands keep
+ *  their sorted order.
+ ***********************************************************/
+void SceneCuller::CullOccludedCommands(const FrameView& view, FramePacket& packet)
+{
+	const float projectionScale = view.projection[1][1];
+	m_occluderCandidates.clear();
+	for (uint32_t i = 0; i < packet.commands.size(); ++i)
+	{
+		const DrawItem& item = packet.commands[i].item;
+		if (!OcclusionCuller::IsOccluderMesh(item.mesh))
+		{
+			continue;
+		}
+		const float radius = DrawBoundsRadius(item);
+		float screenSize = radius * projectionScale;
+		if (!view.bOrthographic)
+		{
+			const float viewDepth = -(view.view * item.model[3]).z;
+			screenSize /= glm::max(viewDepth, radius);
+		}
+		if (screenSize >= m_occlusionConfig.minOccluderSize)
+		{
+			m_occluderCandidates.push_back(std::make_pair(screenSize, i));
+		}
+	}
+	if (m_occluderCandidates.empty())
+	{
+		return;
+	}
+
+	const size_t occluderCount = std::min<size_t>(m_occluderCandidates.size(), m_occlusionConfig.maxOccluders);
+	std::partial_sort(m_occluderCandidates.begin(), m_occluderCandidates.begin() + occluderCount,
+		m_occluderCandidates.end(),
+		[](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b)
+		{
+			return a.first > b.first;
+		});
+	m_occlusionCuller.BeginFrame(view.projection * view.view);
+	for (size_t i = 0; i < occluderCount; ++i)
+	{
+		const DrawItem& item = packet.commands[m_occluderCandidates[i].second].item;
+		m_occlusionCuller.AddOccluder(item.mesh, item.model);
+	}
+	m_occlusionCuller.BuildPyramid();
+	packet.occluders = m_occlusionCuller.GetOccluderCount();
+
+	// an occluder's own bounds are in front of its surface, so the
+	// occluders always pass their own test. The bounds come from the
+	// commands rather than the scene objects: the commands are in
+	// draw order, and looking up their objects would jump around
+	// memory.
+	const uint32_t commandCount = static_cast<uint32_t>(packet.commands.size());
+	m_occludedCommands.resize(commandCount);
+	auto testCommands = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const DrawItem& item = packet.commands[i].item;
+			const bool bOccluded = m_occlusionCuller.IsOccluded(glm::vec3(item.model[3]), DrawBoundsRadius(item));
+			m_occludedCommands[i] = bOccluded ? 1 : 0;
+		}
+	};
+	if (m_pJobSystem != NULL)
+	{
+		m_pJobSystem->ParallelFor(commandCount, 1024, testCommands);
+	}
+	else
+	{
+		testCommands(0, commandCount);
+	}
+
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < commandCount; ++i)
+	{
+		if (m_occludedCommands[i] == 0)
+		{
+			packet.commands[kept++] = packet.commands[i];
+		}
+	}
+	packet.occludedObjects = commandCount - kept;
+	packet.commands.resize(kept);
+}
+
+/***********************************************************
+ *  SetOcclusionCulling()
+ *
+ *  This method is used for turning the occlusion test on or
+ *  off. The cached commands were culled under the old
+ *  setting, so they are dropped.
+ ***********************************************************/
+void SceneCuller::SetOcclusionCulling(bool bEnabled, const OcclusionConfig& config)
+{
+	m_bOcclusionCulling = bEnabled;
+	m_occlusionConfig = config;
+	m_visibilityCache.Invalidate();
+}
+
+/***********************************************************
+ *  SetVisibilityCache()
+ *
+ *  This method is used for turning the reuse of the last
+ *  culled frame on or off, and for setting how far the camera
+ *  may move before the scene is culled again.
+ ***********************************************************/
+void SceneCuller::SetVisibilityCache(bool bEnabled, const VisibilityCacheConfig& config)
+{
+	m_bVisibilityCache = bEnabled;
+	m_visibilityCache.SetConfig(config);
+}
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneculling.h
+// ============
+// the CPU visibility stage of a frame - the placed scene objects are culled
+// against the view frustum and the largest occluders, and the visible ones
+// recorded as sorted render commands. Nothing here touches GL, so headless
+// tools and benchmarks run the same path as the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CommandRecorder.h"
+#include "ObjectPool.h"
+#include "OcclusionCulling.h"
+#include "RenderTypes.h"
+#include "VisibilityCache.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class FrameArena;
+class JobSystem;
+struct FramePacket;
+struct GeneratedScene;
+
+// one placed mesh in the scene; the bounds are in world space
+struct SceneObject
+{
+	MeshType mesh;
+	glm::mat4 model;
+	glm::vec3 boundsCenter;
+	float boundsRadius;
+	glm::vec4 color;
+	uint32_t textureID;
+	bool bUseTexture;
+	// index into the scene's object groups, or kNoObjectGroup
+	uint16_t group;
+};
+const uint16_t kNoObjectGroup = 0xFFFF;
+
+// compose the model matrix and bounding sphere of a placed mesh; a
+// texture ID of 0 draws the mesh with the color
+SceneObject MakeSceneObject(
+	MeshType mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	uint32_t textureID,
+	glm::vec4 color);
+
+// the texture a generated object's texture index maps onto; index 0
+// means the object is colored, as is every object without textures
+uint32_t MapGeneratedTexture(uint8_t textureIndex, const uint32_t* textureIDs, uint32_t textureCount);
+
+// replace the objects of a pool with those of a generated scene; large
+// scenes compose their matrices on the job system when one is given
+void ComposeGeneratedScene(const GeneratedScene& scene,
+	const uint32_t* textureIDs, uint32_t textureCount,
+	ObjectPool<SceneObject>& objects, JobSystem* pJobSystem);
+
+/***********************************************************
+ *  SceneCuller
+ *
+ *  Fills the draw list of a frame packet from the scene
+ *  objects. The objects are split across the job system,
+ *  every partition recording into its own command buffer,
+ *  and the merged commands are sorted for submission. The
+ *  largest visible boxes and planes then hide the commands
+ *  behind them. While the camera stays near the pose of the
+ *  last culled frame, that frame's commands are reused.
+ ***********************************************************/
+class SceneCuller
+{
+public:
+	// the command buffers are taken from the frame arena when one is
+	// given, which the caller resets once per frame
+	SceneCuller(JobSystem* pJobSystem = nullptr, FrameArena* pFrameArena = nullptr);
+
+	// fill the packet's commands and cull counts; objectVersion must
+	// change whenever objects are added, removed or reloaded
+	void Cull(const FrameView& view, const ObjectPool<SceneObject>& objects,
+		uint32_t objectVersion, FramePacket& packet);
+
+	// occlusion culling, on by default
+	void SetOcclusionCulling(bool bEnabled, const OcclusionConfig& config = OcclusionConfig());
+	bool IsOcclusionCulling() const { return m_bOcclusionCulling; }
+	// reuse of the last frame's commands while the camera is still or
+	// moving slowly, on by default
+	void SetVisibilityCache(bool bEnabled, const VisibilityCacheConfig& config = VisibilityCacheConfig());
+	bool IsVisibilityCache() const { return m_bVisibilityCache; }
+	VisibilityCacheStats GetVisibilityCacheStats() const { return m_visibilityCache.GetStats(); }
+
+private:
+	// drop the commands hidden behind the largest occluders
+	void CullOccludedCommands(const FrameView& view, FramePacket& packet);
+
+	JobSystem* m_pJobSystem;
+	// per-thread command buffers for building the draw list
+	CommandRecorder m_commandRecorder;
+	// software depth buffer of the largest boxes and planes in view
+	OcclusionCuller m_occlusionCuller;
+	OcclusionConfig m_occlusionConfig;
+	bool m_bOcclusionCulling;
+	// screen size and command index of the occluder candidates, and
+	// one flag per command; kept to reuse their memory
+	std::vector<std::pair<float, uint32_t>> m_occluderCandidates;
+	std::vector<uint8_t> m_occludedCommands;
+	// the draws of the last culled frame
+	VisibilityCache m_visibilityCache;
+	bool m_bVisibilityCache;
+};
@@ -0,0 +1,400 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegenerator.cpp
+// ============
+// procedural stress scenes - seeded placement of the basic meshes with
+// configurable count, distribution, clustering, material mix and lights
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGenerator.h"
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  Scene file format (version 1, little-endian, packed)
+	 *
+	 *  header: "SCNE", uint32 version, uint32 seed, uint32
+	 *          texture count, uint32 object count, uint32
+	 *          light count
+	 *  object: uint8 mesh, uint8 texture index, 13 floats
+	 *          (scale, rotation, position, color)
+	 *  light:  12 floats (position, ambient, diffuse,
+	 *          specular), uint8 active
+	 ***********************************************************/
+	const char g_Magic[4] = { 'S', 'C', 'N', 'E' };
+	const uint32_t g_Version = 1;
+	// refuse files claiming more than this, rather than allocating blindly
+	const uint32_t g_MaxFileObjects = 16u * 1024u * 1024u;
+
+	// mt19937 output is specified exactly; std distributions are not
+	float Random01(std::mt19937& random)
+	{
+		return static_cast<float>(random() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float RandomRange(std::mt19937& random, float minValue, float maxValue)
+	{
+		return minValue + (maxValue - minValue) * Random01(random);
+	}
+
+	uint32_t RandomIndex(std::mt19937& random, uint32_t count)
+	{
+		return static_cast<uint32_t>(Random01(random) * static_cast<float>(count)) % count;
+	}
+
+	// evenly spread hues so that neighbouring palette entries differ
+	glm::vec3 PaletteColor(uint32_t index)
+	{
+		const float hue = std::fmod(static_cast<float>(index) * 0.618034f, 1.0f) * 6.0f;
+		const float x = 1.0f - std::fabs(std::fmod(hue, 2.0f) - 1.0f);
+		glm::vec3 color;
+		switch (static_cast<int>(hue))
+		{
+		case 0:  color = glm::vec3(1.0f, x, 0.0f); break;
+		case 1:  color = glm::vec3(x, 1.0f, 0.0f); break;
+		case 2:  color = glm::vec3(0.0f, 1.0f, x); break;
+		case 3:  color = glm::vec3(0.0f, x, 1.0f); break;
+		case 4:  color = glm::vec3(x, 0.0f, 1.0f); break;
+		default: color = glm::vec3(1.0f, 0.0f, x); break;
+		}
+		return 0.25f + 0.75f * color;
+	}
+
+	// mesh, scale and material of a random object
+	GeneratedObject RandomShape(std::mt19937& random, const SceneGenerationConfig& cfg)
+	{
+		GeneratedObject object;
+		object.mesh = static_cast<MeshType>(RandomIndex(random, static_cast<uint32_t>(MeshType::Count)));
+		const float size = RandomRange(random, 0.3f, 2.0f);
+		object.scale = size * glm::vec3(RandomRange(random, 0.6f, 1.4f),
+			RandomRange(random, 0.6f, 1.4f), RandomRange(random, 0.6f, 1.4f));
+
+		object.textureIndex = 0;
+		if ((cfg.textureCount > 0) && (Random01(random) < cfg.texturedFraction))
+		{
+			object.textureIndex = static_cast<uint8_t>(1 + RandomIndex(random, std::min(cfg.textureCount, 255u)));
+		}
+		const uint32_t colorCount = std::max(cfg.colorCount, 1u);
+		object.color = glm::vec4(PaletteColor(RandomIndex(random, colorCount)), 1.0f);
+		object.rotation = glm::vec3(0.0f);
+		object.position = glm::vec3(0.0f);
+		return object;
+	}
+
+	template <typename T>
+	void WriteValue(std::ostream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(std::istream& file, T& value)
+	{
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	void WriteFloats(std::ostream& file, const float* values, int count)
+	{
+		file.write(reinterpret_cast<const char*>(values), sizeof(float) * count);
+	}
+
+	bool ReadFloats(std::istream& file, float* values, int count)
+	{
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(values), sizeof(float) * count));
+	}
+}
+
+/***********************************************************
+ *  Generate()
+ *
+ *  Places the objects and lights described by the config.
+ ***********************************************************/
+void SceneGenerator::Generate(const SceneGenerationConfig& cfg, GeneratedScene& scene)
+{
+	std::mt19937 random(cfg.seed);
+	const float halfExtent = cfg.worldExtent * 0.5f;
+
+	scene.seed = cfg.seed;
+	scene.textureCount = cfg.textureCount;
+	scene.objects.clear();
+	scene.objects.reserve(cfg.objectCount);
+	scene.lights.clear();
+
+	// every cluster has a center and a prototype its instances copy
+	const uint32_t clusterCount = std::max(cfg.clusterCount, 1u);
+	std::vector<glm::vec3> centers(clusterCount);
+	std::vector<GeneratedObject> prototypes(clusterCount);
+	for (uint32_t c = 0; c < clusterCount; ++c)
+	{
+		centers[c] = glm::vec3(RandomRange(random, -halfExtent, halfExtent),
+			RandomRange(random, 0.0f, cfg.maxHeight),
+			RandomRange(random, -halfExtent, halfExtent));
+		prototypes[c] = RandomShape(random, cfg);
+	}
+
+	const uint32_t gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(cfg.objectCount))));
+	const float gridSpacing = (gridSide > 0) ? cfg.worldExtent / static_cast<float>(gridSide) : 1.0f;
+
+	for (uint32_t i = 0; i < cfg.objectCount; ++i)
+	{
+		const uint32_t cluster = RandomIndex(random, clusterCount);
+		GeneratedObject object = (Random01(random) < cfg.instanceFraction) ?
+			prototypes[cluster] : RandomShape(random, cfg);
+		object.rotation = glm::vec3(RandomRange(random, 0.0f, 360.0f),
+			RandomRange(random, 0.0f, 360.0f), RandomRange(random, 0.0f, 360.0f));
+
+		switch (cfg.distribution)
+		{
+		case SpatialDistribution::Uniform:
+			object.position = glm::vec3(RandomRange(random, -halfExtent, halfExtent),
+				RandomRange(random, 0.0f, cfg.maxHeight),
+				RandomRange(random, -halfExtent, halfExtent));
+			break;
+		case SpatialDistribution::Clustered:
+		{
+			// random direction; the cube-root radius fills the sphere evenly
+			glm::vec3 direction(RandomRange(random, -1.0f, 1.0f),
+				RandomRange(random, -1.0f, 1.0f), RandomRange(random, -1.0f, 1.0f));
+			if (glm::length(direction) < 1e-4f)
+			{
+				direction = glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+			const float radius = cfg.clusterRadius * std::cbrt(Random01(random));
+			object.position = centers[cluster] + glm::normalize(direction) * radius;
+			object.position.y = std::max(object.position.y, 0.0f);
+			break;
+		}
+		case SpatialDistribution::Grid:
+			object.position = glm::vec3(
+				-halfExtent + (static_cast<float>(i % gridSide) + 0.5f) * gridSpacing,
+				0.0f,
+				-halfExtent + (static_cast<float>(i / gridSide) + 0.5f) * gridSpacing);
+			break;
+		}
+		scene.objects.push_back(object);
+	}
+
+	for (uint32_t l = 0; l < cfg.lightCount; ++l)
+	{
+		const glm::vec3 color = PaletteColor(l);
+		LightData light;
+		light.position = glm::vec3(RandomRange(random, -halfExtent, halfExtent),
+			RandomRange(random, 2.0f, cfg.maxHeight + 5.0f),
+			RandomRange(random, -halfExtent, halfExtent));
+		light.ambient = 0.05f * color;
+		light.diffuse = 0.8f * color;
+		light.specular = color;
+		light.bActive = true;
+		scene.lights.push_back(light);
+	}
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  Writes a scene file.
+ ***********************************************************/
+bool SceneGenerator::Save(const std::string& path, const GeneratedScene& scene)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "[SceneGenerator] cannot create " << path << "\n";
+		return false;
+	}
+
+	file.write(g_Magic, sizeof(g_Magic));
+	WriteValue(file, g_Version);
+	WriteValue(file, scene.seed);
+	WriteValue(file, scene.textureCount);
+	WriteValue(file, static_cast<uint32_t>(scene.objects.size()));
+	WriteValue(file, static_cast<uint32_t>(scene.lights.size()));
+
+	for (const GeneratedObject& object : scene.objects)
+	{
+		WriteObject(file, object);
+	}
+
+	for (const LightData& light : scene.lights)
+	{
+		WriteLight(file, light);
+	}
+
+	if (!file)
+	{
+		std::cerr << "[SceneGenerator] failed writing " << path << "\n";
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  Reads and validates a scene file, from a mounted package
+ *  or from disk.
+ ***********************************************************/
+bool SceneGenerator::Load(const std::string& path, GeneratedScene& scene)
+{
+	AssetBlob blob;
+	if (!VirtualFileSystem::Read(path, blob))
+	{
+		std::cerr << "[SceneGenerator] cannot open " << path << "\n";
+		return false;
+	}
+	AssetStream file(blob);
+
+	char magic[4] = {};
+	uint32_t version = 0;
+	uint32_t objectCount = 0;
+	uint32_t lightCount = 0;
+	file.read(magic, sizeof(magic));
+	if (!file || (std::memcmp(magic, g_Magic, sizeof(magic)) != 0) ||
+		!ReadValue(file, version) || (version != g_Version) ||
+		!ReadValue(file, scene.seed) || !ReadValue(file, scene.textureCount) ||
+		!ReadValue(file, objectCount) || !ReadValue(file, lightCount) ||
+		(objectCount > g_MaxFileObjects) || (lightCount > g_MaxFileObjects))
+	{
+		std::cerr << "[SceneGenerator] " << path << " is not a version "
+			<< g_Version << " scene file\n";
+		return false;
+	}
+
+	scene.objects.resize(objectCount);
+	for (GeneratedObject& object : scene.objects)
+	{
+		if (!ReadObject(file, object))
+		{
+			std::cerr << "[SceneGenerator] " << path << " is truncated or corrupt\n";
+			scene.objects.clear();
+			return false;
+		}
+	}
+
+	scene.lights.resize(lightCount);
+	for (LightData& light : scene.lights)
+	{
+		if (!ReadLight(file, light))
+		{
+			std::cerr << "[SceneGenerator] " << path << " is truncated\n";
+			scene.objects.clear();
+			scene.lights.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+/***********************************************************
+ *  WriteObject()
+ *
+ *  Writes one object record.
+ ***********************************************************/
+void SceneGenerator::WriteObject(std::ostream& file, const GeneratedObject& object)
+{
+	const float values[13] =
+	{
+		object.scale.x, object.scale.y, object.scale.z,
+		object.rotation.x, object.rotation.y, object.rotation.z,
+		object.position.x, object.position.y, object.position.z,
+		object.color.r, object.color.g, object.color.b, object.color.a
+	};
+	WriteValue(file, static_cast<uint8_t>(object.mesh));
+	WriteValue(file, object.textureIndex);
+	WriteFloats(file, values, 13);
+}
+
+/***********************************************************
+ *  ReadObject()
+ *
+ *  Reads one object record, rejecting unknown meshes.
+ ***********************************************************/
+bool SceneGenerator::ReadObject(std::istream& file, GeneratedObject& object)
+{
+	uint8_t mesh = 0;
+	float values[13];
+	if (!ReadValue(file, mesh) || !ReadValue(file, object.textureIndex) ||
+		!ReadFloats(file, values, 13) || (mesh >= static_cast<uint8_t>(MeshType::Count)))
+	{
+		return false;
+	}
+	object.mesh = static_cast<MeshType>(mesh);
+	object.scale = glm::vec3(values[0], values[1], values[2]);
+	object.rotation = glm::vec3(values[3], values[4], values[5]);
+	object.position = glm::vec3(values[6], values[7], values[8]);
+	object.color = glm::vec4(values[9], values[10], values[11], values[12]);
+	return true;
+}
+
+/***********************************************************
+ *  WriteLight()
+ *
+ *  Writes one light record.
+ ***********************************************************/
+void SceneGenerator::WriteLight(std::ostream& file, const LightData& light)
+{
+	const float values[12] =
+	{
+		light.position.x, light.position.y, light.position.z,
+		light.ambient.x, light.ambient.y, light.ambient.z,
+		light.diffuse.x, light.diffuse.y, light.diffuse.z,
+		light.specular.x, light.specular.y, light.specular.z
+	};
+	WriteFloats(file, values, 12);
+	WriteValue(file, static_cast<uint8_t>(light.bActive ? 1 : 0));
+}
+
+/***********************************************************
+ *  ReadLight()
+ *
+ *  Reads one light record.
+ ***********************************************************/
+bool SceneGenerator::ReadLight(std::istream& file, LightData& light)
+{
+	float values[12];
+	uint8_t active = 0;
+	if (!ReadFloats(file, values, 12) || !ReadValue(file, active))
+	{
+		return false;
+	}
+	light.position = glm::vec3(values[0], values[1], values[2]);
+	light.ambient = glm::vec3(values[3], values[4], values[5]);
+	light.diffuse = glm::vec3(values[6], values[7], values[8]);
+	light.specular = glm::vec3(values[9], values[10], values[11]);
+	light.bActive = (active != 0);
+	return true;
+}
+
+/***********************************************************
+ *  ParseDistribution()
+ *
+ *  Converts a command line value into a distribution.
+ ***********************************************************/
+bool SceneGenerator::ParseDistribution(const char* text, SpatialDistribution& distribution)
+{
+	if (std::strcmp(text, "uniform") == 0)
+	{
+		distribution = SpatialDistribution::Uniform;
+	}
+	else if (std::strcmp(text, "clustered") == 0)
+	{
+		distribution = SpatialDistribution::Clustered;
+	}
+	else if (std::strcmp(text, "grid") == 0)
+	{
+		distribution = SpatialDistribution::Grid;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
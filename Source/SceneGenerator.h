@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegenerator.h
+// ============
+// procedural stress scenes - seeded placement of the basic meshes with
+// configurable count, distribution, clustering, material mix and lights
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTypes.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+enum class SpatialDistribution : uint8_t
+{
+	// anywhere inside the world box
+	Uniform,
+	// inside spheres around random cluster centers
+	Clustered,
+	// evenly spaced on the ground plane
+	Grid
+};
+
+struct SceneGenerationConfig
+{
+	uint32_t objectCount = 10000;
+	uint32_t seed = 1;
+	SpatialDistribution distribution = SpatialDistribution::Clustered;
+	// objects are placed within +-worldExtent/2 on x and z
+	float worldExtent = 200.0f;
+	float maxHeight = 20.0f;
+	uint32_t clusterCount = 64;
+	float clusterRadius = 6.0f;
+	// share of objects that copy their cluster's prototype mesh, scale
+	// and material, like instanced props would
+	float instanceFraction = 0.5f;
+	// distinct textures referenced; 0 leaves every object colored
+	uint32_t textureCount = 3;
+	float texturedFraction = 0.5f;
+	// distinct colors for the untextured objects
+	uint32_t colorCount = 16;
+	uint32_t lightCount = 5;
+};
+
+// one placed mesh, in the same terms as SceneManager::AddSceneObject()
+struct GeneratedObject
+{
+	MeshType mesh;
+	// 0 = colored, otherwise 1-based index into the scene's textures
+	uint8_t textureIndex;
+	glm::vec3 scale;
+	// degrees around x, y and z
+	glm::vec3 rotation;
+	glm::vec3 position;
+	glm::vec4 color;
+};
+
+struct GeneratedScene
+{
+	uint32_t seed = 0;
+	uint32_t textureCount = 0;
+	std::vector<GeneratedObject> objects;
+	std::vector<LightData> lights;
+};
+
+/***********************************************************
+ *  SceneGenerator
+ *
+ *  The same config and seed produce the same scene on every
+ *  platform - random numbers come straight from mt19937
+ *  rather than the implementation-defined distributions.
+ ***********************************************************/
+class SceneGenerator
+{
+public:
+	static void Generate(const SceneGenerationConfig& cfg, GeneratedScene& scene);
+
+	// binary scene files, see SceneGenerator.cpp for the layout
+	static bool Save(const std::string& path, const GeneratedScene& scene);
+	static bool Load(const std::string& path, GeneratedScene& scene);
+
+	// single records of the scene file, shared with the cell worlds
+	// of CellWorld.h
+	static const size_t kObjectRecordSize = 2 + 13 * sizeof(float);
+	static const size_t kLightRecordSize = 12 * sizeof(float) + 1;
+	static void WriteObject(std::ostream& file, const GeneratedObject& object);
+	static bool ReadObject(std::istream& file, GeneratedObject& object);
+	static void WriteLight(std::ostream& file, const LightData& light);
+	static bool ReadLight(std::istream& file, LightData& light);
+
+	// parse "uniform", "clustered" or "grid"; returns false on anything else
+	static bool ParseDistribution(const char* text, SpatialDistribution& distribution);
+};
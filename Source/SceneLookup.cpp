@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenelookup.cpp
+// ============
+// the CPU-only parts of scene setup - model matrix composition and the texture
+// and material lookups by interned tag. Nothing here touches GL, so headless
+// tools and benchmarks can link it without a context or the shape and shader
+// libraries
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneLookup.h"
+
+#include <glm/gtx/transform.hpp>
+
+/***********************************************************
+ *  ComposeModelMatrix()
+ *
+ *  This method is used for building a model matrix from the
+ *  passed in scale, rotation and translation values.
+ ***********************************************************/
+glm::mat4 ComposeModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 modelView;
+	glm::mat4 scale;
+	glm::mat4 rotationX;
+	glm::mat4 rotationY;
+	glm::mat4 rotationZ;
+	glm::mat4 translation;
+
+	// set the scale value in the transform buffer
+	scale = glm::scale(scaleXYZ);
+	// set the rotation values in the transform buffer
+	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+	// set the translation value in the transform buffer
+	translation = glm::translate(positionXYZ);
+
+	modelView = translation * rotationZ * rotationY * rotationX * scale;
+
+	return(modelView);
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int FindTextureSlot(const TextureSlot* slots, int slotCount, StringId tag)
+{
+	for (int index = 0; index < slotCount; index++)
+	{
+		if (slots[index].tag == tag)
+		{
+			return(index);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool FindMaterial(const std::vector<ObjectMaterial>& materials,
+	StringId tag, ObjectMaterial& material)
+{
+	for (const ObjectMaterial& candidate : materials)
+	{
+		if (candidate.tag == tag)
+		{
+			material.diffuseColor = candidate.diffuseColor;
+			material.specularColor = candidate.specularColor;
+			material.shininess = candidate.shininess;
+			return(true);
+		}
+	}
+
+	return(false);
+}
@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenelookup.h
+// ============
+// the CPU-only parts of scene setup - model matrix composition and the texture
+// and material lookups by interned tag. Nothing here touches GL, so headless
+// tools and benchmarks can link it without a context or the shape and shader
+// libraries
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "StringInterner.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct TextureSlot
+{
+	StringId tag;
+	uint32_t ID;
+};
+
+struct ObjectMaterial
+{
+	glm::vec3 diffuseColor;
+	glm::vec3 specularColor;
+	float shininess;
+	StringId tag;
+};
+
+// scale, then rotate around x, y and z, then translate
+glm::mat4 ComposeModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ);
+
+// index of the first slot with the tag, or -1
+int FindTextureSlot(const TextureSlot* slots, int slotCount, StringId tag);
+
+// copies the first material with the tag; returns false if there is none
+bool FindMaterial(const std::vector<ObjectMaterial>& materials,
+	StringId tag, ObjectMaterial& material);
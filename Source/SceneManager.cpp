@@ -10,7 +10,12 @@
 
 
 #include "SceneManager.h"
+#include "AllocationTracker.h"
 #include "DBHelper.h"
+#include "JobSystem.h"
+#include "FramePipeline.h"
+#include "SceneGenerator.h"
+#include "VirtualFileSystem.h"
 extern std::unique_ptr<DbHelper> g_Db;
 
 
@@ -21,6 +26,11 @@ extern std::unique_ptr<DbHelper> g_Db;
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <iostream>
+
 // declaration of global variables
 namespace
 {
@@ -29,6 +39,32 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+
+	// size of the pointLights array in the fragment shader
+	const size_t g_MaxShaderPointLights = 5;
+
+	// read by LoadSceneTextures(), in the order of its texture handles
+	const char* const g_SceneTextureFiles[] =
+	{
+		"textures/wood_seamless.jpeg",
+		"textures/grey_mouse_body.jpeg",
+		"textures/dark_mouse_buttons.jpeg"
+	};
+	const size_t g_SceneTextureCount = sizeof(g_SceneTextureFiles) / sizeof(g_SceneTextureFiles[0]);
+
+	// where EnableImpostors() looks for and writes each group's atlas
+	const char* g_ImpostorCacheFolder = "impostors/";
+
+	// FNV-1a, 64-bit, continued from a previous hash
+	uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+	{
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash = (hash ^ pBytes[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
 }
 
 /***********************************************************
@@ -36,10 +72,18 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderManager *pShaderManager, JobSystem* pJobSystem)
+	: m_sceneCuller(pJobSystem, &m_buildArena)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
+	m_pJobSystem = pJobSystem;
+	// the meshes own GL buffers, so they are created by PrepareScene()
+	// and a scene used without a GL context never touches them
+	m_basicMeshes = NULL;
+	m_textureWood = 0;
+	m_textureMouseBody = 0;
+	m_textureMouseButtons = 0;
+	m_localPacket = std::make_unique<FramePacket>();
 }
 
 /***********************************************************
@@ -50,6 +94,7 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
+	m_gpuPicker.reset();
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
 }
@@ -75,12 +120,18 @@ bool SceneManager::CreateGLTexture(const std::string& tag,
     }
 
     // If we already had a texture under this tag, delete it to prevent leaks
-    auto it = m_textureMap.find(tag);
-    if (it != m_textureMap.end() && it->second != 0) {
-        glDeleteTextures(1, &it->second);
+    const StringId id = StringInterner::Intern(tag);
+    for (TAGGED_TEXTURE& texture : m_textures) {
+        if (texture.tag == id) {
+            if (texture.ID != 0) {
+                glDeleteTextures(1, &texture.ID);
+            }
+            texture.ID = tex;
+            return true;
+        }
     }
 
-    m_textureMap[tag] = tex;
+    m_textures.Create({ id, tex });
     return true;
 }
 
@@ -109,12 +160,12 @@ void SceneManager::BindGLTextures()
 // Correctly deletes all GL textures created by SceneManager.
 void SceneManager::DestroyGLTextures()
 {
-    for (auto& kv : m_textureMap) {
-        if (kv.second != 0) {
-            glDeleteTextures(1, &kv.second);
+    for (TAGGED_TEXTURE& texture : m_textures) {
+        if (texture.ID != 0) {
+            glDeleteTextures(1, &texture.ID);
         }
     }
-    m_textureMap.clear();
+    m_textures.Clear();
 }
 
 
@@ -124,11 +175,12 @@ void SceneManager::DestroyGLTextures()
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-GLuint SceneManager::FindTextureID(const std::string& tag) const
+GLuint SceneManager::FindTextureID(StringId tag) const
 {
-    auto it = m_textureMap.find(tag);
-    if (it != m_textureMap.end()) {
-        return it->second;
+    for (const TAGGED_TEXTURE& texture : m_textures) {
+        if (texture.tag == tag) {
+            return texture.ID;
+        }
     }
     return 0; // 0 means "no texture" in OpenGL
 }
@@ -139,24 +191,9 @@ GLuint SceneManager::FindTextureID(const std::string& tag) const
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(StringId tag)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
-	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
-	}
-
-	return(textureSlot);
+	return(::FindTextureSlot(m_textureIDs, m_loadedTextures, tag));
 }
 
 /***********************************************************
@@ -165,31 +202,9 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(StringId tag, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
-	{
-		return(false);
-	}
-
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
-	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
-	}
-
-	return(true);
+	return(::FindMaterial(m_objectMaterials, tag, material));
 }
 
 /***********************************************************
@@ -205,24 +220,12 @@ void SceneManager::SetTransformations(
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	glm::mat4 modelView = ComposeModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
 
 	if (NULL != m_pShaderManager)
 	{
@@ -264,7 +267,7 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	StringId textureTag)
 {
 	if (NULL != m_pShaderManager)
 	{
@@ -297,7 +300,7 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	StringId materialTag)
 {
 	if (m_objectMaterials.size() > 0)
 	{
@@ -314,7 +317,7 @@ void SceneManager::SetShaderMaterial(
 	}
 }
 
-bool SceneManager::BindTextureByTag(const std::string& tag, GLenum target) const
+bool SceneManager::BindTextureByTag(StringId tag, GLenum target) const
 {
     const GLuint id = FindTextureID(tag);
     if (id == 0) return false;
@@ -322,9 +325,20 @@ bool SceneManager::BindTextureByTag(const std::string& tag, GLenum target) const
     return true;
 }
 
-bool SceneManager::TextureExists(const std::string& tag) const
+bool SceneManager::TextureExists(StringId tag) const
+{
+    return FindTextureID(tag) != 0;
+}
+
+bool SceneManager::DeleteGLTexture(StringId tag)
 {
-    return m_textureMap.find(tag) != m_textureMap.end();
+    for (size_t i = 0; i < m_textures.Size(); ++i) {
+        if (m_textures[i].tag == tag) {
+            glDeleteTextures(1, &m_textures[i].ID);
+            return m_textures.Destroy(m_textures.HandleAt(i));
+        }
+    }
+    return false;
 }
 
 // =====================
@@ -338,7 +352,12 @@ bool SceneManager::loadTextureFromFile(const std::string& filePath,
     stbi_set_flip_vertically_on_load(flipVertically ? 1 : 0);
 
     int width = 0, height = 0, channels = 0;
-    unsigned char* data = stbi_load(filePath.c_str(), &width, &height, &channels, 0);
+    AssetBlob blob;
+    unsigned char* data = nullptr;
+    if (VirtualFileSystem::Read(filePath, blob)) {
+        data = stbi_load_from_memory(blob.GetData(), static_cast<int>(blob.GetSize()),
+                                     &width, &height, &channels, 0);
+    }
     if (!data) {
 		if (g_Db && g_Db->isOpen()) {
     g_Db->logError("SceneManager", std::string("Failed to load texture: ") + filePath);
@@ -392,8 +411,44 @@ bool SceneManager::loadTextureFromFile(const std::string& filePath,
 /*** for assistance.                                        ***/
 /**************************************************************/
 
-GLuint SceneManager::LoadTexture(const char* filepath)
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for reading an image file into memory
+ *  with stb_image, from a mounted package or from disk. No
+ *  OpenGL calls are made here.
+ ***********************************************************/
+bool SceneManager::DecodeImage(const char* filepath, DECODED_IMAGE& image)
 {
+	AssetBlob blob;
+	image.pixels = NULL;
+	if (VirtualFileSystem::Read(filepath, blob))
+	{
+		image.pixels = stbi_load_from_memory(blob.GetData(), static_cast<int>(blob.GetSize()),
+			&image.width, &image.height, &image.channels, 0);
+	}
+	if (image.pixels == NULL)
+	{
+		std::cout << "Failed to load texture: " << filepath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  UploadTexture()
+ *
+ *  This method is used for creating an OpenGL texture from a
+ *  decoded image, generating the mipmaps and freeing the
+ *  decoded pixels.
+ ***********************************************************/
+GLuint SceneManager::UploadTexture(DECODED_IMAGE& image)
+{
+	if (image.pixels == NULL)
+	{
+		return 0;
+	}
+
 	GLuint textureID;
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_2D, textureID);
@@ -404,23 +459,101 @@ GLuint SceneManager::LoadTexture(const char* filepath)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	// Load the image using stb_image
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load(filepath, &width, &height, &nrChannels, 0);
-	if (data)
+	SpecifyTextureImage(image);
+	return textureID;
+}
+
+/***********************************************************
+ *  SpecifyTextureImage()
+ *
+ *  This method is used for loading decoded pixels into the
+ *  bound texture, generating the mipmaps and freeing the
+ *  decoded pixels.
+ ***********************************************************/
+void SceneManager::SpecifyTextureImage(DECODED_IMAGE& image)
+{
+	GLenum format = (image.channels == 3) ? GL_RGB : GL_RGBA;
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	FreeImage(image);
+}
+
+/***********************************************************
+ *  FreeImage()
+ *
+ *  This method is used for releasing decoded pixels.
+ ***********************************************************/
+void SceneManager::FreeImage(DECODED_IMAGE& image)
+{
+	if (image.pixels != NULL)
 	{
-		GLenum format = (nrChannels == 3) ? GL_RGB : GL_RGBA;
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		stbi_image_free(data);
-		return textureID;
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
 	}
-	else
+}
+
+/***********************************************************
+ *  GetSceneTextureCount()
+ *
+ *  This method is used for getting the number of texture
+ *  files that LoadSceneTextures() reads.
+ ***********************************************************/
+size_t SceneManager::GetSceneTextureCount()
+{
+	return g_SceneTextureCount;
+}
+
+const char* SceneManager::GetSceneTextureFile(size_t index)
+{
+	return (index < g_SceneTextureCount) ? g_SceneTextureFiles[index] : NULL;
+}
+
+/***********************************************************
+ *  ReplaceSceneTexture()
+ *
+ *  This method is used for swapping new pixels into one of
+ *  the scene textures. The texture object is respecified
+ *  rather than recreated, so the IDs held by the scene
+ *  objects and by packets in flight stay valid. Frees the
+ *  pixels either way; returns false if the file is not one
+ *  of the scene textures.
+ ***********************************************************/
+bool SceneManager::ReplaceSceneTexture(const char* filepath, DECODED_IMAGE& image)
+{
+	const GLuint textures[] = { m_textureWood, m_textureMouseBody, m_textureMouseButtons };
+	for (size_t i = 0; i < g_SceneTextureCount; ++i)
+	{
+		if ((std::strcmp(filepath, g_SceneTextureFiles[i]) == 0) && (textures[i] != 0) &&
+			(image.pixels != NULL))
+		{
+			if (m_textureStreamer && m_textureStreamer->ReplaceTexture(textures[i],
+				image.pixels, image.width, image.height, image.channels))
+			{
+				FreeImage(image);
+			}
+			else
+			{
+				glBindTexture(GL_TEXTURE_2D, textures[i]);
+				SpecifyTextureImage(image);
+			}
+			m_sceneVersion++;
+			return true;
+		}
+	}
+
+	FreeImage(image);
+	return false;
+}
+
+GLuint SceneManager::LoadTexture(const char* filepath)
+{
+	DECODED_IMAGE image;
+	if (!DecodeImage(filepath, image))
 	{
-		std::cout << "Failed to load texture: " << filepath << std::endl;
-		stbi_image_free(data);
 		return 0;
 	}
+	return UploadTexture(image);
 }
 
 // ---------- Define Material Properties ----------
@@ -433,6 +566,34 @@ void SceneManager::DefineObjectMaterials()
 
 // ---------- Set Up Lighting ----------
 void SceneManager::SetupSceneLights()
+{
+	UploadLightingConstants();
+
+	// point lights travel with the frame packet and are uploaded
+	// by ExecuteFramePacket() whenever the light version changes
+	LightData light;
+	light.bActive = true;
+	light.position = glm::vec3(1.0f, 3.0f, 2.0f);
+	light.ambient = glm::vec3(0.2f, 0.1f, 0.1f);
+	light.diffuse = glm::vec3(0.9f, 0.3f, 0.3f);
+	light.specular = glm::vec3(0.9f, 0.3f, 0.3f);
+
+	m_pointLights.Clear();
+	m_pointLights.Create(light);
+	for (int i = 1; i < 5; ++i)
+		m_pointLights.Create(LightData());
+	m_lightVersion++;
+	m_sceneVersion++;
+}
+
+/***********************************************************
+ *  UploadLightingConstants()
+ *
+ *  This method is used for setting the lighting uniforms
+ *  that stay the same for the whole run. The point lights
+ *  travel with the frame packets instead.
+ ***********************************************************/
+void SceneManager::UploadLightingConstants()
 {
 	m_pShaderManager->setBoolValue("bUseLighting", true);
 
@@ -442,16 +603,89 @@ void SceneManager::SetupSceneLights()
 	m_pShaderManager->setVec3Value("directionalLight.diffuse", glm::vec3(0.6f));
 	m_pShaderManager->setVec3Value("directionalLight.specular", glm::vec3(1.0f));
 
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
-	m_pShaderManager->setVec3Value("pointLights[0].position", glm::vec3(1.0f, 3.0f, 2.0f));
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", glm::vec3(0.2f, 0.1f, 0.1f));
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", glm::vec3(0.9f, 0.3f, 0.3f));
-	m_pShaderManager->setVec3Value("pointLights[0].specular", glm::vec3(0.9f, 0.3f, 0.3f));
+	m_pShaderManager->setBoolValue("spotLight.bActive", false);
+}
 
-	for (int i = 1; i < 5; ++i)
-		m_pShaderManager->setBoolValue("pointLights[" + std::to_string(i) + "].bActive", false);
+/***********************************************************
+ *  OnShaderProgramChanged()
+ *
+ *  This method is used for restoring the uniforms set once
+ *  by PrepareScene() after the scene program was rebuilt;
+ *  the new program must be bound. The per-draw uniforms
+ *  and the point lights are picked up by the next
+ *  ExecuteFramePacket(), which notices the new program.
+ ***********************************************************/
+void SceneManager::OnShaderProgramChanged()
+{
+	DefineObjectMaterials();
+	UploadLightingConstants();
+	m_sceneVersion++;
+}
 
-	m_pShaderManager->setBoolValue("spotLight.bActive", false);
+/***********************************************************
+ *  UploadLights()
+ *
+ *  This method is used for passing the point lights of a
+ *  frame packet into the shader. The uniform names are
+ *  formatted in the frame arena and set on the bound scene
+ *  program directly, since the ShaderManager setters would
+ *  copy each name into a heap string.
+ ***********************************************************/
+void SceneManager::UploadLights(const FramePacket& packet)
+{
+	const GLuint program = static_cast<GLuint>(m_drawUniforms.program);
+	auto location = [&](size_t index, const char* member)
+	{
+		return glGetUniformLocation(program,
+			m_submitArena.Format("pointLights[%u].%s", static_cast<unsigned>(index), member));
+	};
+
+	// scenes may hold more lights than the shader has slots for
+	const size_t lightCount = std::min(packet.lights.size(), g_MaxShaderPointLights);
+	for (size_t i = 0; i < lightCount; ++i)
+	{
+		const LightData& light = packet.lights[i];
+
+		glUniform1i(location(i, "bActive"), light.bActive ? 1 : 0);
+		if (light.bActive)
+		{
+			glUniform3fv(location(i, "position"), 1, &light.position[0]);
+			glUniform3fv(location(i, "ambient"), 1, &light.ambient[0]);
+			glUniform3fv(location(i, "diffuse"), 1, &light.diffuse[0]);
+			glUniform3fv(location(i, "specular"), 1, &light.specular[0]);
+		}
+	}
+	// or fewer, after lights were removed or a smaller scene loaded;
+	// the slots they leave keep the old values unless switched off
+	for (size_t i = lightCount; i < g_MaxShaderPointLights; ++i)
+	{
+		glUniform1i(location(i, "bActive"), 0);
+	}
+	m_uploadedLightVersion = packet.lightVersion;
+}
+
+/***********************************************************
+ *  ResolveDrawUniforms()
+ *
+ *  This method is used for looking up the uniforms that
+ *  ExecuteFramePacket() sets for every draw. The lookups
+ *  are repeated only when a different program is bound,
+ *  since each one goes through a name string.
+ ***********************************************************/
+bool SceneManager::ResolveDrawUniforms()
+{
+	GLint program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	if (program == m_drawUniforms.program)
+	{
+		return false;
+	}
+
+	m_drawUniforms.program = program;
+	m_drawUniforms.model = glGetUniformLocation(program, g_ModelName);
+	m_drawUniforms.useTexture = glGetUniformLocation(program, g_UseTextureName);
+	m_drawUniforms.objectColor = glGetUniformLocation(program, g_ColorValueName);
+	return true;
 }
 /***********************************************************
  *  PrepareScene()
@@ -467,94 +701,864 @@ void SceneManager::PrepareScene()
 	DefineObjectMaterials();
 	SetupSceneLights();
 
+	if (m_basicMeshes == NULL)
+	{
+		m_basicMeshes = new ShapeMeshes();
+	}
 	m_basicMeshes->LoadBoxMesh();
 	m_basicMeshes->LoadSphereMesh();
 	m_basicMeshes->LoadPlaneMesh();
 	m_basicMeshes->LoadCylinderMesh();
+	m_basicMeshes->LoadTaperedCylinderMesh();
 	m_basicMeshes->LoadConeMesh();
 	m_basicMeshes->LoadTorusMesh();
+
+	DefineSceneObjects();
 }
 void SceneManager::LoadSceneTextures()
 {
-	m_textureWood = LoadTexture("textures/wood_seamless.jpeg");
-	m_textureMouseBody = LoadTexture("textures/grey_mouse_body.jpeg");
-	m_textureMouseButtons = LoadTexture("textures/dark_mouse_buttons.jpeg");
+	GLuint* handles[] = {
+		&m_textureWood,
+		&m_textureMouseBody,
+		&m_textureMouseButtons
+	};
+
+	// only the coarse mips are uploaded here; the finer ones stream
+	// in once objects using the texture come close to the camera
+	GLuint textures[g_SceneTextureCount];
+	m_textureStreamer = std::make_unique<TextureStreamer>();
+	m_textureStreamer->LoadTextures(g_SceneTextureFiles, g_SceneTextureCount, textures, m_pJobSystem);
+	for (size_t i = 0; i < g_SceneTextureCount; ++i)
+	{
+		*handles[i] = textures[i];
+	}
+}
+
+/***********************************************************
+ *  GetTextureStreamingStats()
+ *
+ *  This method is used for reporting how much of the scene
+ *  textures is resident.
+ ***********************************************************/
+TextureStreamingStats SceneManager::GetTextureStreamingStats() const
+{
+	return m_textureStreamer ? m_textureStreamer->GetStats() : TextureStreamingStats();
 }
 
 
 /***********************************************************
- *  RenderScene()
+ *  AddSceneObject()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for placing a basic mesh in the scene.
+ *  A texture ID of 0 draws the mesh with the passed in color.
  ***********************************************************/
- // RenderScene() - 7-1 Final Project Milestone 5
+PoolHandle SceneManager::AddSceneObject(
+	MeshType mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	GLuint textureID,
+	glm::vec4 color)
+{
+	m_sceneVersion++;
+	m_objectVersion++;
+	SCENE_OBJECT object = MakeSceneObject(mesh, scaleXYZ,
+		XrotationDegrees, YrotationDegrees, ZrotationDegrees,
+		positionXYZ, textureID, color);
+	object.group = m_openGroup;
+	const PoolHandle handle = m_sceneObjects.Create(object);
+	if (m_openGroup != kNoGroup)
+	{
+		m_objectGroups[m_openGroup].objects.push_back(handle);
+	}
+	return handle;
+}
 
-// RenderScene() - 7-1 Final Project Milestone 5
+/***********************************************************
+ *  RemoveSceneObject()
+ *
+ *  This method is used for taking a placed mesh out of the
+ *  scene. The last object moves into its place, so object
+ *  indices in frame packets already built stay meaningful
+ *  only for the frame they were built in.
+ ***********************************************************/
+bool SceneManager::RemoveSceneObject(PoolHandle object)
+{
+	// a group missing an object no longer looks like its impostor; the
+	// streamer removes objects on the simulation thread, so the texture
+	// is only deleted with the groups
+	const SCENE_OBJECT* pObject = m_sceneObjects.Get(object);
+	if ((pObject != nullptr) && (pObject->group != kNoGroup))
+	{
+		m_objectGroups[pObject->group].bImpostorValid = false;
+	}
+	if (!m_sceneObjects.Destroy(object))
+	{
+		return false;
+	}
+	m_sceneVersion++;
+	m_objectVersion++;
+	return true;
+}
+
+/***********************************************************
+ *  AddPointLight()
+ *
+ *  This method is used for adding a point light. Only the
+ *  first lights up to the shader's array size are drawn.
+ ***********************************************************/
+PoolHandle SceneManager::AddPointLight(const LightData& light)
+{
+	m_lightVersion++;
+	m_sceneVersion++;
+	return m_pointLights.Create(light);
+}
 
-void SceneManager::RenderScene()
+/***********************************************************
+ *  UpdatePointLight()
+ *
+ *  This method is used for changing the values of a point
+ *  light added earlier.
+ ***********************************************************/
+bool SceneManager::UpdatePointLight(PoolHandle light, const LightData& values)
+{
+	LightData* pLight = m_pointLights.Get(light);
+	if (pLight == NULL)
+	{
+		return false;
+	}
+	*pLight = values;
+	m_lightVersion++;
+	m_sceneVersion++;
+	return true;
+}
+
+/***********************************************************
+ *  RemovePointLight()
+ *
+ *  This method is used for removing a point light.
+ ***********************************************************/
+bool SceneManager::RemovePointLight(PoolHandle light)
+{
+	if (!m_pointLights.Destroy(light))
+	{
+		return false;
+	}
+	m_lightVersion++;
+	m_sceneVersion++;
+	return true;
+}
+
+/***********************************************************
+ *  LoadGeneratedScene()
+ *
+ *  This method is used for replacing the hand-placed scene
+ *  with a generated one. The generated texture indices map
+ *  onto the loaded scene textures; without textures (such as
+ *  in headless runs) every object uses its color. Large
+ *  scenes compose their matrices on the job system. The
+ *  impostors of the replaced object groups are deleted, so
+ *  this runs on the GL thread while no packet is in flight.
+ ***********************************************************/
+void SceneManager::LoadGeneratedScene(const GeneratedScene& scene)
 {
-	glm::vec3 scale, position;
-	float rotX = 0.0f, rotY = 0.0f, rotZ = 0.0f;
+	ClearObjectGroups();
+	const uint32_t textures[] = { m_textureWood, m_textureMouseBody, m_textureMouseButtons };
+	ComposeGeneratedScene(scene, textures, sizeof(textures) / sizeof(textures[0]),
+		m_sceneObjects, m_pJobSystem);
+
+	if (!scene.lights.empty())
+	{
+		m_pointLights.Clear();
+		for (const LightData& light : scene.lights)
+		{
+			m_pointLights.Create(light);
+		}
+		m_lightVersion++;
+	}
+	m_sceneVersion++;
+	m_objectVersion++;
+}
+
+/***********************************************************
+ *  AddGeneratedObject()
+ *
+ *  This method is used for placing a single generated object,
+ *  such as one of a streamed cell.
+ ***********************************************************/
+PoolHandle SceneManager::AddGeneratedObject(const GeneratedObject& object)
+{
+	return AddSceneObject(object.mesh, object.scale,
+		object.rotation.x, object.rotation.y, object.rotation.z,
+		object.position, GetGeneratedTextureID(object.textureIndex), object.color);
+}
+
+/***********************************************************
+ *  GetGeneratedTextureID()
+ *
+ *  This method is used for mapping the texture index of a
+ *  generated object onto the loaded scene textures. Index 0
+ *  means the object is colored.
+ ***********************************************************/
+GLuint SceneManager::GetGeneratedTextureID(uint8_t textureIndex) const
+{
+	const uint32_t textures[] = { m_textureWood, m_textureMouseBody, m_textureMouseButtons };
+	return MapGeneratedTexture(textureIndex, textures, sizeof(textures) / sizeof(textures[0]));
+}
+
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  This method is used for placing the basic 3D shapes that
+ *  make up the scene. Nothing is drawn here - RenderScene()
+ *  draws the objects that are visible each frame.
+ ***********************************************************/
+ // DefineSceneObjects() - 7-1 Final Project Milestone 5
+void SceneManager::DefineSceneObjects()
+{
+	const glm::vec4 noColor(1.0f);
+	m_sceneObjects.Clear();
+	ClearObjectGroups();
 
 	// === Desk Plane (Textured Wood) ===
-	scale = glm::vec3(20.0f, 1.0f, 10.0f);
-	position = glm::vec3(0.0f);
-	SetTransformations(scale, 0.0f, 0.0f, 0.0f, position);
-	m_pShaderManager->setBoolValue("bUseTexture", true);
-	glBindTexture(GL_TEXTURE_2D, m_textureWood);
-	m_basicMeshes->DrawPlaneMesh();
+	AddSceneObject(MeshType::Plane, glm::vec3(20.0f, 1.0f, 10.0f),
+		0.0f, 0.0f, 0.0f, glm::vec3(0.0f), m_textureWood, noColor);
 
 	// === Mouse Body (Textured Sphere) ===
-	scale = glm::vec3(0.9f, 0.5f, 1.3f);
-	position = glm::vec3(-2.0f, 0.5f, 0.0f);
-	SetTransformations(scale, 0.0f, 0.0f, -15.0f, position);
-	m_pShaderManager->setBoolValue("bUseTexture", true);
-	glBindTexture(GL_TEXTURE_2D, m_textureMouseBody);
-	m_basicMeshes->DrawSphereMesh();
+	BeginObjectGroup("mouse");
+	AddSceneObject(MeshType::Sphere, glm::vec3(0.9f, 0.5f, 1.3f),
+		0.0f, 0.0f, -15.0f, glm::vec3(-2.0f, 0.5f, 0.0f), m_textureMouseBody, noColor);
 
 	// === Mouse Buttons (Tapered Cylinders) ===
-	m_pShaderManager->setBoolValue("bUseTexture", true);
-	glBindTexture(GL_TEXTURE_2D, m_textureMouseButtons);
 	for (int i = 0; i < 2; i++) {
-		scale = glm::vec3(0.2f, 0.05f, 0.2f);
-		position = glm::vec3(-2.0f + 0.1f * i, 0.65f, 0.2f);
-		SetTransformations(scale, 90.0f, 0.0f, 0.0f, position);
-		m_basicMeshes->DrawTaperedCylinderMesh();
+		AddSceneObject(MeshType::TaperedCylinder, glm::vec3(0.2f, 0.05f, 0.2f),
+			90.0f, 0.0f, 0.0f, glm::vec3(-2.0f + 0.1f * i, 0.65f, 0.2f),
+			m_textureMouseButtons, noColor);
 	}
+	EndObjectGroup();
 
 	// === Keyboard (Box) ===
-	scale = glm::vec3(3.0f, 0.3f, 1.5f);
-	position = glm::vec3(1.0f, 0.15f, 0.0f);
-	SetTransformations(scale, 0.0f, 0.0f, 0.0f, position);
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-	SetShaderColor(0.9f, 0.9f, 0.9f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
+	AddSceneObject(MeshType::Box, glm::vec3(3.0f, 0.3f, 1.5f),
+		0.0f, 0.0f, 0.0f, glm::vec3(1.0f, 0.15f, 0.0f),
+		0, glm::vec4(0.9f, 0.9f, 0.9f, 1.0f));
 
 	// === Cloud Wrist Rest (Overlapping White Spheres) ===
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
+	BeginObjectGroup("wrist_rest");
 	for (int i = 0; i < 3; i++) {
-		scale = glm::vec3(0.6f);
-		position = glm::vec3(-0.5f + i * 0.6f, 0.35f, -0.6f);
-		SetTransformations(scale, 0.0f, 0.0f, 0.0f, position);
-		m_basicMeshes->DrawSphereMesh();
+		AddSceneObject(MeshType::Sphere, glm::vec3(0.6f),
+			0.0f, 0.0f, 0.0f, glm::vec3(-0.5f + i * 0.6f, 0.35f, -0.6f),
+			0, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 	}
+	EndObjectGroup();
 
 	// === Glasses (Torus + Cylinders) ===
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-	SetShaderColor(0.1f, 0.1f, 0.1f, 1.0f);
+	BeginObjectGroup("glasses");
 	for (int i = 0; i < 2; i++) {
-		scale = glm::vec3(0.3f);
-		position = glm::vec3(-0.5f + i * 0.8f, 0.5f, 1.0f);
-		SetTransformations(scale, 90.0f, 0.0f, 0.0f, position);
-		m_basicMeshes->DrawTorusMesh();
+		AddSceneObject(MeshType::Torus, glm::vec3(0.3f),
+			90.0f, 0.0f, 0.0f, glm::vec3(-0.5f + i * 0.8f, 0.5f, 1.0f),
+			0, glm::vec4(0.1f, 0.1f, 0.1f, 1.0f));
 	}
 
 	// Glasses arm (bridge)
-	scale = glm::vec3(0.8f, 0.05f, 0.05f);
-	position = glm::vec3(-0.1f, 0.5f, 1.0f);
-	SetTransformations(scale, 0.0f, 0.0f, 0.0f, position);
-	m_basicMeshes->DrawBoxMesh();
+	AddSceneObject(MeshType::Box, glm::vec3(0.8f, 0.05f, 0.05f),
+		0.0f, 0.0f, 0.0f, glm::vec3(-0.1f, 0.5f, 1.0f),
+		0, glm::vec4(0.1f, 0.1f, 0.1f, 1.0f));
+	EndObjectGroup();
+}
+
+/***********************************************************
+ *  BeginObjectGroup()
+ *
+ *  This method is used for starting a composite object: the
+ *  objects added until EndObjectGroup() belong to it.
+ ***********************************************************/
+void SceneManager::BeginObjectGroup(const char* name)
+{
+	OBJECT_GROUP group;
+	group.name = name;
+	group.boundsCenter = glm::vec3(0.0f);
+	group.boundsRadius = 0.0f;
+	group.impostorTexture = 0;
+	group.bImpostorValid = true;
+	m_openGroup = static_cast<uint16_t>(m_objectGroups.size());
+	m_objectGroups.push_back(group);
+}
+
+/***********************************************************
+ *  EndObjectGroup()
+ *
+ *  This method is used for finishing a composite object. Its
+ *  bounding sphere is centered on the box around its objects'
+ *  spheres and encloses all of them.
+ ***********************************************************/
+void SceneManager::EndObjectGroup()
+{
+	OBJECT_GROUP& group = m_objectGroups[m_openGroup];
+	m_openGroup = kNoGroup;
+
+	glm::vec3 low(FLT_MAX);
+	glm::vec3 high(-FLT_MAX);
+	for (PoolHandle handle : group.objects)
+	{
+		const SCENE_OBJECT& object = *m_sceneObjects.Get(handle);
+		low = glm::min(low, object.boundsCenter - glm::vec3(object.boundsRadius));
+		high = glm::max(high, object.boundsCenter + glm::vec3(object.boundsRadius));
+	}
+	group.boundsCenter = (low + high) * 0.5f;
+	group.boundsRadius = 0.0f;
+	for (PoolHandle handle : group.objects)
+	{
+		const SCENE_OBJECT& object = *m_sceneObjects.Get(handle);
+		group.boundsRadius = glm::max(group.boundsRadius,
+			glm::length(object.boundsCenter - group.boundsCenter) + object.boundsRadius);
+	}
+}
+
+/***********************************************************
+ *  ClearObjectGroups()
+ *
+ *  This method is used for dropping the composite objects
+ *  when the objects they were made of are replaced. Their
+ *  impostor textures are deleted with them, so reloading a
+ *  scene does not leave the old atlases behind.
+ ***********************************************************/
+void SceneManager::ClearObjectGroups()
+{
+	if (m_impostorRenderer)
+	{
+		for (const OBJECT_GROUP& group : m_objectGroups)
+		{
+			if (group.impostorTexture != 0)
+			{
+				m_impostorRenderer->DeleteTexture(group.impostorTexture);
+			}
+		}
+	}
+	m_objectGroups.clear();
+	m_openGroup = kNoGroup;
+}
+
+/***********************************************************
+ *  BuildFramePacket()
+ *
+ *  This method is used for filling a frame packet. The scene
+ *  culler records a sorted render command for each visible
+ *  object, small object groups are swapped for impostors,
+ *  and the lights and texture demand of the frame are added.
+ *  No OpenGL calls are made, so the frame pipeline runs this
+ *  on the simulation thread.
+ ***********************************************************/
+void SceneManager::BuildFramePacket(const FrameView& view, FramePacket& packet)
+{
+	AllocationScope allocationScope("BuildFramePacket");
+	m_buildArena.BeginFrame();
+
+	m_sceneCuller.Cull(view, m_sceneObjects, m_objectVersion, packet);
+	// the ID pass draws the commands only, so a frame that picks on
+	// the GPU keeps the objects of every group to be hit
+	const bool bGpuPick = view.bPickRequested && m_gpuPicker;
+	if (bGpuPick)
+	{
+		packet.impostors.clear();
+		packet.impostorObjects = 0;
+	}
+	else
+	{
+		SubstituteImpostors(view, packet);
+	}
+
+	// handles rather than indices, as streamed cells may move objects
+	// before the GL thread reads the pick back
+	packet.pickObjects.clear();
+	if (bGpuPick)
+	{
+		packet.pickObjects.reserve(packet.commands.size());
+		for (const RenderCommand& command : packet.commands)
+		{
+			packet.pickObjects.push_back(m_sceneObjects.HandleAt(command.item.objectIndex));
+		}
+	}
+
+	packet.lights.assign(m_pointLights.begin(), m_pointLights.end());
+	packet.lightVersion = m_lightVersion;
+
+	// largest on-screen size of each texture, from the bounding sphere
+	// of the visible objects; the texture streamer picks mips by it
+	packet.textureDemand.clear();
+	const float projectionScale = view.projection[1][1];
+	for (const RenderCommand& command : packet.commands)
+	{
+		const DrawItem& item = command.item;
+		if (!item.bUseTexture)
+		{
+			continue;
+		}
+		const SCENE_OBJECT& object = m_sceneObjects[item.objectIndex];
+		float screenSize = object.boundsRadius * projectionScale * glm::max(item.uvScale.x, item.uvScale.y);
+		if (!view.bOrthographic)
+		{
+			const float viewDepth = -(view.view * glm::vec4(object.boundsCenter, 1.0f)).z;
+			screenSize /= glm::max(viewDepth, object.boundsRadius);
+		}
+
+		bool bFound = false;
+		for (TextureDemand& demand : packet.textureDemand)
+		{
+			if (demand.textureID == item.textureID)
+			{
+				demand.screenSize = glm::max(demand.screenSize, screenSize);
+				bFound = true;
+				break;
+			}
+		}
+		if (!bFound)
+		{
+			packet.textureDemand.push_back({ item.textureID, screenSize });
+		}
+	}
+}
+
+/***********************************************************
+ *  SetOcclusionCulling()
+ *
+ *  This method is used for turning the occlusion test of
+ *  BuildFramePacket() on or off.
+ ***********************************************************/
+void SceneManager::SetOcclusionCulling(bool bEnabled, const OcclusionConfig& config)
+{
+	m_sceneCuller.SetOcclusionCulling(bEnabled, config);
+}
+
+/***********************************************************
+ *  SetVisibilityCache()
+ *
+ *  This method is used for turning the reuse of the last
+ *  culled frame on or off, and for setting how far the camera
+ *  may move before the scene is culled again.
+ ***********************************************************/
+void SceneManager::SetVisibilityCache(bool bEnabled, const VisibilityCacheConfig& config)
+{
+	m_sceneCuller.SetVisibilityCache(bEnabled, config);
+}
+
+/***********************************************************
+ *  SubstituteImpostors()
+ *
+ *  This method is used for drawing the object groups that
+ *  are small on screen as their impostors. The visible
+ *  commands of such a group are removed, keeping the others
+ *  in order, and a quad is added for every group that had
+ *  any: the culling already done on its objects decides
+ *  whether the group is seen.
+ ***********************************************************/
+void SceneManager::SubstituteImpostors(const FrameView& view, FramePacket& packet)
+{
+	packet.impostors.clear();
+	packet.impostorObjects = 0;
+	if (!m_impostorRenderer || m_objectGroups.empty())
+	{
+		return;
+	}
+
+	// 0 drawn as objects, 1 replaced, 2 replaced and in view
+	const float projectionScale = view.projection[1][1];
+	bool bAnyReplaced = false;
+	m_impostorStates.assign(m_objectGroups.size(), 0);
+	for (size_t i = 0; i < m_objectGroups.size(); ++i)
+	{
+		const OBJECT_GROUP& group = m_objectGroups[i];
+		if ((group.impostorTexture == 0) || !group.bImpostorValid)
+		{
+			continue;
+		}
+		float screenSize = group.boundsRadius * projectionScale;
+		if (!view.bOrthographic)
+		{
+			const float viewDepth = -(view.view * glm::vec4(group.boundsCenter, 1.0f)).z;
+			screenSize /= glm::max(viewDepth, group.boundsRadius);
+		}
+		if (screenSize < m_impostorConfig.maxScreenSize)
+		{
+			m_impostorStates[i] = 1;
+			bAnyReplaced = true;
+		}
+	}
+	if (!bAnyReplaced)
+	{
+		return;
+	}
+
+	const uint32_t commandCount = static_cast<uint32_t>(packet.commands.size());
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < commandCount; ++i)
+	{
+		const uint16_t group = m_sceneObjects[packet.commands[i].item.objectIndex].group;
+		if ((group != kNoGroup) && (m_impostorStates[group] != 0))
+		{
+			m_impostorStates[group] = 2;
+			continue;
+		}
+		packet.commands[kept++] = packet.commands[i];
+	}
+	packet.impostorObjects = commandCount - kept;
+	packet.commands.resize(kept);
+
+	// an orthographic camera sees every group from the same direction
+	const glm::vec3 backward(view.view[0][2], view.view[1][2], view.view[2][2]);
+	for (size_t i = 0; i < m_objectGroups.size(); ++i)
+	{
+		if (m_impostorStates[i] != 2)
+		{
+			continue;
+		}
+		const OBJECT_GROUP& group = m_objectGroups[i];
+		const glm::vec3 direction = view.bOrthographic ? backward :
+			glm::normalize(view.position - group.boundsCenter);
+		packet.impostors.push_back(ImpostorRenderer::MakeDraw(m_impostorConfig.gridSize,
+			group.boundsCenter, group.boundsRadius, direction, group.impostorTexture));
+	}
 }
 
+/***********************************************************
+ *  PickObject()
+ *
+ *  This method is used for finding the scene object under a
+ *  point of the viewport by casting a ray against the objects'
+ *  meshes. The picking tree is only rebuilt when the objects
+ *  have changed since the last pick, so repeated picks cost
+ *  microseconds even for large scenes.
+ ***********************************************************/
+bool SceneManager::PickObject(const FrameView& view, const glm::vec2& point, PICK_RESULT& result)
+{
+	const uint32_t version = m_objectVersion;
+	const uint32_t objectCount = static_cast<uint32_t>(m_sceneObjects.Size());
+	if (!m_bPickerValid || (version != m_pickerVersion) || (m_picker.GetObjectCount() != objectCount))
+	{
+		m_picker.Reset(objectCount);
+		auto setObjects = [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				m_picker.SetObject(i, m_sceneObjects[i].mesh, m_sceneObjects[i].model);
+			}
+		};
+		if (m_pJobSystem != NULL)
+		{
+			m_pJobSystem->ParallelFor(objectCount, 4096, setObjects);
+		}
+		else
+		{
+			setObjects(0, objectCount);
+		}
+		m_picker.Build();
+		m_pickerVersion = version;
+		m_bPickerValid = true;
+	}
+
+	PickHit hit;
+	if (!m_picker.Cast(MakePickRay(view, point), hit))
+	{
+		return false;
+	}
+	result.object = m_sceneObjects.HandleAt(hit.objectIndex);
+	result.distance = hit.distance;
+	result.position = hit.position;
+	return true;
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing one of the basic meshes.
+ ***********************************************************/
+void SceneManager::DrawMesh(MeshType mesh)
+{
+	switch (mesh)
+	{
+	case MeshType::Plane:           m_basicMeshes->DrawPlaneMesh(); break;
+	case MeshType::Box:             m_basicMeshes->DrawBoxMesh(); break;
+	case MeshType::Sphere:          m_basicMeshes->DrawSphereMesh(); break;
+	case MeshType::Cylinder:        m_basicMeshes->DrawCylinderMesh(); break;
+	case MeshType::TaperedCylinder: m_basicMeshes->DrawTaperedCylinderMesh(); break;
+	case MeshType::Cone:            m_basicMeshes->DrawConeMesh(); break;
+	case MeshType::Torus:           m_basicMeshes->DrawTorusMesh(); break;
+	default: break;
+	}
+}
+
+/***********************************************************
+ *  ExecuteFramePacket()
+ *
+ *  This method is used for issuing the OpenGL draw calls
+ *  recorded in a frame packet. It must run on the thread
+ *  that owns the GL context.
+ ***********************************************************/
+void SceneManager::ExecuteFramePacket(const FramePacket& packet)
+{
+	AllocationScope allocationScope("ExecuteFramePacket");
+	m_submitArena.BeginFrame();
+	// a newly bound program holds none of the uploaded light values
+	const bool bProgramChanged = ResolveDrawUniforms();
+	if (bProgramChanged || (packet.lightVersion != m_uploadedLightVersion))
+	{
+		UploadLights(packet);
+	}
+
+	// mips stream on the thread owning the context; a changed mip
+	// changes the image, so idle rendering draws again
+	if (m_textureStreamer)
+	{
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		if (m_textureStreamer->Update(packet, viewport[3]))
+		{
+			m_redrawVersion++;
+		}
+	}
+
+	// the commands arrive grouped by texture, so only bind when it changes;
+	// the uniforms are set through the cached locations, since a setter
+	// call by name costs a lookup on every draw
+	GLuint boundTexture = 0;
+	for (const RenderCommand& command : packet.commands)
+	{
+		SubmitDrawItem(command.item, boundTexture);
+	}
+	if (m_impostorRenderer && !packet.impostors.empty())
+	{
+		m_impostorRenderer->Draw(packet.view, packet.impostors);
+	}
+
+	// a request made while a readback is still in flight is dropped
+	if (packet.view.bPickRequested && m_gpuPicker && !m_gpuPicker->IsPending())
+	{
+		RenderPickPass(packet);
+	}
+}
+
+/***********************************************************
+ *  SubmitDrawItem()
+ *
+ *  This method is used for drawing one item with the scene
+ *  program, binding its texture only if it differs from the
+ *  one bound by the previous item.
+ ***********************************************************/
+void SceneManager::SubmitDrawItem(const DrawItem& item, GLuint& boundTexture)
+{
+	glUniformMatrix4fv(m_drawUniforms.model, 1, GL_FALSE, &item.model[0][0]);
+	if (item.bUseTexture)
+	{
+		glUniform1i(m_drawUniforms.useTexture, 1);
+		if (item.textureID != boundTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, item.textureID);
+			boundTexture = item.textureID;
+		}
+	}
+	else
+	{
+		glUniform1i(m_drawUniforms.useTexture, 0);
+		glUniform4fv(m_drawUniforms.objectColor, 1, &item.color[0]);
+	}
+	DrawMesh(item.mesh);
+}
+
+/***********************************************************
+ *  EnableImpostors()
+ *
+ *  This method is used for creating the impostor renderer
+ *  and the atlas of every object group. An atlas is read
+ *  from the cache when its hash still matches the group,
+ *  lights and bake settings; otherwise the group is baked
+ *  with the scene program and the cache file rewritten.
+ *  Returns false, drawing every group as its objects, if
+ *  the impostor shader cannot be created.
+ ***********************************************************/
+bool SceneManager::EnableImpostors(const char* vertexShaderPath, const char* fragmentShaderPath,
+	const ImpostorConfig& config)
+{
+	if ((m_pShaderManager == NULL) || (m_basicMeshes == NULL))
+	{
+		return false;
+	}
+	m_impostorRenderer = std::make_unique<ImpostorRenderer>();
+	if (!m_impostorRenderer->Initialize(vertexShaderPath, fragmentShaderPath))
+	{
+		m_impostorRenderer.reset();
+		return false;
+	}
+	m_impostorConfig = config;
+
+	// the bakes draw with the scene program and its current lights
+	ResolveDrawUniforms();
+	m_submitArena.BeginFrame();
+	FramePacket lights;
+	lights.lights.assign(m_pointLights.begin(), m_pointLights.end());
+	lights.lightVersion = m_lightVersion;
+	UploadLights(lights);
+
+	for (OBJECT_GROUP& group : m_objectGroups)
+	{
+		const std::string path = g_ImpostorCacheFolder + group.name + ".imp";
+		ImpostorImage image;
+		const uint64_t hash = HashObjectGroup(group);
+		if (!ImpostorRenderer::LoadImage(path, hash, config.gridSize, config.cellSize, image))
+		{
+			auto drawGroup = [&](const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eye)
+			{
+				m_pShaderManager->setMat4Value("view", view);
+				m_pShaderManager->setMat4Value("projection", projection);
+				m_pShaderManager->setVec3Value("viewPosition", eye);
+				GLuint boundTexture = 0;
+				for (PoolHandle handle : group.objects)
+				{
+					const SCENE_OBJECT* pObject = m_sceneObjects.Get(handle);
+					if (pObject == nullptr)
+					{
+						continue;
+					}
+					DrawItem item;
+					item.model = pObject->model;
+					item.color = pObject->color;
+					item.textureID = pObject->textureID;
+					item.mesh = pObject->mesh;
+					item.bUseTexture = pObject->bUseTexture;
+					SubmitDrawItem(item, boundTexture);
+				}
+			};
+			if (!m_impostorRenderer->Bake(group.boundsCenter, group.boundsRadius,
+				config.gridSize, config.cellSize, drawGroup, image))
+			{
+				continue;
+			}
+			image.sourceHash = hash;
+			ImpostorRenderer::SaveImage(path, image);
+		}
+		group.impostorTexture = m_impostorRenderer->CreateTexture(image);
+	}
+	m_sceneVersion++;
+	return true;
+}
+
+/***********************************************************
+ *  HashObjectGroup()
+ *
+ *  This method is used for identifying what a group's
+ *  impostor shows: its objects, named by their texture files
+ *  rather than GL IDs, the point lights and the bake
+ *  settings.
+ ***********************************************************/
+uint64_t SceneManager::HashObjectGroup(const OBJECT_GROUP& group) const
+{
+	const GLuint textures[] = { m_textureWood, m_textureMouseBody, m_textureMouseButtons };
+	uint64_t hash = 14695981039346656037ull;
+	hash = HashBytes(hash, &m_impostorConfig.gridSize, sizeof(m_impostorConfig.gridSize));
+	hash = HashBytes(hash, &m_impostorConfig.cellSize, sizeof(m_impostorConfig.cellSize));
+	for (PoolHandle handle : group.objects)
+	{
+		const SCENE_OBJECT* pObject = m_sceneObjects.Get(handle);
+		if (pObject == nullptr)
+		{
+			continue;
+		}
+		hash = HashBytes(hash, &pObject->mesh, sizeof(pObject->mesh));
+		hash = HashBytes(hash, &pObject->model[0][0], sizeof(float) * 16);
+		hash = HashBytes(hash, &pObject->color[0], sizeof(float) * 4);
+		for (size_t i = 0; i < g_SceneTextureCount; ++i)
+		{
+			if (pObject->bUseTexture && (pObject->textureID == textures[i]))
+			{
+				hash = HashBytes(hash, g_SceneTextureFiles[i], std::strlen(g_SceneTextureFiles[i]));
+			}
+		}
+	}
+	for (const LightData& light : m_pointLights)
+	{
+		const uint8_t bActive = light.bActive ? 1 : 0;
+		hash = HashBytes(hash, &bActive, sizeof(bActive));
+		if (light.bActive)
+		{
+			hash = HashBytes(hash, &light.position[0], sizeof(float) * 3);
+			hash = HashBytes(hash, &light.ambient[0], sizeof(float) * 3);
+			hash = HashBytes(hash, &light.diffuse[0], sizeof(float) * 3);
+			hash = HashBytes(hash, &light.specular[0], sizeof(float) * 3);
+		}
+	}
+	return hash;
+}
+
+/***********************************************************
+ *  EnableGpuPicking()
+ *
+ *  This method is used for creating the ID buffer picker.
+ *  Returns false, leaving picking on the CPU, if its shader
+ *  or render target cannot be created.
+ ***********************************************************/
+bool SceneManager::EnableGpuPicking(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	m_gpuPicker = std::make_unique<GpuPicker>();
+	if (!m_gpuPicker->Initialize(vertexShaderPath, fragmentShaderPath))
+	{
+		m_gpuPicker.reset();
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  RenderPickPass()
+ *
+ *  This method is used for drawing the commands of a packet
+ *  once more with the ID of each, its command index plus one,
+ *  into the picker's target. The pass reuses the sorted draw
+ *  list, so it costs one extra draw per visible object.
+ ***********************************************************/
+void SceneManager::RenderPickPass(const FramePacket& packet)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_gpuPickObjects.assign(packet.pickObjects.begin(), packet.pickObjects.end());
+
+	m_gpuPicker->BeginPass(packet.view, packet.view.pickPoint, viewport[2], viewport[3]);
+	const uint32_t commandCount = static_cast<uint32_t>(
+		std::min(packet.commands.size(), m_gpuPickObjects.size()));
+	for (uint32_t i = 0; i < commandCount; ++i)
+	{
+		const DrawItem& item = packet.commands[i].item;
+		m_gpuPicker->SetObject(item.model, i + 1);
+		DrawMesh(item.mesh);
+	}
+	m_gpuPicker->EndPass();
+}
+
+/***********************************************************
+ *  TakeGpuPick()
+ *
+ *  This method is used for polling the pick in flight. It
+ *  returns true once, when the readback has arrived.
+ ***********************************************************/
+bool SceneManager::TakeGpuPick(PICK_RESULT& result)
+{
+	uint32_t id = 0;
+	if (!m_gpuPicker || !m_gpuPicker->TryGetResult(id, result.position, result.distance))
+	{
+		return false;
+	}
+	result.object = ((id > 0) && (id <= m_gpuPickObjects.size())) ? m_gpuPickObjects[id - 1] : PoolHandle();
+	return true;
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene without
+ *  the frame pipeline - both stages run on this thread.
+ ***********************************************************/
+void SceneManager::RenderScene(const FrameView& view)
+{
+	m_localPacket->view = view;
+	BuildFramePacket(view, *m_localPacket);
+	ExecuteFramePacket(*m_localPacket);
+}
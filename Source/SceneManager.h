@@ -11,10 +11,27 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "RenderTypes.h"
+#include "CommandRecorder.h"
+#include "FrameArena.h"
+#include "SceneLookup.h"
+#include "ObjectPool.h"
+#include "TextureStreaming.h"
+#include "ScenePicking.h"
+#include "GpuPicking.h"
+#include "SceneCulling.h"
+#include "ImpostorRendering.h"
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
+class JobSystem;
+struct FramePacket;
+struct GeneratedScene;
+struct GeneratedObject;
+
 /***********************************************************
  *  SceneManager
  *
@@ -25,55 +42,184 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(ShaderManager *pShaderManager, JobSystem* pJobSystem = nullptr);
 	// destructor
 	~SceneManager();
 
-	struct TEXTURE_INFO
-	{
-		std::string tag;
-		uint32_t ID;
-	};
+	// defined with the GL-free lookups in SceneLookup.h
+	using TEXTURE_INFO = TextureSlot;
+	using OBJECT_MATERIAL = ObjectMaterial;
+	// defined with the GL-free culling in SceneCulling.h
+	using SCENE_OBJECT = SceneObject;
+	static const uint16_t kNoGroup = kNoObjectGroup;
 
-	struct OBJECT_MATERIAL
+	// image pixels decoded by stb_image, not yet uploaded to OpenGL
+	struct DECODED_IMAGE
 	{
-		glm::vec3 diffuseColor;
-		glm::vec3 specularColor;
-		float shininess;
-		std::string tag;
+		unsigned char* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
 	};
 
+	// decoding touches no GL state, so it may run on any thread
+	static bool DecodeImage(const char* filepath, DECODED_IMAGE& image);
+	// release pixels that will not be uploaded
+	static void FreeImage(DECODED_IMAGE& image);
+
 private:
 	// === Texture Handles ===
 	GLuint m_textureWood;
 	GLuint m_textureMouseBody;
 	GLuint m_textureMouseButtons;
+	// streams the mips of the scene textures; made by LoadSceneTextures()
+	std::unique_ptr<TextureStreamer> m_textureStreamer;
 
 	// === Texture Loading ===
 	GLuint LoadTexture(const char* filepath);
+	// upload must happen on the thread owning the GL context; frees the pixels
+	static GLuint UploadTexture(DECODED_IMAGE& image);
+	// load the pixels into the bound texture and build its mipmaps; frees them
+	static void SpecifyTextureImage(DECODED_IMAGE& image);
+	bool loadTextureFromFile(const std::string& filePath,
+		GLuint& outTex,
+		bool flipVertically);
 
 	
 	ShaderManager* m_pShaderManager;
 	ShapeMeshes* m_basicMeshes;
+	JobSystem* m_pJobSystem;
 
 	// total number of loaded textures
-	int m_loadedTextures;
+	int m_loadedTextures = 0;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// textures created through CreateGLTexture(); searched by ID, as
+	// there are only ever a handful
+	struct TAGGED_TEXTURE
+	{
+		StringId tag;
+		GLuint ID;
+	};
+	ObjectPool<TAGGED_TEXTURE> m_textures;
+	// every mesh placed by DefineSceneObjects() or a generated scene
+	ObjectPool<SCENE_OBJECT> m_sceneObjects;
+	// point lights uploaded to the shader when the version changes
+	ObjectPool<LightData> m_pointLights;
+	uint32_t m_lightVersion = 0;
+	uint32_t m_uploadedLightVersion = 0;
+	// bumped whenever objects or lights change; atomic because the
+	// scene streamer changes objects on the simulation thread
+	std::atomic<uint32_t> m_sceneVersion{ 0 };
+	// bumped only when objects are added, removed or reloaded; the
+	// visibility cache and the picking tree are kept while it stays
+	// the same
+	uint32_t m_objectVersion = 0;
+	// bumped when a streamed mip lands, which changes the image but
+	// nothing the culling or picking look at; GL thread only
+	uint32_t m_redrawVersion = 0;
+	// packet used when RenderScene() is called without the pipeline
+	std::unique_ptr<FramePacket> m_localPacket;
+	// transient memory of BuildFramePacket(), on the simulation thread
+	FrameArena m_buildArena;
+	// transient memory of ExecuteFramePacket(), on the GL thread
+	FrameArena m_submitArena;
+	// frustum and occlusion culling of the objects into the draw list,
+	// with the reuse of the last culled frame's draws
+	SceneCuller m_sceneCuller;
+	// ray picking tree over the scene objects, rebuilt by the first
+	// PickObject() after the object version changes
+	ScenePicker m_picker;
+	uint32_t m_pickerVersion = 0;
+	bool m_bPickerValid = false;
+	// ID buffer picking, made by EnableGpuPicking(); the objects of the
+	// pass in flight, in the order of their IDs
+	std::unique_ptr<GpuPicker> m_gpuPicker;
+	std::vector<PoolHandle> m_gpuPickObjects;
+	// objects placed together as one composite, such as the mouse,
+	// which BuildFramePacket() replaces by a single impostor quad
+	// while they are small on screen
+	struct OBJECT_GROUP
+	{
+		std::string name;
+		std::vector<PoolHandle> objects;
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+		// 0 until the impostor is baked or loaded
+		GLuint impostorTexture;
+		// cleared once one of the objects is removed, as the impostor
+		// no longer looks like the group
+		bool bImpostorValid;
+	};
+	std::vector<OBJECT_GROUP> m_objectGroups;
+	// group new objects are added to, between BeginObjectGroup() and
+	// EndObjectGroup()
+	uint16_t m_openGroup = kNoGroup;
+	// made by EnableImpostors(); bakes and draws the impostors
+	std::unique_ptr<ImpostorRenderer> m_impostorRenderer;
+	ImpostorConfig m_impostorConfig;
+	// per group while building a packet; kept to reuse its memory
+	std::vector<uint8_t> m_impostorStates;
+
+	// uniform locations set for every draw, looked up once per program
+	struct DRAW_UNIFORMS
+	{
+		GLint program = 0;
+		GLint model = -1;
+		GLint useTexture = -1;
+		GLint objectColor = -1;
+	};
+	DRAW_UNIFORMS m_drawUniforms;
+
+	// add a textured or colored mesh to the scene object list
+	PoolHandle AddSceneObject(
+		MeshType mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		GLuint textureID,
+		glm::vec4 color);
+	// the scene texture a generated texture index maps onto
+	GLuint GetGeneratedTextureID(uint8_t textureIndex) const;
+	// draw one of the loaded basic meshes
+	void DrawMesh(MeshType mesh);
+	// set the per-draw uniforms of an item and draw its mesh
+	void SubmitDrawItem(const DrawItem& item, GLuint& boundTexture);
+	// upload the point lights of a frame packet
+	void UploadLights(const FramePacket& packet);
+	// set the lighting uniforms that do not travel with the packets
+	void UploadLightingConstants();
+	// refresh m_drawUniforms; returns true if the bound program changed
+	bool ResolveDrawUniforms();
+	// start and finish a group of the objects added in between
+	void BeginObjectGroup(const char* name);
+	void EndObjectGroup();
+	// drop every group, deleting their impostors; GL thread only
+	void ClearObjectGroups();
+	// replace the commands of small groups by their impostors
+	void SubstituteImpostors(const FrameView& view, FramePacket& packet);
+	// hash of everything a group's impostor is baked from
+	uint64_t HashObjectGroup(const OBJECT_GROUP& group) const;
+	// draw the commands of a packet into the GPU picker's ID target
+	void RenderPickPass(const FramePacket& packet);
 
 	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	bool CreateGLTexture(const std::string& tag,
+		const std::string& filePath,
+		bool flipVertically);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	GLuint FindTextureID(StringId tag) const;
+	int FindTextureSlot(StringId tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(StringId tag, OBJECT_MATERIAL& material);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -93,7 +239,7 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		StringId textureTag);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -101,16 +247,101 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		StringId materialTag);
 
 public:
 
+	// bind a texture created through CreateGLTexture()
+	bool BindTextureByTag(StringId tag, GLenum target) const;
+	bool TextureExists(StringId tag) const;
+	// delete a texture created through CreateGLTexture()
+	bool DeleteGLTexture(StringId tag);
+
+	// objects and lights added or removed at run time; stale handles
+	// are rejected and return false
+	bool RemoveSceneObject(PoolHandle object);
+	PoolHandle AddGeneratedObject(const GeneratedObject& object);
+	PoolHandle AddPointLight(const LightData& light);
+	bool UpdatePointLight(PoolHandle light, const LightData& values);
+	bool RemovePointLight(PoolHandle light);
+
+	// hot reload: the files LoadSceneTextures() reads, replacing the
+	// pixels of one of them in place, and restoring the uniforms the
+	// scene sets once after the shader program has been rebuilt
+	static size_t GetSceneTextureCount();
+	static const char* GetSceneTextureFile(size_t index);
+	bool ReplaceSceneTexture(const char* filepath, DECODED_IMAGE& image);
+	void OnShaderProgramChanged();
+
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void LoadSceneTextures();
 	void SetupSceneLights();
 	void DefineObjectMaterials();
-	void RenderScene();
+	void DefineSceneObjects();
+	// replace the scene objects and point lights with a generated scene;
+	// GL thread only, with the frame pipeline idle
+	void LoadGeneratedScene(const GeneratedScene& scene);
+	void RenderScene(const FrameView& view);
 	void PrepareScene();
 
+	// CPU stage: cull the scene against the view and fill the
+	// packet's draw list and lights; makes no GL calls
+	void BuildFramePacket(const FrameView& view, FramePacket& packet);
+	// GL stage: issue the draws recorded in a frame packet
+	void ExecuteFramePacket(const FramePacket& packet);
+	// occlusion culling on the CPU, on by default; set before the
+	// frame pipeline starts
+	void SetOcclusionCulling(bool bEnabled, const OcclusionConfig& config = OcclusionConfig());
+	bool IsOcclusionCulling() const { return m_sceneCuller.IsOcclusionCulling(); }
+	// reuse of the last frame's culling while the camera is still or
+	// moving slowly, on by default; set before the frame pipeline starts
+	void SetVisibilityCache(bool bEnabled, const VisibilityCacheConfig& config = VisibilityCacheConfig());
+	bool IsVisibilityCache() const { return m_sceneCuller.IsVisibilityCache(); }
+	VisibilityCacheStats GetVisibilityCacheStats() const { return m_sceneCuller.GetVisibilityCacheStats(); }
+
+	// the nearest object under a point of the viewport, given in
+	// normalized device coordinates; makes no GL calls and runs where
+	// the objects change, on the simulation thread
+	struct PICK_RESULT
+	{
+		PoolHandle object;
+		float distance;
+		glm::vec3 position;
+	};
+	bool PickObject(const FrameView& view, const glm::vec2& point, PICK_RESULT& result);
+
+	// pixel-exact picking through an ID buffer instead: frame packets
+	// whose view requests a pick are drawn once more with object IDs,
+	// and TakeGpuPick() returns true once the GPU has finished the
+	// readback, with a null object if the point hit the background.
+	// Enable before the frame pipeline starts; GL thread only.
+	bool EnableGpuPicking(const char* vertexShaderPath, const char* fragmentShaderPath);
+	bool IsGpuPicking() const { return m_gpuPicker != nullptr; }
+	bool IsGpuPickPending() const { return m_gpuPicker && m_gpuPicker->IsPending(); }
+	bool TakeGpuPick(PICK_RESULT& result);
+
+	// draw distant object groups as impostors: each group's atlas is
+	// read from impostors/<name>.imp, from a mounted package or a loose
+	// file, and baked and written there when missing or stale. Enable
+	// once the scene is loaded and before the frame pipeline starts,
+	// with the scene program bound; GL thread only.
+	bool EnableImpostors(const char* vertexShaderPath, const char* fragmentShaderPath,
+		const ImpostorConfig& config = ImpostorConfig());
+	bool IsImpostorRendering() const { return m_impostorRenderer != nullptr; }
+
+	// changes whenever the rendered result of a fixed view would change;
+	// call from the GL thread
+	uint32_t GetSceneVersion() const { return m_sceneVersion + m_redrawVersion; }
+	// the packet filled by the last RenderScene()
+	const FramePacket& GetLocalPacket() const { return *m_localPacket; }
+	// transient memory use of the build and submit stages
+	FrameArenaStats GetBuildArenaStats() const { return m_buildArena.GetStats(); }
+	FrameArenaStats GetSubmitArenaStats() const { return m_submitArena.GetStats(); }
+	// resident mips of the scene textures; call from the GL thread
+	TextureStreamingStats GetTextureStreamingStats() const;
+	// finer mips are on their way; only a rendered frame uploads
+	// them, so idle rendering keeps drawing until they are in
+	bool IsTextureStreamingPending() const { return m_textureStreamer && m_textureStreamer->IsStreaming(); }
+
 };
\ No newline at end of file
@@ -0,0 +1,410 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenepicking.cpp
+// ============
+// CPU ray picking - a bounding volume hierarchy over the scene objects and
+// exact ray tests against the unit shapes, for selecting objects under the
+// cursor without touching the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ScenePicking.h"
+#include "MeshGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// tessellation of the shapes hit on their triangles; the tree
+	// keeps the number of meshes a pick tests to a handful
+	const uint32_t g_PickSegments = 32;
+	// deep enough for a median split of any 32-bit object count
+	const int g_MaxTraversalDepth = 64;
+
+	// one triangle as its first corner and the two edges from it
+	struct PICK_TRIANGLE
+	{
+		glm::vec3 corner;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+	};
+
+	// unit mesh of a shape in model space
+	struct PICK_SHAPE
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		std::vector<PICK_TRIANGLE> triangles;
+	};
+
+	// built once, on the first pick, and read-only from then on
+	const PICK_SHAPE& GetPickShape(MeshType mesh)
+	{
+		static const std::vector<PICK_SHAPE> shapes = []()
+		{
+			std::vector<PICK_SHAPE> result(static_cast<size_t>(MeshType::Count));
+			MeshGeometry geometry;
+			for (size_t m = 0; m < result.size(); ++m)
+			{
+				GenerateMeshGeometry(static_cast<MeshType>(m), g_PickSegments, geometry);
+				PICK_SHAPE& shape = result[m];
+				shape.boundsMin = glm::vec3(FLT_MAX);
+				shape.boundsMax = glm::vec3(-FLT_MAX);
+				for (const MeshVertex& vertex : geometry.vertices)
+				{
+					shape.boundsMin = glm::min(shape.boundsMin, vertex.position);
+					shape.boundsMax = glm::max(shape.boundsMax, vertex.position);
+				}
+				for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3)
+				{
+					const glm::vec3& a = geometry.vertices[geometry.indices[i]].position;
+					const glm::vec3& b = geometry.vertices[geometry.indices[i + 1]].position;
+					const glm::vec3& c = geometry.vertices[geometry.indices[i + 2]].position;
+					shape.triangles.push_back({ a, b - a, c - a });
+				}
+			}
+			return result;
+		}();
+		return shapes[static_cast<size_t>(mesh)];
+	}
+
+	// 1/direction with zero components kept finite, so that the slab
+	// test never multiplies zero by infinity
+	glm::vec3 SafeInverse(const glm::vec3& direction)
+	{
+		glm::vec3 inverse;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float d = direction[axis];
+			inverse[axis] = 1.0f / ((std::fabs(d) > 1e-30f) ? d : std::copysign(1e-30f, d));
+		}
+		return inverse;
+	}
+
+	// distance to where the ray enters the box, or to its origin
+	// when it starts inside; false if it misses before maxDistance
+	bool IntersectBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+		const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& entry)
+	{
+		const glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+		const glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+		const glm::vec3 enter = glm::min(t0, t1);
+		const glm::vec3 exit = glm::max(t0, t1);
+		const float tEnter = std::max(std::max(enter.x, enter.y), std::max(enter.z, 0.0f));
+		const float tExit = std::min(std::min(exit.x, exit.y), std::min(exit.z, maxDistance));
+		entry = tEnter;
+		return tEnter <= tExit;
+	}
+
+	// the ray parameter of a model-space ray where it meets the shape;
+	// the direction is not normalized, so the parameter is the world
+	// distance along the original ray
+	float IntersectShape(MeshType mesh, const glm::vec3& origin, const glm::vec3& direction,
+		float maxDistance)
+	{
+		switch (mesh)
+		{
+		case MeshType::Plane:
+		{
+			if (std::fabs(direction.y) < 1e-12f)
+			{
+				return FLT_MAX;
+			}
+			const float t = -origin.y / direction.y;
+			const glm::vec3 point = origin + direction * t;
+			return ((t >= 0.0f) && (std::fabs(point.x) <= 1.0f) && (std::fabs(point.z) <= 1.0f)) ? t : FLT_MAX;
+		}
+		case MeshType::Box:
+		{
+			float entry = 0.0f;
+			return IntersectBounds(glm::vec3(-0.5f), glm::vec3(0.5f), origin, SafeInverse(direction),
+				maxDistance, entry) ? entry : FLT_MAX;
+		}
+		case MeshType::Sphere:
+		{
+			// |origin + t * direction| = 1
+			const float a = glm::dot(direction, direction);
+			const float b = glm::dot(origin, direction);
+			const float c = glm::dot(origin, origin) - 1.0f;
+			const float discriminant = b * b - a * c;
+			if (discriminant < 0.0f)
+			{
+				return FLT_MAX;
+			}
+			const float root = std::sqrt(discriminant);
+			float t = (-b - root) / a;
+			if (t < 0.0f)
+			{
+				// the ray starts inside and hits the far side
+				t = (-b + root) / a;
+			}
+			return (t >= 0.0f) ? t : FLT_MAX;
+		}
+		default:
+			break;
+		}
+
+		const PICK_SHAPE& shape = GetPickShape(mesh);
+		float nearest = maxDistance;
+		float entry = 0.0f;
+		if (!IntersectBounds(shape.boundsMin - 1e-4f, shape.boundsMax + 1e-4f, origin,
+			SafeInverse(direction), maxDistance, entry))
+		{
+			return FLT_MAX;
+		}
+
+		// two-sided Moller-Trumbore, so open ends are hit from inside too
+		bool bHit = false;
+		for (const PICK_TRIANGLE& triangle : shape.triangles)
+		{
+			const glm::vec3 p = glm::cross(direction, triangle.edge2);
+			const float determinant = glm::dot(triangle.edge1, p);
+			if (std::fabs(determinant) < 1e-12f)
+			{
+				continue;
+			}
+			const float inverse = 1.0f / determinant;
+			const glm::vec3 s = origin - triangle.corner;
+			const float u = glm::dot(s, p) * inverse;
+			if ((u < 0.0f) || (u > 1.0f))
+			{
+				continue;
+			}
+			const glm::vec3 q = glm::cross(s, triangle.edge1);
+			const float v = glm::dot(direction, q) * inverse;
+			if ((v < 0.0f) || (u + v > 1.0f))
+			{
+				continue;
+			}
+			const float t = glm::dot(triangle.edge2, q) * inverse;
+			if ((t >= 0.0f) && (t < nearest))
+			{
+				nearest = t;
+				bHit = true;
+			}
+		}
+		return bHit ? nearest : FLT_MAX;
+	}
+}
+
+/***********************************************************
+ *  MakePickRay()
+ *
+ *  Unprojects the point on the near and far planes, which
+ *  works for both perspective and orthographic views.
+ ***********************************************************/
+PickRay MakePickRay(const FrameView& view, const glm::vec2& point)
+{
+	const glm::mat4 inverse = glm::inverse(view.projection * view.view);
+	glm::vec4 nearPoint = inverse * glm::vec4(point.x, point.y, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverse * glm::vec4(point.x, point.y, 1.0f, 1.0f);
+	nearPoint /= nearPoint.w;
+	farPoint /= farPoint.w;
+
+	PickRay ray;
+	ray.origin = glm::vec3(nearPoint);
+	ray.direction = glm::normalize(glm::vec3(farPoint) - glm::vec3(nearPoint));
+	return ray;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  Drops the tree and makes room for the objects.
+ ***********************************************************/
+void ScenePicker::Reset(uint32_t objectCount)
+{
+	m_objects.resize(objectCount);
+	m_nodes.clear();
+}
+
+/***********************************************************
+ *  SetObject()
+ *
+ *  Stores the inverse model matrix and the world bounds of
+ *  one object. Different indices may be set concurrently.
+ ***********************************************************/
+void ScenePicker::SetObject(uint32_t index, MeshType mesh, const glm::mat4& model)
+{
+	OBJECT& object = m_objects[index];
+	object.worldToModel = glm::inverse(model);
+	object.objectIndex = index;
+	object.mesh = mesh;
+
+	// world box of the model box, from the absolute matrix
+	const PICK_SHAPE& shape = GetPickShape(mesh);
+	const glm::vec3 center = (shape.boundsMin + shape.boundsMax) * 0.5f;
+	const glm::vec3 extent = (shape.boundsMax - shape.boundsMin) * 0.5f;
+	const glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent(0.0f);
+	for (int column = 0; column < 3; ++column)
+	{
+		worldExtent += glm::abs(glm::vec3(model[column])) * extent[column];
+	}
+	// flat shapes such as the plane still get a box with volume
+	worldExtent += glm::vec3(1e-4f);
+	object.boundsMin = worldCenter - worldExtent;
+	object.boundsMax = worldCenter + worldExtent;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  Builds the tree over the objects set since Reset(). The
+ *  objects are reordered into leaf order.
+ ***********************************************************/
+void ScenePicker::Build()
+{
+	m_nodes.clear();
+	if (m_objects.empty())
+	{
+		return;
+	}
+	m_nodes.reserve(2 * (m_objects.size() / kLeafObjects + 1));
+	m_nodes.push_back(NODE());
+	Split(0, 0, static_cast<uint32_t>(m_objects.size()));
+}
+
+/***********************************************************
+ *  Split()
+ *
+ *  Bounds a range of objects and splits it at the median
+ *  centroid of its longest axis until the leaves are small.
+ ***********************************************************/
+void ScenePicker::Split(uint32_t node, uint32_t first, uint32_t count)
+{
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		const OBJECT& object = m_objects[i];
+		boundsMin = glm::min(boundsMin, object.boundsMin);
+		boundsMax = glm::max(boundsMax, object.boundsMax);
+		const glm::vec3 centroid = object.boundsMin + object.boundsMax;
+		centroidMin = glm::min(centroidMin, centroid);
+		centroidMax = glm::max(centroidMax, centroid);
+	}
+	m_nodes[node].boundsMin = boundsMin;
+	m_nodes[node].boundsMax = boundsMax;
+
+	if (count <= kLeafObjects)
+	{
+		m_nodes[node].first = first;
+		m_nodes[node].count = count;
+		return;
+	}
+
+	const glm::vec3 spread = centroidMax - centroidMin;
+	const int axis = (spread.x >= spread.y) ? ((spread.x >= spread.z) ? 0 : 2) : ((spread.y >= spread.z) ? 1 : 2);
+	const uint32_t half = count / 2;
+	std::nth_element(m_objects.begin() + first, m_objects.begin() + first + half,
+		m_objects.begin() + first + count, [axis](const OBJECT& a, const OBJECT& b)
+		{
+			return (a.boundsMin[axis] + a.boundsMax[axis]) < (b.boundsMin[axis] + b.boundsMax[axis]);
+		});
+
+	const uint32_t children = static_cast<uint32_t>(m_nodes.size());
+	m_nodes[node].first = children;
+	m_nodes[node].count = 0;
+	m_nodes.push_back(NODE());
+	m_nodes.push_back(NODE());
+	Split(children, first, half);
+	Split(children + 1, first + half, count - half);
+}
+
+/***********************************************************
+ *  Cast()
+ *
+ *  Finds the nearest object the ray hits. The ray is taken
+ *  into each candidate's model space, so the shapes are
+ *  always tested at unit size.
+ ***********************************************************/
+bool ScenePicker::Cast(const PickRay& ray, PickHit& hit, float maxDistance) const
+{
+	hit = PickHit();
+	if (m_nodes.empty())
+	{
+		return false;
+	}
+
+	const glm::vec3 inverseDirection = SafeInverse(ray.direction);
+	float nearest = maxDistance;
+	uint32_t nearestObject = 0xFFFFFFFFu;
+
+	struct PENDING
+	{
+		uint32_t node;
+		float entry;
+	};
+	PENDING stack[g_MaxTraversalDepth];
+	int depth = 0;
+	float entry = 0.0f;
+	if (IntersectBounds(m_nodes[0].boundsMin, m_nodes[0].boundsMax, ray.origin, inverseDirection,
+		nearest, entry))
+	{
+		stack[depth++] = { 0, entry };
+	}
+
+	while (depth > 0)
+	{
+		const PENDING pending = stack[--depth];
+		if (pending.entry >= nearest)
+		{
+			continue;
+		}
+
+		const NODE& node = m_nodes[pending.node];
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+			{
+				const OBJECT& object = m_objects[i];
+				if (!IntersectBounds(object.boundsMin, object.boundsMax, ray.origin, inverseDirection,
+					nearest, entry))
+				{
+					continue;
+				}
+				const glm::vec3 origin = glm::vec3(object.worldToModel * glm::vec4(ray.origin, 1.0f));
+				const glm::vec3 direction = glm::vec3(object.worldToModel * glm::vec4(ray.direction, 0.0f));
+				const float t = IntersectShape(object.mesh, origin, direction, nearest);
+				if (t < nearest)
+				{
+					nearest = t;
+					nearestObject = object.objectIndex;
+				}
+			}
+			continue;
+		}
+
+		// push the farther child first so the nearer one is visited next
+		float entries[2];
+		bool bHits[2];
+		for (uint32_t c = 0; c < 2; ++c)
+		{
+			const NODE& child = m_nodes[node.first + c];
+			bHits[c] = IntersectBounds(child.boundsMin, child.boundsMax, ray.origin, inverseDirection,
+				nearest, entries[c]);
+		}
+		const uint32_t nearer = (bHits[1] && (!bHits[0] || (entries[1] < entries[0]))) ? 1u : 0u;
+		const uint32_t farther = 1u - nearer;
+		if (bHits[farther])
+		{
+			stack[depth++] = { node.first + farther, entries[farther] };
+		}
+		if (bHits[nearer])
+		{
+			stack[depth++] = { node.first + nearer, entries[nearer] };
+		}
+	}
+
+	if (nearestObject == 0xFFFFFFFFu)
+	{
+		return false;
+	}
+	hit.objectIndex = nearestObject;
+	hit.distance = nearest;
+	hit.position = ray.origin + ray.direction * nearest;
+	return true;
+}
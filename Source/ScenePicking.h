@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenepicking.h
+// ============
+// CPU ray picking - a bounding volume hierarchy over the scene objects and
+// exact ray tests against the unit shapes, for selecting objects under the
+// cursor without touching the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderTypes.h"
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+// a ray in world space; the direction has unit length
+struct PickRay
+{
+	glm::vec3 origin;
+	glm::vec3 direction;
+};
+
+// the ray through a point of the viewport, given in normalized device
+// coordinates; it starts on the near plane, so distances are measured
+// from there
+PickRay MakePickRay(const FrameView& view, const glm::vec2& point);
+
+struct PickHit
+{
+	// index the object was given to ScenePicker::SetObject()
+	uint32_t objectIndex = 0xFFFFFFFFu;
+	float distance = FLT_MAX;
+	glm::vec3 position = glm::vec3(0.0f);
+};
+
+/***********************************************************
+ *  ScenePicker
+ *
+ *  The objects' world bounds are split at the median of the
+ *  longest axis into a binary tree with a few objects per
+ *  leaf. A cast walks the tree nearest child first and
+ *  stops descending once a node starts beyond the nearest
+ *  hit. Planes, boxes and spheres are hit analytically; the
+ *  other shapes are hit on the triangles of MeshGeometry.
+ *  Built on one thread, a picker may be cast from several.
+ ***********************************************************/
+class ScenePicker
+{
+public:
+	// sizes the object list, then every object is set once, possibly
+	// in parallel, before Build()
+	void Reset(uint32_t objectCount);
+	void SetObject(uint32_t index, MeshType mesh, const glm::mat4& model);
+	void Build();
+
+	// nearest object along the ray closer than maxDistance
+	bool Cast(const PickRay& ray, PickHit& hit, float maxDistance = FLT_MAX) const;
+
+	uint32_t GetObjectCount() const { return static_cast<uint32_t>(m_objects.size()); }
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_nodes.size()); }
+
+private:
+	static const uint32_t kLeafObjects = 4;
+
+	struct OBJECT
+	{
+		glm::mat4 worldToModel;
+		glm::vec3 boundsMin;
+		uint32_t objectIndex;
+		glm::vec3 boundsMax;
+		MeshType mesh;
+	};
+
+	// leaves hold count objects from first, inner nodes have
+	// count 0 and their children at first and first + 1
+	struct NODE
+	{
+		glm::vec3 boundsMin;
+		uint32_t first;
+		glm::vec3 boundsMax;
+		uint32_t count;
+	};
+
+	void Split(uint32_t node, uint32_t first, uint32_t count);
+
+	std::vector<OBJECT> m_objects;
+	std::vector<NODE> m_nodes;
+};
@@ -0,0 +1,450 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenestreaming.cpp
+// ============
+// distance-based streaming of cell worlds - the cells around the camera and
+// ahead of it are read on a loader thread and added to the scene, far cells
+// are dropped, within fixed memory and per-frame budgets
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneStreaming.h"
+#include "SceneManager.h"
+#include "DBHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+extern std::unique_ptr<DbHelper> g_Db;
+
+// declaration of global variables
+namespace
+{
+	// weight of the newest frame in the smoothed camera velocity
+	const float g_VelocitySmoothing = 0.25f;
+	// frames shorter than this do not update the velocity
+	const float g_MinVelocityInterval = 0.001f;
+
+	template <typename T>
+	bool NearerFirst(const T& a, const T& b)
+	{
+		return a.distance < b.distance;
+	}
+}
+
+/***********************************************************
+ *  SceneStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneStreamer::SceneStreamer(SceneManager* pSceneManager, const StreamingConfig& cfg)
+	: m_pSceneManager(pSceneManager)
+	, m_cfg(cfg)
+{
+}
+
+/***********************************************************
+ *  ~SceneStreamer()
+ *
+ *  The destructor for the class - stops the loader thread.
+ *  The streamed objects stay in the scene.
+ ***********************************************************/
+SceneStreamer::~SceneStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bRunning = false;
+	}
+	m_condition.notify_all();
+	if (m_loaderThread.joinable())
+	{
+		m_loaderThread.join();
+	}
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  Reads the cell table of a cell world, replaces the scene
+ *  with its lights and no objects, and starts the loader.
+ *  The objects come in with the following Update() calls.
+ ***********************************************************/
+bool SceneStreamer::Open(const std::string& path)
+{
+	if (m_loaderThread.joinable())
+	{
+		std::cerr << "[SceneStreamer] a cell world is already open\n";
+		return false;
+	}
+
+	GeneratedScene scene;
+	if (!m_world.Open(path, scene.lights))
+	{
+		return false;
+	}
+	m_pSceneManager->LoadGeneratedScene(scene);
+
+	m_cellStates.assign(m_world.GetCellCount(), CellState::Unloaded);
+	m_resident.reserve(m_cfg.maxResidentCells);
+	m_requests.reserve(m_cfg.maxPendingCells);
+	m_bRunning = true;
+	m_loaderThread = std::thread(&SceneStreamer::LoaderLoop, this);
+
+	std::cout << "INFO: streaming " << m_world.GetObjectCount() << " objects in "
+		<< m_world.GetCellsX() << " x " << m_world.GetCellsZ() << " cells of "
+		<< m_world.GetCellSize() << " from " << path << "\n";
+	return true;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  Adds the cells the loader has read, drops the cells out
+ *  of range, and queues the nearest missing cells within
+ *  the resident limits, evicting farther cells to make room.
+ ***********************************************************/
+void SceneStreamer::Update(const FrameView& view)
+{
+	if (!m_bRunning)
+	{
+		return;
+	}
+
+	// the camera velocity on the ground plane, smoothed over frames
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const glm::vec2 position(view.position.x, view.position.z);
+	if (m_bHasLastUpdate)
+	{
+		const float interval = std::chrono::duration<float>(now - m_lastUpdate).count();
+		if (interval >= g_MinVelocityInterval)
+		{
+			const glm::vec2 velocity = (position - m_position) / interval;
+			m_velocity += (velocity - m_velocity) * g_VelocitySmoothing;
+		}
+	}
+	m_lastUpdate = now;
+	m_bHasLastUpdate = true;
+	m_position = position;
+	m_predicted = position + m_velocity * m_cfg.lookaheadSeconds;
+
+	ApplyLoads();
+
+	for (size_t i = 0; i < m_resident.size();)
+	{
+		RESIDENT_CELL& resident = m_resident[i];
+		resident.distance = std::min(CellDistance(resident.cell, m_position),
+			CellDistance(resident.cell, m_predicted));
+		if (resident.distance > m_cfg.unloadRadius)
+		{
+			UnloadCell(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	CollectCandidates();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// requests the loader has not started are re-prioritized for
+		// the new camera, or dropped once out of range
+		for (size_t i = 0; i < m_requests.size();)
+		{
+			CELL_REQUEST& request = m_requests[i];
+			request.distance = std::min(CellDistance(request.cell, m_position),
+				CellDistance(request.cell, m_predicted));
+			if (request.distance > m_cfg.loadRadius)
+			{
+				m_cellStates[request.cell] = CellState::Unloaded;
+				m_pendingCells--;
+				m_pendingObjects -= m_world.GetCell(request.cell).objectCount;
+				request = m_requests.back();
+				m_requests.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		for (const CELL_REQUEST& candidate : m_candidates)
+		{
+			if ((m_pendingCells >= m_cfg.maxPendingCells) || !MakeRoom(candidate))
+			{
+				break;
+			}
+			m_requests.push_back(candidate);
+			m_cellStates[candidate.cell] = CellState::Pending;
+			m_pendingCells++;
+			m_pendingObjects += m_world.GetCell(candidate.cell).objectCount;
+		}
+
+		// unused read budget does not carry over into a burst
+		m_ioCredit = std::min<int64_t>(m_ioCredit + m_cfg.ioBytesPerFrame, m_cfg.ioBytesPerFrame);
+	}
+	m_bLoading = (m_pendingCells > 0) || !m_applying.empty();
+	m_condition.notify_one();
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  Call from the Update() thread, or while the frame
+ *  pipeline is idle.
+ ***********************************************************/
+StreamingStats SceneStreamer::GetStats() const
+{
+	StreamingStats stats;
+	stats.residentCells = static_cast<uint32_t>(m_resident.size());
+	stats.residentObjects = m_residentObjects;
+	stats.pendingCells = m_pendingCells;
+	stats.cellsLoaded = m_cellsLoaded;
+	stats.cellsUnloaded = m_cellsUnloaded;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	stats.bytesRead = m_bytesRead;
+	return stats;
+}
+
+/***********************************************************
+ *  LoaderLoop()
+ *
+ *  Body of the loader thread. Reads the nearest requested
+ *  cell whenever the frame's read budget is not used up.
+ ***********************************************************/
+void SceneStreamer::LoaderLoop()
+{
+	for (;;)
+	{
+		std::unique_ptr<CELL_LOAD> load;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [&]()
+			{
+				return !m_bRunning || (!m_requests.empty() && (m_ioCredit > 0));
+			});
+			if (!m_bRunning)
+			{
+				return;
+			}
+
+			std::vector<CELL_REQUEST>::iterator nearest =
+				std::min_element(m_requests.begin(), m_requests.end(), NearerFirst<CELL_REQUEST>);
+			const uint32_t cell = nearest->cell;
+			*nearest = m_requests.back();
+			m_requests.pop_back();
+
+			const int64_t bytes = static_cast<int64_t>(CellWorldFile::GetCellBytes(m_world.GetCell(cell)));
+			m_ioCredit -= bytes;
+			m_bytesRead += bytes;
+
+			if (m_freeLoads.empty())
+			{
+				load = std::make_unique<CELL_LOAD>();
+			}
+			else
+			{
+				load = std::move(m_freeLoads.back());
+				m_freeLoads.pop_back();
+			}
+			load->cell = cell;
+		}
+
+		load->bFailed = !m_world.ReadCell(load->cell, load->objects);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_completed.push_back(std::move(load));
+	}
+}
+
+/***********************************************************
+ *  CellDistance()
+ *
+ *  Distance on the ground plane from a point to the nearest
+ *  edge of a cell; zero inside it.
+ ***********************************************************/
+float SceneStreamer::CellDistance(uint32_t cell, const glm::vec2& point) const
+{
+	const float size = m_world.GetCellSize();
+	const glm::vec2 minimum = m_world.GetOrigin() + size * glm::vec2(
+		static_cast<float>(cell % m_world.GetCellsX()),
+		static_cast<float>(cell / m_world.GetCellsX()));
+	return glm::length(point - glm::clamp(point, minimum, minimum + glm::vec2(size)));
+}
+
+/***********************************************************
+ *  ApplyLoads()
+ *
+ *  Adds the objects of the cells read by the loader, up to
+ *  the per-frame object budget. Cells the camera has left
+ *  while they were read are released unused.
+ ***********************************************************/
+void SceneStreamer::ApplyLoads()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (std::unique_ptr<CELL_LOAD>& load : m_completed)
+		{
+			m_applying.push_back(std::move(load));
+		}
+		m_completed.clear();
+	}
+
+	uint32_t appliedObjects = 0;
+	size_t next = 0;
+	for (; next < m_applying.size(); ++next)
+	{
+		CELL_LOAD& load = *m_applying[next];
+		const uint32_t objectCount = m_world.GetCell(load.cell).objectCount;
+		const float distance = std::min(CellDistance(load.cell, m_position),
+			CellDistance(load.cell, m_predicted));
+		if (!load.bFailed && (distance <= m_cfg.unloadRadius) && (appliedObjects > 0) &&
+			(appliedObjects + objectCount > m_cfg.objectsPerFrame))
+		{
+			break;
+		}
+
+		m_pendingCells--;
+		m_pendingObjects -= objectCount;
+		if (load.bFailed)
+		{
+			m_cellStates[load.cell] = CellState::Failed;
+			if (g_Db && g_Db->isOpen()) {
+				g_Db->logError("SceneStreamer", "cell " + std::to_string(load.cell) + " could not be read");
+			}
+		}
+		else if (distance > m_cfg.unloadRadius)
+		{
+			m_cellStates[load.cell] = CellState::Unloaded;
+		}
+		else
+		{
+			RESIDENT_CELL resident;
+			resident.cell = load.cell;
+			resident.distance = distance;
+			if (!m_spareHandleLists.empty())
+			{
+				resident.objects = std::move(m_spareHandleLists.back());
+				m_spareHandleLists.pop_back();
+			}
+			resident.objects.reserve(load.objects.size());
+			for (const GeneratedObject& object : load.objects)
+			{
+				resident.objects.push_back(m_pSceneManager->AddGeneratedObject(object));
+			}
+			m_resident.push_back(std::move(resident));
+			m_cellStates[load.cell] = CellState::Resident;
+			m_residentObjects += objectCount;
+			m_cellsLoaded++;
+			appliedObjects += objectCount;
+		}
+	}
+
+	if (next > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < next; ++i)
+		{
+			m_freeLoads.push_back(std::move(m_applying[i]));
+		}
+	}
+	m_applying.erase(m_applying.begin(), m_applying.begin() + next);
+}
+
+/***********************************************************
+ *  UnloadCell()
+ *
+ *  Removes the objects of a resident cell from the scene.
+ *  The handle list is kept for the next cell loaded.
+ ***********************************************************/
+void SceneStreamer::UnloadCell(size_t residentIndex)
+{
+	RESIDENT_CELL& resident = m_resident[residentIndex];
+	for (PoolHandle object : resident.objects)
+	{
+		m_pSceneManager->RemoveSceneObject(object);
+	}
+	m_residentObjects -= static_cast<uint32_t>(resident.objects.size());
+	m_cellStates[resident.cell] = CellState::Unloaded;
+	m_cellsUnloaded++;
+
+	resident.objects.clear();
+	m_spareHandleLists.push_back(std::move(resident.objects));
+	if (residentIndex + 1 != m_resident.size())
+	{
+		resident = std::move(m_resident.back());
+	}
+	m_resident.pop_back();
+}
+
+/***********************************************************
+ *  CollectCandidates()
+ *
+ *  Lists the unloaded cells in load range of the camera or
+ *  its predicted position, nearest first. Only the cells
+ *  around the two points are visited, so the cost does not
+ *  grow with the world.
+ ***********************************************************/
+void SceneStreamer::CollectCandidates()
+{
+	m_candidates.clear();
+
+	const float size = m_world.GetCellSize();
+	const glm::vec2 origin = m_world.GetOrigin();
+	const glm::vec2 low = (glm::min(m_position, m_predicted) - m_cfg.loadRadius - origin) / size;
+	const glm::vec2 high = (glm::max(m_position, m_predicted) + m_cfg.loadRadius - origin) / size;
+	const float lastX = static_cast<float>(m_world.GetCellsX() - 1);
+	const float lastZ = static_cast<float>(m_world.GetCellsZ() - 1);
+	if ((high.x < 0.0f) || (high.y < 0.0f) || (low.x > lastX) || (low.y > lastZ))
+	{
+		return;
+	}
+
+	const uint32_t x0 = static_cast<uint32_t>(glm::clamp(std::floor(low.x), 0.0f, lastX));
+	const uint32_t x1 = static_cast<uint32_t>(glm::clamp(std::floor(high.x), 0.0f, lastX));
+	const uint32_t z0 = static_cast<uint32_t>(glm::clamp(std::floor(low.y), 0.0f, lastZ));
+	const uint32_t z1 = static_cast<uint32_t>(glm::clamp(std::floor(high.y), 0.0f, lastZ));
+	for (uint32_t z = z0; z <= z1; ++z)
+	{
+		for (uint32_t x = x0; x <= x1; ++x)
+		{
+			const uint32_t cell = z * m_world.GetCellsX() + x;
+			if ((m_cellStates[cell] != CellState::Unloaded) || (m_world.GetCell(cell).objectCount == 0))
+			{
+				continue;
+			}
+
+			const float distance = std::min(CellDistance(cell, m_position), CellDistance(cell, m_predicted));
+			if (distance <= m_cfg.loadRadius)
+			{
+				m_candidates.push_back({ cell, distance });
+			}
+		}
+	}
+	std::sort(m_candidates.begin(), m_candidates.end(), NearerFirst<CELL_REQUEST>);
+}
+
+/***********************************************************
+ *  MakeRoom()
+ *
+ *  Keeps the resident and pending cells within the memory
+ *  limits once the candidate is added, by dropping resident
+ *  cells farther away than it. Returns false if that is
+ *  not enough.
+ ***********************************************************/
+bool SceneStreamer::MakeRoom(const CELL_REQUEST& candidate)
+{
+	const uint32_t objectCount = m_world.GetCell(candidate.cell).objectCount;
+	while ((m_resident.size() + m_pendingCells + 1 > m_cfg.maxResidentCells) ||
+		(static_cast<uint64_t>(m_residentObjects) + m_pendingObjects + objectCount > m_cfg.maxResidentObjects))
+	{
+		std::vector<RESIDENT_CELL>::iterator farthest =
+			std::max_element(m_resident.begin(), m_resident.end(), NearerFirst<RESIDENT_CELL>);
+		if ((farthest == m_resident.end()) || (farthest->distance <= candidate.distance))
+		{
+			return false;
+		}
+		UnloadCell(static_cast<size_t>(farthest - m_resident.begin()));
+	}
+	return true;
+}
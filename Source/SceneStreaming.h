@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenestreaming.h
+// ============
+// distance-based streaming of cell worlds - the cells around the camera and
+// ahead of it are read on a loader thread and added to the scene, far cells
+// are dropped, within fixed memory and per-frame budgets
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CellWorld.h"
+#include "ObjectPool.h"
+#include "RenderTypes.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SceneManager;
+
+struct StreamingConfig
+{
+	// cells closer than this to the camera, or to where it will be
+	// after lookaheadSeconds at its current velocity, are loaded
+	float loadRadius = 60.0f;
+	// resident cells farther than this from both are dropped
+	float unloadRadius = 80.0f;
+	float lookaheadSeconds = 1.5f;
+	// what may be resident at once, whatever the size of the world
+	uint32_t maxResidentCells = 256;
+	uint32_t maxResidentObjects = 200000;
+	// cells queued or being read at once
+	uint32_t maxPendingCells = 8;
+	// bytes the loader thread may read per frame, and objects added
+	// to the scene per frame; a cell larger than either still loads
+	uint32_t ioBytesPerFrame = 512 * 1024;
+	uint32_t objectsPerFrame = 8192;
+};
+
+struct StreamingStats
+{
+	uint32_t residentCells = 0;
+	uint32_t residentObjects = 0;
+	uint32_t pendingCells = 0;
+	uint64_t cellsLoaded = 0;
+	uint64_t cellsUnloaded = 0;
+	uint64_t bytesRead = 0;
+};
+
+/***********************************************************
+ *  SceneStreamer
+ *
+ *  Update() runs on the thread that builds the frame
+ *  packets, right before BuildFramePacket(), so the scene
+ *  objects never change under a packet being built. Only
+ *  objects stream; the meshes and the textures they map
+ *  onto are shared and stay loaded. Cells are requested
+ *  nearest first, measured from the camera and from its
+ *  predicted position, so the cells it is moving towards
+ *  come in before the ones it leaves behind.
+ ***********************************************************/
+class SceneStreamer
+{
+public:
+	SceneStreamer(SceneManager* pSceneManager, const StreamingConfig& cfg = StreamingConfig());
+	~SceneStreamer();
+
+	SceneStreamer(const SceneStreamer&) = delete;
+	SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+	// replaces the scene objects and lights; starts the loader thread
+	bool Open(const std::string& path);
+
+	// load, unload and re-prioritize cells for the camera of a frame
+	void Update(const FrameView& view);
+	// true while cells are queued, being read, or read and waiting
+	// for the next Update() to add them; safe from any thread
+	bool IsLoading() const { return m_bLoading; }
+
+	StreamingStats GetStats() const;
+
+private:
+	enum class CellState : uint8_t
+	{
+		Unloaded,
+		// queued, being read, or read and waiting to be added
+		Pending,
+		Resident,
+		// failed to read; not requested again
+		Failed
+	};
+
+	struct CELL_REQUEST
+	{
+		uint32_t cell;
+		float distance;
+	};
+
+	struct CELL_LOAD
+	{
+		uint32_t cell = 0;
+		bool bFailed = false;
+		std::vector<GeneratedObject> objects;
+	};
+
+	struct RESIDENT_CELL
+	{
+		uint32_t cell;
+		float distance;
+		std::vector<PoolHandle> objects;
+	};
+
+	void LoaderLoop();
+	float CellDistance(uint32_t cell, const glm::vec2& point) const;
+	void ApplyLoads();
+	void UnloadCell(size_t residentIndex);
+	void CollectCandidates();
+	bool MakeRoom(const CELL_REQUEST& candidate);
+
+	SceneManager* m_pSceneManager;
+	StreamingConfig m_cfg;
+	CellWorldFile m_world;
+
+	// owned by the Update() thread
+	std::vector<CellState> m_cellStates;
+	std::vector<RESIDENT_CELL> m_resident;
+	std::vector<std::vector<PoolHandle>> m_spareHandleLists;
+	std::vector<CELL_REQUEST> m_candidates;
+	std::vector<std::unique_ptr<CELL_LOAD>> m_applying;
+	glm::vec2 m_position = glm::vec2(0.0f);
+	glm::vec2 m_predicted = glm::vec2(0.0f);
+	glm::vec2 m_velocity = glm::vec2(0.0f);
+	std::chrono::steady_clock::time_point m_lastUpdate;
+	bool m_bHasLastUpdate = false;
+	uint32_t m_pendingCells = 0;
+	uint32_t m_pendingObjects = 0;
+	uint32_t m_residentObjects = 0;
+	uint64_t m_cellsLoaded = 0;
+	uint64_t m_cellsUnloaded = 0;
+	// m_pendingCells or m_applying as of the last Update(), for
+	// the thread deciding whether to render
+	std::atomic<bool> m_bLoading{ false };
+
+	// shared with the loader thread
+	std::thread m_loaderThread;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_bRunning = false;
+	std::vector<CELL_REQUEST> m_requests;
+	std::vector<std::unique_ptr<CELL_LOAD>> m_completed;
+	std::vector<std::unique_ptr<CELL_LOAD>> m_freeLoads;
+	int64_t m_ioCredit = 0;
+	uint64_t m_bytesRead = 0;
+};
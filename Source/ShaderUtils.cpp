@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderutils.cpp
+// ============
+// compile and link the small helper shader programs used by the engine
+// passes (upscaling, ID picking, ...) next to the main ShaderManager program
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUtils.h"
+#include "VirtualFileSystem.h"
+
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	GLuint CompileStage(GLenum stage, const std::string& source, std::string& errorLog)
+	{
+		GLuint shader = glCreateShader(stage);
+		const char* text = source.c_str();
+		glShaderSource(shader, 1, &text, NULL);
+		glCompileShader(shader);
+
+		GLint success = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (success != GL_TRUE)
+		{
+			GLint length = 0;
+			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+			std::vector<char> log(static_cast<size_t>(length) + 1, '\0');
+			glGetShaderInfoLog(shader, length, NULL, log.data());
+			errorLog += (stage == GL_VERTEX_SHADER) ? "vertex: " : "fragment: ";
+			errorLog += log.data();
+			glDeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+}
+
+/***********************************************************
+ *  ReadTextFile()
+ *
+ *  Reads a whole text file into a string, from a mounted
+ *  package or from disk.
+ ***********************************************************/
+bool ReadTextFile(const char* path, std::string& contents)
+{
+	AssetBlob blob;
+	if (!VirtualFileSystem::Read(path, blob))
+	{
+		return false;
+	}
+
+	contents.assign(reinterpret_cast<const char*>(blob.GetData()), blob.GetSize());
+	return true;
+}
+
+/***********************************************************
+ *  CompileShaderProgram()
+ *
+ *  Compiles both stages and links them. Nothing is left
+ *  behind in the GL context when compiling fails.
+ ***********************************************************/
+GLuint CompileShaderProgram(const std::string& vertexSource,
+	const std::string& fragmentSource,
+	std::string& errorLog)
+{
+	errorLog.clear();
+
+	GLuint vertexShader = CompileStage(GL_VERTEX_SHADER, vertexSource, errorLog);
+	GLuint fragmentShader = CompileStage(GL_FRAGMENT_SHADER, fragmentSource, errorLog);
+	if ((vertexShader == 0) || (fragmentShader == 0))
+	{
+		if (vertexShader != 0) glDeleteShader(vertexShader);
+		if (fragmentShader != 0) glDeleteShader(fragmentShader);
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+
+	// the program keeps the compiled code after linking
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (success != GL_TRUE)
+	{
+		GLint length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+		std::vector<char> log(static_cast<size_t>(length) + 1, '\0');
+		glGetProgramInfoLog(program, length, NULL, log.data());
+		errorLog += "link: ";
+		errorLog += log.data();
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+/***********************************************************
+ *  LoadShaderProgram()
+ *
+ *  Reads the two GLSL files and compiles them.
+ ***********************************************************/
+GLuint LoadShaderProgram(const char* vertexPath,
+	const char* fragmentPath,
+	std::string& errorLog)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+	if (!ReadTextFile(vertexPath, vertexSource))
+	{
+		errorLog = std::string("cannot read ") + vertexPath;
+		return 0;
+	}
+	if (!ReadTextFile(fragmentPath, fragmentSource))
+	{
+		errorLog = std::string("cannot read ") + fragmentPath;
+		return 0;
+	}
+	return CompileShaderProgram(vertexSource, fragmentSource, errorLog);
+}
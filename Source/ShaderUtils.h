@@ -0,0 +1,26 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderutils.h
+// ============
+// compile and link the small helper shader programs used by the engine
+// passes (upscaling, ID picking, ...) next to the main ShaderManager program
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+// compile and link a program from GLSL source text; returns 0 on
+// failure with the compiler or linker output in errorLog
+GLuint CompileShaderProgram(const std::string& vertexSource,
+	const std::string& fragmentSource,
+	std::string& errorLog);
+
+// read both files and compile them; returns 0 on failure
+GLuint LoadShaderProgram(const char* vertexPath,
+	const char* fragmentPath,
+	std::string& errorLog);
+
+// read a whole text file; returns false if it cannot be opened
+bool ReadTextFile(const char* path, std::string& contents);
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// stringinterner.cpp
+// ============
+// 32-bit IDs for texture, material and uniform tags - a constexpr FNV-1a hash
+// so literals become IDs at compile time, and a global table of the interned
+// strings for reverse lookup and collision checks
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StringInterner.h"
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// a literal must get the same ID as the same string interned at run time
+static_assert("wood"_sid == HashString("wood"), "tag IDs depend on how they are made");
+
+// declaration of global variables
+namespace
+{
+	struct INTERNED_STRINGS
+	{
+		std::mutex mutex;
+		// the strings are held by pointer so that those handed out by
+		// Lookup() stay valid while the table rehashes
+		std::unordered_map<StringId, std::unique_ptr<std::string>> strings;
+	};
+
+	// created on first use, since tags may be interned during static init
+	INTERNED_STRINGS& GetTable()
+	{
+		static INTERNED_STRINGS table;
+		return table;
+	}
+
+	StringId InternString(const char* text, size_t length)
+	{
+		const StringId id = HashString(text, length);
+
+		INTERNED_STRINGS& table = GetTable();
+		std::lock_guard<std::mutex> lock(table.mutex);
+		auto it = table.strings.find(id);
+		if (it == table.strings.end())
+		{
+			table.strings.emplace(id, std::make_unique<std::string>(text, length));
+		}
+		else if (it->second->compare(0, std::string::npos, text, length) != 0)
+		{
+			std::cerr << "[StringInterner] '" << std::string(text, length) << "' and '"
+				<< *it->second << "' share the ID " << id << "\n";
+		}
+		return id;
+	}
+}
+
+StringId StringInterner::Intern(const char* text)
+{
+	return InternString(text, std::char_traits<char>::length(text));
+}
+
+StringId StringInterner::Intern(const std::string& text)
+{
+	return InternString(text.data(), text.size());
+}
+
+const char* StringInterner::Lookup(StringId id)
+{
+	INTERNED_STRINGS& table = GetTable();
+	std::lock_guard<std::mutex> lock(table.mutex);
+	auto it = table.strings.find(id);
+	return (it != table.strings.end()) ? it->second->c_str() : "?";
+}
+
+size_t StringInterner::GetCount()
+{
+	INTERNED_STRINGS& table = GetTable();
+	std::lock_guard<std::mutex> lock(table.mutex);
+	return table.strings.size();
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// stringinterner.h
+// ============
+// 32-bit IDs for texture, material and uniform tags - a constexpr FNV-1a hash
+// so literals become IDs at compile time, and a global table of the interned
+// strings for reverse lookup and collision checks
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+typedef uint32_t StringId;
+
+// FNV-1a over the bytes of the string
+constexpr StringId HashString(const char* text, size_t length)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash = (hash ^ static_cast<uint8_t>(text[i])) * 16777619u;
+	}
+	return hash;
+}
+
+constexpr StringId HashString(const char* text)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; text[i] != '\0'; ++i)
+	{
+		hash = (hash ^ static_cast<uint8_t>(text[i])) * 16777619u;
+	}
+	return hash;
+}
+
+// "wood"_sid is the ID of "wood", computed by the compiler
+constexpr StringId operator"" _sid(const char* text, size_t length)
+{
+	return HashString(text, length);
+}
+
+/***********************************************************
+ *  StringInterner
+ *
+ *  IDs are the hash of the string, so an ID computed from a
+ *  literal matches the one interned at run time. Interning
+ *  is for load time: it takes a lock and keeps a copy of
+ *  the string, which lets Lookup() name an ID in messages
+ *  and lets two strings sharing a hash be reported rather
+ *  than silently matching each other.
+ ***********************************************************/
+class StringInterner
+{
+public:
+	static StringId Intern(const char* text);
+	static StringId Intern(const std::string& text);
+
+	// the interned string with the ID, or "?" if it was never interned
+	static const char* Lookup(StringId id);
+
+	static size_t GetCount();
+};
@@ -0,0 +1,615 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreaming.cpp
+// ============
+// mip streaming of the scene textures - only the coarse mips are uploaded
+// at load, finer mips are decoded on a loader thread and uploaded when the
+// on-screen size of the textured objects calls for them
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreaming.h"
+#include "FramePipeline.h"
+#include "JobSystem.h"
+#include "SceneManager.h"
+#include "DBHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+extern std::unique_ptr<DbHelper> g_Db;
+
+// declaration of global variables
+namespace
+{
+	GLenum PixelFormat(int channels)
+	{
+		switch (channels)
+		{
+		case 1:  return GL_RED;
+		case 2:  return GL_RG;
+		case 3:  return GL_RGB;
+		default: return GL_RGBA;
+		}
+	}
+
+	int LevelSize(int size, uint32_t level)
+	{
+		return std::max(1, size >> level);
+	}
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class - starts the loader thread
+ ***********************************************************/
+TextureStreamer::TextureStreamer(const TextureStreamingConfig& cfg)
+	: m_cfg(cfg)
+{
+	m_loaderThread = std::thread(&TextureStreamer::LoaderLoop, this);
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class - stops the loader thread.
+ *  The textures belong to the caller of LoadTextures().
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bRunning = false;
+	}
+	m_condition.notify_all();
+	m_loaderThread.join();
+}
+
+/***********************************************************
+ *  LoadTextures()
+ *
+ *  Decodes every file and reduces it to the always-resident
+ *  mips, which are all that is uploaded. The files are read
+ *  again when finer mips are needed.
+ ***********************************************************/
+void TextureStreamer::LoadTextures(const char* const* filepaths, size_t count, GLuint* textures,
+	JobSystem* pJobSystem)
+{
+	// decoding and reducing dominate the load time, so they are
+	// spread across the job system; the GL upload stays on this thread
+	std::vector<MIP_CHAIN> chains(count);
+	auto decode = [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			SceneManager::DECODED_IMAGE image;
+			if (!SceneManager::DecodeImage(filepaths[i], image))
+			{
+				continue;
+			}
+			BuildMipChain(image.pixels, image.width, image.height, image.channels,
+				ResidentLevel(image.width, image.height), LevelCount(image.width, image.height), chains[i]);
+			SceneManager::FreeImage(image);
+		}
+	};
+	if (pJobSystem != nullptr)
+	{
+		pJobSystem->ParallelFor(static_cast<uint32_t>(count), 1, decode);
+	}
+	else
+	{
+		decode(0, static_cast<uint32_t>(count));
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		textures[i] = 0;
+		if (chains[i].levels.empty())
+		{
+			continue;
+		}
+
+		STREAMED_TEXTURE streamed;
+		streamed.filepath = filepaths[i];
+		streamed.width = chains[i].width;
+		streamed.height = chains[i].height;
+		streamed.channels = chains[i].channels;
+		streamed.levelCount = LevelCount(streamed.width, streamed.height);
+		streamed.residentLevel = chains[i].firstLevel;
+		glGenTextures(1, &streamed.texture);
+		CreateTexture(streamed, chains[i]);
+		textures[i] = streamed.texture;
+		m_textures.push_back(streamed);
+	}
+}
+
+/***********************************************************
+ *  ReplaceTexture()
+ *
+ *  Respecifies a streamed texture from new pixels, keeping
+ *  only its resident mips; finer mips stream in again from
+ *  the file. The caller keeps ownership of the pixels.
+ ***********************************************************/
+bool TextureStreamer::ReplaceTexture(GLuint texture, unsigned char* pixels, int width, int height,
+	int channels)
+{
+	std::vector<STREAMED_TEXTURE>::iterator found = std::find_if(m_textures.begin(), m_textures.end(),
+		[texture](const STREAMED_TEXTURE& streamed) { return streamed.texture == texture; });
+	if ((found == m_textures.end()) || (pixels == nullptr))
+	{
+		return false;
+	}
+
+	STREAMED_TEXTURE& streamed = *found;
+	CancelRequests(static_cast<size_t>(found - m_textures.begin()));
+
+	// release every old level, the size may have changed
+	glBindTexture(GL_TEXTURE_2D, streamed.texture);
+	for (uint32_t level = 0; level < streamed.levelCount; ++level)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, PixelFormat(streamed.channels), 0, 0, 0,
+			PixelFormat(streamed.channels), GL_UNSIGNED_BYTE, nullptr);
+	}
+
+	streamed.width = width;
+	streamed.height = height;
+	streamed.channels = channels;
+	streamed.levelCount = LevelCount(width, height);
+	streamed.residentLevel = ResidentLevel(width, height);
+
+	MIP_CHAIN chain;
+	BuildMipChain(pixels, width, height, channels, streamed.residentLevel, streamed.levelCount, chain);
+	CreateTexture(streamed, chain);
+	return true;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  Runs on the GL thread once per frame. Textures drawn
+ *  larger than their base mip supports get a finer mip
+ *  decoded; textures drawn smaller for a while, or over the
+ *  texel budget, give their finer mips back.
+ ***********************************************************/
+bool TextureStreamer::Update(const FramePacket& packet, int viewportHeight)
+{
+	if (m_textures.empty())
+	{
+		return false;
+	}
+
+	ApplyDemand(packet, viewportHeight);
+	ApplyBudget();
+
+	bool bChanged = false;
+	bool bRequested = false;
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		STREAMED_TEXTURE& streamed = m_textures[i];
+		if (streamed.wantedLevel > streamed.baseLevel)
+		{
+			DropLevels(streamed, streamed.wantedLevel);
+			bChanged = true;
+		}
+		else if (streamed.NeedsDecode())
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_requests.push_back({ i, streamed.wantedLevel, streamed.baseLevel,
+				streamed.generation, streamed.filepath });
+			streamed.bDecoding = true;
+			bRequested = true;
+		}
+	}
+	if (bRequested)
+	{
+		m_condition.notify_one();
+	}
+
+	return UploadDecoded() || bChanged;
+}
+
+/***********************************************************
+ *  IsStreaming()
+ *
+ *  Call from the GL thread. A texture stays decoding until
+ *  its result is uploaded or dropped, which covers the mips
+ *  still waiting for their upload.
+ ***********************************************************/
+bool TextureStreamer::IsStreaming() const
+{
+	return std::any_of(m_textures.begin(), m_textures.end(),
+		[](const STREAMED_TEXTURE& streamed) { return streamed.bDecoding; });
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  Call from the GL thread.
+ ***********************************************************/
+TextureStreamingStats TextureStreamer::GetStats() const
+{
+	TextureStreamingStats stats;
+	for (const STREAMED_TEXTURE& streamed : m_textures)
+	{
+		stats.residentTexels += ChainTexels(streamed.width, streamed.height,
+			streamed.baseLevel, streamed.levelCount);
+		stats.fullTexels += ChainTexels(streamed.width, streamed.height, 0, streamed.levelCount);
+		stats.pendingDecodes += streamed.bDecoding ? 1 : 0;
+	}
+	stats.levelsUploaded = m_levelsUploaded;
+	stats.levelsDropped = m_levelsDropped;
+	return stats;
+}
+
+/***********************************************************
+ *  LevelCount()
+ *
+ *  Number of mips down to 1x1.
+ ***********************************************************/
+uint32_t TextureStreamer::LevelCount(int width, int height)
+{
+	uint32_t count = 1;
+	while ((LevelSize(width, count - 1) > 1) || (LevelSize(height, count - 1) > 1))
+	{
+		count++;
+	}
+	return count;
+}
+
+uint32_t TextureStreamer::ResidentLevel(int width, int height) const
+{
+	const uint32_t levelCount = LevelCount(width, height);
+	uint32_t level = 0;
+	while ((level + 1 < levelCount) &&
+		((static_cast<uint32_t>(LevelSize(width, level)) > m_cfg.residentMipSize) ||
+		(static_cast<uint32_t>(LevelSize(height, level)) > m_cfg.residentMipSize)))
+	{
+		level++;
+	}
+	return level;
+}
+
+uint64_t TextureStreamer::LevelTexels(int width, int height, uint32_t level)
+{
+	return static_cast<uint64_t>(LevelSize(width, level)) * static_cast<uint64_t>(LevelSize(height, level));
+}
+
+uint64_t TextureStreamer::ChainTexels(int width, int height, uint32_t baseLevel, uint32_t levelCount)
+{
+	uint64_t texels = 0;
+	for (uint32_t level = baseLevel; level < levelCount; ++level)
+	{
+		texels += LevelTexels(width, height, level);
+	}
+	return texels;
+}
+
+/***********************************************************
+ *  BuildMipChain()
+ *
+ *  Halves the image with a 2x2 box filter down to the last
+ *  level, keeping the levels from firstLevel on. Odd sizes
+ *  repeat their last row or column.
+ ***********************************************************/
+void TextureStreamer::BuildMipChain(const unsigned char* pixels, int width, int height, int channels,
+	uint32_t firstLevel, uint32_t lastLevel, MIP_CHAIN& chain)
+{
+	chain.width = width;
+	chain.height = height;
+	chain.channels = channels;
+	chain.firstLevel = firstLevel;
+	chain.levels.clear();
+	if (firstLevel >= lastLevel)
+	{
+		return;
+	}
+	chain.levels.resize(lastLevel - firstLevel);
+	if (firstLevel == 0)
+	{
+		chain.levels[0].assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+	}
+
+	std::vector<unsigned char> previous;
+	const unsigned char* source = pixels;
+	int sourceWidth = width;
+	int sourceHeight = height;
+	for (uint32_t level = 1; level < lastLevel; ++level)
+	{
+		const int reducedWidth = std::max(1, sourceWidth / 2);
+		const int reducedHeight = std::max(1, sourceHeight / 2);
+		std::vector<unsigned char> reduced(static_cast<size_t>(reducedWidth) * reducedHeight * channels);
+		for (int y = 0; y < reducedHeight; ++y)
+		{
+			const unsigned char* row0 = source + static_cast<size_t>(std::min(2 * y, sourceHeight - 1)) * sourceWidth * channels;
+			const unsigned char* row1 = source + static_cast<size_t>(std::min(2 * y + 1, sourceHeight - 1)) * sourceWidth * channels;
+			for (int x = 0; x < reducedWidth; ++x)
+			{
+				const int x0 = std::min(2 * x, sourceWidth - 1) * channels;
+				const int x1 = std::min(2 * x + 1, sourceWidth - 1) * channels;
+				unsigned char* out = &reduced[(static_cast<size_t>(y) * reducedWidth + x) * channels];
+				for (int c = 0; c < channels; ++c)
+				{
+					out[c] = static_cast<unsigned char>(
+						(row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+				}
+			}
+		}
+
+		if (level >= firstLevel)
+		{
+			std::vector<unsigned char>& kept = chain.levels[level - firstLevel];
+			kept.swap(reduced);
+			source = kept.data();
+		}
+		else
+		{
+			previous.swap(reduced);
+			source = previous.data();
+		}
+		sourceWidth = reducedWidth;
+		sourceHeight = reducedHeight;
+	}
+}
+
+/***********************************************************
+ *  UploadLevel()
+ *
+ *  Specifies one mip of the bound texture. Rows of the
+ *  small mips are not 4-byte aligned.
+ ***********************************************************/
+void TextureStreamer::UploadLevel(uint32_t level, int width, int height, int channels,
+	const unsigned char* pixels)
+{
+	const GLenum format = PixelFormat(channels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, level, format, LevelSize(width, level), LevelSize(height, level),
+		0, format, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  Sets up the texture for mipmapping and uploads its
+ *  resident mips; the base level starts at the coarsest
+ *  streamed one.
+ ***********************************************************/
+void TextureStreamer::CreateTexture(STREAMED_TEXTURE& streamed, const MIP_CHAIN& coarse)
+{
+	glBindTexture(GL_TEXTURE_2D, streamed.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	for (size_t i = 0; i < coarse.levels.size(); ++i)
+	{
+		UploadLevel(coarse.firstLevel + static_cast<uint32_t>(i), streamed.width, streamed.height,
+			streamed.channels, coarse.levels[i].data());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(streamed.residentLevel));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(streamed.levelCount - 1));
+
+	streamed.Restart();
+}
+
+/***********************************************************
+ *  ApplyDemand()
+ *
+ *  The wanted mip of a texture is the finest one whose size
+ *  still exceeds the number of pixels the texture covers on
+ *  screen. A texture wanting a coarser mip than its base
+ *  keeps the base for dropDelayFrames first, so that finer
+ *  mips do not stream out and back in as the camera turns.
+ ***********************************************************/
+void TextureStreamer::ApplyDemand(const FramePacket& packet, int viewportHeight)
+{
+	for (STREAMED_TEXTURE& streamed : m_textures)
+	{
+		streamed.wantedLevel = streamed.residentLevel;
+	}
+
+	for (const TextureDemand& demand : packet.textureDemand)
+	{
+		const float texels = demand.screenSize * static_cast<float>(viewportHeight);
+		for (STREAMED_TEXTURE& streamed : m_textures)
+		{
+			if ((streamed.texture != demand.textureID) || !(texels > 0.0f))
+			{
+				continue;
+			}
+			const float size = static_cast<float>(std::max(streamed.width, streamed.height));
+			const float level = std::floor(std::log2(std::max(size / texels, 1.0f)));
+			streamed.wantedLevel = std::min(streamed.wantedLevel,
+				static_cast<uint32_t>(std::min(level, static_cast<float>(streamed.residentLevel))));
+		}
+	}
+
+	for (STREAMED_TEXTURE& streamed : m_textures)
+	{
+		if (streamed.wantedLevel <= streamed.baseLevel)
+		{
+			streamed.framesAboveBase = 0;
+		}
+		else if (++streamed.framesAboveBase < m_cfg.dropDelayFrames)
+		{
+			streamed.wantedLevel = streamed.baseLevel;
+		}
+	}
+}
+
+/***********************************************************
+ *  ApplyBudget()
+ *
+ *  Coarsens the wanted mips until all textures fit the
+ *  texel budget, always taking a level from the texture
+ *  whose finest wanted mip is the largest.
+ ***********************************************************/
+void TextureStreamer::ApplyBudget()
+{
+	uint64_t total = 0;
+	for (const STREAMED_TEXTURE& streamed : m_textures)
+	{
+		total += ChainTexels(streamed.width, streamed.height, streamed.wantedLevel, streamed.levelCount);
+	}
+
+	while (total > m_cfg.texelBudget)
+	{
+		STREAMED_TEXTURE* pLargest = nullptr;
+		uint64_t largestTexels = 0;
+		for (STREAMED_TEXTURE& streamed : m_textures)
+		{
+			const uint64_t texels = LevelTexels(streamed.width, streamed.height, streamed.wantedLevel);
+			if ((streamed.wantedLevel < streamed.residentLevel) && (texels > largestTexels))
+			{
+				pLargest = &streamed;
+				largestTexels = texels;
+			}
+		}
+		if (pLargest == nullptr)
+		{
+			break;
+		}
+		pLargest->wantedLevel++;
+		total -= largestTexels;
+	}
+}
+
+/***********************************************************
+ *  DropLevels()
+ *
+ *  Moves the base level to a coarser mip and releases the
+ *  storage of the finer ones. A decode of the texture that
+ *  is queued or in flight was made for the old base level,
+ *  so it is cancelled; the next Update() asks again if the
+ *  finer mips are still wanted.
+ ***********************************************************/
+void TextureStreamer::DropLevels(STREAMED_TEXTURE& streamed, uint32_t baseLevel)
+{
+	CancelRequests(static_cast<size_t>(&streamed - m_textures.data()));
+	glBindTexture(GL_TEXTURE_2D, streamed.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(baseLevel));
+	const GLenum format = PixelFormat(streamed.channels);
+	for (uint32_t level = streamed.baseLevel; level < baseLevel; ++level)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, format, 0, 0, 0, format, GL_UNSIGNED_BYTE, nullptr);
+	}
+	m_levelsDropped += baseLevel - streamed.baseLevel;
+	streamed.Drop(baseLevel);
+}
+
+/***********************************************************
+ *  CancelRequests()
+ *
+ *  Removes the queued decodes of a texture.
+ ***********************************************************/
+void TextureStreamer::CancelRequests(size_t index)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_requests.erase(std::remove_if(m_requests.begin(), m_requests.end(),
+		[index](const DECODE_REQUEST& request) { return request.index == index; }), m_requests.end());
+}
+
+/***********************************************************
+ *  UploadDecoded()
+ *
+ *  Uploads decoded mips, coarsest first and at most
+ *  uploadsPerFrame per call, moving the base level down
+ *  after each so every frame sees a complete chain. Mips
+ *  no longer wanted by the time they arrive are skipped.
+ ***********************************************************/
+bool TextureStreamer::UploadDecoded()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (std::unique_ptr<DECODE_RESULT>& result : m_completed)
+		{
+			m_uploading.push_back(std::move(result));
+		}
+		m_completed.clear();
+	}
+
+	bool bChanged = false;
+	uint32_t uploads = 0;
+	while (!m_uploading.empty() && (uploads < m_cfg.uploadsPerFrame))
+	{
+		DECODE_RESULT& result = *m_uploading.front();
+		STREAMED_TEXTURE& streamed = m_textures[result.index];
+		const MIP_CHAIN& chain = result.chain;
+		const bool bCurrent = (result.generation == streamed.generation);
+		if (bCurrent && result.bFailed)
+		{
+			// the resident mips stay; the file is not read again
+			streamed.bFailed = true;
+			std::cerr << "[TextureStreamer] cannot stream the mips of " << streamed.filepath << "\n";
+			if (g_Db && g_Db->isOpen()) {
+				g_Db->logError("TextureStreamer", "cannot stream the mips of " + streamed.filepath);
+			}
+		}
+
+		const bool bUsable = !result.bFailed && (chain.width == streamed.width) &&
+			(chain.height == streamed.height) && (chain.channels == streamed.channels);
+		uint32_t level = 0;
+		if (bUsable && streamed.NextUpload(result.generation, chain.firstLevel, chain.levels.size(), level))
+		{
+			glBindTexture(GL_TEXTURE_2D, streamed.texture);
+			UploadLevel(level, streamed.width, streamed.height, streamed.channels,
+				chain.levels[level - chain.firstLevel].data());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level));
+			streamed.baseLevel = level;
+			m_levelsUploaded++;
+			uploads++;
+			bChanged = true;
+			continue;
+		}
+
+		if (bCurrent)
+		{
+			streamed.bDecoding = false;
+		}
+		m_uploading.erase(m_uploading.begin());
+	}
+	return bChanged;
+}
+
+/***********************************************************
+ *  LoaderLoop()
+ *
+ *  Body of the loader thread. Decodes the file of each
+ *  request and reduces it to the requested mips.
+ ***********************************************************/
+void TextureStreamer::LoaderLoop()
+{
+	for (;;)
+	{
+		DECODE_REQUEST request;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [&]()
+			{
+				return !m_requests.empty() || !m_bRunning;
+			});
+			if (!m_bRunning)
+			{
+				return;
+			}
+			request = std::move(m_requests.front());
+			m_requests.erase(m_requests.begin());
+		}
+
+		std::unique_ptr<DECODE_RESULT> result = std::make_unique<DECODE_RESULT>();
+		result->index = request.index;
+		result->generation = request.generation;
+		SceneManager::DECODED_IMAGE image;
+		result->bFailed = !SceneManager::DecodeImage(request.filepath.c_str(), image);
+		if (!result->bFailed)
+		{
+			BuildMipChain(image.pixels, image.width, image.height, image.channels,
+				request.level, std::min(request.lastLevel, LevelCount(image.width, image.height)),
+				result->chain);
+			SceneManager::FreeImage(image);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_completed.push_back(std::move(result));
+	}
+}
@@ -0,0 +1,160 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreaming.h
+// ============
+// mip streaming of the scene textures - only the coarse mips are uploaded
+// at load, finer mips are decoded on a loader thread and uploaded when the
+// on-screen size of the textured objects calls for them
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MipResidency.h"
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct FramePacket;
+
+struct TextureStreamingConfig
+{
+	// mips no larger than this on either side are uploaded at load
+	// and always stay resident
+	uint32_t residentMipSize = 128;
+	// texels of all resident mips of all streamed textures
+	uint64_t texelBudget = 8u * 1024u * 1024u;
+	// mip levels uploaded per frame
+	uint32_t uploadsPerFrame = 2;
+	// frames a texture keeps finer mips after it stops needing them
+	uint32_t dropDelayFrames = 120;
+};
+
+struct TextureStreamingStats
+{
+	uint64_t residentTexels = 0;
+	uint64_t fullTexels = 0;
+	uint32_t pendingDecodes = 0;
+	uint64_t levelsUploaded = 0;
+	uint64_t levelsDropped = 0;
+};
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  The resident mips of a texture are always a complete
+ *  chain from GL_TEXTURE_BASE_LEVEL down to 1x1; streaming
+ *  in moves the base level to a finer mip, streaming out
+ *  releases the finer mips and moves it back. The texture
+ *  names never change, so draw commands and packets in
+ *  flight stay valid. Image files carry no mips, so a finer
+ *  level is made by decoding the file again and reducing
+ *  it on the loader thread. All GL calls happen on the
+ *  thread that calls LoadTextures() and Update().
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	TextureStreamer(const TextureStreamingConfig& cfg = TextureStreamingConfig());
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// decode the files, on the job system when given, and create a
+	// texture from the coarse mips of each; 0 for files that failed
+	void LoadTextures(const char* const* filepaths, size_t count, GLuint* textures,
+		JobSystem* pJobSystem);
+
+	// swap in new pixels for a streamed texture, starting again from
+	// its coarse mips; false if the texture is not streamed here
+	bool ReplaceTexture(GLuint texture, unsigned char* pixels, int width, int height, int channels);
+
+	// pick the wanted mip of every texture from the packet's demand,
+	// queue decodes and upload the levels decoded since the last call;
+	// returns true if any texture changed
+	bool Update(const FramePacket& packet, int viewportHeight);
+	// true while finer mips are being decoded or wait to be
+	// uploaded, which only the next Update() does
+	bool IsStreaming() const;
+
+	TextureStreamingStats GetStats() const;
+
+private:
+	// pixels of a run of mips, finest first
+	struct MIP_CHAIN
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		uint32_t firstLevel = 0;
+		std::vector<std::vector<unsigned char>> levels;
+	};
+
+	struct STREAMED_TEXTURE : MipResidency
+	{
+		GLuint texture = 0;
+		std::string filepath;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+	};
+
+	struct DECODE_REQUEST
+	{
+		size_t index;
+		// mips [level, lastLevel) are wanted
+		uint32_t level;
+		uint32_t lastLevel;
+		uint32_t generation;
+		std::string filepath;
+	};
+
+	struct DECODE_RESULT
+	{
+		size_t index;
+		uint32_t generation;
+		bool bFailed;
+		MIP_CHAIN chain;
+	};
+
+	static uint32_t LevelCount(int width, int height);
+	// finest mip within residentMipSize
+	uint32_t ResidentLevel(int width, int height) const;
+	static uint64_t LevelTexels(int width, int height, uint32_t level);
+	static uint64_t ChainTexels(int width, int height, uint32_t baseLevel, uint32_t levelCount);
+	// reduce full-size pixels to levels [firstLevel, lastLevel)
+	static void BuildMipChain(const unsigned char* pixels, int width, int height, int channels,
+		uint32_t firstLevel, uint32_t lastLevel, MIP_CHAIN& chain);
+	static void UploadLevel(uint32_t level, int width, int height, int channels,
+		const unsigned char* pixels);
+
+	void CreateTexture(STREAMED_TEXTURE& streamed, const MIP_CHAIN& coarse);
+	void ApplyDemand(const FramePacket& packet, int viewportHeight);
+	void ApplyBudget();
+	void DropLevels(STREAMED_TEXTURE& streamed, uint32_t baseLevel);
+	// forget the queued decodes of a texture; the one being read
+	// is dropped by its generation
+	void CancelRequests(size_t index);
+	bool UploadDecoded();
+	void LoaderLoop();
+
+	TextureStreamingConfig m_cfg;
+	std::vector<STREAMED_TEXTURE> m_textures;
+	std::vector<std::unique_ptr<DECODE_RESULT>> m_uploading;
+	uint64_t m_levelsUploaded = 0;
+	uint64_t m_levelsDropped = 0;
+
+	std::thread m_loaderThread;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_bRunning = true;
+	std::vector<DECODE_REQUEST> m_requests;
+	std::vector<std::unique_ptr<DECODE_RESULT>> m_completed;
+};
@@ -8,8 +8,10 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
-#include "DBHelper.h"
-  // from MainCode.cpp
+#include "DBHelper.h"  // g_Db from MainCode.cpp
+
+#include <algorithm>
+#include <iostream>
 
 
 // GLM Math Header inclusions
@@ -18,7 +20,48 @@
 #include <glm/gtc/type_ptr.hpp>    
 
 extern std::unique_ptr<DbHelper> g_Db;
+
 // declaration of the global variables and defines
+namespace
+{
+	const char* g_ViewName = "view";
+	const char* g_ProjectionName = "projection";
+
+	// keys that move the camera for as long as they are held
+	struct MOVEMENT_KEY
+	{
+		int key;
+		Camera_Movement direction;
+	};
+	const MOVEMENT_KEY g_MovementKeys[] =
+	{
+		{ GLFW_KEY_W, FORWARD },   // move forward (zoom in)
+		{ GLFW_KEY_S, BACKWARD },  // move backward (zoom out)
+		{ GLFW_KEY_A, LEFT },      // pan left
+		{ GLFW_KEY_D, RIGHT },     // pan right
+		{ GLFW_KEY_Q, UP },        // move upward
+		{ GLFW_KEY_E, DOWN },      // move downward
+	};
+	const int g_MovementKeyCount = sizeof(g_MovementKeys) / sizeof(g_MovementKeys[0]);
+
+	int FindMovementKey(int key)
+	{
+		for (int i = 0; i < g_MovementKeyCount; ++i)
+		{
+			if (g_MovementKeys[i].key == key)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+}
+
+/***********************************************************
+ *  ViewManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
 ViewManager::ViewManager(ShaderManager *pShaderManager, const ViewConfig& cfg)
 {
     m_pShaderManager = pShaderManager;
@@ -33,6 +76,15 @@ ViewManager::ViewManager(ShaderManager *pShaderManager, const ViewConfig& cfg)
 
     m_lastX = static_cast<float>(m_cfg.windowWidth)  / 2.0f;
     m_lastY = static_cast<float>(m_cfg.windowHeight) / 2.0f;
+
+    static_assert(sizeof(g_MovementKeys) / sizeof(g_MovementKeys[0]) == kMovementKeyCount,
+        "movement key table and key state arrays differ in size");
+    for (int i = 0; i < kMovementKeyCount; ++i)
+    {
+        m_keyDown[i] = false;
+        m_keyDownSince[i] = 0.0;
+    }
+    m_frameEvents.reserve(256);
 }
 
 
@@ -57,7 +109,28 @@ ViewManager::~ViewManager()
 GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 {
     GLFWwindow* window = glfwCreateWindow(m_cfg.windowWidth, m_cfg.windowHeight, windowTitle, NULL, NULL);
-    ...
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return NULL;
+    }
+    glfwMakeContextCurrent(window);
+
+    // the static callbacks find this instance through the user pointer
+    glfwSetWindowUserPointer(window, this);
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
+    glfwSetScrollCallback(window, &ViewManager::Scroll_Callback);
+    glfwSetKeyCallback(window, &ViewManager::Key_Callback);
+    glfwSetMouseButtonCallback(window, &ViewManager::Mouse_Button_Callback);
+
+    // enable blending for supporting transparent rendering
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_pWindow = window;
+    return(window);
 }
 
 
@@ -67,115 +140,233 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  *
  *  This method is automatically called from GLFW whenever
  *  the mouse is moved within the active GLFW display window.
+ *  The position is queued and applied by UpdateCamera().
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
-	// when the first mouse move event is received, this needs to be recorded so that
-	// all subsequent mouse moves can correctly calculate the X position offset and Y
-	// position offset for proper operation
-	if (gFirstMouse)
+	ViewManager* self = static_cast<ViewManager*>(glfwGetWindowUserPointer(window));
+	if ((self == NULL) || !self->m_bLiveInput)
 	{
-		gLastX = xMousePos;
-		gLastY = yMousePos;
-		gFirstMouse = false;
+		return;
 	}
 
-	// calculate the X offset and Y offset values for moving the 3D camera accordingly
-	float xOffset = xMousePos - gLastX;
-	float yOffset = gLastY - yMousePos; // reversed since y-coordinates go from bottom to top
-
-	// set the current positions into the last position variables
-	gLastX = xMousePos;
-	gLastY = yMousePos;
-
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	InputEvent event;
+	event.time = glfwGetTime();
+	event.type = InputEventType::MouseMove;
+	event.x = xMousePos;
+	event.y = yMousePos;
+	self->m_inputQueue.Push(event);
 }
 
 /***********************************************************
- *  ProcessKeyboardEvents()
+ *  Key_Callback()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is automatically called from GLFW whenever a
+ *  key is pressed or released. Repeats carry no information
+ *  beyond the held state, so they are not queued.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-	// Close the window if the Escape key is pressed.
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	ViewManager* self = static_cast<ViewManager*>(glfwGetWindowUserPointer(window));
+	if ((self == NULL) || !self->m_bLiveInput || (action == GLFW_REPEAT))
 	{
-		glfwSetWindowShouldClose(m_pWindow, true);
+		return;
 	}
 
+	InputEvent event;
+	event.time = glfwGetTime();
+	event.type = InputEventType::Key;
+	event.key = key;
+	event.action = action;
+	self->m_inputQueue.Push(event);
+}
+
+/***********************************************************
+ *  ProcessInputEvents()
+ *
+ *  This method is called to apply the input events queued
+ *  since the last frame. Movement keys move the camera for
+ *  exactly the part of the frame they were held, using the
+ *  event timestamps rather than the frame boundaries.
+ ***********************************************************/
+void ViewManager::ProcessInputEvents(double frameStart, double frameEnd)
+{
+	m_frameEvents.clear();
+	m_inputQueue.Drain(m_frameEvents);
+
 	// Ensure the camera object is valid.
-	if (g_pCamera == NULL)
+	if (m_camera == NULL)
 	{
 		return;
 	}
 
-	// ----------------------------
-	// Horizontal & Depth Navigation (WASD)
-	// ----------------------------
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	for (const InputEvent& event : m_frameEvents)
 	{
-		// Move forward (zoom in)
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		ApplyInputEvent(event, frameStart);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+
+	// keys that are still held move the camera up to the end of the frame
+	for (int i = 0; i < kMovementKeyCount; ++i)
+	{
+		if (m_keyDown[i])
+		{
+			double start = std::max(m_keyDownSince[i], frameStart);
+			if (frameEnd > start)
+			{
+				m_camera->ProcessKeyboard(g_MovementKeys[i].direction,
+					static_cast<float>(frameEnd - start));
+			}
+			m_keyDownSince[i] = frameEnd;
+		}
+	}
+
+	// persist the camera once it comes to rest rather than every frame
+	if (m_bProfileDirty && !IsInputActive())
 	{
-		// Move backward (zoom out)
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		SaveCameraProfile();
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+}
+
+/***********************************************************
+ *  ApplyInputEvent()
+ *
+ *  This method is called to apply one queued input event.
+ ***********************************************************/
+void ViewManager::ApplyInputEvent(const InputEvent& event, double frameStart)
+{
+	if (event.type == InputEventType::MouseMove)
 	{
-		// Pan left
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		// when the first mouse move event is received, this needs to be recorded so that
+		// all subsequent mouse moves can correctly calculate the X position offset and Y
+		// position offset for proper operation
+		if (m_firstMouse)
+		{
+			m_lastX = static_cast<float>(event.x);
+			m_lastY = static_cast<float>(event.y);
+			m_firstMouse = false;
+		}
+
+		// calculate the X offset and Y offset values for moving the 3D camera accordingly
+		float xOffset = static_cast<float>(event.x) - m_lastX;
+		float yOffset = m_lastY - static_cast<float>(event.y); // reversed since y-coordinates go from bottom to top
+
+		// set the current positions into the last position variables
+		m_lastX = static_cast<float>(event.x);
+		m_lastY = static_cast<float>(event.y);
+
+		// move the 3D camera according to the calculated offsets
+		m_camera->ProcessMouseMovement(xOffset, yOffset);
+		return;
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+
+	if (event.type == InputEventType::MouseButton)
 	{
-		// Pan right
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		// the left button selects the object under the cursor
+		if ((event.key == GLFW_MOUSE_BUTTON_LEFT) && (event.action == GLFW_PRESS))
+		{
+			m_bPickRequested = true;
+		}
+		return;
 	}
 
-	// ----------------------------
-	// Vertical Navigation (QE)
-	// ----------------------------
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
+	if (event.type == InputEventType::Scroll)
 	{
-		// Move upward
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		// Adjust the camera's movement speed based on the scroll input.
+		// The Camera's ProcessMouseScroll() method should modify MovementSpeed.
+		m_camera->ProcessMouseScroll(static_cast<float>(event.y));
+		m_bProfileDirty = true;
+		return;
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
+
+	const bool bPressed = (event.action == GLFW_PRESS);
+	const int movementKey = FindMovementKey(event.key);
+	if (movementKey >= 0)
 	{
-		// Move downward
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		if (bPressed && !m_keyDown[movementKey])
+		{
+			m_keyDown[movementKey] = true;
+			m_keyDownSince[movementKey] = event.time;
+		}
+		else if (!bPressed && m_keyDown[movementKey])
+		{
+			// move for the part of this frame the key was still held
+			double start = std::max(m_keyDownSince[movementKey], frameStart);
+			if (event.time > start)
+			{
+				m_camera->ProcessKeyboard(g_MovementKeys[movementKey].direction,
+					static_cast<float>(event.time - start));
+			}
+			m_keyDown[movementKey] = false;
+			m_bProfileDirty = true;
+		}
+		return;
 	}
 
-	// ----------------------------
-	// Projection Mode Toggle: P for Perspective, O for Orthographic
-	// ----------------------------
-	// Note: To avoid rapid switching from continuous key press, you might later
-	// add a debounce mechanism.
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+	if (!bPressed)
 	{
-		// Set to perspective projection.
-		bOrthographicProjection = false;
+		return;
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+
+	switch (event.key)
 	{
+	case GLFW_KEY_ESCAPE:
+		// Close the window if the Escape key is pressed.
+		if (m_pWindow != NULL)
+		{
+			glfwSetWindowShouldClose(m_pWindow, true);
+		}
+		break;
+	case GLFW_KEY_P:
+		// Set to perspective projection.
+		m_bProfileDirty |= m_isOrtho;
+		m_isOrtho = false;
+		break;
+	case GLFW_KEY_O:
 		// Set to orthographic projection.
-		bOrthographicProjection = true;
+		m_bProfileDirty |= !m_isOrtho;
+		m_isOrtho = true;
+		break;
+	default:
+		break;
 	}
+}
 
-	if (g_Db && g_Db->isOpen()) {
-    const char* proj = (m_bIsOrthoProjection ? "ORTHO" : "PERSPECTIVE");
-    g_Db->saveCameraProfile("default",
-        m_pCamera->Position.x,
-        m_pCamera->Position.y,
-        m_pCamera->Position.z,
-        m_pCamera->Zoom,
-        proj);
+/***********************************************************
+ *  IsInputActive()
+ *
+ *  This method returns true while a movement key is held,
+ *  so the camera keeps changing without further events.
+ ***********************************************************/
+bool ViewManager::IsInputActive() const
+{
+	for (int i = 0; i < kMovementKeyCount; ++i)
+	{
+		if (m_keyDown[i])
+		{
+			return true;
+		}
+	}
+	return false;
 }
 
+/***********************************************************
+ *  SaveCameraProfile()
+ *
+ *  This method is used for storing the camera position,
+ *  zoom and projection in the database.
+ ***********************************************************/
+void ViewManager::SaveCameraProfile()
+{
+	m_bProfileDirty = false;
+	if (g_Db && g_Db->isOpen()) {
+		const char* proj = (m_isOrtho ? "ORTHO" : "PERSPECTIVE");
+		g_Db->saveCameraProfile("default",
+			m_camera->Position.x,
+			m_camera->Position.y,
+			m_camera->Position.z,
+			m_camera->Zoom,
+			proj);
+	}
 }
 
 
@@ -188,64 +379,190 @@ void ViewManager::ProcessKeyboardEvents()
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
-	glm::mat4 view;
-	glm::mat4 projection;
+	ApplyFrameView(UpdateCamera());
+}
+
+/***********************************************************
+ *  UpdateCamera()
+ *
+ *  This method is used for advancing the frame timer,
+ *  processing the keyboard input and capturing the camera
+ *  matrices for this frame. No OpenGL calls are made here.
+ ***********************************************************/
+FrameView ViewManager::UpdateCamera()
+{
+	return UpdateCamera(glfwGetTime());
+}
+
+/***********************************************************
+ *  UpdateCamera()
+ *
+ *  This method is used for advancing the frame timer to the
+ *  passed in time, so that replays can run on a simulated
+ *  clock. No GLFW or OpenGL calls are made here.
+ ***********************************************************/
+FrameView ViewManager::UpdateCamera(double currentTime)
+{
+	FrameView frameView;
 
 	// Update timing information.
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	m_frameStart = m_lastFrame;
+	m_deltaTime = static_cast<float>(currentTime - m_frameStart);
+	m_lastFrame = currentTime;
 
-	// Process keyboard events for camera movement and projection toggling.
-	ProcessKeyboardEvents();
+	// Apply the queued input for camera movement and projection toggling.
+	ProcessInputEvents(m_frameStart, currentTime);
 
 	// Get the current view matrix from the camera.
-	view = g_pCamera->GetViewMatrix();
+	frameView.view = m_camera->GetViewMatrix();
 
 	// Calculate the projection matrix based on the selected projection mode.
-	if (bOrthographicProjection)
+	float aspect = (GLfloat)m_cfg.windowWidth / (GLfloat)m_cfg.windowHeight;
+	if (m_isOrtho)
 	{
 		// For orthographic projection, define the view volume.
 		// Adjust the dimensions (orthoWidth and orthoHeight) to your scene.
-		float aspect = (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT;
 		float orthoHeight = 10.0f;  // For example, 10 units tall.
 		float orthoWidth = orthoHeight * aspect;
 
 		// The near and far planes are set to include the scene.
-		projection = glm::ortho(-orthoWidth / 2.0f, orthoWidth / 2.0f,
+		frameView.projection = glm::ortho(-orthoWidth / 2.0f, orthoWidth / 2.0f,
 			-orthoHeight / 2.0f, orthoHeight / 2.0f,
 			0.1f, 100.0f);
 	}
 	else
 	{
 		// Perspective projection using the camera's Zoom value.
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom),
-			(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT,
+		frameView.projection = glm::perspective(glm::radians(m_camera->Zoom),
+			aspect,
 			0.1f, 100.0f);
 	}
 
-	// Pass the matrices to the shader.
+	frameView.position = m_camera->Position;
+	frameView.bOrthographic = m_isOrtho;
+
+	// the cursor is captured for mouse look, so the object under it
+	// is the one in the middle of the view
+	frameView.bPickRequested = m_bPickRequested;
+	frameView.pickPoint = glm::vec2(0.0f);
+	m_bPickRequested = false;
+	return frameView;
+}
+
+/***********************************************************
+ *  ResetFrameTimer()
+ *
+ *  This method is used after the loop stopped for a while,
+ *  so that held keys do not move the camera by the whole
+ *  paused duration on the next frame.
+ ***********************************************************/
+void ViewManager::ResetFrameTimer()
+{
+	ResetFrameTimer(glfwGetTime());
+}
+
+void ViewManager::ResetFrameTimer(double currentTime)
+{
+	m_lastFrame = currentTime;
+}
+
+/***********************************************************
+ *  GetCameraState()
+ *
+ *  This method is used for capturing the camera so that it
+ *  can be recorded.
+ ***********************************************************/
+CameraState ViewManager::GetCameraState() const
+{
+	CameraState state;
+	state.position = m_camera->Position;
+	state.front = m_camera->Front;
+	state.up = m_camera->Up;
+	state.right = m_camera->Right;
+	state.yaw = m_camera->Yaw;
+	state.pitch = m_camera->Pitch;
+	state.zoom = m_camera->Zoom;
+	state.movementSpeed = m_camera->MovementSpeed;
+	state.bOrthographic = m_isOrtho;
+	return state;
+}
+
+/***********************************************************
+ *  SetCameraState()
+ *
+ *  This method is used for restoring a recorded camera.
+ ***********************************************************/
+void ViewManager::SetCameraState(const CameraState& state)
+{
+	m_camera->Position = state.position;
+	m_camera->Front = state.front;
+	m_camera->Up = state.up;
+	m_camera->Right = state.right;
+	m_camera->Yaw = state.yaw;
+	m_camera->Pitch = state.pitch;
+	m_camera->Zoom = state.zoom;
+	m_camera->MovementSpeed = state.movementSpeed;
+	m_isOrtho = state.bOrthographic;
+}
+
+/***********************************************************
+ *  ApplyFrameView()
+ *
+ *  This method is used for passing the camera matrices of a
+ *  frame into the shader.
+ ***********************************************************/
+void ViewManager::ApplyFrameView(const FrameView& frameView)
+{
 	if (m_pShaderManager != NULL)
 	{
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pShaderManager->setMat4Value(g_ViewName, frameView.view);
+		m_pShaderManager->setMat4Value(g_ProjectionName, frameView.projection);
+		m_pShaderManager->setVec3Value("viewPosition", frameView.position);
 	}
 }
+
+/***********************************************************
+ *  Scroll_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the mouse wheel is scrolled within the display window.
+ *  The offset is queued and applied by UpdateCamera().
+ ***********************************************************/
 void ViewManager::Scroll_Callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-	// Adjust the camera's movement speed based on the scroll input.
-	// The Camera's ProcessMouseScroll() method should modify MovementSpeed.
-	g_pCamera->ProcessMouseScroll((float)yoffset);
+	ViewManager* self = static_cast<ViewManager*>(glfwGetWindowUserPointer(window));
+	if ((self == NULL) || !self->m_bLiveInput)
+	{
+		return;
+	}
 
-	if (g_Db && g_Db->isOpen()) {
-    const char* proj = (m_bIsOrthoProjection ? "ORTHO" : "PERSPECTIVE");
-    g_Db->saveCameraProfile("default",
-        m_pCamera->Position.x,
-        m_pCamera->Position.y,
-        m_pCamera->Position.z,
-        m_pCamera->Zoom,
-        proj);
+	InputEvent event;
+	event.time = glfwGetTime();
+	event.type = InputEventType::Scroll;
+	event.x = xoffset;
+	event.y = yoffset;
+	self->m_inputQueue.Push(event);
 }
 
+/***********************************************************
+ *  Mouse_Button_Callback()
+ *
+ *  This method is automatically called from GLFW whenever a
+ *  mouse button is pressed or released. The event is queued
+ *  and applied by UpdateCamera().
+ ***********************************************************/
+void ViewManager::Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods)
+{
+	ViewManager* self = static_cast<ViewManager*>(glfwGetWindowUserPointer(window));
+	if ((self == NULL) || !self->m_bLiveInput)
+	{
+		return;
+	}
+
+	InputEvent event;
+	event.time = glfwGetTime();
+	event.type = InputEventType::MouseButton;
+	event.key = button;
+	event.action = action;
+	self->m_inputQueue.Push(event);
 }
@@ -11,6 +11,11 @@
 
 #include "ShaderManager.h"
 #include "camera.h"
+#include "RenderTypes.h"
+#include "InputQueue.h"
+
+#include <memory>
+#include <vector>
 
 // GLFW library
 #include "GLFW/glfw3.h" 
@@ -34,10 +39,38 @@ public:
 
     static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
     static void Scroll_Callback(GLFWwindow* window, double xoffset, double yoffset);
+    static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods);
 
     GLFWwindow* CreateDisplayWindow(const char* windowTitle);
     void PrepareSceneView();
 
+    // CPU stage: advance timing, apply input and capture the camera
+    FrameView UpdateCamera();
+    // same, at a caller-supplied time in seconds; replays run on this
+    FrameView UpdateCamera(double currentTime);
+    // GL stage: upload the camera matrices of a frame
+    void ApplyFrameView(const FrameView& frameView);
+    // restart the frame timer so a pause does not become one huge step
+    void ResetFrameTimer();
+    void ResetFrameTimer(double currentTime);
+
+    // true while held keys keep moving the camera
+    bool IsInputActive() const;
+    // the input events applied by the last UpdateCamera()
+    const std::vector<InputEvent>& GetFrameEvents() const { return m_frameEvents; }
+    // the time span covered by the last UpdateCamera()
+    double GetFrameStart() const { return m_frameStart; }
+    double GetFrameEnd() const { return m_lastFrame; }
+
+    // feed an event as if it came from GLFW
+    void QueueInputEvent(const InputEvent& event) { m_inputQueue.Push(event); }
+    // ignore the window's own input, e.g. while replaying a recording
+    void SetLiveInput(bool bEnabled) { m_bLiveInput = bEnabled; }
+
+    CameraState GetCameraState() const;
+    void SetCameraState(const CameraState& state);
+
 private:
     ShaderManager* m_pShaderManager = nullptr;
     GLFWwindow*    m_pWindow        = nullptr;
@@ -49,8 +82,25 @@ private:
     float m_lastY;
     bool  m_firstMouse = true;
     float m_deltaTime  = 0.0f;
-    float m_lastFrame  = 0.0f;
+    double m_lastFrame = 0.0;
+    double m_frameStart = 0.0;
     bool  m_isOrtho    = false;
 
-    void ProcessKeyboardEvents();
+    // input pushed by the GLFW callbacks, drained once per frame
+    InputQueue m_inputQueue;
+    std::vector<InputEvent> m_frameEvents;
+    // held state of the movement keys and when each was last applied
+    static const int kMovementKeyCount = 6;
+    bool   m_keyDown[kMovementKeyCount];
+    double m_keyDownSince[kMovementKeyCount];
+    // the camera profile changed since it was last saved
+    bool   m_bProfileDirty = false;
+    // callbacks only queue events while live input is enabled
+    bool   m_bLiveInput = true;
+    // a click asked for an object pick in the next frame view
+    bool   m_bPickRequested = false;
+
+    void ProcessInputEvents(double frameStart, double frameEnd);
+    void ApplyInputEvent(const InputEvent& event, double frameStart);
+    void SaveCameraProfile();
 };
@@ -0,0 +1,218 @@
+///////////////////////////////////////////////////////////////////////////////
+// virtualfilesystem.cpp
+// ============
+// one place for the loaders to read assets from - mounted asset packages
+// first, newest mount winning, then loose files on disk
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VirtualFileSystem.h"
+#include "AssetPackage.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+// declaration of global variables
+namespace
+{
+	// in mount order; searched from the back
+	std::vector<std::unique_ptr<AssetPackage>> g_Packages;
+
+	bool ReadLooseFile(const std::string& path, std::vector<uint8_t>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()),
+			static_cast<std::streamsize>(data.size())));
+	}
+}
+
+/***********************************************************
+ *  AssetStream()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetStream::AssetStream(const AssetBlob& blob) :
+	std::istream(nullptr),
+	m_buffer(blob.GetData(), blob.GetSize())
+{
+	rdbuf(&m_buffer);
+}
+
+AssetStream::BUFFER::BUFFER(const uint8_t* data, size_t size)
+{
+	// the get area is never written through
+	char* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+	setg(begin, begin, begin + size);
+}
+
+std::streambuf::pos_type AssetStream::BUFFER::seekoff(off_type offset, std::ios_base::seekdir direction,
+	std::ios_base::openmode which)
+{
+	if ((which & std::ios_base::in) == 0)
+	{
+		return pos_type(off_type(-1));
+	}
+
+	off_type base = 0;
+	if (direction == std::ios_base::cur)
+	{
+		base = gptr() - eback();
+	}
+	else if (direction == std::ios_base::end)
+	{
+		base = egptr() - eback();
+	}
+	const off_type position = base + offset;
+	if ((position < 0) || (position > egptr() - eback()))
+	{
+		return pos_type(off_type(-1));
+	}
+	setg(eback(), eback() + position, egptr());
+	return pos_type(position);
+}
+
+std::streambuf::pos_type AssetStream::BUFFER::seekpos(pos_type position, std::ios_base::openmode which)
+{
+	return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+/***********************************************************
+ *  MountPackage()
+ *
+ *  Maps a package; its entries shadow loose files and
+ *  packages mounted before it.
+ ***********************************************************/
+bool VirtualFileSystem::MountPackage(const std::string& path)
+{
+	std::unique_ptr<AssetPackage> package = std::make_unique<AssetPackage>();
+	if (!package->Open(path))
+	{
+		return false;
+	}
+	std::cout << "[VirtualFileSystem] mounted " << path << " with "
+		<< package->GetEntryCount() << " assets\n";
+	g_Packages.push_back(std::move(package));
+	return true;
+}
+
+/***********************************************************
+ *  UnmountAll()
+ *
+ *  Unmaps every package. Mapped blobs read before this are
+ *  no longer valid.
+ ***********************************************************/
+void VirtualFileSystem::UnmountAll()
+{
+	g_Packages.clear();
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  Reads an asset from the newest package holding it, or
+ *  from disk.
+ ***********************************************************/
+bool VirtualFileSystem::Read(const std::string& path, AssetBlob& blob)
+{
+	if (ReadPackaged(path, blob))
+	{
+		return true;
+	}
+
+	if (!ReadLooseFile(path, blob.m_storage))
+	{
+		blob = AssetBlob();
+		return false;
+	}
+	blob.m_pData = blob.m_storage.data();
+	blob.m_size = blob.m_storage.size();
+	return true;
+}
+
+/***********************************************************
+ *  ReadPackaged()
+ *
+ *  Like Read(), without the fallback to loose files.
+ ***********************************************************/
+bool VirtualFileSystem::ReadPackaged(const std::string& path, AssetBlob& blob)
+{
+	blob = AssetBlob();
+	if (g_Packages.empty())
+	{
+		return false;
+	}
+
+	const std::string name = NormalizePath(path);
+	for (auto package = g_Packages.rbegin(); package != g_Packages.rend(); ++package)
+	{
+		const AssetPackage::ENTRY* pEntry = (*package)->Find(name);
+		if (pEntry == nullptr)
+		{
+			continue;
+		}
+		if ((pEntry->flags & AssetPackage::kCompressed) == 0)
+		{
+			blob.m_pData = (*package)->GetStoredData(*pEntry);
+		}
+		else
+		{
+			if (!(*package)->Extract(*pEntry, blob.m_storage))
+			{
+				return false;
+			}
+			blob.m_pData = blob.m_storage.data();
+		}
+		blob.m_size = static_cast<size_t>(pEntry->size);
+		return true;
+	}
+	return false;
+}
+
+/***********************************************************
+ *  Exists()
+ *
+ *  True if a package or the disk has the asset.
+ ***********************************************************/
+bool VirtualFileSystem::Exists(const std::string& path)
+{
+	const std::string name = NormalizePath(path);
+	for (const std::unique_ptr<AssetPackage>& package : g_Packages)
+	{
+		if (package->Find(name) != nullptr)
+		{
+			return true;
+		}
+	}
+	std::error_code error;
+	return std::filesystem::is_regular_file(path, error);
+}
+
+/***********************************************************
+ *  NormalizePath()
+ *
+ *  The name a path is packed and looked up under.
+ ***********************************************************/
+std::string VirtualFileSystem::NormalizePath(const std::string& path)
+{
+	std::string slashes = path;
+	for (char& c : slashes)
+	{
+		if (c == '\\')
+		{
+			c = '/';
+		}
+	}
+	std::string name = std::filesystem::path(slashes).lexically_normal().generic_string();
+	while (name.compare(0, 2, "./") == 0)
+	{
+		name.erase(0, 2);
+	}
+	return name;
+}
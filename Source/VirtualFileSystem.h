@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// virtualfilesystem.h
+// ============
+// one place for the loaders to read assets from - mounted asset packages
+// first, newest mount winning, then loose files on disk
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  AssetBlob
+ *
+ *  The bytes of one asset. Stored package entries point
+ *  straight into the mapping; compressed entries and loose
+ *  files own a copy.
+ ***********************************************************/
+class AssetBlob
+{
+public:
+	const uint8_t* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+	bool IsMapped() const { return m_storage.empty() && (m_pData != nullptr); }
+
+private:
+	friend class VirtualFileSystem;
+
+	const uint8_t* m_pData = nullptr;
+	size_t m_size = 0;
+	std::vector<uint8_t> m_storage;
+};
+
+/***********************************************************
+ *  AssetStream
+ *
+ *  A seekable std::istream over a blob, for loaders written
+ *  against streams. The blob must outlive the stream.
+ ***********************************************************/
+class AssetStream : public std::istream
+{
+public:
+	explicit AssetStream(const AssetBlob& blob);
+
+private:
+	class BUFFER : public std::streambuf
+	{
+	public:
+		BUFFER(const uint8_t* data, size_t size);
+
+	protected:
+		pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+			std::ios_base::openmode which) override;
+		pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+	};
+
+	BUFFER m_buffer;
+};
+
+/***********************************************************
+ *  VirtualFileSystem
+ *
+ *  Paths are normalized before lookup: backslashes become
+ *  slashes and "." and ".." are folded, so "./textures\\a"
+ *  and "textures/a" name the same asset. Packages are
+ *  mounted at startup, before any loader runs, and stay
+ *  mounted until UnmountAll().
+ ***********************************************************/
+class VirtualFileSystem
+{
+public:
+	static bool MountPackage(const std::string& path);
+	static void UnmountAll();
+
+	// package entry, or the loose file if no package has it
+	static bool Read(const std::string& path, AssetBlob& blob);
+	// package entries only, for loaders that keep streaming loose
+	// files from disk rather than reading them whole
+	static bool ReadPackaged(const std::string& path, AssetBlob& blob);
+	static bool Exists(const std::string& path);
+
+	static std::string NormalizePath(const std::string& path);
+};
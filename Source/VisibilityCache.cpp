@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// visibilitycache.cpp
+// ============
+// temporal coherence of visibility - the draws culled for one camera pose are
+// reused by the following frames while the camera stays close to that pose
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VisibilityCache.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// a row of the rotation in a view matrix; rows 1 and 2 are the
+	// camera's up and backward directions
+	glm::vec3 ViewAxis(const glm::mat4& view, int row)
+	{
+		return glm::vec3(view[0][row], view[1][row], view[2][row]);
+	}
+}
+
+/***********************************************************
+ *  VisibilityCache()
+ *
+ *  The constructor starts with nothing cached, so the first
+ *  frame always culls.
+ ***********************************************************/
+VisibilityCache::VisibilityCache(const VisibilityCacheConfig& config) :
+	m_minTurnCosine(1.0f),
+	m_bValid(false),
+	m_objectVersion(0),
+	m_culledObjects(0),
+	m_occludedObjects(0),
+	m_occluders(0)
+{
+	SetConfig(config);
+}
+
+/***********************************************************
+ *  SetConfig()
+ *
+ *  This method is used for changing the pose thresholds. The
+ *  cached draws are dropped, as they may have been kept under
+ *  looser ones.
+ ***********************************************************/
+void VisibilityCache::SetConfig(const VisibilityCacheConfig& config)
+{
+	m_config = config;
+	m_minTurnCosine = std::cos(glm::radians(config.maxTurnDegrees));
+	m_bValid = false;
+}
+
+/***********************************************************
+ *  IsNearPose()
+ *
+ *  This method is used for comparing a view against the one
+ *  the cached draws were culled for. The projection must not
+ *  have changed at all, as zooming or resizing moves every
+ *  object on screen.
+ ***********************************************************/
+bool VisibilityCache::IsNearPose(const FrameView& view) const
+{
+	if ((view.bOrthographic != m_view.bOrthographic) ||
+		(view.projection != m_view.projection))
+	{
+		return false;
+	}
+
+	const glm::vec3 move = view.position - m_view.position;
+	if (glm::dot(move, move) > m_config.maxMove * m_config.maxMove)
+	{
+		return false;
+	}
+	return (glm::dot(ViewAxis(view.view, 1), ViewAxis(m_view.view, 1)) >= m_minTurnCosine) &&
+		(glm::dot(ViewAxis(view.view, 2), ViewAxis(m_view.view, 2)) >= m_minTurnCosine);
+}
+
+/***********************************************************
+ *  Reuse()
+ *
+ *  This method is used for filling a packet with the cached
+ *  draws when the scene objects are the ones they were culled
+ *  from and the view is near the cached pose.
+ ***********************************************************/
+bool VisibilityCache::Reuse(const FrameView& view, uint32_t objectVersion, FramePacket& packet)
+{
+	if (!m_bValid || (objectVersion != m_objectVersion) || !IsNearPose(view))
+	{
+		return false;
+	}
+
+	packet.commands.assign(m_commands.begin(), m_commands.end());
+	packet.culledObjects = m_culledObjects;
+	packet.occludedObjects = m_occludedObjects;
+	packet.occluders = m_occluders;
+	m_stats.reusedFrames++;
+	return true;
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for keeping the draws of a freshly
+ *  culled packet for the frames that follow. The command
+ *  vector keeps its memory, so storing allocates nothing
+ *  once it has grown to the largest visible set.
+ ***********************************************************/
+void VisibilityCache::Store(const FrameView& view, uint32_t objectVersion, const FramePacket& packet)
+{
+	m_view = view;
+	m_objectVersion = objectVersion;
+	m_commands.assign(packet.commands.begin(), packet.commands.end());
+	m_culledObjects = packet.culledObjects;
+	m_occludedObjects = packet.occludedObjects;
+	m_occluders = packet.occluders;
+	m_bValid = true;
+	m_stats.culledFrames++;
+}
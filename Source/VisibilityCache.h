@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// visibilitycache.h
+// ============
+// temporal coherence of visibility - the draws culled for one camera pose are
+// reused by the following frames while the camera stays close to that pose
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FramePipeline.h"
+#include "RenderTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+struct VisibilityCacheConfig
+{
+	// farthest the camera may move from the pose the draws were culled
+	// for, in world units, before the scene is culled again
+	float maxMove = 0.01f;
+	// largest turn of the camera from that pose, in degrees
+	float maxTurnDegrees = 0.05f;
+};
+
+struct VisibilityCacheStats
+{
+	uint64_t reusedFrames = 0;
+	uint64_t culledFrames = 0;
+};
+
+/***********************************************************
+ *  VisibilityCache
+ *
+ *  Keeps the culled draws of the last frame that ran the
+ *  visibility tests, with the view they were made for. The
+ *  pose delta is measured from that view rather than from
+ *  the previous frame, so a slowly moving camera cannot drift
+ *  further than the thresholds before the scene is culled
+ *  again. Any change of projection or of the scene objects
+ *  culls again too; the draws of a reused frame keep the
+ *  order they were sorted in.
+ ***********************************************************/
+class VisibilityCache
+{
+public:
+	explicit VisibilityCache(const VisibilityCacheConfig& config = VisibilityCacheConfig());
+
+	void SetConfig(const VisibilityCacheConfig& config);
+	const VisibilityCacheConfig& GetConfig() const { return m_config; }
+
+	// copy the cached draws and cull counts into the packet if the view
+	// is close enough to the cached one; returns false if the scene
+	// must be culled for this view
+	bool Reuse(const FrameView& view, uint32_t objectVersion, FramePacket& packet);
+	// keep the draws of a packet just culled for the view
+	void Store(const FrameView& view, uint32_t objectVersion, const FramePacket& packet);
+	// forget the cached draws, such as when the culling settings change
+	void Invalidate() { m_bValid = false; }
+
+	VisibilityCacheStats GetStats() const { return m_stats; }
+
+private:
+	bool IsNearPose(const FrameView& view) const;
+
+	VisibilityCacheConfig m_config;
+	float m_minTurnCosine;
+	bool m_bValid;
+	FrameView m_view;
+	uint32_t m_objectVersion;
+	std::vector<RenderCommand> m_commands;
+	uint32_t m_culledObjects;
+	uint32_t m_occludedObjects;
+	uint32_t m_occluders;
+	VisibilityCacheStats m_stats;
+};
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// packassets.cpp
+// ============
+// command line front end for asset packages - packs files and folders into
+// one memory-mapped .pak for the renderer's --package option, or lists one
+//
+//  usage: PackAssets <output.pak> <file|folder>... [--root DIR] [--align N]
+//         [--store]
+//         PackAssets --list <package.pak>
+//
+// entries are named by their path relative to --root (the current folder
+// by default), which is the path the renderer loads them by
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPackage.h"
+#include "VirtualFileSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+// declaration of global variables
+namespace
+{
+	int ListPackage(const char* path)
+	{
+		AssetPackage package;
+		if (!package.Open(path))
+		{
+			return EXIT_FAILURE;
+		}
+
+		uint64_t size = 0;
+		uint64_t storedSize = 0;
+		for (uint32_t i = 0; i < package.GetEntryCount(); ++i)
+		{
+			const AssetPackage::ENTRY& entry = package.GetEntry(i);
+			std::printf("%12llu %12llu %s %s\n", static_cast<unsigned long long>(entry.size),
+				static_cast<unsigned long long>(entry.storedSize),
+				((entry.flags & AssetPackage::kCompressed) != 0) ? "lz" : "--",
+				package.GetName(entry).c_str());
+			size += entry.size;
+			storedSize += entry.storedSize;
+		}
+		std::printf("%u assets, %llu bytes stored as %llu\n", package.GetEntryCount(),
+			static_cast<unsigned long long>(size), static_cast<unsigned long long>(storedSize));
+		return EXIT_SUCCESS;
+	}
+
+	bool AddFile(const std::filesystem::path& path, const std::filesystem::path& root,
+		std::vector<AssetPackage::SOURCE_FILE>& files)
+	{
+		const std::filesystem::path relative = path.lexically_relative(root);
+		if (relative.empty() || (*relative.begin() == ".."))
+		{
+			std::fprintf(stderr, "%s is outside the root folder %s\n",
+				path.string().c_str(), root.string().c_str());
+			return false;
+		}
+
+		AssetPackage::SOURCE_FILE file;
+		file.name = VirtualFileSystem::NormalizePath(relative.generic_string());
+		file.path = path.string();
+		files.push_back(file);
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if ((argc == 3) && (std::strcmp(argv[1], "--list") == 0))
+	{
+		return ListPackage(argv[2]);
+	}
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "usage: PackAssets <output.pak> <file|folder>... [options]\n"
+			"       PackAssets --list <package.pak>\n");
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::string> inputs;
+	std::filesystem::path root = ".";
+	uint32_t alignment = AssetPackage::kDefaultAlignment;
+	bool bCompress = true;
+	for (int i = 2; i < argc; ++i)
+	{
+		if ((std::strcmp(argv[i], "--root") == 0) && (i + 1 < argc))
+		{
+			root = argv[++i];
+		}
+		else if ((std::strcmp(argv[i], "--align") == 0) && (i + 1 < argc))
+		{
+			alignment = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--store") == 0)
+		{
+			bCompress = false;
+		}
+		else
+		{
+			inputs.push_back(argv[i]);
+		}
+	}
+
+	std::error_code error;
+	root = std::filesystem::absolute(root, error).lexically_normal();
+	std::vector<AssetPackage::SOURCE_FILE> files;
+	for (const std::string& input : inputs)
+	{
+		const std::filesystem::path path = std::filesystem::absolute(input, error).lexically_normal();
+		if (std::filesystem::is_directory(path, error))
+		{
+			for (const auto& item : std::filesystem::recursive_directory_iterator(path, error))
+			{
+				if (item.is_regular_file() && !AddFile(item.path(), root, files))
+				{
+					return EXIT_FAILURE;
+				}
+			}
+		}
+		else if (!std::filesystem::is_regular_file(path, error) || !AddFile(path, root, files))
+		{
+			std::fprintf(stderr, "cannot pack %s\n", input.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	// folder order is up to the file system; keep the output reproducible
+	std::sort(files.begin(), files.end(), [](const AssetPackage::SOURCE_FILE& a,
+		const AssetPackage::SOURCE_FILE& b) { return a.name < b.name; });
+	if (!AssetPackage::Write(argv[1], files, alignment, bCompress))
+	{
+		return EXIT_FAILURE;
+	}
+	std::printf("packed %zu assets into %s\n", files.size(), argv[1]);
+	return EXIT_SUCCESS;
+}
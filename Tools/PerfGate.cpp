@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfgate.cpp
+// ============
+// performance regression gate - compares a candidate run against a baseline
+// and exits non-zero when any benchmark slowed down significantly
+//
+//  usage: PerfGate <baseline.json> <candidate.json> [--alpha A]
+//         [--threshold PERCENT] [--min-samples N] [--metric cpu|real]
+//         [--db path] [--no-db]
+//
+// both files are EngineBenchmarks output (run with --benchmark_repetitions
+// so each benchmark has several samples) or --timings JSON from a replay or
+// flythrough. Results are added to the perf_comparisons table of the
+// database. Exit codes: 0 no regression, 1 regression, 2 bad input
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PerfCompare.h"
+#include "DBHelper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+// declaration of global variables
+namespace
+{
+	const int g_ExitRegression = 1;
+	const int g_ExitBadInput = 2;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "usage: PerfGate <baseline.json> <candidate.json> [options]\n");
+		return g_ExitBadInput;
+	}
+
+	const char* baselinePath = argv[1];
+	const char* candidatePath = argv[2];
+	PerfGateConfig cfg;
+	TimingMetric metric = TimingMetric::Cpu;
+	const char* dbPath = "app.db";
+
+	for (int i = 3; i < argc; ++i)
+	{
+		const char* option = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if (std::strcmp(option, "--no-db") == 0)
+		{
+			dbPath = nullptr;
+			continue;
+		}
+		if (value == nullptr)
+		{
+			std::fprintf(stderr, "%s needs a value\n", option);
+			return g_ExitBadInput;
+		}
+		i++;
+
+		if (std::strcmp(option, "--alpha") == 0)
+		{
+			cfg.alpha = std::atof(value);
+		}
+		else if (std::strcmp(option, "--threshold") == 0)
+		{
+			cfg.thresholdPercent = std::atof(value);
+		}
+		else if (std::strcmp(option, "--min-samples") == 0)
+		{
+			cfg.minSamples = static_cast<size_t>(std::strtoul(value, nullptr, 10));
+		}
+		else if (std::strcmp(option, "--metric") == 0)
+		{
+			if (std::strcmp(value, "cpu") == 0)
+				metric = TimingMetric::Cpu;
+			else if (std::strcmp(value, "real") == 0)
+				metric = TimingMetric::Real;
+			else
+			{
+				std::fprintf(stderr, "--metric must be cpu or real\n");
+				return g_ExitBadInput;
+			}
+		}
+		else if (std::strcmp(option, "--db") == 0)
+		{
+			dbPath = value;
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", option);
+			return g_ExitBadInput;
+		}
+	}
+
+	if ((cfg.alpha <= 0.0) || (cfg.alpha >= 1.0) || (cfg.thresholdPercent < 0.0))
+	{
+		std::fprintf(stderr, "--alpha must be in (0, 1) and --threshold at least 0\n");
+		return g_ExitBadInput;
+	}
+
+	TimingSamples baseline;
+	TimingSamples candidate;
+	if (!LoadTimingSamples(baselinePath, metric, baseline) ||
+		!LoadTimingSamples(candidatePath, metric, candidate))
+	{
+		return g_ExitBadInput;
+	}
+
+	const std::vector<PerfComparison> comparisons = ComparePerformance(baseline, candidate, cfg);
+	if (comparisons.empty())
+	{
+		std::fprintf(stderr, "the two runs have no benchmark in common\n");
+		return g_ExitBadInput;
+	}
+
+	std::unique_ptr<DbHelper> db;
+	if (dbPath != nullptr)
+	{
+		db = std::make_unique<DbHelper>(dbPath);
+	}
+
+	std::printf("%-48s %6s %12s %12s %8s %9s  %s\n", "benchmark", "n", "baseline ms",
+		"candidate ms", "change", "p", "result");
+
+	int regressions = 0;
+	int untested = 0;
+	for (const PerfComparison& c : comparisons)
+	{
+		const char* result = "ok";
+		if (!c.bTested)
+		{
+			result = "too few samples";
+			untested++;
+		}
+		else if (c.bRegression)
+		{
+			result = "REGRESSION";
+			regressions++;
+		}
+
+		std::printf("%-48s %3zu/%-3zu %12.6f %12.6f %+7.1f%% %9.2g  %s\n", c.name.c_str(),
+			c.baselineCount, c.candidateCount, c.baselineMedianMs, c.candidateMedianMs,
+			(c.ratio - 1.0) * 100.0, c.pValue, result);
+
+		if (db && db->isOpen())
+		{
+			db->logPerfComparison(c.name, baselinePath, candidatePath, c.baselineMedianMs,
+				c.candidateMedianMs, c.ratio, c.pValue, c.bRegression);
+		}
+	}
+
+	for (const auto& entry : baseline)
+	{
+		if (candidate.find(entry.first) == candidate.end())
+		{
+			std::printf("%-48s missing from the candidate\n", entry.first.c_str());
+		}
+	}
+
+	std::printf("\n%zu compared, %d regressed, %d untested (alpha %.3g, threshold %.1f%%)\n",
+		comparisons.size(), regressions, untested, cfg.alpha, cfg.thresholdPercent);
+	return (regressions > 0) ? g_ExitRegression : EXIT_SUCCESS;
+}
@@ -0,0 +1,18 @@
+#version 330 core
+out vec4 fragmentColor;
+
+in vec2 fragmentTextureCoordinate;
+
+// the group rendered from every direction of the octahedral grid,
+// already lit; transparent around the objects
+uniform sampler2D impostorTexture;
+
+void main()
+{
+   vec4 color = texture(impostorTexture, fragmentTextureCoordinate);
+   if (color.a < 0.5)
+   {
+      discard;
+   }
+   fragmentColor = vec4(color.rgb, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+out vec2 fragmentTextureCoordinate;
+
+uniform mat4 view;
+uniform mat4 projection;
+// the quad is centered on the group, spanning center -/+ right and up
+uniform vec3 center;
+uniform vec3 right;
+uniform vec3 up;
+// atlas cell of the view the quad faces: offset, then size
+uniform vec4 uvRect;
+
+void main()
+{
+   // a four vertex strip, no vertex buffer needed
+   vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+   vec3 position = center + right * (corner.x * 2.0 - 1.0) + up * (corner.y * 2.0 - 1.0);
+   fragmentTextureCoordinate = uvRect.xy + corner * uvRect.zw;
+   gl_Position = projection * view * vec4(position, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+out uint fragmentObjectId;
+
+// ID of the object being drawn; 0 is left for the background
+uniform uint objectId;
+
+void main()
+{
+   fragmentObjectId = objectId;
+}
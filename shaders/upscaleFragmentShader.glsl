@@ -0,0 +1,30 @@
+#version 330 core
+out vec4 fragmentColor;
+
+in vec2 fragmentTextureCoordinate;
+
+uniform sampler2D sceneTexture;
+// size of one source texel in texture coordinates
+uniform vec2 texelSize;
+// 0 = plain bilinear upscale, 1 = strongest sharpening
+uniform float sharpness;
+
+void main()
+{
+   vec2 uv = fragmentTextureCoordinate;
+   vec3 center = texture(sceneTexture, uv).rgb;
+   vec3 north = texture(sceneTexture, uv + vec2(0.0, texelSize.y)).rgb;
+   vec3 south = texture(sceneTexture, uv - vec2(0.0, texelSize.y)).rgb;
+   vec3 east = texture(sceneTexture, uv + vec2(texelSize.x, 0.0)).rgb;
+   vec3 west = texture(sceneTexture, uv - vec2(texelSize.x, 0.0)).rgb;
+
+   // contrast adaptive sharpening: sharpen less where the local
+   // contrast is already high so edges do not ring
+   vec3 minimum = min(center, min(min(north, south), min(east, west)));
+   vec3 maximum = max(center, max(max(north, south), max(east, west)));
+   vec3 amplitude = sqrt(clamp(min(minimum, 1.0 - maximum) / max(maximum, 1e-4), 0.0, 1.0));
+   vec3 weight = -amplitude * mix(0.125, 0.2, sharpness);
+
+   vec3 color = (center + (north + south + east + west) * weight) / (1.0 + 4.0 * weight);
+   fragmentColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+out vec2 fragmentTextureCoordinate;
+
+// portion of the scene texture covered by the rendered image
+uniform vec2 uvScale;
+
+void main()
+{
+   // one triangle covering the whole screen, no vertex buffer needed
+   vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   fragmentTextureCoordinate = position * uvScale;
+   gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}